@@ -0,0 +1,51 @@
+// Checks that lexing and parsing stay off the heap once warm: every source named on the command line is lexed and parsed
+// twice, the second time into the token buffer, constant pool and parser of the first, and the second time has to make
+// no heap allocation at all, in the Lexer, in Parser::reset or in any statement. Sources the lexer or parser rejects
+// are skipped. Exits 1 if anything allocated once warm, and 2 if allocation counting isn't compiled in, rather than
+// passing without having counted anything.
+//
+// fuzz/check_allocations.sh builds it with -DPA_COUNT_ALLOCATIONS and runs it on assets/ and a generated corpus, or by hand:
+//   g++ -std=c++23 -O2 -pthread -DPA_COUNT_ALLOCATIONS -Iinternal/... internal/*/*.cpp fuzz/check_allocations.cpp
+//   ./a.out assets/*.txt
+
+#include <format>
+#include <iostream>
+#include "alloc_counter.h"
+#include "io.h"
+#include "line_index.h"
+
+int main(int argc, char* argv[]) {
+        if (!pa::alloc::Counting) {
+                std::cout << "Allocation counting isn't compiled in, build with -DPA_COUNT_ALLOCATIONS\n";
+                return 2;
+        }
+        
+        int checked = 0;
+        int skipped = 0;
+        int failed = 0;
+        for (int i = 1; i < argc; i++) {
+                std::string src = pa::io::readFile(argv[i]);
+                pa::alloc::Pass warm;
+                try {
+                        warm = pa::alloc::measureLexAndParse(src).warm;
+                } catch (const pa::CompileError&) {
+                        skipped++;
+                        continue;
+                }
+                
+                checked++;
+                if (!warm.allocated())
+                        continue;
+                failed++;
+                std::cout << std::format("{}: allocated once warm, lexing {} ({} bytes), resetting {} ({} bytes), parsing {} ({} bytes)\n", argv[i],
+                                         warm.lexing.allocations, warm.lexing.bytes, warm.resetting.allocations, warm.resetting.bytes,
+                                         warm.parsing.allocations, warm.parsing.bytes);
+                if (!warm.allocating_statements.empty()) {
+                        pa::LineIndex::Location location = pa::LineIndex(src).locate(warm.allocating_statements.front().first);
+                        std::cout << std::format("  first allocating statement at {}:{}\n", location.line, location.column);
+                }
+        }
+        
+        std::cout << std::format("{} sources checked, {} rejected and skipped, {} allocating once warm\n", checked, skipped, failed);
+        return failed == 0 ? 0 : 1;
+}
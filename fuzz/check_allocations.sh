@@ -0,0 +1,16 @@
+#!/usr/bin/env bash
+# Builds check_allocations.cpp with allocation counting compiled in and runs it on assets/ and on a corpus from
+# gen_arrays.py, failing if a warm lex or parse allocates. Extra compiler flags can be passed in CXXFLAGS.
+#
+# Usage: fuzz/check_allocations.sh [build directory]
+
+set -eu
+repo=$(dirname "$(dirname "$(realpath "$0")")")
+build=${1:-$repo/build/alloc}
+mkdir -p "$build"
+
+cd "$repo"
+g++ -std=c++23 -O2 -pthread -DPA_COUNT_ALLOCATIONS ${CXXFLAGS:-} $(for module in internal/*/; do echo "-I$module"; done) \
+    internal/*/*.cpp fuzz/check_allocations.cpp -o "$build/check_allocations"
+python3 fuzz/gen_arrays.py "$build/corpus"
+"$build/check_allocations" assets/*.txt "$build"/corpus/*.txt
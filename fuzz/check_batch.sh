@@ -0,0 +1,69 @@
+#!/usr/bin/env bash
+# Compares --batch with one --run per record on programs written by gen_records.py: all the records are fed to a single
+# --batch run, and what it prints has to match the --run outputs one after another. Programs the checker rejects, or
+# that don't run in batches, are skipped. Exits 1 if any program differs.
+#
+# Usage: fuzz/check_batch.sh <pa binary> <directory> [program count] [records per program] [--chunked]
+# Generates seeds 1 to <program count> (300 by default) into <directory>. The default record count is random, from 0
+# to 40; give 9000 or so to have a program span several batches. --chunked feeds the batch input through a pipe a few
+# bytes at a time, so records arrive split across reads.
+
+set -u
+pa=$(realpath "$1")
+directory=$2
+count=${3:-300}
+records=${4:-}
+chunked=${5:-}
+generator=$(dirname "$(realpath "$0")")/gen_records.py
+mkdir -p "$directory"
+cd "$directory" || exit 2
+
+feed() {
+        if [ "$chunked" == "--chunked" ]; then
+                python3 -c '
+import os, sys, time
+data = open(sys.argv[1], "rb").read()
+for i in range(0, len(data), 7):
+        os.write(1, data[i:i + 7])
+        time.sleep(0.0001)' "$1"
+        else
+                cat "$1"
+        fi
+}
+
+ok=0; differ=0; skip=0
+for seed in $(seq 1 "$count"); do
+        python3 "$generator" "$seed" . $records
+        program=p$seed.txt
+        out=$("$pa" --batch "$program" </dev/null 2>&1 | head -2 | tr -d "\0")
+        if ! grep -q "Parsed Successfully" <<< "$out" || grep -q "Not running" <<< "$out"; then skip=$((skip + 1)); continue; fi
+        
+        # One input file per record, and all of them together for --batch
+        record_count=$(python3 -c '
+import ast, sys
+seed = sys.argv[1]
+records = ast.literal_eval(open("p%s.rec" % seed).read())
+for i, record in enumerate(records):
+        open("record%s_%d" % (seed, i), "w").write("".join(field + "\n" for field in record))
+open("records%s" % seed, "w").write("".join("".join(field + "\n" for field in record) for record in records))
+print(len(records))' "$seed")
+        : > "expected$seed"
+        if ! grep -q "read(" "$program"; then
+                "$pa" --run "$program" </dev/null | tail -n +2 >> "expected$seed"
+        else
+                for i in $(seq 0 $((record_count - 1))); do
+                        "$pa" --run "$program" < "record${seed}_$i" | tail -n +2 >> "expected$seed"
+                done
+        fi
+        feed "records$seed" | "$pa" --batch "$program" | tail -n +2 > "got$seed"
+        
+        if cmp -s "expected$seed" "got$seed"; then
+                ok=$((ok + 1))
+                rm -f "p$seed.txt" "p$seed.rec" "record${seed}_"* "records$seed" "expected$seed" "got$seed"
+        else
+                differ=$((differ + 1))
+                echo "DIFF p$seed.txt: expected$seed got$seed"
+        fi
+done
+echo "ok=$ok differ=$differ skip=$skip"
+[ $differ -eq 0 ]
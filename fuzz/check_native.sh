@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+# Compares the native backends on every program in a directory (such as one written by gen_arrays.py): the executable
+# written by --emit-elf has to exit 0 with the same output and status as --run, and when a reference build is given,
+# --run has to print the same as it does with that build. Programs the checker rejects are counted as parse errors,
+# and those that can't be compiled natively as skipped. Exits 1 if anything differs or the compiler crashes.
+#
+# Usage: fuzz/check_native.sh <pa binary> <directory> [reference pa binary]
+# The executables are written to and removed from <directory>/output.
+
+set -u
+pa=$(realpath "$1")
+reference=${3:+$(realpath "$3")}
+cd "$2" || exit 2
+
+ok=0; skip=0; fail=0; crash=0; parse_errors=0; differ=0
+for program in *.txt; do
+        out=$(timeout 10 "$pa" --emit-elf "$program" 2>&1); status=$?
+        if [ $status -gt 1 ]; then crash=$((crash + 1)); echo "CRASH $program: status $status"; fi
+        [ $status -eq 1 ] && parse_errors=$((parse_errors + 1))
+        executable=output/${program%.txt}
+        if [ -x "$executable" ]; then
+                elf=$(timeout 5 "$executable" </dev/null 2>&1; echo "status $?")
+                rm -f "$executable"
+                if [ "${elf##*status }" != 0 ]; then fail=$((fail + 1)); echo "FAIL $program: ${elf##*status }"; continue; fi
+                ok=$((ok + 1))
+                run=$(timeout 10 "$pa" --run "$program" </dev/null 2>&1 | tail -n +2; echo "status ${PIPESTATUS[0]}")
+                if [ "$elf" != "$run" ]; then differ=$((differ + 1)); echo "DIFF $program: --emit-elf and --run"; fi
+                if [ -n "$reference" ]; then
+                        expected=$(timeout 10 "$reference" --run "$program" </dev/null 2>&1 | tail -n +2; echo "status ${PIPESTATUS[0]}")
+                        if [ "$expected" != "$run" ]; then differ=$((differ + 1)); echo "DIFF $program: --run and the reference build"; fi
+                fi
+        elif grep -q "Not writing" <<< "$out"; then
+                skip=$((skip + 1))
+        fi
+done
+echo "ok=$ok skip=$skip fail=$fail crash=$crash parse_errors=$parse_errors differ=$differ"
+[ $((fail + crash + differ)) -eq 0 ]
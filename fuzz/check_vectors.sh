@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+# Compares --run between two builds on the programs gen_vectors.py writes for a range of seeds, to check the vector
+# loop against the scalar one: the reference is a build from before the vector loop, or one whose NativeRuntime
+# reports no AVX2. Programs the reference doesn't compile natively are skipped. Exits 1 if any program differs.
+#
+# Usage: fuzz/check_vectors.sh <pa binary> <reference pa binary> <first seed> <last seed> <directory>
+# The programs that differ are left in <directory>.
+
+set -u
+pa=$(realpath "$1")
+reference=$(realpath "$2")
+generator=$(dirname "$(realpath "$0")")/gen_vectors.py
+directory=$5
+
+ok=0; differ=0; skip=0
+for seed in $(seq "$3" "$4"); do
+        python3 "$generator" "$seed" "$directory"
+        program=$directory/v$seed.txt
+        expected=$(timeout 60 "$reference" --run "$program" </dev/null 2>&1; echo "status $?")
+        if head -2 <<< "$expected" | grep -q "Not compiling natively\|Error"; then
+                skip=$((skip + 1))
+                rm -f "$program"
+                continue
+        fi
+        got=$(timeout 60 "$pa" --run "$program" </dev/null 2>&1; echo "status $?")
+        if [ "$expected" == "$got" ]; then ok=$((ok + 1)); rm -f "$program"; else differ=$((differ + 1)); echo "DIFF $program"; fi
+done
+echo "ok=$ok differ=$differ skip=$skip"
+[ $differ -eq 0 ]
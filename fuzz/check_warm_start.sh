@@ -0,0 +1,44 @@
+#!/usr/bin/env bash
+# Compares --run --warm-start with a cold --run on every program in the directories given: the output and exit status
+# have to be the same. Programs with a p<seed>.rec beside them (from gen_records.py) are fed its first record, the rest
+# nothing. Programs that don't compile natively are skipped, and those that fall back to a cold start are counted.
+# Exits 1 if any program differs.
+#
+# Usage: fuzz/check_warm_start.sh <pa binary> <directory>...
+# For example, on the corpus the warm start was checked on:
+#   python3 fuzz/gen_arrays.py /tmp/arrays
+#   for seed in $(seq 1 150); do python3 fuzz/gen_records.py $seed /tmp/records; done
+#   fuzz/check_warm_start.sh ./pa /tmp/arrays /tmp/records
+
+set -u
+pa=$(realpath "$1")
+shift
+
+ok=0; differ=0; skip=0; cold=0
+for directory in "$@"; do
+        for program in "$directory"/*.txt; do
+                input=/dev/null
+                if [ -f "${program%.txt}.rec" ]; then
+                        input=$(mktemp)
+                        python3 -c '
+import ast, sys
+records = ast.literal_eval(open(sys.argv[1]).read())
+sys.stdout.write("".join(field + "\n" for field in records[0]) if records else "")' "${program%.txt}.rec" > "$input"
+                fi
+                expected=$(timeout 10 "$pa" --run "$program" < "$input" 2>&1 | tr -d '\0'; echo "status ${PIPESTATUS[0]}")
+                if grep -q "Not compiling natively\|Error" <<< "$expected"; then
+                        skip=$((skip + 1))
+                else
+                        got=$(timeout 20 "$pa" --run --warm-start "$program" < "$input" 2>&1 | tr -d '\0'; echo "status ${PIPESTATUS[0]}")
+                        # The note about falling back to a cold start is the only thing allowed to differ
+                        if grep -q "Not warm starting" <<< "$got"; then
+                                cold=$((cold + 1))
+                                got=$(grep -v "Not warm starting" <<< "$got")
+                        fi
+                        if [ "$expected" == "$got" ]; then ok=$((ok + 1)); else differ=$((differ + 1)); echo "DIFF $program"; fi
+                fi
+                [ "$input" != /dev/null ] && rm -f "$input"
+        done
+done
+echo "ok=$ok differ=$differ skip=$skip cold=$cold"
+[ $differ -eq 0 ]
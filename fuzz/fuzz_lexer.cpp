@@ -0,0 +1,355 @@
+// Differential fuzz target for pa::Lexer's tables: every input is lexed by the table-driven Lexer and by a reference lexer
+// that dispatches on each character through a switch, as the Lexer did before CharacterClasses and OperatorTransitions,
+// and the two have to agree on every token, the constant pool and the error (message and position) they stop at, if any.
+// A disagreement is printed and aborts. The reference scans literals and words with its own code too, decoding numbers,
+// chars and strings into its own constant pool, so the Lexer's scanners, its digit skipping and its keyword hashing are
+// checked as well as its tables. The same comparison runs during constant evaluation on a source covering every
+// token, so a build of this target fails outright if the tables are off.
+//
+// With libFuzzer:
+//   clang++ -std=c++23 -O1 -g -fsanitize=fuzzer,address,undefined -Iinternal/... internal/*/*.cpp fuzz/fuzz_lexer.cpp
+//   ./a.out corpus/
+// Without it, build with -DPA_FUZZ_STANDALONE to get a driver that runs the inputs named on the command line.
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include "io.h"
+#include "lexer.h"
+
+namespace {
+        constexpr bool isSpace(const char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+        constexpr bool isDigit(const char c) { return c >= '0' && c <= '9'; }
+        constexpr bool isAlpha(const char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+        
+        constexpr bool isWordCharacter(const char c) { return isAlpha(c) || isDigit(c) || c == '_'; }
+        
+        [[noreturn]] void fail(const std::string& message, const size_t position) {
+                pa::reportError(pa::ErrorMode::Throw, message, position);
+        }
+        
+        // Throws like validateAndIncrementIndex when the source ends before the delimiter opened at open_index is closed
+        constexpr void advanceWithin(const std::string_view src, size_t& index, const std::string_view delimiter, const size_t open_index) {
+                if (++index >= src.size())
+                        fail(std::format("Lexing Error({}): Could not locate closing {} for open {}.", open_index, delimiter, delimiter), open_index);
+        }
+        
+        // Accumulates towards the negative end, which holds every magnitude a literal can have, and checks every step for overflow
+        constexpr uint32_t decodeIntReference(const std::string_view text, const size_t end, pa::ConstantPool& constants) {
+                bool negative = text.starts_with('-');
+                int64_t value = 0;
+                for (char c: text.substr(negative)) {
+                        if (__builtin_mul_overflow(value, 10, &value) || __builtin_sub_overflow(value, c - '0', &value))
+                                fail(std::format("Lexing Error({}): Integer literal {} does not fit in 64 bits.", end, text), end);
+                }
+                if (!negative && __builtin_mul_overflow(value, -1, &value))
+                        fail(std::format("Lexing Error({}): Integer literal {} does not fit in 64 bits.", end, text), end);
+                return constants.addInt(value);
+        }
+        
+        constexpr uint32_t decodeFloatReference(const std::string_view text, const size_t end, pa::ConstantPool& constants) {
+                std::optional<double> value;
+                if consteval {
+                        value = pa::Decimal::toDouble(text);
+                } else {
+                        double parsed = 0;
+                        if (std::from_chars(text.begin(), text.end(), parsed).ec != std::errc::result_out_of_range)
+                                value = parsed;
+                }
+                if (!value)
+                        fail(std::format("Lexing Error({}): Float literal {} is out of range.", end, text), end);
+                return constants.addFloat(*value);
+        }
+        
+        // An optional minus, digits, and a point with more digits after it, with at least one digit on either side
+        constexpr pa::Token scanNumber(const std::string_view src, size_t& index, pa::ConstantPool& constants) {
+                auto at = [src](const size_t i) { return i < src.size() ? src[i] : '\0'; };
+                size_t start = index;
+                if (at(index) == '-')
+                        index++;
+                size_t whole = index;
+                while (isDigit(at(index)))
+                        index++;
+                bool has_whole = index > whole;
+                bool is_float = at(index) == '.';
+                if (is_float)
+                        index++;
+                size_t fraction = index;
+                while (isDigit(at(index)))
+                        index++;
+                if (!has_whole && index == fraction)
+                        fail(std::format("Lexing Error({}): Floating point numbers require atleast one digit on atleast one side of the decimal point.", index), index);
+                
+                std::string_view text = src.substr(start, index - start);
+                if (is_float)
+                        return {pa::TokenType::FloatLiteral, start, index - 1, decodeFloatReference(text, index, constants)};
+                return {pa::TokenType::IntLiteral, start, index - 1, decodeIntReference(text, index, constants)};
+        }
+        
+        constexpr pa::Token scanChar(const std::string_view src, size_t& index, pa::ConstantPool& constants) {
+                size_t start = index;
+                advanceWithin(src, index, "quote", start);
+                char value = src[index];
+                if (value == '\\') {
+                        advanceWithin(src, index, "quote", start);
+                        value = pa::ConstantPool::unescape(src[index]);
+                } else if (value == '\'') {
+                        fail(std::format("Lexing Error({}): Empty char.", start), start);
+                }
+                advanceWithin(src, index, "quote", start);
+                if (src[index] != '\'')
+                        fail(std::format("Lexing Error({}): Expected closing quote, found {} instead.", index, src[index]), index);
+                index++;
+                return {pa::TokenType::CharLiteral, start, index - 1, constants.addChar(value)};
+        }
+        
+        // Decodes the escapes itself and adds the result as a plain string
+        constexpr pa::Token scanString(const std::string_view src, size_t& index, pa::ConstantPool& constants) {
+                size_t start = index;
+                std::string value;
+                advanceWithin(src, index, "quote", start);
+                while (src[index] != '"') {
+                        if (src[index] == '\\') {
+                                advanceWithin(src, index, "quote", start);
+                                value += pa::ConstantPool::unescape(src[index]);
+                        } else
+                                value += src[index];
+                        advanceWithin(src, index, "quote", start);
+                }
+                index++;
+                return {pa::TokenType::StringLiteral, start, index - 1, constants.addString(value)};
+        }
+        
+        // An array extent is the integer between the brackets, ending on its last digit
+        constexpr pa::Token scanArray(const std::string_view src, size_t& index, pa::ConstantPool& constants) {
+                advanceWithin(src, index, "brace", index);
+                pa::Token extent = scanNumber(src, index, constants);
+                char close = index < src.size() ? src[index] : '\0';
+                if (close != ']')
+                        fail(std::format("Lexing Error({}): Expected closing brace, found {} instead.", index, close), index);
+                index++;
+                if (extent.type == pa::TokenType::FloatLiteral)
+                        fail(std::format("Lexing Error({}): Expected Integer Literal, found Float Literal({}).", index, src.substr(extent.start, extent.end - extent.start + 1)), index);
+                extent.type = pa::TokenType::Array;
+                return extent;
+        }
+        
+        constexpr pa::Token scanWord(const std::string_view src, size_t& index) {
+                using enum pa::TokenType;
+                constexpr std::pair<std::string_view, pa::TokenType> Keywords[] = {
+                        {"True", True}, {"False", False}, {"int", Int}, {"bool", Bool}, {"float", Float}, {"char", Char}, {"string", String},
+                        {"print", Print}, {"read", Read}, {"load", Load},
+                };
+                size_t start = index;
+                while (index < src.size() && isWordCharacter(src[index]))
+                        index++;
+                std::string_view word = src.substr(start, index - start);
+                for (const auto& [keyword, type]: Keywords) {
+                        if (word == keyword)
+                                return {type, start, index - 1};
+                }
+                return {Identifier, start, index - 1};
+        }
+        
+        // The Lexer as it was before the tables, dispatching on each character in turn. Errors are thrown as with
+        // ErrorMode::Throw, so nothing is handed out once one is reached.
+        constexpr std::vector<pa::Token> tokenizeReference(const std::string_view src, pa::ConstantPool& constants) {
+                using enum pa::TokenType;
+                auto at = [src](const size_t index) { return index < src.size() ? src[index] : '\0'; };
+                std::vector<pa::Token> tokens;
+                size_t index = 0;
+                for (;;) {
+                        while (index < src.size() && isSpace(src[index]))
+                                index++;
+                        if (index >= src.size()) {
+                                tokens.push_back({Eof, index, index});
+                                return tokens;
+                        }
+                        
+                        char c = src[index];
+                        if (isDigit(c) || c == '-' || c == '.') {
+                                tokens.push_back(scanNumber(src, index, constants));
+                                continue;
+                        }
+                        if (isAlpha(c) || c == '_') {
+                                tokens.push_back(scanWord(src, index));
+                                continue;
+                        }
+                        
+                        // A token of two characters ends one past its second
+                        auto pair = [&](const char second, const pa::TokenType single, const pa::TokenType doubled) {
+                                if (at(index + 1) == second) {
+                                        tokens.push_back({doubled, index, index + 2});
+                                        index += 2;
+                                } else {
+                                        tokens.push_back({single, index, index});
+                                        index++;
+                                }
+                        };
+                        auto bitwise = [&](const pa::TokenType type) {
+                                if (at(index + 1) != c)
+                                        fail(std::format("Lexing Error({}): Bitwise operations are not supported, expected sequention {}, got {} instead.", index + 1, c, at(index + 1)),
+                                             index + 1);
+                                tokens.push_back({type, index, index + 2});
+                                index += 2;
+                        };
+                        auto single = [&](const pa::TokenType type) {
+                                tokens.push_back({type, index, index});
+                                index++;
+                        };
+                        switch (c) {
+                                case '"':
+                                        tokens.push_back(scanString(src, index, constants));
+                                        break;
+                                case '\'':
+                                        tokens.push_back(scanChar(src, index, constants));
+                                        break;
+                                case '[':
+                                        tokens.push_back(scanArray(src, index, constants));
+                                        break;
+                                case '(':
+                                        single(OpenParen);
+                                        break;
+                                case ')':
+                                        single(CloseParen);
+                                        break;
+                                case '{':
+                                        single(OpenCurly);
+                                        break;
+                                case '}':
+                                        single(CloseCurly);
+                                        break;
+                                case ',':
+                                        single(Comma);
+                                        break;
+                                case ';':
+                                        single(SemiColon);
+                                        break;
+                                case '+':
+                                        single(Plus);
+                                        break;
+                                case '*':
+                                        single(Asterisk);
+                                        break;
+                                case '/':
+                                        if (at(index + 1) == '/') {
+                                                while (index < src.size() && src[index] != '\n' && src[index] != '\r')
+                                                        index++;
+                                        } else {
+                                                single(ForwardSlash);
+                                        }
+                                        break;
+                                case '<':
+                                        pair('=', LessThan, LessThanOrEquals);
+                                        break;
+                                case '>':
+                                        pair('=', GreaterThan, GreaterThanOrEquals);
+                                        break;
+                                case '=':
+                                        pair('=', Equals, EqualsEquals);
+                                        break;
+                                case '!':
+                                        pair('=', Not, NotEquals);
+                                        break;
+                                case '&':
+                                        bitwise(And);
+                                        break;
+                                case '|':
+                                        bitwise(Or);
+                                        break;
+                                default:
+                                        fail(std::format("Lexing Error({}): Unexpected Character {}.", index, c), index);
+                        }
+                }
+        }
+        
+        constexpr bool sameToken(const pa::Token& token, const pa::Token& expected) {
+                return token.type == expected.type && token.start == expected.start && token.end == expected.end && token.constant == expected.constant;
+        }
+        
+        // Lexes source with both lexers during constant evaluation, so tables that disagree with the reference fail the build
+        constexpr bool agreesWithReference(const std::string_view source) {
+                pa::ConstantPool constants;
+                pa::ConstantPool reference_constants;
+                return std::ranges::equal(pa::Lexer(source, constants).tokenize(), tokenizeReference(source, reference_constants), sameToken);
+        }
+}
+
+static_assert(agreesWithReference("int a[3]; float f;\tbool b; char c; string s_1; // A comment\r\n"
+                                  "a = {1, -2, 30}; f = .5 * 2. + 1.25 / -0.5;\n"
+                                  "b = !True && (a <= 2 || a >= 4) == False != (a < 6) > a; b=!b;\v\f"
+                                  "c = '\\n'; s_1 = \"x\\\"y\"; print(a); read(s_1); load(\"f.txt\");//"),
+              "The table-driven lexer has to lex exactly what the reference lexer does");
+
+[[noreturn]] static void disagree(const std::string_view src, const std::string_view what) {
+        std::cout << std::format("Lexers disagree on {} bytes: {}", src.size(), what) << std::endl;
+        std::abort();
+}
+
+static std::string describe(const std::optional<pa::CompileError>& compile_error) {
+        return compile_error ? std::format("\"{}\" at {}", compile_error->message, compile_error->position) : std::string("no error");
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, const size_t size) {
+        std::string_view src(reinterpret_cast<const char*>(data), size);
+        
+        pa::ConstantPool constants;
+        std::vector<pa::Token> tokens;
+        std::optional<pa::CompileError> lex_error;
+        try {
+                pa::Lexer(src, constants, pa::ErrorMode::Throw).tokenize(tokens);
+        } catch (const pa::CompileError& compile_error) {
+                lex_error = compile_error;
+        }
+        
+        pa::ConstantPool reference_constants;
+        std::vector<pa::Token> reference_tokens;
+        std::optional<pa::CompileError> reference_error;
+        try {
+                reference_tokens = tokenizeReference(src, reference_constants);
+        } catch (const pa::CompileError& compile_error) {
+                reference_error = compile_error;
+        }
+        
+        // The reference hands out nothing once it errors, so only the errors are compared then
+        if (lex_error || reference_error) {
+                if (!lex_error || !reference_error || lex_error->message != reference_error->message || lex_error->position != reference_error->position)
+                        disagree(src, std::format("the lexer stopped with {}, the reference with {}", describe(lex_error), describe(reference_error)));
+                return 0;
+        }
+        
+        auto [token, expected] = std::ranges::mismatch(tokens, reference_tokens, sameToken);
+        if (token != tokens.end() && expected != reference_tokens.end())
+                disagree(src, std::format("token {} is {}({}, {}, constant {}), the reference has {}({}, {}, constant {})", token - tokens.begin(),
+                                          pa::Token::typeToString(token->type), token->start, token->end, token->constant,
+                                          pa::Token::typeToString(expected->type), expected->start, expected->end, expected->constant));
+        if (tokens.size() != reference_tokens.size())
+                disagree(src, std::format("the lexer produced {} tokens, the reference {}", tokens.size(), reference_tokens.size()));
+        
+        if (!std::ranges::equal(constants.ints(), reference_constants.ints()) || !std::ranges::equal(constants.floats(), reference_constants.floats())
+            || !std::ranges::equal(constants.chars(), reference_constants.chars()) || !std::ranges::equal(constants.strings(), reference_constants.strings()))
+                disagree(src, "the two decoded different constant pools");
+        return 0;
+}
+
+
+#ifdef PA_FUZZ_STANDALONE
+int main(int argc, char* argv[]) {
+        if (argc < 2) {
+                std::cout << "Usage: fuzz_lexer inputs...\n";
+                return EXIT_FAILURE;
+        }
+        
+        for (int i = 1; i < argc; i++) {
+                std::string src = pa::io::readFile(argv[i]);
+                LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(src.data()), src.size());
+        }
+        return 0;
+}
+#endif
@@ -0,0 +1,149 @@
+// Coverage guided fuzz target for pa::Lexer and pa::Parser::parseProgram that hunts for performance cliffs as well as crashes.
+//
+// Every input is lexed and parsed in-process with ErrorMode::Throw, so rejected programs are just another outcome rather
+// than the end of the process. The time spent per input byte is tracked, and whenever an input sets a new worst
+// time per byte it is probed for superlinear growth: prefixes of a quarter, half and all of it are re-timed and the
+// growth exponent between them estimated. Inputs growing faster than MaxGrowthExponent are reported and saved as
+// slow-<hash>.clike in the working directory.
+//
+// With libFuzzer:
+//   clang++ -std=c++23 -O1 -g -fsanitize=fuzzer,address,undefined -Iinternal/... internal/*/*.cpp fuzz/fuzz_parser.cpp
+//   ./a.out corpus/
+// Without it, build with -DPA_FUZZ_STANDALONE to get a driver that runs the inputs named on the command line, or with
+// --shapes doubles the known problem shapes (deep array and parenthesis nesting, ! chains, comments at EOF, long literals)
+// and prints the growth exponent between each size. Truncating a nested shape cuts off its closing half, so these are
+// grown rather than probed through prefixes.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <functional>
+#include "io.h"
+#include "hash.h"
+#include "parser.h"
+
+static constexpr size_t MinimumProbeSize = 256;
+static constexpr double MaxGrowthExponent = 1.5;
+static constexpr int ProbeRepetitions = 5;
+
+// Lexes and parses src, returning whether it was accepted
+static bool compile(const std::string_view src) {
+        try {
+                pa::Parser parser(src, pa::ErrorMode::Throw);
+                parser.parseProgram();
+                return true;
+        } catch (const pa::CompileError&) {
+                return false;
+        }
+}
+
+// Best of a few runs, to keep scheduler noise out of the comparison
+static double timeCompile(const std::string_view src) {
+        double best = INFINITY;
+        for (int i = 0; i < ProbeRepetitions; i++) {
+                auto start = std::chrono::steady_clock::now();
+                compile(src);
+                best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+}
+
+// How the cost of src grows with its length, 1 for linear, 2 for quadratic
+static double growthExponent(const std::string_view src) {
+        double quarter = timeCompile(src.substr(0, src.size() / 4));
+        double half = timeCompile(src.substr(0, src.size() / 2));
+        double full = timeCompile(src);
+        return (std::log2(half / quarter) + std::log2(full / half)) / 2;
+}
+
+static void reportSuperlinear(const std::string_view src, const double nanoseconds_per_byte, const double exponent) {
+        auto path = std::format("slow-{:016x}.clike", pa::hashBytes(src));
+        std::ofstream(path, std::ios::binary) << src;
+        std::cout << std::format("Superlinear input: {} bytes, {:.1f}ns/byte, growth exponent {:.2f}, saved to {}\n", src.size(), nanoseconds_per_byte, exponent, path);
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, const size_t size) {
+        static double worst_nanoseconds_per_byte = 0;
+        
+        std::string_view src(reinterpret_cast<const char*>(data), size);
+        
+        auto start = std::chrono::steady_clock::now();
+        compile(src);
+        double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        
+        if (size < MinimumProbeSize)
+                return 0;
+        
+        double nanoseconds_per_byte = nanoseconds / static_cast<double>(size);
+        if (nanoseconds_per_byte <= worst_nanoseconds_per_byte)
+                return 0;
+        worst_nanoseconds_per_byte = nanoseconds_per_byte;
+        
+        double exponent = growthExponent(src);
+        if (exponent > MaxGrowthExponent)
+                reportSuperlinear(src, nanoseconds_per_byte, exponent);
+        return 0;
+}
+
+
+#ifdef PA_FUZZ_STANDALONE
+// Doubles each shape a few times and prints how its cost scales
+static void probeShapes() {
+        const std::pair<std::string_view, std::function<std::string(size_t)>> shapes[] = {
+                {"nested array literal", [](size_t n) { return "int a[1];\na = " + std::string(n, '{') + std::string(n, '}') + ";\n"; }},
+                {"nested parentheses", [](size_t n) { return "int a;\na = " + std::string(n, '(') + "1" + std::string(n, ')') + ";\n"; }},
+                {"! chain", [](size_t n) {
+                        std::string src = "bool a;\na = ";
+                        for (size_t i = 0; i < n; i++)
+                                src += "!(";
+                        return src + "True" + std::string(n, ')') + ";\n";
+                }},
+                {"comment at EOF", [](size_t n) { return "int a;\n//" + std::string(n, 'x'); }},
+                {"string literal", [](size_t n) { return "string a;\na = \"" + std::string(n, 'x') + "\";\n"; }},
+                {"flat array literal", [](size_t n) {
+                        std::string src = "int a[" + std::to_string(n) + "];\na = {";
+                        for (size_t i = 0; i < n; i++)
+                                src += i == 0 ? "1" : ", 1";
+                        return src + "};\n";
+                }},
+        };
+        
+        for (const auto& [name, make]: shapes) {
+                double previous_nanoseconds = 0;
+                for (size_t n = 100; n < static_cast<size_t>(pa::Parser::MaxNestingDepth); n *= 2) {
+                        std::string src = make(n);
+                        double nanoseconds = timeCompile(src);
+                        std::cout << std::format("{:<22} n={:<5} {:>9} bytes {:>10.1f}ns/byte", name, n, src.size(), nanoseconds / static_cast<double>(src.size()));
+                        
+                        if (previous_nanoseconds > 0) {
+                                double exponent = std::log2(nanoseconds / previous_nanoseconds);
+                                std::cout << std::format(" growth exponent {:.2f}{}", exponent, exponent > MaxGrowthExponent ? "  SUPERLINEAR" : "");
+                        }
+                        std::cout << "\n";
+                        previous_nanoseconds = nanoseconds;
+                }
+        }
+}
+
+int main(int argc, char* argv[]) {
+        if (argc < 2) {
+                std::cout << "Usage: fuzz_parser --shapes | inputs...\n";
+                return EXIT_FAILURE;
+        }
+        
+        if (std::string_view(argv[1]) == "--shapes") {
+                probeShapes();
+                return 0;
+        }
+        
+        for (int i = 1; i < argc; i++) {
+                std::string src = pa::io::readFile(argv[i]);
+                LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(src.data()), src.size());
+        }
+        return 0;
+}
+#endif
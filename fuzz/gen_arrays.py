@@ -0,0 +1,33 @@
+# Writes a corpus of small programs assigning nested array literals, well and badly shaped, to variables of every type.
+# Most are rejected by the checker; the rest (198 of the default 3000) compile natively, and are what check_native.sh
+# and check_warm_start.sh compare the backends on.
+#
+# Usage: python3 fuzz/gen_arrays.py <directory> [count] [seed], writing <directory>/0.txt up to <count - 1>.txt
+
+import os
+import random
+import sys
+
+directory = sys.argv[1]
+count = int(sys.argv[2]) if len(sys.argv) > 2 else 3000
+random.seed(int(sys.argv[3]) if len(sys.argv) > 3 else 5)
+os.makedirs(directory, exist_ok=True)
+
+literals = ['1', '-2', '3.5', '"s"', "'c'", 'True', 'False', 'a', 'c', '1 + 2', '1 +2', '(1)', '!True', '"a" + "b"', '2.0 * 3', 'x']
+
+
+def array(depth):
+    if depth == 0 or random.random() < 0.2:
+        size = random.randint(0, 4)
+        return '{' + random.choice([', ', ',', ' , ']).join(random.choice(literals[:random.choice([7, 16])]) for _ in range(size)) + '}'
+    size = random.randint(0, 3)
+    return '{' + ', '.join(array(depth - 1) for _ in range(size)) + '}' + random.choice(['', '', ' // c\n'])
+
+
+for i in range(count):
+    source = 'int a; float c; char x; int i1[3]; int i2[2][2]; float f2[2][3]; string s2[2]; bool b3[2][2][2]; char c1[2];\n'
+    for _ in range(random.randint(1, 5)):
+        variable = random.choice(['i1', 'i2', 'f2', 's2', 'b3', 'c1', 'a'])
+        source += variable + ' = ' + array(random.randint(0, 4)) + ';\n'
+    with open(os.path.join(directory, '%d.txt' % i), 'w') as file:
+        file.write(source)
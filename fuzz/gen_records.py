@@ -0,0 +1,127 @@
+# Writes a random straight-line program over scalars of every type, with reads, prints and nested expressions, and the
+# records to feed it: one field per read, drawn from well-formed, padded, CRLF, blank, overlong and malformed lines.
+# check_batch.sh and check_warm_start.sh run these.
+#
+# Usage: python3 fuzz/gen_records.py <seed> <directory> [record count]
+# Writes <directory>/p<seed>.txt, and <directory>/p<seed>.rec with the records as a Python list of lists of fields.
+
+import os
+import random
+import sys
+
+seed = int(sys.argv[1])
+directory = sys.argv[2]
+random.seed(seed)
+os.makedirs(directory, exist_ok=True)
+
+types = ['int', 'float', 'bool', 'char', 'string']
+variables = []
+lines = []
+reads = 0
+
+
+def pick(type):
+    candidates = [name for name, variable_type in variables if variable_type == type]
+    return random.choice(candidates) if candidates and random.random() < .75 else None
+
+
+def literal(type):
+    if type == 'int':
+        return random.choice(['0', '1', '2', '7', '100', '4611686018427387904', str(random.randint(0, 10**6)), '9223372036854775807'])
+    if type == 'float':
+        return random.choice(['1.0', '1.5', '2.25', '.1', '3.14159', '100000000000000000000.0', '123456.789', '.000001', '9007199254740993.0', '.0'])
+    if type == 'bool':
+        return random.choice(['True', 'False'])
+    if type == 'char':
+        return "'%s'" % random.choice('aZ0x')
+    return '"%s"' % random.choice(['', 'ab', 'hi there', 'x'])
+
+
+def atom(type):
+    return pick(type) or literal(type)
+
+
+operators = ['+', '*', '/']
+
+
+def number(depth):
+    return random.choice([int_expression, float_expression])(depth)
+
+
+def int_expression(depth):
+    if depth >= 3 or random.random() < .4:
+        return atom('int')
+    if random.random() < .15:
+        return '(' + int_expression(depth + 1) + ')'
+    return atom('int') + ' ' + random.choice(operators) + ' ' + int_expression(depth + 1)
+
+
+def float_expression(depth):
+    if depth >= 3 or random.random() < .4:
+        return atom('float')
+    r = random.random()
+    if r < .15:
+        return '(' + float_expression(depth + 1) + ')'
+    if r < .55:
+        return atom('float') + ' ' + random.choice(operators) + ' ' + number(depth + 1)
+    return atom('int') + ' ' + random.choice(operators) + ' ' + float_expression(depth + 1)
+
+
+def bool_expression(depth):
+    r = random.random()
+    if depth >= 3 or r < .25:
+        return atom('bool')
+    if r < .35:
+        return '!(' + bool_expression(depth + 1) + ')'
+    if r < .45:
+        return '!' + literal('bool')
+    if r < .75:
+        return '(' + number(depth + 1) + ') ' + random.choice(['<', '<=', '>', '>=', '==', '!=']) + ' ' + number(depth + 1)
+    return '(' + bool_expression(depth + 1) + ') ' + random.choice(['&&', '||']) + ' (' + random.choice([bool_expression, number])(depth + 1) + ')'
+
+
+def string_expression(depth):
+    if depth >= 2 or random.random() < .5:
+        return atom('string')
+    return atom('string') + ' + ' + string_expression(depth + 1)
+
+
+def expression(type):
+    return {'int': int_expression, 'float': float_expression, 'bool': bool_expression, 'string': string_expression,
+            'char': lambda depth: atom('char')}[type](0)
+
+
+for i in range(random.randint(2, 7)):
+    type = random.choice(types)
+    name = 'v%d' % i
+    lines.append('%s %s;' % (type, name))
+    variables.append((name, type))
+for _ in range(random.randint(3, 14)):
+    r = random.random()
+    name, type = random.choice(variables)
+    if r < .3:
+        lines.append('read(%s);' % name)
+        reads += 1
+    elif r < .33:
+        lines.append('read(1 + 2);')
+        reads += 1
+    elif r < .6:
+        lines.append('%s = %s;' % (name, expression(type)))
+    else:
+        lines.append('print(%s);' % expression(random.choice(types)))
+with open(os.path.join(directory, 'p%d.txt' % seed), 'w') as file:
+    file.write('\n'.join(lines) + '\n')
+
+
+def field():
+    return random.choice(['0', '1', '-5', '42', '  17', '+3', '3.75', '-0.5', '1e5', 'true', 'True', 't', 'false', 'x', 'hello', '',
+                          '99999999999999999999', '0.1234567890123456789', '12.', '\t-8.25', 'abc\r', '1.0000005', '123456789012345678',
+                          '-0', 'nan'])
+
+
+record_count = random.randint(0, 40)
+if len(sys.argv) > 3:
+    record_count = int(sys.argv[3])
+records = [[field() for _ in range(reads)] for _ in range(record_count)]
+with open(os.path.join(directory, 'p%d.rec' % seed), 'w') as file:
+    file.write(repr(records))
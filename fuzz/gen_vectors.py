@@ -0,0 +1,68 @@
+# Writes a random program of whole-array int and float arithmetic mixed with scalars, on arrays of 16 up to 300003
+# elements, so both sides of the vector loop's leftover elements and of kernels::ParallelThreshold get covered.
+# check_vectors.sh compares what these print between two builds.
+#
+# Usage: python3 fuzz/gen_vectors.py <seed> <directory>, writing <directory>/v<seed>.txt
+
+import os
+import random
+import sys
+
+seed = int(sys.argv[1])
+directory = sys.argv[2]
+random.seed(seed)
+os.makedirs(directory, exist_ok=True)
+
+size = random.choice([16, 17, 18, 19, 20, 31, 64, 100, 1000, 5000, 140000, 270000, 300003])
+
+
+def ints():
+    return '{' + ', '.join(str(random.choice([random.randint(-9, 9), random.randint(-2**63, 2**63 - 1), random.randint(-2**31, 2**31)])) for _ in range(size)) + '}'
+
+
+def floats():
+    return '{' + ', '.join(random.choice(['0.0', '1.5', '%.6f' % random.uniform(-1e6, 1e6), '%.3f' % random.uniform(-10, 10), '.000001']) for _ in range(size)) + '}'
+
+
+lines = ['int a[%d]; int b[%d]; int c[%d]; float f[%d]; float g[%d]; float h[%d]; int s; float t; bool q; char ch;' % ((size,) * 6)]
+lines.append('a = %s;' % ints())
+lines.append('b = %s;' % ints())
+lines.append('f = %s;' % floats())
+lines.append('g = %s;' % floats())
+lines.append("s = %d; t = %s; q = True; ch = 'x';" % (random.randint(-100, 100), random.choice(['2.5', '.5', '3.0'])))
+
+
+# Subtraction is written as + -1 *, a minus always lexing as part of a number
+def int_expression(depth):
+    r = random.random()
+    if depth == 0 or r < 0.3:
+        return random.choice(['a', 'b', 'c', 'a', 'b', 's', '3', '(s * 7)'])
+    return '(%s %s %s)' % (int_expression(depth - 1), random.choice(['+', '*', '*', '+ -1 *']), int_expression(depth - 1))
+
+
+def float_expression(depth):
+    r = random.random()
+    if depth == 0 or r < 0.3:
+        return random.choice(['f', 'g', 'h', 't', 's', '2', '1.5', '(s * t)'])
+    return '(%s %s %s)' % (float_expression(depth - 1), random.choice(['+', '*', '/', '+ -1.0 *']), float_expression(depth - 1))
+
+
+for _ in range(6):
+    # Retried until the expression has an array in it, a scalar one not being assignable to an array
+    if random.random() < 0.5:
+        expression = int_expression(random.randint(1, 5))
+        while not any(name in expression for name in 'abc'):
+            expression = int_expression(random.randint(1, 5))
+        lines.append('%s = %s;' % (random.choice('abc'), expression))
+    else:
+        expression = float_expression(random.randint(1, 5))
+        while not any(name in expression for name in 'fgh'):
+            expression = float_expression(random.randint(1, 5))
+        lines.append('%s = %s;' % (random.choice('fgh'), expression))
+    if size <= 1000:
+        lines.append('print(%s);' % random.choice('abcfgh'))
+lines.append('print(%s + %s);' % (random.choice('abc'), random.choice('abc')))
+lines.append('print(%s * 2.0);' % random.choice('fgh'))
+lines.append('print(a); print(b); print(c); print(f); print(g); print(h);')
+with open(os.path.join(directory, 'v%d.txt' % seed), 'w') as file:
+    file.write('\n'.join(lines) + '\n')
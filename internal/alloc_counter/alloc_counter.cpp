@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include "alloc_counter.h"
+
+namespace {
+        // Plain thread locals, so counting needs no allocation or locking of its own
+        thread_local uint64_t t_allocations = 0;
+        thread_local uint64_t t_bytes = 0;
+}
+
+pa::alloc::Counts pa::alloc::counts() {
+        return {t_allocations, t_bytes};
+}
+
+// Lexes and parses src into the buffers left by the previous pass, setting up the parser on the first
+static pa::alloc::Pass lexAndParse(const std::string_view src, std::vector<pa::Token>& tokens, pa::ConstantPool& constants, std::optional<pa::Parser>& parser) {
+        pa::alloc::Pass pass;
+        pa::alloc::Counts before = pa::alloc::counts();
+        tokens.clear();
+        constants.clear();
+        pa::Lexer(src, constants, pa::ErrorMode::Throw).tokenize(tokens);
+        pass.lexing = pa::alloc::counts() - before;
+        
+        before = pa::alloc::counts();
+        if (parser)
+                parser->reset(src, tokens, constants);
+        else
+                parser.emplace(src, tokens, constants, pa::ErrorMode::Throw);
+        pass.resetting = pa::alloc::counts() - before;
+        
+        while (parser->nextToken().type != pa::TokenType::Eof) {
+                size_t start = parser->nextToken().start;
+                before = pa::alloc::counts();
+                parser->parseStatement();
+                pa::alloc::Counts statement = pa::alloc::counts() - before;
+                pass.parsing += statement;
+                // Recorded outside the counted span, so growing the list doesn't show up as the parser allocating
+                if (statement.allocations != 0)
+                        pass.allocating_statements.emplace_back(start, statement);
+        }
+        return pass;
+}
+
+pa::alloc::Measurement pa::alloc::measureLexAndParse(const std::string_view src) {
+        std::vector<pa::Token> tokens;
+        pa::ConstantPool constants;
+        std::optional<pa::Parser> parser;
+        Measurement measurement;
+        measurement.cold = lexAndParse(src, tokens, constants, parser);
+        measurement.warm = lexAndParse(src, tokens, constants, parser);
+        return measurement;
+}
+
+#if defined(PA_COUNT_ALLOCATIONS)
+// The array and nothrow forms are left to the standard library, which implements them through these
+void* operator new(const std::size_t size) {
+        t_allocations++;
+        t_bytes += size;
+        if (void* memory = std::malloc(size == 0 ? 1 : size))
+                return memory;
+        throw std::bad_alloc();
+}
+
+void* operator new(const std::size_t size, const std::align_val_t alignment) {
+        t_allocations++;
+        t_bytes += size;
+        auto align = static_cast<std::size_t>(alignment);
+        if (void* memory = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align))
+                return memory;
+        throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+        std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+        std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+        std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+        std::free(memory);
+}
+#endif
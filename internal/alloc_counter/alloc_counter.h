@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "parser.h"
+
+// Counts the heap allocations of each thread, for checking that lexing and parsing stay off the heap once their buffers
+// have grown to fit a program. Counting replaces the global operator new and delete, so it is only compiled in when
+// building with -DPA_COUNT_ALLOCATIONS. Otherwise the counts stay at zero and nothing is replaced.
+// measureLexAndParse is the one measurement behind both --alloc-stats and fuzz/check_allocations.sh, which makes that
+// build and fails if a warm lex or parse of assets/ or a generated corpus allocates.
+
+namespace pa::alloc {
+#if defined(PA_COUNT_ALLOCATIONS)
+        inline constexpr bool Counting = true;
+#else
+        inline constexpr bool Counting = false;
+#endif
+        
+        struct Counts {
+                uint64_t allocations{0};
+                uint64_t bytes{0};
+                
+                [[nodiscard]] Counts operator-(const Counts& since) const { return {allocations - since.allocations, bytes - since.bytes}; }
+                Counts& operator+=(const Counts& other) {
+                        allocations += other.allocations;
+                        bytes += other.bytes;
+                        return *this;
+                }
+        };
+        
+        // What one lex and parse of a source allocated in each phase, and where each statement that allocated starts
+        struct Pass {
+                Counts lexing;
+                Counts resetting;
+                Counts parsing;
+                std::vector<std::pair<size_t, Counts>> allocating_statements;
+                
+                [[nodiscard]] bool allocated() const { return lexing.allocations != 0 || resetting.allocations != 0 || parsing.allocations != 0; }
+        };
+        
+        struct Measurement {
+                Pass cold;
+                Pass warm; // Into the token buffer, constant pool and parser left by the cold pass
+        };
+        
+        // Everything the calling thread has allocated so far
+        [[nodiscard]] Counts counts();
+        
+        // Lexes and parses src twice, the second time reusing the buffers of the first, counting what each phase allocated.
+        // Throws the CompileError of a source the lexer or parser rejects.
+        [[nodiscard]] Measurement measureLexAndParse(std::string_view src);
+}
@@ -0,0 +1,688 @@
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <unistd.h>
+#include "batch.h"
+
+namespace {
+        using pa::kernels::Comparison;
+        using pa::kernels::Operation;
+        
+        template<typename T>
+        std::span<const T> lanesOf(const std::vector<T>& values, const size_t size) {
+                return {values.data(), size};
+        }
+        
+        template<typename T>
+        std::span<T> lanesOf(std::vector<T>& values, const size_t size) {
+                return {values.data(), size};
+        }
+        
+        Comparison comparisonOf(const pa::TokenType operation) {
+                switch (operation) {
+                        case pa::TokenType::LessThan:
+                                return Comparison::Less;
+                        case pa::TokenType::LessThanOrEquals:
+                                return Comparison::LessOrEqual;
+                        case pa::TokenType::GreaterThan:
+                                return Comparison::Greater;
+                        case pa::TokenType::GreaterThanOrEquals:
+                                return Comparison::GreaterOrEqual;
+                        case pa::TokenType::EqualsEquals:
+                                return Comparison::Equal;
+                        default:
+                                return Comparison::NotEqual;
+                }
+        }
+        
+        Operation operationOf(const pa::TokenType operation) {
+                switch (operation) {
+                        case pa::TokenType::Plus:
+                                return Operation::Add;
+                        case pa::TokenType::Minus:
+                                return Operation::Subtract;
+                        case pa::TokenType::Asterisk:
+                                return Operation::Multiply;
+                        case pa::TokenType::ForwardSlash:
+                                return Operation::Divide;
+                        case pa::TokenType::And:
+                                return Operation::And;
+                        default:
+                                return Operation::Or;
+                }
+        }
+        
+        // The input parsers of the native runtime, which read as much of a line as makes sense and ignore the rest
+        size_t skipBlanksAndSign(const std::string_view line, bool& negative) {
+                size_t i = 0;
+                while (i < line.size() && (line[i] == ' ' || line[i] == '\t'))
+                        i++;
+                negative = i < line.size() && line[i] == '-';
+                if (i < line.size() && (line[i] == '-' || line[i] == '+'))
+                        i++;
+                return i;
+        }
+        
+        // Wraps around on overflow, as the native multiply and add do
+        int64_t parseInt(const std::string_view line) {
+                bool negative = false;
+                uint64_t value = 0;
+                for (size_t i = skipBlanksAndSign(line, negative); i < line.size() && static_cast<unsigned char>(line[i] - '0') <= 9; i++)
+                        value = value * 10 + static_cast<unsigned char>(line[i] - '0');
+                return static_cast<int64_t>(negative ? 0 - value : value);
+        }
+        
+        // The integer part accumulates as a double and the first 18 digits of the fraction as an int over the matching
+        // power of ten, each step rounded as the native one is
+        double parseFloat(const std::string_view line) {
+                bool negative = false;
+                size_t i = skipBlanksAndSign(line, negative);
+                double value = 0;
+                for (; i < line.size() && static_cast<unsigned char>(line[i] - '0') <= 9; i++) {
+                        value *= 10.0;
+                        value += static_cast<double>(line[i] - '0');
+                }
+                
+                if (i < line.size() && line[i] == '.') {
+                        int64_t digits = 0, scale = 1;
+                        for (i++; i < line.size() && static_cast<unsigned char>(line[i] - '0') <= 9; i++) {
+                                if (scale > 100000000000000000)
+                                        continue;
+                                digits = digits * 10 + (line[i] - '0');
+                                scale *= 10;
+                        }
+                        value += static_cast<double>(digits) / static_cast<double>(scale);
+                }
+                return negative ? -value : value;
+        }
+        
+        bool parseBool(const std::string_view line) {
+                bool negative = false;
+                size_t i = skipBlanksAndSign(line, negative);
+                return i < line.size() && (line[i] == 'T' || line[i] == 't' || line[i] == '1');
+        }
+        
+        void writeAll(const int fd, std::string_view bytes) {
+                while (!bytes.empty()) {
+                        ssize_t result = write(fd, bytes.data(), bytes.size());
+                        if (result < 0 && errno == EINTR)
+                                continue;
+                        // Stops early on an error, as the native runtime does
+                        if (result <= 0)
+                                return;
+                        bytes.remove_prefix(result);
+                }
+        }
+}
+
+pa::BatchRunner::BatchRunner(const std::string_view src, const std::span<const pa::Token> tokens, const pa::ConstantPool& constants, const size_t lanes)
+        : m_source(src), m_tokens(tokens), m_constants(constants), m_lanes(std::max<size_t>(lanes, 1)) {
+        while (peek().type != TokenType::Eof)
+                compileStatement();
+        for (Step& step: m_steps)
+                if (step.kind == Step::Kind::Print)
+                        step.ends.resize(m_lanes);
+}
+
+uint64_t pa::BatchRunner::run(const int input_fd, const int output_fd) {
+        uint64_t records = 0;
+        for (;;) {
+                size_t lanes = m_reads == 0 ? records == 0 : readRecords(input_fd);
+                if (lanes == 0)
+                        return records;
+                runBatch(lanes);
+                writeOutput(output_fd, lanes);
+                records += lanes;
+        }
+}
+
+
+void pa::BatchRunner::compileStatement() {
+        switch (peek().type) {
+                case TokenType::Int:
+                case TokenType::Bool:
+                case TokenType::Float:
+                case TokenType::Char:
+                case TokenType::String:
+                        compileDeclaration();
+                        break;
+                case TokenType::Identifier:
+                        compileAssignment();
+                        break;
+                case TokenType::Print:
+                        compilePrint();
+                        break;
+                case TokenType::Read:
+                        compileRead();
+                        break;
+                default:
+                        unsupported("compileStatement", peek(), std::format("A statement starting with {}", Token::typeToString(peek().type)));
+        }
+}
+
+// A redeclaration gets a column of its own, which like every column starts out zeroed for each batch
+void pa::BatchRunner::compileDeclaration() {
+        TokenType type = eat().type;
+        Token name = eat();
+        if (peek().type == TokenType::Array)
+                unsupported("compileDeclaration", name, "An array");
+        eat(); // ;
+        
+        m_scope[name.toString(m_source)] = m_slots.size();
+        m_slots.push_back(makeColumn(type, m_lanes));
+}
+
+void pa::BatchRunner::compileAssignment() {
+        Token name = eat();
+        eat(); // =
+        size_t slot = findSlot(name);
+        if (peek().type == TokenType::Load)
+                unsupported("compileAssignment", peek(), "Loading a file");
+        if (peek().type == TokenType::OpenCurly)
+                unsupported("compileAssignment", peek(), "An array literal");
+        
+        m_steps.push_back({Step::Kind::Assign, slot, 0, parseOr()});
+        eat(); // ;
+}
+
+void pa::BatchRunner::compilePrint() {
+        eat(); // print
+        eat(); // (
+        if (peek().type == TokenType::OpenCurly)
+                unsupported("compilePrint", peek(), "An array literal");
+        Expression expression = parseOr();
+        eat(); // )
+        eat(); // ;
+        m_steps.push_back({Step::Kind::Print, 0, 0, std::move(expression)});
+}
+
+// A variable takes the next line of the record, anything else just has it read past
+void pa::BatchRunner::compileRead() {
+        eat(); // read
+        eat(); // (
+        if (peek().type == TokenType::OpenCurly)
+                unsupported("compileRead", peek(), "An array literal");
+        Expression expression = parseOr();
+        eat(); // )
+        eat(); // ;
+        
+        if (expression.kind == Expression::Kind::Variable)
+                m_steps.push_back({Step::Kind::Read, expression.slot, m_reads++});
+        else
+                m_steps.push_back({Step::Kind::SkipLine, 0, m_reads++});
+}
+
+
+pa::BatchRunner::Expression pa::BatchRunner::parseOr() {
+        Expression expression = parseAnd();
+        while (peek().type == TokenType::Or) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parseAnd());
+        }
+        return expression;
+}
+
+pa::BatchRunner::Expression pa::BatchRunner::parseAnd() {
+        Expression expression = parseComparison();
+        while (peek().type == TokenType::And) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parseComparison());
+        }
+        return expression;
+}
+
+pa::BatchRunner::Expression pa::BatchRunner::parseComparison() {
+        Expression expression = parseAdditive();
+        while (peek().type >= TokenType::LessThan && peek().type <= TokenType::NotEquals) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parseAdditive());
+        }
+        return expression;
+}
+
+pa::BatchRunner::Expression pa::BatchRunner::parseAdditive() {
+        Expression expression = parseMultiplicative();
+        while (peek().type == TokenType::Plus || peek().type == TokenType::Minus) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parseMultiplicative());
+        }
+        return expression;
+}
+
+pa::BatchRunner::Expression pa::BatchRunner::parseMultiplicative() {
+        Expression expression = parsePrimary();
+        while (peek().type == TokenType::Asterisk || peek().type == TokenType::ForwardSlash) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parsePrimary());
+        }
+        return expression;
+}
+
+pa::BatchRunner::Expression pa::BatchRunner::parsePrimary() {
+        Token token = eat();
+        auto literal = [&](const TokenType type) {
+                Expression expression{Expression::Kind::Literal, token, type};
+                expression.value = makeColumn(type, 1);
+                return expression;
+        };
+        
+        switch (token.type) {
+                case TokenType::Not: {
+                        Expression operand = parsePrimary();
+                        if (operand.type == TokenType::String)
+                                unsupported("parsePrimary", token, "Not of a string");
+                        Expression expression{Expression::Kind::Not, token, TokenType::Bool};
+                        expression.value = makeColumn(TokenType::Bool, m_lanes);
+                        expression.operands.push_back(std::move(operand));
+                        return expression;
+                }
+                case TokenType::OpenParen: {
+                        Expression expression = parseOr();
+                        eat(); // )
+                        return expression;
+                }
+                case TokenType::Identifier: {
+                        size_t slot = findSlot(token);
+                        return {Expression::Kind::Variable, token, m_slots[slot].type, slot};
+                }
+                case TokenType::IntLiteral: {
+                        Expression expression = literal(TokenType::Int);
+                        expression.value.ints[0] = m_constants.intValue(token.constant);
+                        return expression;
+                }
+                case TokenType::FloatLiteral: {
+                        Expression expression = literal(TokenType::Float);
+                        expression.value.floats[0] = m_constants.floatValue(token.constant);
+                        return expression;
+                }
+                case TokenType::True:
+                case TokenType::False: {
+                        Expression expression = literal(TokenType::Bool);
+                        expression.value.ints[0] = token.type == TokenType::True;
+                        return expression;
+                }
+                case TokenType::CharLiteral: {
+                        Expression expression = literal(TokenType::Char);
+                        expression.value.ints[0] = static_cast<unsigned char>(m_constants.charValue(token.constant));
+                        return expression;
+                }
+                case TokenType::StringLiteral: {
+                        Expression expression = literal(TokenType::String);
+                        expression.value.strings[0] = m_constants.stringValue(token.constant);
+                        return expression;
+                }
+                default:
+                        unsupported("parsePrimary", token, std::format("An expression starting with {}", Token::typeToString(token.type)));
+        }
+}
+
+// Typed as the native backend types it: + of two strings joins them, comparisons and logic give bools, anything with a
+// float in it floats and everything else ints, bools and chars being ints to arithmetic
+pa::BatchRunner::Expression pa::BatchRunner::makeBinary(const pa::Token operation, pa::BatchRunner::Expression lhs, pa::BatchRunner::Expression rhs) {
+        Expression expression{Expression::Kind::Binary, operation, TokenType::Int};
+        
+        bool strings = lhs.type == TokenType::String || rhs.type == TokenType::String;
+        bool floating = lhs.type == TokenType::Float || rhs.type == TokenType::Float;
+        if (operation.type == TokenType::Plus && lhs.type == TokenType::String && rhs.type == TokenType::String)
+                expression.type = TokenType::String;
+        else if (strings)
+                unsupported("makeBinary", operation, std::format("{} on strings", Token::typeToString(operation.type)));
+        else if (operation.type >= TokenType::LessThan && operation.type <= TokenType::Or)
+                expression.type = TokenType::Bool;
+        else if (floating)
+                expression.type = TokenType::Float;
+        expression.value = makeColumn(expression.type, m_lanes);
+        
+        if (operation.type == TokenType::And || operation.type == TokenType::Or) {
+                expression.lhs = makeColumn(TokenType::Bool, m_lanes);
+                expression.rhs = makeColumn(TokenType::Bool, m_lanes);
+        } else if (floating) {
+                expression.lhs = makeColumn(TokenType::Float, m_lanes);
+                expression.rhs = makeColumn(TokenType::Float, m_lanes);
+        }
+        
+        expression.operands.push_back(std::move(lhs));
+        expression.operands.push_back(std::move(rhs));
+        return expression;
+}
+
+pa::BatchRunner::Column pa::BatchRunner::makeColumn(const pa::TokenType type, const size_t size) const {
+        Column column{type, size};
+        if (type == TokenType::Float)
+                column.floats.resize(size);
+        else if (type == TokenType::String)
+                column.strings.resize(size);
+        else
+                column.ints.resize(size);
+        return column;
+}
+
+
+size_t pa::BatchRunner::readRecords(const int input_fd) {
+        // The lines of the last batch are done with
+        m_input.erase(0, m_input_position);
+        m_input_position = 0;
+        m_lines.clear();
+        
+        // Lines are kept as readLine returns them, cut short and without a trailing carriage return
+        auto addLine = [&](const size_t begin, const size_t end) {
+                size_t size = std::min(end - begin, LineCapacity);
+                if (size != 0 && m_input[begin + size - 1] == '\r')
+                        size--;
+                m_lines.emplace_back(begin, size);
+        };
+        
+        size_t wanted = m_lanes * m_reads;
+        size_t scanned = 0; // Searched for a line break up to here
+        while (m_lines.size() < wanted) {
+                size_t from = std::max(scanned, m_input_position);
+                auto newline = static_cast<const char*>(std::memchr(m_input.data() + from, '\n', m_input.size() - from));
+                if (newline != nullptr) {
+                        size_t end = newline - m_input.data();
+                        addLine(m_input_position, end);
+                        m_input_position = end + 1;
+                        continue;
+                }
+                scanned = m_input.size();
+                
+                if (m_input_done) {
+                        // A last line without a line break is a line all the same
+                        if (m_input_position < m_input.size())
+                                addLine(m_input_position, m_input.size());
+                        m_input_position = m_input.size();
+                        break;
+                }
+                
+                size_t size = m_input.size();
+                ssize_t result = 0;
+                m_input.resize_and_overwrite(size + InputBlock, [&](char* data, size_t) {
+                        do
+                                result = read(input_fd, data + size, InputBlock);
+                        while (result < 0 && errno == EINTR);
+                        return size + std::max<ssize_t>(result, 0);
+                });
+                m_input_done = result <= 0;
+        }
+        
+        size_t records = (m_lines.size() + m_reads - 1) / m_reads;
+        m_lines.resize(records * m_reads, {0, 0});
+        return records;
+}
+
+void pa::BatchRunner::runBatch(const size_t lanes) {
+        for (Column& slot: m_slots) {
+                slot.size = lanes;
+                std::fill_n(slot.ints.begin(), std::min(lanes, slot.ints.size()), 0);
+                std::fill_n(slot.floats.begin(), std::min(lanes, slot.floats.size()), 0.0);
+                for (size_t i = 0; i < std::min(lanes, slot.strings.size()); i++)
+                        slot.strings[i].clear();
+        }
+        
+        for (Step& step: m_steps) {
+                switch (step.kind) {
+                        case Step::Kind::Assign:
+                                store(m_slots[step.slot], evaluate(step.expression, lanes), lanes);
+                                break;
+                        case Step::Kind::Read:
+                                runRead(step, lanes);
+                                break;
+                        case Step::Kind::SkipLine:
+                                break;
+                        case Step::Kind::Print:
+                                runPrint(step, lanes);
+                                break;
+                }
+        }
+}
+
+void pa::BatchRunner::runRead(pa::BatchRunner::Step& step, const size_t lanes) {
+        Column& target = m_slots[step.slot];
+        for (size_t i = 0; i < lanes; i++) {
+                auto [offset, size] = m_lines[i * m_reads + step.line];
+                std::string_view line(m_input.data() + offset, size);
+                switch (target.type) {
+                        case TokenType::Int:
+                                target.ints[i] = parseInt(line);
+                                break;
+                        case TokenType::Float:
+                                target.floats[i] = parseFloat(line);
+                                break;
+                        case TokenType::Bool:
+                                target.ints[i] = parseBool(line);
+                                break;
+                        case TokenType::Char:
+                                target.ints[i] = line.empty() ? 0 : static_cast<unsigned char>(line.front());
+                                break;
+                        default:
+                                target.strings[i].assign(line);
+                                break;
+                }
+        }
+}
+
+void pa::BatchRunner::runPrint(pa::BatchRunner::Step& step, const size_t lanes) {
+        const Column& value = evaluate(step.expression, lanes);
+        step.text.clear();
+        for (size_t i = 0; i < lanes; i++) {
+                appendValue(step.text, value, value.size == 1 ? 0 : i);
+                step.text.push_back('\n');
+                step.ends[i] = step.text.size();
+        }
+}
+
+// Each record puts out what every print gave it in turn, as it would running on its own
+void pa::BatchRunner::writeOutput(const int output_fd, const size_t lanes) {
+        m_output.clear();
+        for (size_t i = 0; i < lanes; i++)
+                for (const Step& step: m_steps)
+                        if (step.kind == Step::Kind::Print) {
+                                size_t begin = i == 0 ? 0 : step.ends[i - 1];
+                                m_output.append(step.text, begin, step.ends[i] - begin);
+                        }
+        writeAll(output_fd, m_output);
+}
+
+
+const pa::BatchRunner::Column& pa::BatchRunner::evaluate(pa::BatchRunner::Expression& expression, const size_t lanes) {
+        switch (expression.kind) {
+                case Expression::Kind::Literal:
+                        return expression.value;
+                case Expression::Kind::Variable:
+                        return m_slots[expression.slot];
+                case Expression::Kind::Not: {
+                        const Column& operand = evaluate(expression.operands.front(), lanes);
+                        Column& result = expression.value;
+                        result.size = operand.size;
+                        if (operand.type == TokenType::Float)
+                                kernels::truth(lanesOf(operand.floats, operand.size), lanesOf(result.ints, result.size), true);
+                        else
+                                kernels::truth(lanesOf(operand.ints, operand.size), lanesOf(result.ints, result.size), true);
+                        return result;
+                }
+                default:
+                        return evaluateBinary(expression, lanes);
+        }
+}
+
+const pa::BatchRunner::Column& pa::BatchRunner::evaluateBinary(pa::BatchRunner::Expression& expression, const size_t lanes) {
+        const Column& lhs = evaluate(expression.operands[0], lanes);
+        const Column& rhs = evaluate(expression.operands[1], lanes);
+        Column& result = expression.value;
+        result.size = lhs.size == 1 && rhs.size == 1 ? 1 : lanes;
+        TokenType operation = expression.token.type;
+        
+        if (result.type == TokenType::String) {
+                for (size_t i = 0; i < result.size; i++) {
+                        result.strings[i].assign(lhs.strings[lhs.size == 1 ? 0 : i]);
+                        result.strings[i].append(rhs.strings[rhs.size == 1 ? 0 : i]);
+                }
+                return result;
+        }
+        
+        if (operation == TokenType::And || operation == TokenType::Or) {
+                kernels::apply(operationOf(operation), asTruths(lhs, expression.lhs), asTruths(rhs, expression.rhs), lanesOf(result.ints, result.size));
+                return result;
+        }
+        
+        bool comparison = operation >= TokenType::LessThan && operation <= TokenType::NotEquals;
+        if (lhs.type == TokenType::Float || rhs.type == TokenType::Float) {
+                std::span<const double> l = asDoubles(lhs, expression.lhs), r = asDoubles(rhs, expression.rhs);
+                if (comparison)
+                        kernels::compare(comparisonOf(operation), l, r, lanesOf(result.ints, result.size));
+                else
+                        kernels::apply(operationOf(operation), l, r, lanesOf(result.floats, result.size));
+                return result;
+        }
+        
+        std::span<const int64_t> l = lanesOf(lhs.ints, lhs.size), r = lanesOf(rhs.ints, rhs.size);
+        if (comparison)
+                kernels::compare(comparisonOf(operation), l, r, lanesOf(result.ints, result.size));
+        else
+                kernels::apply(operationOf(operation), l, r, lanesOf(result.ints, result.size));
+        return result;
+}
+
+// A float stored into a char keeps the low byte of its bits, as the native store of a whole register does
+void pa::BatchRunner::store(pa::BatchRunner::Column& target, const pa::BatchRunner::Column& value, const size_t lanes) {
+        if (&target == &value)
+                return;
+        
+        size_t size = value.size;
+        switch (target.type) {
+                case TokenType::String:
+                        for (size_t i = 0; i < lanes; i++)
+                                target.strings[i].assign(value.strings[size == 1 ? 0 : i]);
+                        return;
+                case TokenType::Float:
+                        if (value.type == TokenType::Float)
+                                std::copy_n(value.floats.begin(), size, target.floats.begin());
+                        else
+                                kernels::convert(lanesOf(value.ints, size), lanesOf(target.floats, size));
+                        std::fill(target.floats.begin() + size, target.floats.begin() + lanes, target.floats[0]);
+                        return;
+                case TokenType::Int:
+                        if (value.type == TokenType::Float)
+                                kernels::convert(lanesOf(value.floats, size), lanesOf(target.ints, size));
+                        else
+                                std::copy_n(value.ints.begin(), size, target.ints.begin());
+                        break;
+                case TokenType::Bool:
+                        if (value.type == TokenType::Float)
+                                kernels::truth(lanesOf(value.floats, size), lanesOf(target.ints, size));
+                        else if (value.type != TokenType::Bool)
+                                kernels::truth(lanesOf(value.ints, size), lanesOf(target.ints, size));
+                        else
+                                std::copy_n(value.ints.begin(), size, target.ints.begin());
+                        break;
+                default:
+                        for (size_t i = 0; i < size; i++)
+                                target.ints[i] = (value.type == TokenType::Float ? std::bit_cast<int64_t>(value.floats[i]) : value.ints[i]) & 0xFF;
+                        break;
+        }
+        std::fill(target.ints.begin() + size, target.ints.begin() + lanes, target.ints[0]);
+}
+
+std::span<const double> pa::BatchRunner::asDoubles(const pa::BatchRunner::Column& column, pa::BatchRunner::Column& scratch) {
+        if (column.type == TokenType::Float)
+                return lanesOf(column.floats, column.size);
+        kernels::convert(lanesOf(column.ints, column.size), lanesOf(scratch.floats, column.size));
+        return lanesOf(scratch.floats, column.size);
+}
+
+std::span<const int64_t> pa::BatchRunner::asTruths(const pa::BatchRunner::Column& column, pa::BatchRunner::Column& scratch) {
+        if (column.type == TokenType::Bool)
+                return lanesOf(column.ints, column.size);
+        if (column.type == TokenType::Float)
+                kernels::truth(lanesOf(column.floats, column.size), lanesOf(scratch.ints, column.size));
+        else
+                kernels::truth(lanesOf(column.ints, column.size), lanesOf(scratch.ints, column.size));
+        return lanesOf(scratch.ints, column.size);
+}
+
+void pa::BatchRunner::appendValue(std::string& text, const pa::BatchRunner::Column& column, const size_t lane) {
+        switch (column.type) {
+                case TokenType::Int: {
+                        char digits[24];
+                        text.append(digits, std::to_chars(digits, std::end(digits), column.ints[lane]).ptr);
+                        break;
+                }
+                case TokenType::Float:
+                        appendFloat(text, column.floats[lane]);
+                        break;
+                case TokenType::Bool:
+                        text += column.ints[lane] != 0 ? "True" : "False";
+                        break;
+                case TokenType::Char:
+                        text.push_back(static_cast<char>(column.ints[lane]));
+                        break;
+                default:
+                        text += column.strings[lane];
+                        break;
+        }
+}
+
+// As printFloat does: the integer part as an int and the fraction rounded to six digits, leaving off the trailing zeros
+// but one, and from 1e15 up the value divided down to a single digit before the point, followed by the exponent
+void pa::BatchRunner::appendFloat(std::string& text, double value) {
+        auto bits = std::bit_cast<uint64_t>(value);
+        if ((bits >> 52 & 0x7FF) == 0x7FF) {
+                if (bits << 12 != 0) {
+                        text += "nan";
+                        return;
+                }
+                text += bits >> 63 ? "-inf" : "inf";
+                return;
+        }
+        if (bits >> 63) {
+                text.push_back('-');
+                value = std::bit_cast<double>(bits & ~(uint64_t(1) << 63));
+        }
+        
+        int64_t exponent = 0;
+        if (value >= 1e15) {
+                do {
+                        value /= 10.0;
+                        exponent++;
+                } while (value >= 10.0);
+        }
+        
+        auto integer = static_cast<int64_t>(value);
+        double fraction_part = value - static_cast<double>(integer);
+        fraction_part *= 1e6;
+        fraction_part += 0.5;
+        auto fraction = static_cast<int64_t>(fraction_part);
+        if (fraction >= 1000000) {
+                fraction -= 1000000;
+                integer++;
+        }
+        
+        char digits[24];
+        text.append(digits, std::to_chars(digits, std::end(digits), integer).ptr);
+        char decimals[7] = {'.'};
+        for (size_t i = 6; i >= 1; i--, fraction /= 10)
+                decimals[i] = static_cast<char>('0' + fraction % 10);
+        size_t size = 7;
+        while (size > 2 && decimals[size - 1] == '0')
+                size--;
+        text.append(decimals, size);
+        
+        if (exponent != 0) {
+                text.push_back('e');
+                text.append(digits, std::to_chars(digits, std::end(digits), exponent).ptr);
+        }
+}
+
+
+size_t pa::BatchRunner::findSlot(const pa::Token identifier) const {
+        const size_t* slot = m_scope.find(identifier.toString(m_source));
+        if (slot == nullptr)
+                unsupported("findSlot", identifier, "A variable used before its declaration");
+        return *slot;
+}
+
+void pa::BatchRunner::unsupported(const std::string_view rule_name, const pa::Token token, const std::string_view what) const {
+        reportError(ErrorMode::Throw, std::format("Batch Error({} {}): {} isn't supported in batches.", rule_name, token.start, what), token.start);
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "constant_pool.h"
+#include "error.h"
+#include "flat_map.h"
+#include "kernels.h"
+
+// Runs a checked program over many records at once, as if it were run once per record, for programs that read a few
+// values, compute and print. A record is as many lines of input as the program has reads, and the program is compiled
+// once into a list of steps that then each run over a batch of up to lanes records before the next step does.
+// Every scalar variable becomes a column of a value per record. Ints, bools and chars are columns of int64_t, floats of
+// double, and expressions on them run through the element-wise kernels, AVX2 where there is one. A literal is a single
+// value shared by every record. Reads parse a column out of a batch of lines read from the input in large blocks, each
+// print formats a column, and the output of the batch is then put together record by record and written in one go.
+// Values come out exactly as the native backend computes, parses and prints them: its precedence, int arithmetic that
+// wraps, division by zero giving zero, its float formatting and its reading of lines.
+// There being no control flow, every record runs the same steps. Arrays, loads and anything else the columns can't
+// hold are reported as a CompileError rather than run.
+
+namespace pa {
+        class BatchRunner {
+        public: // Static Data
+                static constexpr size_t DefaultLanes = 1 << 12;
+                static constexpr size_t InputBlock = 1 << 20;
+                static constexpr size_t LineCapacity = 1 << 12; // Longer lines are cut short, as the native runtime does
+        public: // Constructors/Destructors/Overloads
+                // src and constants have to be the ones tokens were lexed from, and the program has to have passed the Parser.
+                // They are only used while constructing.
+                BatchRunner(std::string_view src, std::span<const Token> tokens, const ConstantPool& constants, size_t lanes = DefaultLanes);
+        public: // Public Member Functions
+                // Runs every record read from input_fd until it runs out, writing what they print to output_fd, and returns
+                // how many records there were. A program without reads runs once. A partial record at the end reads empty
+                // lines for the rest, as the program would at the end of its input.
+                uint64_t run(int input_fd, int output_fd);
+        private: // Private Member Types
+                // A value per record, or a single one every record shares
+                struct Column {
+                        TokenType type{TokenType::Int}; // Int, Float, Bool, Char or String
+                        size_t size{0};
+                        std::vector<int64_t> ints{};     // Ints, bools as 0 or 1 and chars as 0 to 255
+                        std::vector<double> floats{};
+                        std::vector<std::string> strings{};
+                };
+                
+                struct Expression {
+                        enum class Kind {
+                                Literal,
+                                Variable,
+                                Not,
+                                Binary,
+                        };
+                        
+                        Kind kind;
+                        Token token;   // The literal, identifier or operator
+                        TokenType type;
+                        size_t slot{0}; // Of a variable
+                        std::vector<Expression> operands{};
+                        Column value{};      // The result, a literal holding its value from the start
+                        Column lhs{}, rhs{}; // The operands converted to what the operation works on
+                };
+                
+                struct Step {
+                        enum class Kind {
+                                Assign,
+                                Read,
+                                SkipLine,
+                                Print,
+                        };
+                        
+                        Kind kind;
+                        size_t slot{0};
+                        size_t line{0}; // Of the record, read or skipped
+                        Expression expression{};
+                        // What a print puts out for the batch, the output of record i ending at ends[i]
+                        std::string text{};
+                        std::vector<size_t> ends{};
+                };
+        private: // Private Member Functions
+                // Statements
+                void compileStatement();
+                void compileDeclaration();
+                void compileAssignment();
+                void compilePrint();
+                void compileRead();
+                
+                // Expressions, with the precedence and types of the native backend
+                Expression parseOr();
+                Expression parseAnd();
+                Expression parseComparison();
+                Expression parseAdditive();
+                Expression parseMultiplicative();
+                Expression parsePrimary();
+                Expression makeBinary(Token operation, Expression lhs, Expression rhs);
+                Column makeColumn(TokenType type, size_t size) const;
+                
+                // Gathers the lines of up to m_lanes records into m_lines, returning how many records there are
+                size_t readRecords(int input_fd);
+                void runBatch(size_t lanes);
+                void runRead(Step& step, size_t lanes);
+                void runPrint(Step& step, size_t lanes);
+                void writeOutput(int output_fd, size_t lanes);
+                
+                const Column& evaluate(Expression& expression, size_t lanes);
+                const Column& evaluateBinary(Expression& expression, size_t lanes);
+                // Converts value to the type of target, a variable, with a value in every lane
+                static void store(Column& target, const Column& value, size_t lanes);
+                // The ints or floats of column as doubles, converted into scratch unless they are floats already
+                static std::span<const double> asDoubles(const Column& column, Column& scratch);
+                static std::span<const int64_t> asTruths(const Column& column, Column& scratch);
+                static void appendValue(std::string& text, const Column& column, size_t lane);
+                static void appendFloat(std::string& text, double value);
+                
+                [[nodiscard]] const Token& peek() const { return m_tokens[m_next]; }
+                const Token& eat() { return m_tokens[m_next++]; }
+                [[nodiscard]] size_t findSlot(Token identifier) const;
+                [[noreturn]] void unsupported(std::string_view rule_name, Token token, std::string_view what) const;
+        private: // Private Member Variables
+                std::string_view m_source;
+                std::span<const Token> m_tokens;
+                const ConstantPool& m_constants;
+                size_t m_next{0};
+                
+                size_t m_lanes;
+                std::vector<Step> m_steps;
+                std::vector<Column> m_slots; // A column per declaration
+                FlatMap<std::string, size_t> m_scope; // Name -> slot of its latest declaration
+                size_t m_reads{0}; // Lines per record
+                
+                std::string m_input;
+                size_t m_input_position{0};
+                bool m_input_done{false};
+                std::vector<std::pair<size_t, size_t>> m_lines; // Offset into m_input and size, of each line of the batch
+                std::string m_output;
+        };
+}
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <format>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include "cache.h"
+#include "hash.h"
+#include "io.h"
+#include "version.h"
+
+template<typename T>
+static void appendValue(std::string& buffer, const T value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool readValue(std::string_view& bytes, T& value) {
+        if (bytes.size() < sizeof(T))
+                return false;
+        std::memcpy(&value, bytes.data(), sizeof(T));
+        bytes.remove_prefix(sizeof(T));
+        return true;
+}
+
+static bool readBytes(std::string_view& bytes, const uint64_t size, std::string& out) {
+        if (bytes.size() < size)
+                return false;
+        out = bytes.substr(0, size);
+        bytes.remove_prefix(size);
+        return true;
+}
+
+
+pa::CompilationCache::CompilationCache(std::filesystem::path directory, const uint64_t max_size) : m_directory(std::move(directory)), m_max_size(max_size) {}
+
+pa::CompilationCache::~CompilationCache() {
+        if (!m_flushed)
+                flushStatistics();
+}
+
+
+pa::CompilationCache::Key pa::CompilationCache::key(const std::string_view src, const std::string_view flags) {
+        return {
+                .hash = pa::hashBytes(src, pa::hashBytes(flags, pa::hashBytes(CompilerVersion))),
+                .check = pa::hashBytes(src, pa::hashBytes(flags, pa::hashBytes(CompilerVersion, CheckSeed))),
+                .source_size = src.size(),
+        };
+}
+
+std::optional<pa::CompilationCache::Entry> pa::CompilationCache::lookup(const pa::CompilationCache::Key& key) {
+        auto path = entryPath(key.hash);
+        io::MappedFile file(path.c_str());
+        
+        Entry entry;
+        std::string_view bytes = file.bytes();
+        char magic[sizeof(Magic)];
+        uint64_t check = 0;
+        uint64_t source_size = 0;
+        uint32_t succeeded = 0;
+        uint32_t artifact_count = 0;
+        uint64_t diagnostics_size = 0;
+        uint64_t notes_size = 0;
+        
+        bool valid = readValue(bytes, magic) && std::memcmp(magic, Magic, sizeof(Magic)) == 0
+                     && readValue(bytes, check) && readValue(bytes, source_size)
+                     && readValue(bytes, succeeded) && readValue(bytes, artifact_count)
+                     && readValue(bytes, diagnostics_size) && readBytes(bytes, diagnostics_size, entry.diagnostics)
+                     && readValue(bytes, notes_size) && readBytes(bytes, notes_size, entry.notes);
+        
+        for (uint32_t i = 0; valid && i < artifact_count; i++) {
+                Artifact& artifact = entry.artifacts.emplace_back();
+                uint64_t name_size = 0;
+                uint64_t data_size = 0;
+                valid = readValue(bytes, name_size) && readValue(bytes, data_size) && readBytes(bytes, name_size, artifact.name) && readBytes(bytes, data_size, artifact.data);
+        }
+        
+        if (!valid) {
+                // Missing, or left behind by something else entirely
+                if (file.isOpen())
+                        std::filesystem::remove(path);
+                m_statistics.misses++;
+                return std::nullopt;
+        }
+        
+        // The result of another source whose key collides with this one's, left for the store of this one to replace
+        if (check != key.check || source_size != key.source_size) {
+                m_statistics.misses++;
+                return std::nullopt;
+        }
+        
+        entry.succeeded = succeeded != 0;
+        
+        // Mark as recently used for eviction
+        std::error_code ignored;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ignored);
+        
+        m_statistics.hits++;
+        return entry;
+}
+
+void pa::CompilationCache::store(const pa::CompilationCache::Key& key, const pa::CompilationCache::Entry& entry) {
+        std::string buffer(Magic, sizeof(Magic));
+        appendValue<uint64_t>(buffer, key.check);
+        appendValue<uint64_t>(buffer, key.source_size);
+        appendValue<uint32_t>(buffer, entry.succeeded);
+        appendValue<uint32_t>(buffer, entry.artifacts.size());
+        appendValue<uint64_t>(buffer, entry.diagnostics.size());
+        buffer += entry.diagnostics;
+        appendValue<uint64_t>(buffer, entry.notes.size());
+        buffer += entry.notes;
+        for (const auto& artifact: entry.artifacts) {
+                appendValue<uint64_t>(buffer, artifact.name.size());
+                appendValue<uint64_t>(buffer, artifact.data.size());
+                buffer += artifact.name;
+                buffer += artifact.data;
+        }
+        
+        auto path = entryPath(key.hash);
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+        if (error || !io::writeFileAtomic(path.c_str(), buffer))
+                return;
+        m_statistics.stores++;
+        
+        if (!m_size) {
+                m_size = 0;
+                for (const auto& file: std::filesystem::recursive_directory_iterator(m_directory, error))
+                        if (file.is_regular_file(error))
+                                *m_size += file.file_size(error);
+        } else {
+                *m_size += buffer.size();
+        }
+        
+        if (*m_size > m_max_size)
+                evict();
+}
+
+pa::CompilationCache::Statistics pa::CompilationCache::flushStatistics() {
+        m_flushed = true;
+        auto path = m_directory / "stats";
+        
+        std::error_code error;
+        std::filesystem::create_directories(m_directory, error);
+        
+        // The statistics file itself is replaced through a rename, so the lock is held on a file of its own. Without one
+        // (a read-only directory, say) the totals are still merged, only no longer safe against concurrent runs.
+        auto lock_path = m_directory / "stats.lock";
+        int lock = open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lock >= 0)
+                while (flock(lock, LOCK_EX) != 0 && errno == EINTR) {}
+        
+        Statistics total;
+        std::ifstream(path) >> total.hits >> total.misses >> total.stores >> total.evictions;
+        total.hits += m_statistics.hits;
+        total.misses += m_statistics.misses;
+        total.stores += m_statistics.stores;
+        total.evictions += m_statistics.evictions;
+        io::writeFileAtomic(path.c_str(), std::format("{} {} {} {}\n", total.hits, total.misses, total.stores, total.evictions));
+        
+        if (lock >= 0)
+                close(lock);
+        return total;
+}
+
+
+// Entries fan out over 256 subdirectories so no single directory grows huge
+std::filesystem::path pa::CompilationCache::entryPath(const uint64_t key) const {
+        auto name = std::format("{:016x}", key);
+        return m_directory / name.substr(0, 2) / name.substr(2);
+}
+
+void pa::CompilationCache::evict() {
+        struct CachedFile {
+                std::filesystem::path path;
+                std::filesystem::file_time_type last_used;
+                uint64_t size;
+        };
+        
+        std::error_code error;
+        std::vector<CachedFile> files;
+        uint64_t size = 0;
+        for (const auto& file: std::filesystem::recursive_directory_iterator(m_directory, error)) {
+                // Only entries live in the fan out directories, the statistics file and its lock sit at the top level
+                if (!file.is_regular_file(error) || file.path().parent_path() == m_directory)
+                        continue;
+                files.push_back({file.path(), file.last_write_time(error), file.file_size(error)});
+                size += files.back().size;
+        }
+        
+        // Evict down to 90% so the next few stores don't immediately trigger another scan
+        std::sort(files.begin(), files.end(), [](const CachedFile& l, const CachedFile& r) { return l.last_used < r.last_used; });
+        for (const auto& file: files) {
+                if (size <= m_max_size / 10 * 9)
+                        break;
+                if (std::filesystem::remove(file.path, error)) {
+                        size -= file.size;
+                        m_statistics.evictions++;
+                }
+        }
+        
+        m_size = size;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A local, content addressed cache of compile results, shared by every run pointed at the same directory.
+// Entries are keyed by a hash of the source bytes, the compiler version and the flags that affect the result, and hold
+// whether the check succeeded, its diagnostics, the backends' notes and any emitted artifacts. Each entry also records
+// the size of its source and a second hash seeded apart from the first, so that a collision of the first is a miss
+// rather than another program's result. Entries are written through a rename so concurrent runs never see a partial
+// one. A hit refreshes the entry's modification time, and once the directory grows past its size limit the least
+// recently used entries are evicted. The all-time statistics are merged under an flock, so concurrent runs don't lose
+// each other's counts.
+
+namespace pa {
+        class CompilationCache {
+        public: // Static Data
+                static constexpr char Magic[8] = {'P', 'A', 'C', 'A', 'C', 'H', 'E', '3'};
+                static constexpr uint64_t DefaultMaxSize = uint64_t(1) << 30;
+                static constexpr uint64_t CheckSeed = 0xC2B2AE3D27D4EB4Full;
+                
+                struct Key {
+                        uint64_t hash{0};        // Names the entry
+                        uint64_t check{0};       // Stored in it, hashed from the same bytes with CheckSeed
+                        uint64_t source_size{0}; // Stored in it as well
+                };
+                
+                struct Artifact {
+                        std::string name;
+                        std::string data;
+                };
+                
+                struct Entry {
+                        bool succeeded{false};
+                        std::string diagnostics;
+                        std::string notes; // What the backends had to say, replayed after the status line
+                        std::vector<Artifact> artifacts;
+                };
+                
+                struct Statistics {
+                        uint64_t hits{0};
+                        uint64_t misses{0};
+                        uint64_t stores{0};
+                        uint64_t evictions{0};
+                };
+        public: // Constructors/Destructors/Overloads
+                CompilationCache(std::filesystem::path directory, uint64_t max_size = DefaultMaxSize);
+                ~CompilationCache();
+        public: // Public Member Functions
+                static Key key(std::string_view src, std::string_view flags);
+                
+                std::optional<Entry> lookup(const Key& key);
+                void store(const Key& key, const Entry& entry);
+                
+                [[nodiscard]] const Statistics& statistics() const { return m_statistics; }
+                
+                // Adds this run's statistics to the totals kept in the cache directory and returns the new totals
+                Statistics flushStatistics();
+        
+        public: // Public Member Variables
+        private: // Private Member Functions
+                [[nodiscard]] std::filesystem::path entryPath(uint64_t key) const;
+                void evict();
+        private: // Private Member Variables
+                std::filesystem::path m_directory;
+                uint64_t m_max_size;
+                
+                std::optional<uint64_t> m_size; // Estimated directory size, only scanned once something is stored
+                Statistics m_statistics;
+                bool m_flushed{false};
+        };
+}
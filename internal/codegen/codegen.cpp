@@ -0,0 +1,1363 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <limits>
+#include "codegen.h"
+#include "table.h"
+
+using enum pa::x86::Register;
+using enum pa::x86::Condition;
+using enum pa::x86::Xmm;
+using enum pa::x86::Ymm;
+using pa::x86::Arithmetic;
+using pa::x86::Section;
+using pa::x86::at;
+
+namespace {
+        constexpr uint64_t Unassigned = std::numeric_limits<uint64_t>::max();
+        
+        bool isScalar(const std::vector<size_t>& sizes) {
+                return sizes.size() == 1 && sizes.front() == 1;
+        }
+        
+        template<typename T>
+        void appendBytes(std::string& image, const T value) {
+                char bytes[sizeof(T)];
+                std::memcpy(bytes, &value, sizeof(T));
+                image.append(bytes, sizeof(T));
+        }
+        
+        // Adds the runs of bytes that aren't zero, bytes starting at byte first of the storage, joining runs at most gap apart.
+        // Returns how many bytes the runs grew by.
+        uint64_t appendRuns(std::vector<pa::CodeGenerator::Snapshot::Run>& runs, const uint64_t first, const std::string_view bytes, const uint64_t gap) {
+                uint64_t added = 0;
+                auto nonzero = [](const char byte) { return byte != '\0'; };
+                for (auto start = std::ranges::find_if(bytes, nonzero); start != bytes.end();) {
+                        auto end = std::find(start, bytes.end(), '\0');
+                        uint64_t offset = first + (start - bytes.begin());
+                        if (!runs.empty() && offset <= runs.back().first + runs.back().bytes.size() + gap) {
+                                added += offset - runs.back().first - runs.back().bytes.size();
+                                runs.back().bytes.resize(offset - runs.back().first, '\0');
+                        } else
+                                runs.push_back({offset, {}});
+                        runs.back().bytes.append(start, end);
+                        added += end - start;
+                        start = std::find_if(end, bytes.end(), nonzero);
+                }
+                return added;
+        }
+}
+
+uint64_t pa::CodeGenerator::Expression::count() const {
+        uint64_t count = 1;
+        for (size_t size: sizes)
+                count *= size;
+        return count;
+}
+
+pa::CodeGenerator::CodeGenerator(const std::string_view src, const std::span<const pa::Token> tokens, const pa::ConstantPool& constants, const std::string_view name, const bool profile)
+        : m_source(src), m_tokens(tokens), m_constants(constants), m_name(name), m_lines(src), m_runtime(m_assembler),
+          m_string_bytes(constants.strings().size(), Unassigned), m_string_descriptors(constants.strings().size(), Unassigned) {
+        // Every statement ends in the only semicolons there are
+        if (profile)
+                m_profiler.emplace(m_assembler, m_runtime, name, std::ranges::count(tokens, TokenType::SemiColon, &Token::type));
+}
+
+pa::x86::Image pa::CodeGenerator::generate() {
+        return generateProgram();
+}
+
+pa::x86::Image pa::CodeGenerator::generateStopping() {
+        m_stopping = true;
+        return generateProgram();
+}
+
+pa::x86::Image pa::CodeGenerator::generateResuming(const pa::CodeGenerator::Snapshot& snapshot) {
+        m_resuming = &snapshot;
+        return generateProgram();
+}
+
+// Reading the storage of each variable a block at a time, so that a large mapping that is mostly zeroes never has to be
+// held whole
+pa::CodeGenerator::Snapshot pa::CodeGenerator::capture(const pa::jit::StoppedProgram& program) const {
+        constexpr uint64_t Block = 1 << 20;
+        auto read = [&](const uint64_t address, char* bytes, const uint64_t size) {
+                if (!program.read(address, bytes, size))
+                        reportError(ErrorMode::Throw, std::format("Snapshot Error: Couldn't read {} bytes of the stopped program at {:#x}.", size, address));
+        };
+        uint64_t total = 0;
+        auto count = [&](const uint64_t bytes) {
+                total += bytes;
+                if (total > MaxSnapshotBytes)
+                        reportError(ErrorMode::Throw, std::format("Snapshot Error: The variables take more than {} bytes at the snapshot point.", MaxSnapshotBytes));
+        };
+        
+        Snapshot snapshot{program.output()};
+        count(snapshot.output.size());
+        std::string block;
+        for (const Variable* variable: m_snapshot_variables) {
+                Snapshot::Storage& storage = snapshot.variables.emplace_back();
+                uint64_t address = program.bss() + variable->offset;
+                if (variable->mapped)
+                        read(address, reinterpret_cast<char*>(&address), sizeof(address));
+                
+                uint64_t bytes = storageBytes(variable->type, variable->count);
+                for (uint64_t first = 0; first < bytes; first += Block) {
+                        block.resize(std::min(Block, bytes - first));
+                        read(address + first, block.data(), block.size());
+                        if (variable->type != TokenType::String) {
+                                count(appendRuns(storage.runs, first, block, MaxImageGap));
+                                continue;
+                        }
+                        
+                        for (size_t descriptor = 0; descriptor < block.size(); descriptor += 16) {
+                                uint64_t pointer = 0, size = 0;
+                                std::memcpy(&pointer, block.data() + descriptor, 8);
+                                std::memcpy(&size, block.data() + descriptor + 8, 8);
+                                count(size);
+                                std::string& string = storage.strings.emplace_back(size, '\0');
+                                if (size != 0)
+                                        read(pointer, string.data(), size);
+                        }
+                }
+        }
+        return snapshot;
+}
+
+pa::x86::Image pa::CodeGenerator::generateProgram() {
+        x86::Label entry = m_assembler.newLabel();
+        m_assembler.bind(entry);
+        m_runtime.initialize();
+        if (m_profiler)
+                m_profiler->emitStart();
+        if (m_resuming) {
+                m_restore = m_assembler.newLabel();
+                m_assembler.jump(m_restore);
+        }
+        
+        while (peek().type != TokenType::Eof) {
+                if (peek().type == TokenType::Read && !m_snapshot_point_passed)
+                        emitSnapshotPoint();
+                const Token& first = peek();
+                uint64_t start = m_assembler.position();
+                if (m_profiler)
+                        m_profiler->beginStatement();
+                generateStatement();
+                
+                Statement statement = locateStatement(first, m_tokens[m_next - 1]);
+                if (m_profiler)
+                        m_profiler->endStatement(statement.line, statement.column, statement.text);
+                // Declarations without initializers emit no code to name
+                if (m_assembler.position() != start)
+                        m_assembler.addSymbol(std::format("{}:{}:{} {}", m_name, statement.line, statement.column, statement.text), start, m_assembler.position() - start,
+                                              static_cast<uint32_t>(statement.line));
+        }
+        if (!m_snapshot_point_passed)
+                emitSnapshotPoint();
+        
+        if (m_profiler)
+                m_assembler.call(m_profiler->report);
+        m_assembler.jump(m_runtime.exit);
+        if (m_profiler)
+                m_profiler->emitReport();
+        return m_assembler.finish(entry);
+}
+
+std::vector<pa::CodeGenerator::VariableMemory> pa::CodeGenerator::memoryUsage() const {
+        std::vector<VariableMemory> usage;
+        for (const Variable& variable: m_variables)
+                usage.push_back({variable.declaration.line, variable.declaration.column, variable.declaration.text, storageBytes(variable.type, variable.count),
+                                 variable.mapped, variable.image_bytes});
+        if (m_temporary_capacity != 0)
+                usage.push_back({0, 0, "temporaries of array expressions", m_temporary_capacity, m_temporary.mapped, m_temporary.image_bytes});
+        return usage;
+}
+
+
+void pa::CodeGenerator::generateStatement() {
+        switch (peek().type) {
+                case TokenType::Int:
+                case TokenType::Bool:
+                case TokenType::Float:
+                case TokenType::Char:
+                case TokenType::String:
+                        generateDeclaration();
+                        break;
+                case TokenType::Identifier:
+                        generateAssignment();
+                        break;
+                case TokenType::Print:
+                        generatePrint();
+                        break;
+                case TokenType::Read:
+                        generateRead();
+                        break;
+                default:
+                        unsupported("generateStatement", peek(), std::format("A statement starting with {}", Token::typeToString(peek().type)));
+        }
+}
+pa::CodeGenerator::Statement pa::CodeGenerator::locateStatement(const pa::Token& first, const pa::Token& last) {
+        // Semicolons (which could only be in string literals) are replaced too, since they split the frames of folded stacks
+        LineIndex::Location location = m_lines.locate(first.start);
+        Statement statement{location.line, location.column};
+        for (char c: m_source.substr(first.start, last.end - first.start)) {
+                if (c == '\n' || c == '\r' || c == '\t' || c == ' ') {
+                        if (!statement.text.empty() && statement.text.back() != ' ')
+                                statement.text.push_back(' ');
+                } else
+                        statement.text.push_back(c == ';' ? ',' : c);
+        }
+        return statement;
+}
+
+void pa::CodeGenerator::generateDeclaration() {
+        const Token& first = peek();
+        TokenType type = eat().type;
+        Token name = eat();
+        
+        std::vector<size_t> sizes;
+        while (peek().type == TokenType::Array) {
+                int64_t extent = m_constants.intValue(eat().constant);
+                if (extent <= 0)
+                        unsupported("generateDeclaration", name, "An array with an extent of 0");
+                sizes.push_back(extent);
+        }
+        const Token& semicolon = eat();
+        
+        bool array = !sizes.empty();
+        if (!array)
+                sizes = {1};
+        declare(name, type, std::move(sizes), array, locateStatement(first, semicolon));
+}
+
+void pa::CodeGenerator::generateAssignment() {
+        Token name = eat();
+        eat(); // =
+        Variable& target = findVariable(name);
+        
+        if (peek().type == TokenType::Load) {
+                eat();
+                eat(); // (
+                Token path = eat();
+                eat(); // )
+                generateLoad(target, path);
+        } else
+                emitAssignment(target, parseExpression());
+        
+        eat(); // ;
+}
+
+// The file was read by the Parser already, and is read again here to bake its contents into .rodata
+void pa::CodeGenerator::generateLoad(pa::CodeGenerator::Variable& target, const pa::Token path) {
+        std::string file_path(m_constants.stringValue(path.constant));
+        Table table(file_path.c_str(), target.type, target.sizes);
+        if (!table.error().empty())
+                unsupported("generateLoad", path, std::format("Loading '{}', which no longer matches its declaration,", file_path));
+        
+        std::string image;
+        std::vector<std::pair<uint64_t, uint64_t>> pointers;
+        switch (target.type) {
+                case TokenType::Int:
+                        image.assign(reinterpret_cast<const char*>(table.ints().data()), table.ints().size_bytes());
+                        break;
+                case TokenType::Float:
+                        image.assign(reinterpret_cast<const char*>(table.floats().data()), table.floats().size_bytes());
+                        break;
+                case TokenType::Char:
+                        image.assign(table.chars().data(), table.chars().size());
+                        break;
+                case TokenType::Bool:
+                        image.assign(storageBytes(TokenType::Bool, table.bools().size()), '\0');
+                        for (size_t i = 0; i < table.bools().size(); i++)
+                                image[i / 8] = static_cast<char>(image[i / 8] | (table.bools()[i] != 0) << i % 8);
+                        break;
+                case TokenType::String:
+                        for (std::string_view string: table.strings()) {
+                                pointers.emplace_back(image.size(), m_assembler.addData(Section::Rodata, string, 1));
+                                appendBytes<uint64_t>(image, 0);
+                                appendBytes<uint64_t>(image, string.size());
+                        }
+                        break;
+                default:
+                        unsupported("generateLoad", path, std::format("Loading an array of {}", Token::typeToString(target.type)));
+        }
+        
+        emitCopyFromRodata(target, addRodataImage(image, pointers), image.size());
+        target.zeroed = false;
+}
+
+void pa::CodeGenerator::generatePrint() {
+        eat(); // print
+        eat(); // (
+        Expression expression = parseExpression();
+        eat(); // )
+        eat(); // ;
+        
+        if (expression.kind == Expression::Kind::Variable && expression.variable->array) {
+                emitPrintArray(*expression.variable);
+                return;
+        }
+        if (expression.array || expression.kind == Expression::Kind::ArrayLiteral) {
+                Variable& temporary = this->temporary(expression);
+                emitAssignment(temporary, expression);
+                emitPrintArray(temporary);
+                return;
+        }
+        
+        emitExpression(expression, false);
+        m_assembler.mov(Rdi, Rax);
+        switch (expression.type) {
+                case TokenType::Int:
+                        emitCall(m_runtime.printInt, NativeProfiler::Cost::IO);
+                        break;
+                case TokenType::Float:
+                        emitCall(m_runtime.printFloat, NativeProfiler::Cost::IO);
+                        break;
+                case TokenType::Bool:
+                        emitCall(m_runtime.printBool, NativeProfiler::Cost::IO);
+                        break;
+                case TokenType::Char:
+                        emitCall(m_runtime.printChar, NativeProfiler::Cost::IO);
+                        break;
+                case TokenType::String:
+                        emitCall(m_runtime.printString, NativeProfiler::Cost::IO);
+                        break;
+                default:
+                        unsupported("generatePrint", expression.token, std::format("Printing a value of type {}", Token::typeToString(expression.type)));
+        }
+        emitCall(m_runtime.printNewline, NativeProfiler::Cost::IO);
+}
+
+// A variable takes a line per element, anything else just has a line read past
+void pa::CodeGenerator::generateRead() {
+        eat(); // read
+        eat(); // (
+        Expression expression = parseExpression();
+        eat(); // )
+        eat(); // ;
+        
+        if (expression.kind != Expression::Kind::Variable) {
+                emitCall(m_runtime.readLine, NativeProfiler::Cost::IO);
+                return;
+        }
+        
+        Variable& target = findVariable(expression.token);
+        target.zeroed = false;
+        forEachElement(target.count, [&](const bool indexed) {
+                emitCall(m_runtime.readLine, NativeProfiler::Cost::IO);
+                m_assembler.mov(Rsi, Rax);
+                switch (target.type) {
+                        case TokenType::Int:
+                                emitCall(m_runtime.parseInt, NativeProfiler::Cost::IO);
+                                break;
+                        case TokenType::Float:
+                                emitCall(m_runtime.parseFloat, NativeProfiler::Cost::IO);
+                                break;
+                        case TokenType::Bool:
+                                emitCall(m_runtime.parseBool, NativeProfiler::Cost::IO);
+                                break;
+                        case TokenType::Char:
+                                emitCall(m_runtime.parseChar, NativeProfiler::Cost::IO);
+                                break;
+                        default:
+                                emitCall(m_runtime.copyString, NativeProfiler::Cost::Strings);
+                                break;
+                }
+                emitStore(target, target.type, indexed);
+        });
+}
+
+
+pa::CodeGenerator::Expression pa::CodeGenerator::parseExpression() {
+        if (peek().type == TokenType::OpenCurly)
+                return parseArrayLiteral();
+        return parseOr();
+}
+
+pa::CodeGenerator::Expression pa::CodeGenerator::parseArrayLiteral() {
+        Expression literal{Expression::Kind::ArrayLiteral, eat(), TokenType::ALL, {}, true};
+        
+        while (peek().type != TokenType::CloseCurly) {
+                Expression element = parseExpression();
+                if (literal.type == TokenType::ALL)
+                        literal.type = element.type;
+                literal.operands.push_back(std::move(element));
+                
+                if (peek().type == TokenType::Comma)
+                        eat();
+        }
+        eat(); // }
+        
+        // The inner extents are those of the first nested literal with any elements, the Parser having checked the rest agree
+        const Expression* shape = nullptr;
+        for (const Expression& element: literal.operands)
+                if (element.kind == Expression::Kind::ArrayLiteral && (shape == nullptr || (shape->count() == 0 && element.count() != 0)))
+                        shape = &element;
+        
+        literal.sizes = {literal.operands.size()};
+        if (shape != nullptr)
+                literal.sizes.insert(literal.sizes.end(), shape->sizes.begin(), shape->sizes.end());
+        return literal;
+}
+
+pa::CodeGenerator::Expression pa::CodeGenerator::parseOr() {
+        Expression expression = parseAnd();
+        while (peek().type == TokenType::Or) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parseAnd());
+        }
+        return expression;
+}
+
+pa::CodeGenerator::Expression pa::CodeGenerator::parseAnd() {
+        Expression expression = parseComparison();
+        while (peek().type == TokenType::And) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parseComparison());
+        }
+        return expression;
+}
+
+pa::CodeGenerator::Expression pa::CodeGenerator::parseComparison() {
+        Expression expression = parseAdditive();
+        while (peek().type >= TokenType::LessThan && peek().type <= TokenType::NotEquals) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parseAdditive());
+        }
+        return expression;
+}
+
+pa::CodeGenerator::Expression pa::CodeGenerator::parseAdditive() {
+        Expression expression = parseMultiplicative();
+        while (peek().type == TokenType::Plus || peek().type == TokenType::Minus) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parseMultiplicative());
+        }
+        return expression;
+}
+
+pa::CodeGenerator::Expression pa::CodeGenerator::parseMultiplicative() {
+        Expression expression = parsePrimary();
+        while (peek().type == TokenType::Asterisk || peek().type == TokenType::ForwardSlash) {
+                Token operation = eat();
+                expression = makeBinary(operation, std::move(expression), parsePrimary());
+        }
+        return expression;
+}
+
+pa::CodeGenerator::Expression pa::CodeGenerator::parsePrimary() {
+        Token token = eat();
+        switch (token.type) {
+                case TokenType::Not: {
+                        Expression operand = parsePrimary();
+                        if (operand.type == TokenType::String)
+                                unsupported("parsePrimary", token, "Not of a string");
+                        Expression expression{Expression::Kind::Not, token, TokenType::Bool, operand.sizes, operand.array};
+                        expression.operands.push_back(std::move(operand));
+                        return expression;
+                }
+                case TokenType::OpenParen: {
+                        Expression expression = parseOr();
+                        eat(); // )
+                        return expression;
+                }
+                case TokenType::Identifier: {
+                        const Variable& variable = findVariable(token);
+                        return {Expression::Kind::Variable, token, variable.type, variable.sizes, variable.array, &variable};
+                }
+                case TokenType::IntLiteral:
+                        return {Expression::Kind::Literal, token, TokenType::Int};
+                case TokenType::FloatLiteral:
+                        return {Expression::Kind::Literal, token, TokenType::Float};
+                case TokenType::True:
+                case TokenType::False:
+                        return {Expression::Kind::Literal, token, TokenType::Bool};
+                case TokenType::CharLiteral:
+                        return {Expression::Kind::Literal, token, TokenType::Char};
+                case TokenType::StringLiteral:
+                        return {Expression::Kind::Literal, token, TokenType::String};
+                default:
+                        unsupported("parsePrimary", token, std::format("An expression starting with {}", Token::typeToString(token.type)));
+        }
+}
+
+pa::CodeGenerator::Expression pa::CodeGenerator::makeBinary(const pa::Token operation, pa::CodeGenerator::Expression lhs, pa::CodeGenerator::Expression rhs) {
+        Expression expression{Expression::Kind::Binary, operation, TokenType::Int};
+        
+        bool strings = lhs.type == TokenType::String || rhs.type == TokenType::String;
+        if (operation.type == TokenType::Plus && lhs.type == TokenType::String && rhs.type == TokenType::String)
+                expression.type = TokenType::String;
+        else if (strings)
+                unsupported("makeBinary", operation, std::format("{} on strings", Token::typeToString(operation.type)));
+        else if (operation.type >= TokenType::LessThan && operation.type <= TokenType::Or)
+                expression.type = TokenType::Bool;
+        else if (lhs.type == TokenType::Float || rhs.type == TokenType::Float)
+                expression.type = TokenType::Float;
+        
+        if (isScalar(lhs.sizes))
+                expression.sizes = rhs.sizes;
+        else if (isScalar(rhs.sizes) || lhs.sizes == rhs.sizes)
+                expression.sizes = lhs.sizes;
+        else
+                unsupported("makeBinary", operation, "An element-wise operation on arrays of different shapes");
+        
+        expression.array = lhs.array || rhs.array;
+        expression.operands.push_back(std::move(lhs));
+        expression.operands.push_back(std::move(rhs));
+        return expression;
+}
+
+
+void pa::CodeGenerator::emitCall(const pa::x86::Label routine, const pa::NativeProfiler::Cost cost) {
+        if (m_profiler)
+                m_profiler->call(routine, cost);
+        else
+                m_assembler.call(routine);
+}
+
+void pa::CodeGenerator::emitExpression(const pa::CodeGenerator::Expression& expression, const bool indexed) {
+        x86::Assembler& a = m_assembler;
+        switch (expression.kind) {
+                case Expression::Kind::Literal:
+                        switch (expression.token.type) {
+                                case TokenType::IntLiteral:
+                                        a.mov(Rax, m_constants.intValue(expression.token.constant));
+                                        break;
+                                case TokenType::FloatLiteral:
+                                        a.mov(Rax, std::bit_cast<int64_t>(m_constants.floatValue(expression.token.constant)));
+                                        break;
+                                case TokenType::CharLiteral:
+                                        a.mov(Rax, static_cast<unsigned char>(m_constants.charValue(expression.token.constant)));
+                                        break;
+                                case TokenType::StringLiteral:
+                                        a.lea(Rax, a.global(Section::Rodata, stringDescriptor(expression.token.constant)));
+                                        break;
+                                default:
+                                        a.mov(Rax, expression.token.type == TokenType::True);
+                                        break;
+                        }
+                        break;
+                case Expression::Kind::Variable:
+                        if (expression.type == TokenType::Bool) {
+                                emitLoadBit(*expression.variable, indexed);
+                                break;
+                        }
+                        emitElementAddress(Rax, *expression.variable, indexed);
+                        if (expression.type != TokenType::String)
+                                a.load(Rax, at(Rax), static_cast<int>(elementSize(expression.type)));
+                        break;
+                case Expression::Kind::Not:
+                        emitExpression(expression.operands.front(), indexed);
+                        emitTruth(Rax, expression.operands.front().type);
+                        a.set(Equal, Rax);
+                        break;
+                case Expression::Kind::Binary:
+                        emitBinary(expression, indexed);
+                        break;
+                case Expression::Kind::ArrayLiteral:
+                        unsupported("emitExpression", expression.token, "An array literal within an expression");
+        }
+}
+
+void pa::CodeGenerator::emitBinary(const pa::CodeGenerator::Expression& expression, const bool indexed) {
+        x86::Assembler& a = m_assembler;
+        const Expression& lhs = expression.operands[0];
+        const Expression& rhs = expression.operands[1];
+        
+        // lhs in rax, rhs in rcx
+        emitExpression(lhs, indexed);
+        a.push(Rax);
+        emitExpression(rhs, indexed);
+        a.mov(Rcx, Rax);
+        a.pop(Rax);
+        
+        TokenType operation = expression.token.type;
+        bool floating = lhs.type == TokenType::Float || rhs.type == TokenType::Float;
+        
+        if (expression.type == TokenType::String) {
+                a.mov(Rdi, Rax);
+                a.mov(Rsi, Rcx);
+                emitCall(m_runtime.concatenate, NativeProfiler::Cost::Strings);
+        } else if (operation == TokenType::And || operation == TokenType::Or) {
+                emitTruth(Rax, lhs.type);
+                a.set(NotEqual, Rax);
+                emitTruth(Rcx, rhs.type);
+                a.set(NotEqual, Rcx);
+                a.arithmetic(operation == TokenType::And ? Arithmetic::And : Arithmetic::Or, Rax, Rcx);
+        } else if (expression.type == TokenType::Bool && floating) {
+                emitToDouble(Xmm0, Rax, lhs.type);
+                emitToDouble(Xmm1, Rcx, rhs.type);
+                // Unordered compares set every flag but overflow, so < and <= are turned around into the conditions that
+                // come out false for NaN, and == and != also look at the parity flag
+                switch (operation) {
+                        case TokenType::LessThan:
+                        case TokenType::LessThanOrEquals:
+                                a.ucomisd(Xmm1, Xmm0);
+                                a.set(operation == TokenType::LessThan ? Above : AboveOrEqual, Rax);
+                                break;
+                        case TokenType::GreaterThan:
+                        case TokenType::GreaterThanOrEquals:
+                                a.ucomisd(Xmm0, Xmm1);
+                                a.set(operation == TokenType::GreaterThan ? Above : AboveOrEqual, Rax);
+                                break;
+                        case TokenType::EqualsEquals:
+                                a.ucomisd(Xmm0, Xmm1);
+                                a.set(Equal, Rax);
+                                a.set(NoParity, Rcx);
+                                a.arithmetic(Arithmetic::And, Rax, Rcx);
+                                break;
+                        default:
+                                a.ucomisd(Xmm0, Xmm1);
+                                a.set(NotEqual, Rax);
+                                a.set(Parity, Rcx);
+                                a.arithmetic(Arithmetic::Or, Rax, Rcx);
+                                break;
+                }
+        } else if (expression.type == TokenType::Bool) {
+                a.arithmetic(Arithmetic::Cmp, Rax, Rcx);
+                switch (operation) {
+                        case TokenType::LessThan:
+                                a.set(Less, Rax);
+                                break;
+                        case TokenType::LessThanOrEquals:
+                                a.set(LessOrEqual, Rax);
+                                break;
+                        case TokenType::GreaterThan:
+                                a.set(Greater, Rax);
+                                break;
+                        case TokenType::GreaterThanOrEquals:
+                                a.set(GreaterOrEqual, Rax);
+                                break;
+                        case TokenType::EqualsEquals:
+                                a.set(Equal, Rax);
+                                break;
+                        default:
+                                a.set(NotEqual, Rax);
+                                break;
+                }
+        } else if (floating) {
+                emitToDouble(Xmm0, Rax, lhs.type);
+                emitToDouble(Xmm1, Rcx, rhs.type);
+                switch (operation) {
+                        case TokenType::Plus:
+                                a.scalarDouble(x86::ScalarDouble::Add, Xmm0, Xmm1);
+                                break;
+                        case TokenType::Minus:
+                                a.scalarDouble(x86::ScalarDouble::Subtract, Xmm0, Xmm1);
+                                break;
+                        case TokenType::Asterisk:
+                                a.scalarDouble(x86::ScalarDouble::Multiply, Xmm0, Xmm1);
+                                break;
+                        default:
+                                a.scalarDouble(x86::ScalarDouble::Divide, Xmm0, Xmm1);
+                                break;
+                }
+                a.movq(Rax, Xmm0);
+        } else {
+                switch (operation) {
+                        case TokenType::Plus:
+                                a.arithmetic(Arithmetic::Add, Rax, Rcx);
+                                break;
+                        case TokenType::Minus:
+                                a.arithmetic(Arithmetic::Sub, Rax, Rcx);
+                                break;
+                        case TokenType::Asterisk:
+                                a.imul(Rax, Rcx);
+                                break;
+                        default: {
+                                // Dividing by zero gives zero, and by -1 is a negation so INT64_MIN / -1 doesn't trap
+                                x86::Label nonzero = a.newLabel(), divide = a.newLabel(), done = a.newLabel();
+                                a.test(Rcx, Rcx);
+                                a.jump(NotEqual, nonzero);
+                                a.mov(Rax, 0);
+                                a.jump(done);
+                                a.bind(nonzero);
+                                a.arithmetic(Arithmetic::Cmp, Rcx, -1);
+                                a.jump(NotEqual, divide);
+                                a.neg(Rax);
+                                a.jump(done);
+                                a.bind(divide);
+                                a.cqo();
+                                a.idiv(Rcx);
+                                a.bind(done);
+                                break;
+                        }
+                }
+        }
+}
+
+// A float is true unless it is zero of either sign, which shifting the sign out leaves just the one of
+void pa::CodeGenerator::emitTruth(const pa::x86::Register value, const pa::TokenType type) {
+        if (type == TokenType::Float)
+                m_assembler.shift(x86::Shift::Left, value, 1);
+        m_assembler.test(value, value);
+}
+
+void pa::CodeGenerator::emitToDouble(const pa::x86::Xmm destination, const pa::x86::Register source, const pa::TokenType type) {
+        if (type == TokenType::Float)
+                m_assembler.movq(destination, source);
+        else
+                m_assembler.cvtsi2sd(destination, source);
+}
+
+void pa::CodeGenerator::emitStore(const pa::CodeGenerator::Variable& target, const pa::TokenType type, const bool indexed) {
+        x86::Assembler& a = m_assembler;
+        switch (target.type) {
+                case TokenType::String:
+                        emitElementAddress(Rdi, target, indexed);
+                        a.load(Rcx, at(Rax));
+                        a.store(at(Rdi), Rcx);
+                        a.load(Rcx, at(Rax, 8));
+                        a.store(at(Rdi, 8), Rcx);
+                        return;
+                case TokenType::Float:
+                        if (type != TokenType::Float) {
+                                a.cvtsi2sd(Xmm0, Rax);
+                                a.movq(Rax, Xmm0);
+                        }
+                        break;
+                case TokenType::Int:
+                        if (type == TokenType::Float) {
+                                a.movq(Xmm0, Rax);
+                                a.cvttsd2si(Rax, Xmm0);
+                        }
+                        break;
+                case TokenType::Bool:
+                        if (type != TokenType::Bool) {
+                                emitTruth(Rax, type);
+                                a.set(NotEqual, Rax);
+                        }
+                        emitStoreBit(target, indexed);
+                        return;
+                default:
+                        break;
+        }
+        
+        emitElementAddress(Rdi, target, indexed);
+        a.store(at(Rdi), Rax, static_cast<int>(elementSize(target.type)));
+}
+
+void pa::CodeGenerator::emitElementAddress(const pa::x86::Register destination, const pa::CodeGenerator::Variable& variable, const bool indexed) {
+        x86::Assembler& a = m_assembler;
+        auto offset = static_cast<int32_t>(variable.offset);
+        if (variable.mapped) {
+                a.load(destination, at(NativeRuntime::StorageBase, offset));
+                if (!indexed || variable.count == 1)
+                        return;
+                // Strings are 16 bytes, more than a scale can take
+                uint64_t size = elementSize(variable.type);
+                for (uint64_t scaled = 0; scaled < size; scaled += 8)
+                        a.lea(destination, at(destination, NativeRuntime::ElementIndex, static_cast<uint8_t>(std::min<uint64_t>(size, 8))));
+                return;
+        }
+        if (!indexed || variable.count == 1) {
+                a.lea(destination, at(NativeRuntime::StorageBase, offset));
+                return;
+        }
+        
+        uint64_t size = elementSize(variable.type);
+        if (size <= 8) {
+                a.lea(destination, at(NativeRuntime::StorageBase, NativeRuntime::ElementIndex, static_cast<uint8_t>(size), offset));
+                return;
+        }
+        a.mov(destination, NativeRuntime::ElementIndex);
+        a.shift(x86::Shift::Left, destination, 4);
+        a.lea(destination, at(NativeRuntime::StorageBase, destination, 1, offset));
+}
+
+void pa::CodeGenerator::emitStorageAddress(const pa::x86::Register destination, const pa::CodeGenerator::Variable& variable) {
+        if (variable.mapped)
+                m_assembler.load(destination, at(NativeRuntime::StorageBase, static_cast<int32_t>(variable.offset)));
+        else
+                m_assembler.lea(destination, at(NativeRuntime::StorageBase, static_cast<int32_t>(variable.offset)));
+}
+
+void pa::CodeGenerator::emitLoadBit(const pa::CodeGenerator::Variable& variable, const bool indexed) {
+        x86::Assembler& a = m_assembler;
+        if (!indexed || variable.count == 1) {
+                emitStorageAddress(Rax, variable);
+                a.load(Rax, at(Rax), 1);
+                if (variable.count != 1)
+                        a.arithmetic(Arithmetic::And, Rax, 1);
+                return;
+        }
+        
+        emitStorageAddress(Rax, variable);
+        a.bitTest(x86::BitTest::Test, at(Rax), NativeRuntime::ElementIndex);
+        a.set(Below, Rax);
+}
+
+// rax is 0 or 1, as every bool is
+void pa::CodeGenerator::emitStoreBit(const pa::CodeGenerator::Variable& target, const bool indexed) {
+        x86::Assembler& a = m_assembler;
+        emitStorageAddress(Rdi, target);
+        if (target.count == 1) {
+                a.store(at(Rdi), Rax, 1);
+                return;
+        }
+        if (!indexed) {
+                a.load(Rcx, at(Rdi), 1);
+                a.arithmetic(Arithmetic::And, Rcx, -2);
+                a.arithmetic(Arithmetic::Or, Rcx, Rax);
+                a.store(at(Rdi), Rcx, 1);
+                return;
+        }
+        
+        x86::Label clear = a.newLabel(), done = a.newLabel();
+        a.test(Rax, Rax);
+        a.jump(Equal, clear);
+        a.bitTest(x86::BitTest::Set, at(Rdi), NativeRuntime::ElementIndex);
+        a.jump(done);
+        a.bind(clear);
+        a.bitTest(x86::BitTest::Reset, at(Rdi), NativeRuntime::ElementIndex);
+        a.bind(done);
+}
+
+void pa::CodeGenerator::emitAssignment(pa::CodeGenerator::Variable& target, const pa::CodeGenerator::Expression& expression) {
+        x86::Assembler& a = m_assembler;
+        if (expression.kind == Expression::Kind::ArrayLiteral) {
+                emitArrayLiteral(target, expression);
+                target.zeroed = false;
+                return;
+        }
+        target.zeroed = false;
+        
+        uint64_t count = expression.count();
+        if (count != target.count && count != 1)
+                unsupported("emitAssignment", expression.token, "Assigning an array of a different size");
+        
+        // A whole variable of the same type is copied as it is
+        if (expression.kind == Expression::Kind::Variable && expression.type == target.type && count == target.count) {
+                if (expression.variable == &target)
+                        return;
+                emitStorageAddress(Rsi, *expression.variable);
+                emitStorageAddress(Rdi, target);
+                a.mov(Rcx, static_cast<int64_t>(storageBytes(target.type, count)));
+                a.repMovsb();
+                return;
+        }
+        
+        size_t scalars = 0;
+        if (count == target.count && count >= MinVectorElements && expression.type == target.type
+            && (target.type == TokenType::Int || target.type == TokenType::Float)) {
+                size_t registers = vectorRegisters(expression, target.type, count, scalars);
+                if (registers != 0 && registers <= 16 && scalars <= MaxVectorScalars) {
+                        emitVectorAssignment(target, expression);
+                        return;
+                }
+        }
+        
+        forEachElement(target.count, [&](const bool indexed) {
+                emitExpression(expression, indexed);
+                emitStore(target, expression.type, indexed);
+        });
+}
+
+size_t pa::CodeGenerator::vectorRegisters(const pa::CodeGenerator::Expression& expression, const pa::TokenType type, const uint64_t count, size_t& scalars) {
+        if (expression.count() == 1) {
+                if (expression.type != TokenType::Int && expression.type != TokenType::Float && expression.type != TokenType::Bool && expression.type != TokenType::Char)
+                        return 0;
+                scalars++;
+                return 1;
+        }
+        // Ints would have to be converted to floats a lane at a time, and bools are packed
+        if (expression.type != type || expression.count() != count)
+                return 0;
+        if (expression.kind == Expression::Kind::Variable)
+                return 1;
+        
+        TokenType operation = expression.token.type;
+        if (expression.kind != Expression::Kind::Binary
+            || (operation != TokenType::Plus && operation != TokenType::Minus && operation != TokenType::Asterisk
+                && (operation != TokenType::ForwardSlash || type != TokenType::Float)))
+                return 0;
+        size_t lhs = vectorRegisters(expression.operands[0], type, count, scalars);
+        size_t rhs = vectorRegisters(expression.operands[1], type, count, scalars);
+        if (lhs == 0 || rhs == 0)
+                return 0;
+        // Multiplying ints takes two more for the high halves
+        return std::max({lhs, rhs + 1, type == TokenType::Int && operation == TokenType::Asterisk ? size_t{4} : size_t{2}});
+}
+
+// The loop is a routine of its own, jumped over here, so that vectorLoop can run it on several threads
+void pa::CodeGenerator::emitVectorAssignment(const pa::CodeGenerator::Variable& target, const pa::CodeGenerator::Expression& expression) {
+        x86::Assembler& a = m_assembler;
+        if (m_vector_scalars == Unassigned)
+                m_vector_scalars = a.reserveBss(MaxVectorScalars * 8);
+        size_t slot = 0;
+        emitVectorScalars(expression, target.type, slot);
+        
+        x86::Label skip = a.newLabel(), loop = a.newLabel(), done = a.newLabel();
+        a.jump(skip);
+        uint64_t routine = a.position();
+        a.bind(loop);
+        a.arithmetic(Arithmetic::Cmp, Rdi, Rsi);
+        a.jump(AboveOrEqual, done);
+        slot = 0;
+        emitVector(expression, target.type, Ymm0, slot);
+        a.vmovupd(emitVectorAddress(target), Ymm0);
+        a.arithmetic(Arithmetic::Add, Rdi, 4);
+        a.jump(loop);
+        a.bind(done);
+        a.vzeroupper();
+        a.ret();
+        a.bind(skip);
+        
+        a.lea(Rdi, a.global(Section::Text, routine));
+        a.mov(Rsi, static_cast<int64_t>(target.count));
+        a.call(m_runtime.vectorLoop);
+        
+        // The elements left over (or all of them, without AVX2) one at a time
+        x86::Label tail = a.newLabel(), finished = a.newLabel();
+        a.mov(NativeRuntime::ElementIndex, Rax);
+        a.bind(tail);
+        a.mov(Rcx, static_cast<int64_t>(target.count));
+        a.arithmetic(Arithmetic::Cmp, NativeRuntime::ElementIndex, Rcx);
+        a.jump(AboveOrEqual, finished);
+        emitExpression(expression, true);
+        emitStore(target, expression.type, true);
+        a.arithmetic(Arithmetic::Add, NativeRuntime::ElementIndex, 1);
+        a.jump(tail);
+        a.bind(finished);
+}
+
+void pa::CodeGenerator::emitVectorScalars(const pa::CodeGenerator::Expression& expression, const pa::TokenType type, size_t& slot) {
+        if (expression.count() != 1) {
+                for (const Expression& operand: expression.operands)
+                        emitVectorScalars(operand, type, slot);
+                return;
+        }
+        
+        emitExpression(expression, false);
+        if (type == TokenType::Float) {
+                emitToDouble(Xmm0, Rax, expression.type);
+                m_assembler.movq(Rax, Xmm0);
+        }
+        m_assembler.store(at(NativeRuntime::StorageBase, static_cast<int32_t>(m_vector_scalars + 8 * slot++)), Rax);
+}
+
+void pa::CodeGenerator::emitVector(const pa::CodeGenerator::Expression& expression, const pa::TokenType type, const pa::x86::Ymm destination, size_t& slot) {
+        x86::Assembler& a = m_assembler;
+        if (expression.count() == 1) {
+                a.vbroadcastsd(destination, at(NativeRuntime::StorageBase, static_cast<int32_t>(m_vector_scalars + 8 * slot++)));
+                return;
+        }
+        if (expression.kind == Expression::Kind::Variable) {
+                a.vmovupd(destination, emitVectorAddress(*expression.variable));
+                return;
+        }
+        
+        auto after = [&](const uint8_t n) { return static_cast<x86::Ymm>(static_cast<uint8_t>(destination) + n); };
+        x86::Ymm rhs = after(1);
+        emitVector(expression.operands[0], type, destination, slot);
+        emitVector(expression.operands[1], type, rhs, slot);
+        switch (expression.token.type) {
+                case TokenType::Plus:
+                        a.packed(type == TokenType::Float ? x86::Packed::AddDouble : x86::Packed::AddInt, destination, destination, rhs);
+                        break;
+                case TokenType::Minus:
+                        a.packed(type == TokenType::Float ? x86::Packed::SubtractDouble : x86::Packed::SubtractInt, destination, destination, rhs);
+                        break;
+                case TokenType::Asterisk:
+                        if (type == TokenType::Float) {
+                                a.packed(x86::Packed::MultiplyDouble, destination, destination, rhs);
+                                break;
+                        }
+                        {
+                                // AVX2 only multiplies 32-bit halves, so the low 64 bits of the product are lo * lo plus the two
+                                // cross products shifted up, hi * hi falling off the top
+                                x86::Ymm cross = after(2), other = after(3);
+                                a.packedShift(x86::PackedShift::LogicalRight, cross, destination, 32);
+                                a.packed(x86::Packed::MultiplyUnsigned, cross, cross, rhs);
+                                a.packedShift(x86::PackedShift::LogicalRight, other, rhs, 32);
+                                a.packed(x86::Packed::MultiplyUnsigned, other, other, destination);
+                                a.packed(x86::Packed::AddInt, cross, cross, other);
+                                a.packedShift(x86::PackedShift::Left, cross, cross, 32);
+                                a.packed(x86::Packed::MultiplyUnsigned, destination, destination, rhs);
+                                a.packed(x86::Packed::AddInt, destination, destination, cross);
+                        }
+                        break;
+                default:
+                        a.packed(x86::Packed::DivideDouble, destination, destination, rhs);
+                        break;
+        }
+}
+
+pa::x86::Memory pa::CodeGenerator::emitVectorAddress(const pa::CodeGenerator::Variable& variable) {
+        if (!variable.mapped)
+                return at(NativeRuntime::StorageBase, Rdi, 8, static_cast<int32_t>(variable.offset));
+        m_assembler.load(Rax, at(NativeRuntime::StorageBase, static_cast<int32_t>(variable.offset)));
+        return at(Rax, Rdi, 8);
+}
+
+void pa::CodeGenerator::emitArrayLiteral(pa::CodeGenerator::Variable& target, const pa::CodeGenerator::Expression& literal) {
+        x86::Assembler& a = m_assembler;
+        std::vector<std::pair<uint64_t, const Expression*>> elements;
+        flattenArrayLiteral(target, literal, 0, 0, elements);
+        uint64_t size = elementSize(target.type);
+        uint64_t bytes = storageBytes(target.type, target.count);
+        // Where an element starts in the storage, and how many bytes from there it reaches into, bools sharing their bytes
+        bool bits = target.type == TokenType::Bool;
+        uint64_t width = bits ? 1 : size;
+        auto byteOf = [&](const uint64_t index) { return bits ? index / 8 : index * size; };
+        
+        bool literals = elements.size() >= MinRodataLiterals;
+        for (auto [index, element]: elements)
+                literals = literals && element->kind == Expression::Kind::Literal && element->type == target.type;
+        
+        // Elements left out of the literal are zeroed, unless nothing has been written over the zeroes they started out as.
+        // A mapping goes back to the kernel's zeroed pages, giving up the memory written.
+        if (elements.size() < target.count && !target.zeroed && target.mapped) {
+                emitStorageAddress(Rdi, target);
+                a.mov(Rsi, static_cast<int64_t>(bytes));
+                a.call(m_runtime.clearStorage);
+        } else if (elements.size() < target.count && !target.zeroed) {
+                emitStorageAddress(Rdi, target);
+                a.mov(Rcx, static_cast<int64_t>(bytes));
+                a.mov(Rax, 0);
+                a.repStosb();
+        }
+        
+        if (literals) {
+                // The elements come in order, each run of them close enough together getting an image of its own. Elements
+                // left out between them are zero in the image, as they are to end up.
+                for (size_t run = 0; run < elements.size();) {
+                        uint64_t first = byteOf(elements[run].first);
+                        size_t end = run + 1;
+                        while (end < elements.size() && byteOf(elements[end].first) <= byteOf(elements[end - 1].first) + width + MaxImageGap)
+                                end++;
+                        
+                        std::string image(byteOf(elements[end - 1].first) + width - first, '\0');
+                        std::vector<std::pair<uint64_t, uint64_t>> pointers;
+                        for (auto [index, element]: std::span(elements).subspan(run, end - run)) {
+                                Token token = element->token;
+                                char* destination = image.data() + byteOf(index) - first;
+                                switch (token.type) {
+                                        case TokenType::IntLiteral: {
+                                                int64_t value = m_constants.intValue(token.constant);
+                                                std::memcpy(destination, &value, size);
+                                                break;
+                                        }
+                                        case TokenType::FloatLiteral: {
+                                                double value = m_constants.floatValue(token.constant);
+                                                std::memcpy(destination, &value, size);
+                                                break;
+                                        }
+                                        case TokenType::CharLiteral:
+                                                *destination = m_constants.charValue(token.constant);
+                                                break;
+                                        case TokenType::StringLiteral: {
+                                                uint64_t string_size = m_constants.stringValue(token.constant).size();
+                                                pointers.emplace_back(byteOf(index) - first, stringBytes(token.constant));
+                                                std::memcpy(destination + 8, &string_size, 8);
+                                                break;
+                                        }
+                                        default:
+                                                *destination = static_cast<char>(*destination | (token.type == TokenType::True) << index % 8);
+                                                break;
+                                }
+                        }
+                        emitCopyFromRodata(target, addRodataImage(image, pointers), image.size(), first);
+                        run = end;
+                }
+                return;
+        }
+        
+        for (auto [index, element]: elements) {
+                if (target.count > 1)
+                        a.mov(NativeRuntime::ElementIndex, static_cast<int64_t>(index));
+                emitExpression(*element, false);
+                emitStore(target, element->type, true);
+        }
+}
+
+void pa::CodeGenerator::flattenArrayLiteral(const pa::CodeGenerator::Variable& target, const pa::CodeGenerator::Expression& literal, const size_t depth, const uint64_t first, std::vector<std::pair<uint64_t, const pa::CodeGenerator::Expression*>>& elements) {
+        // An empty literal leaves its elements zeroed however deep the Parser let it go
+        if (literal.operands.empty())
+                return;
+        if (depth >= target.sizes.size() || literal.operands.size() > target.sizes[depth])
+                unsupported("flattenArrayLiteral", literal.token, "An array literal that doesn't match the shape of its variable");
+        
+        uint64_t block = 1;
+        for (size_t i = depth + 1; i < target.sizes.size(); i++)
+                block *= target.sizes[i];
+        
+        for (size_t i = 0; i < literal.operands.size(); i++) {
+                const Expression& element = literal.operands[i];
+                if (element.kind == Expression::Kind::ArrayLiteral)
+                        flattenArrayLiteral(target, element, depth + 1, first + i * block, elements);
+                else if (depth + 1 == target.sizes.size() && element.count() == 1)
+                        elements.emplace_back(first + i, &element);
+                else
+                        unsupported("flattenArrayLiteral", element.token, "An array literal that doesn't match the shape of its variable");
+        }
+}
+
+void pa::CodeGenerator::emitCopyFromRodata(pa::CodeGenerator::Variable& target, const uint64_t offset, const uint64_t size, const uint64_t first) {
+        target.image_bytes += size;
+        m_assembler.lea(Rsi, m_assembler.global(Section::Rodata, offset));
+        emitStorageAddress(Rdi, target);
+        if (first != 0) {
+                m_assembler.mov(Rcx, static_cast<int64_t>(first));
+                m_assembler.arithmetic(Arithmetic::Add, Rdi, Rcx);
+        }
+        m_assembler.mov(Rcx, static_cast<int64_t>(size));
+        m_assembler.repMovsb();
+}
+
+void pa::CodeGenerator::emitPrintArray(const pa::CodeGenerator::Variable& variable) {
+        x86::Assembler& a = m_assembler;
+        emitStorageAddress(Rdi, variable);
+        a.mov(Rsi, static_cast<int64_t>(variable.count));
+        a.mov(Rdx, static_cast<int64_t>(elementKind(variable.type)));
+        a.lea(Rcx, a.global(Section::Rodata, blockSizes(variable.sizes)));
+        a.mov(R8, static_cast<int64_t>(variable.sizes.size()));
+        emitCall(m_runtime.printArray, NativeProfiler::Cost::IO);
+        emitCall(m_runtime.printNewline, NativeProfiler::Cost::IO);
+}
+
+void pa::CodeGenerator::emitSnapshotPoint() {
+        m_snapshot_point_passed = true;
+        for (const auto& [name, variable]: m_scope)
+                m_snapshot_variables.push_back(variable);
+        std::ranges::sort(m_snapshot_variables, {}, &Variable::offset);
+        
+        if (m_stopping)
+                m_assembler.call(m_runtime.snapshot);
+        if (!m_resuming)
+                return;
+        uint64_t start = m_assembler.position();
+        emitRestore(*m_resuming);
+        m_assembler.addSymbol(std::format("{}:snapshot", m_name), start, m_assembler.position() - start);
+}
+
+// Only what isn't zero is copied, everything else being in zeroed .bss or freshly mapped
+void pa::CodeGenerator::emitRestore(const pa::CodeGenerator::Snapshot& snapshot) {
+        x86::Assembler& a = m_assembler;
+        a.bind(m_restore);
+        if (snapshot.variables.size() != m_snapshot_variables.size())
+                reportError(ErrorMode::Throw, "Snapshot Error: The snapshot was taken of a different program.");
+        
+        if (!snapshot.output.empty()) {
+                a.lea(Rsi, a.global(Section::Rodata, a.addData(Section::Rodata, snapshot.output, 1)));
+                a.mov(Rdx, static_cast<int64_t>(snapshot.output.size()));
+                a.call(m_runtime.write);
+        }
+        
+        // The mappings the statements before would have made, the temporary's included
+        for (const Variable* variable: m_snapshot_variables)
+                if (variable->mapped) {
+                        a.mov(Rdi, static_cast<int64_t>(storageBytes(variable->type, variable->count)));
+                        a.call(m_runtime.mapStorage);
+                        a.store(at(NativeRuntime::StorageBase, static_cast<int32_t>(variable->offset)), Rax);
+                }
+        if (m_temporary_capacity != 0 && m_temporary.mapped) {
+                a.mov(Rdi, static_cast<int64_t>(m_temporary_capacity));
+                a.call(m_runtime.mapStorage);
+                a.store(at(NativeRuntime::StorageBase, static_cast<int32_t>(m_temporary.offset)), Rax);
+        }
+        
+        FlatMap<std::string, uint64_t> strings;
+        for (size_t i = 0; i < m_snapshot_variables.size(); i++) {
+                Variable& variable = *m_snapshot_variables[i];
+                const Snapshot::Storage& storage = snapshot.variables[i];
+                for (const Snapshot::Run& run: storage.runs)
+                        emitCopyFromRodata(variable, addRodataImage(run.bytes, {}), run.bytes.size(), run.first);
+                
+                // Runs of descriptors of the strings that aren't empty, each pointing at its bytes
+                for (size_t run = 0; run < storage.strings.size();) {
+                        if (storage.strings[run].empty()) {
+                                run++;
+                                continue;
+                        }
+                        size_t end = run + 1;
+                        for (size_t next = end; next < storage.strings.size() && (next - end) * 16 <= MaxImageGap; next++)
+                                if (!storage.strings[next].empty())
+                                        end = next + 1;
+                        
+                        std::string image;
+                        std::vector<std::pair<uint64_t, uint64_t>> pointers;
+                        for (size_t element = run; element < end; element++) {
+                                const std::string& string = storage.strings[element];
+                                if (!string.empty()) {
+                                        auto [bytes, added] = strings.tryEmplace(string, 0);
+                                        if (added)
+                                                *bytes = a.addData(Section::Rodata, string, 1);
+                                        pointers.emplace_back(image.size(), *bytes);
+                                }
+                                appendBytes<uint64_t>(image, 0);
+                                appendBytes<uint64_t>(image, string.size());
+                        }
+                        emitCopyFromRodata(variable, addRodataImage(image, pointers), image.size(), run * 16);
+                        run = end;
+                }
+        }
+}
+
+template<typename Body>
+void pa::CodeGenerator::forEachElement(const uint64_t count, const Body& body) {
+        if (count == 0)
+                return;
+        if (count == 1) {
+                body(false);
+                return;
+        }
+        
+        x86::Assembler& a = m_assembler;
+        x86::Label loop = a.newLabel();
+        a.mov(NativeRuntime::ElementIndex, 0);
+        a.bind(loop);
+        body(true);
+        a.arithmetic(Arithmetic::Add, NativeRuntime::ElementIndex, 1);
+        a.mov(Rcx, static_cast<int64_t>(count));
+        a.arithmetic(Arithmetic::Cmp, NativeRuntime::ElementIndex, Rcx);
+        a.jump(Below, loop);
+}
+
+
+pa::CodeGenerator::Variable& pa::CodeGenerator::declare(const pa::Token name, const pa::TokenType type, std::vector<size_t> sizes, const bool array, Statement declaration) {
+        Variable variable{type, std::move(sizes), 1, 0, array};
+        variable.declaration = std::move(declaration);
+        reserveStorage(name, variable);
+        m_variables.push_back(std::move(variable));
+        
+        // The declaration hidden can't be named any more
+        Variable*& latest = m_scope[name.toString(m_source)];
+        if (latest != nullptr && latest->mapped)
+                emitUnmap(*latest);
+        latest = &m_variables.back();
+        return m_variables.back();
+}
+
+pa::CodeGenerator::Variable& pa::CodeGenerator::temporary(const pa::CodeGenerator::Expression& expression) {
+        // The type of an empty array literal doesn't matter, it has no elements
+        TokenType type = expression.type == TokenType::ALL ? TokenType::Int : expression.type;
+        uint64_t count = expression.count();
+        if (storageBytes(type, count) > m_temporary_capacity) {
+                if (m_temporary.mapped)
+                        emitUnmap(m_temporary);
+                m_temporary.type = type;
+                m_temporary.sizes = expression.sizes;
+                reserveStorage(expression.token, m_temporary);
+                m_temporary_capacity = storageBytes(type, count);
+                m_temporary.zeroed = true;
+        }
+        
+        m_temporary.type = type;
+        m_temporary.sizes = expression.sizes;
+        m_temporary.count = count;
+        m_temporary.array = true;
+        return m_temporary;
+}
+
+void pa::CodeGenerator::reserveStorage(const pa::Token token, pa::CodeGenerator::Variable& variable) {
+        uint64_t count = 1;
+        uint64_t bytes = 0;
+        bool overflow = false;
+        for (size_t size: variable.sizes)
+                overflow = overflow || __builtin_mul_overflow(count, size, &count);
+        overflow = overflow || __builtin_mul_overflow(count, elementSize(variable.type), &bytes);
+        if (!overflow)
+                bytes = storageBytes(variable.type, count);
+        if (overflow)
+                unsupported("reserveStorage", token, "An array of more than 2^64 bytes");
+        variable.count = count;
+        
+        variable.mapped = bytes >= MinMappedBytes;
+        uint64_t offset = m_assembler.reserveBss(variable.mapped ? 8 : bytes == 0 ? 1 : bytes);
+        if (offset + (variable.mapped ? 8 : bytes) > std::numeric_limits<int32_t>::max())
+                unsupported("reserveStorage", token, "More than 2 GiB of variables");
+        variable.offset = offset;
+        
+        if (variable.mapped) {
+                m_assembler.mov(Rdi, static_cast<int64_t>(bytes));
+                m_assembler.call(m_runtime.mapStorage);
+                m_assembler.store(at(NativeRuntime::StorageBase, static_cast<int32_t>(offset)), Rax);
+        }
+}
+
+void pa::CodeGenerator::emitUnmap(const pa::CodeGenerator::Variable& variable) {
+        m_assembler.load(Rdi, at(NativeRuntime::StorageBase, static_cast<int32_t>(variable.offset)));
+        m_assembler.mov(Rsi, static_cast<int64_t>(storageBytes(variable.type, variable.count)));
+        m_assembler.call(m_runtime.unmapStorage);
+}
+
+uint64_t pa::CodeGenerator::stringBytes(const uint32_t constant) {
+        if (m_string_bytes[constant] == Unassigned)
+                m_string_bytes[constant] = m_assembler.addData(Section::Rodata, m_constants.stringValue(constant), 1);
+        return m_string_bytes[constant];
+}
+
+uint64_t pa::CodeGenerator::stringDescriptor(const uint32_t constant) {
+        if (m_string_descriptors[constant] == Unassigned) {
+                std::string descriptor;
+                appendBytes<uint64_t>(descriptor, 0);
+                appendBytes<uint64_t>(descriptor, m_constants.stringValue(constant).size());
+                m_string_descriptors[constant] = addRodataImage(descriptor, {{0, stringBytes(constant)}});
+        }
+        return m_string_descriptors[constant];
+}
+
+uint64_t pa::CodeGenerator::addRodataImage(const std::string_view image, const std::vector<std::pair<uint64_t, uint64_t>>& pointers) {
+        uint64_t offset = m_assembler.addData(Section::Rodata, image, 16);
+        for (auto [pointer, target]: pointers)
+                m_assembler.addPointer(Section::Rodata, offset + pointer, Section::Rodata, static_cast<int64_t>(target));
+        return offset;
+}
+
+uint64_t pa::CodeGenerator::blockSizes(const std::vector<size_t>& sizes) {
+        std::string table;
+        for (size_t i = 0; i < sizes.size(); i++) {
+                uint64_t block = 1;
+                for (size_t j = i; j < sizes.size(); j++)
+                        block *= sizes[j];
+                appendBytes(table, block);
+        }
+        return m_assembler.addData(Section::Rodata, table);
+}
+
+
+pa::CodeGenerator::Variable& pa::CodeGenerator::findVariable(const pa::Token identifier) const {
+        Variable* const* variable = m_scope.find(identifier.toString(m_source));
+        if (variable == nullptr)
+                unsupported("findVariable", identifier, "A variable used before its declaration");
+        return **variable;
+}
+
+void pa::CodeGenerator::unsupported(const std::string_view rule_name, const pa::Token token, const std::string_view what) const {
+        reportError(ErrorMode::Throw, std::format("Code Generation Error({} {}): {} isn't supported by the native backend.", rule_name, token.start, what), token.start);
+}
+
+uint64_t pa::CodeGenerator::elementSize(const pa::TokenType type) {
+        switch (type) {
+                case TokenType::Bool:
+                case TokenType::Char:
+                        return 1;
+                case TokenType::String:
+                        return 16;
+                default:
+                        return 8;
+        }
+}
+
+uint64_t pa::CodeGenerator::storageBytes(const pa::TokenType type, const uint64_t count) {
+        if (type == TokenType::Bool)
+                return count == 1 ? 1 : (count + 63) / 64 * 8;
+        return count * elementSize(type);
+}
+
+pa::NativeRuntime::ElementKind pa::CodeGenerator::elementKind(const pa::TokenType type) {
+        switch (type) {
+                case TokenType::Float:
+                        return NativeRuntime::ElementKind::Float;
+                case TokenType::Bool:
+                        return NativeRuntime::ElementKind::Bool;
+                case TokenType::Char:
+                        return NativeRuntime::ElementKind::Char;
+                case TokenType::String:
+                        return NativeRuntime::ElementKind::String;
+                default:
+                        return NativeRuntime::ElementKind::Int;
+        }
+}
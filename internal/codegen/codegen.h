@@ -0,0 +1,261 @@
+#pragma once
+#include <deque>
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "constant_pool.h"
+#include "error.h"
+#include "flat_map.h"
+#include "jit.h"
+#include "line_index.h"
+#include "profiler.h"
+#include "runtime.h"
+#include "x86.h"
+
+// Compiles a checked program to x86-64 machine code for Linux, linked against nothing but NativeRuntime.
+// The Parser only checks a program and keeps nothing of its structure, so the generator walks the tokens once more,
+// building each statement's expressions as a small tree it then emits code for. Unlike the Parser it gives arithmetic
+// its usual precedence: * and / before + and -, comparisons after those, && before || last.
+// Every variable is an array, a scalar being a single element, and lives in .bss at a fixed offset from StorageBase:
+// ints and floats take 8 bytes, chars 1 and strings a 16 byte descriptor. Bool arrays are packed a bit to an element into
+// whole 8 byte words, element i being bit i % 64 of word i / 64, and read and written with bt, bts and btr (a scalar
+// bool is the single byte it would be anyway). Arrays of any rank are one buffer in row-major order. A redeclaration gets storage of its
+// own, starting out zeroed like every variable. Arrays of at least MinMappedBytes are instead mapped by the runtime where
+// they are declared, .bss only holding their address, so that they cost nothing until written and don't count against
+// the 2 GiB .bss can reach. Redeclaring one unmaps the storage of the declaration it hides.
+// Expressions are evaluated one element at a time into rax (the bits of a double for floats, the address of the
+// descriptor for strings) on a stack of intermediate results. An assignment or print of a whole array runs the
+// expression once per element with ElementIndex counting up, an operand of a single element being read for every
+// element. Integer division by zero gives zero. Whole-array +, - and * on ints, and those and / on floats, are instead
+// run four elements at a time in ymm registers by NativeRuntime::vectorLoop (which also splits large arrays across
+// threads), operands of a single element being evaluated once beforehand and broadcast, and only the elements left
+// over go one at a time. The results are the same either way. Array literals made of literals alone, and load expressions, become an
+// image in .rodata that is copied into place. A literal that leaves most of its array out (with {} or short rows) only
+// gets images of the runs of elements it has, and as long as nothing was written to the array since its declaration the
+// elements left out aren't zeroed again either.
+// The code of each statement is named in the symbols of the Image after its line, column and text, for perf and the like.
+// Everything a program does before its first read (or, without one, all it does) is the same on every run, so it can be
+// done once instead: generateStopping() stops the program at that snapshot point for capture() to read what it printed
+// and the variables it can still name, and generateResuming() then starts a program out at the snapshot point, printing
+// the same and copying the variables back in from .rodata, runs of zeroes left out, as it does for array literals. Strings
+// come back as bytes in .rodata too, the arena they were made in starting out empty. The statements before the snapshot
+// point are still generated, to lay out the variables as they were, but are jumped over.
+// Anything the backend can't compile is reported as a CompileError rather than miscompiled.
+
+namespace pa {
+        class CodeGenerator {
+        public: // Static Data
+                // Array literals of at least this many literals are copied out of .rodata rather than stored one by one
+                static constexpr size_t MinRodataLiterals = 4;
+                // Arrays taking at least this many bytes get a mapping of their own
+                static constexpr uint64_t MinMappedBytes = 1 << 20;
+                // Elements of a literal this many bytes or fewer apart share an image, the zeroes between them included
+                static constexpr uint64_t MaxImageGap = 64;
+                // Shorter arrays aren't worth setting up a vector loop for
+                static constexpr uint64_t MinVectorElements = 16;
+                // Operands of a single element a vector loop can broadcast
+                static constexpr size_t MaxVectorScalars = 16;
+                
+                // The storage of a variable, or of all the temporaries of array expressions together
+                struct VariableMemory {
+                        size_t line;             // 0 for the temporaries
+                        size_t column;
+                        std::string declaration; // Without its semicolon
+                        uint64_t bytes;
+                        bool mapped;             // Or in .bss
+                        uint64_t image_bytes;    // Of .rodata images copied into it
+                };
+                
+                // Where a program stands at its snapshot point, as capture() reads it
+                struct Snapshot {
+                        // Bytes starting at byte first of a variable's storage
+                        struct Run {
+                                uint64_t first;
+                                std::string bytes;
+                        };
+                        
+                        struct Storage {
+                                std::vector<Run> runs;            // Of its bytes that aren't zero, for all but strings
+                                std::vector<std::string> strings; // Every element of a string variable
+                        };
+                        
+                        std::string output;
+                        std::vector<Storage> variables{}; // Each variable in scope, in order of declaration
+                };
+                
+                // How many bytes of variables capture() takes at most, .rodata having to stay within reach of a 32-bit displacement
+                static constexpr uint64_t MaxSnapshotBytes = 1 << 30;
+        public: // Constructors/Destructors/Overloads
+                // src and constants have to be the ones tokens were lexed from, and the program has to have passed the Parser.
+                // name prefixes the symbol of each statement in the Image, and with profile every statement is instrumented by
+                // a NativeProfiler.
+                CodeGenerator(std::string_view src, std::span<const Token> tokens, const ConstantPool& constants, std::string_view name = "program", bool profile = false);
+        public: // Public Member Functions
+                // The whole program, starting at its entry point and exiting once the last statement has run
+                [[nodiscard]] x86::Image generate();
+                // The program stopping itself at its snapshot point with SIGSTOP, to be run by a jit::StoppedProgram
+                [[nodiscard]] x86::Image generateStopping();
+                // The program starting out at its snapshot point, from a snapshot of the same program and flags
+                [[nodiscard]] x86::Image generateResuming(const Snapshot& snapshot);
+                // Reads where program, from generateStopping() of this generator, stands at its snapshot point
+                [[nodiscard]] Snapshot capture(const jit::StoppedProgram& program) const;
+                // Every variable declared by generate(), in order of declaration, followed by the temporaries if there were any
+                [[nodiscard]] std::vector<VariableMemory> memoryUsage() const;
+        private: // Private Member Types
+                // Where a statement is in the source, and its text on a single line without its semicolon
+                struct Statement {
+                        size_t line;
+                        size_t column;
+                        std::string text{};
+                };
+                
+                struct Variable {
+                        TokenType type{TokenType::INVALID};
+                        std::vector<size_t> sizes{1};
+                        uint64_t count{1};
+                        uint64_t offset{0}; // Into .bss, of the storage or if mapped of its address
+                        bool array{false};  // Declared with extents, so printed as one even if it has a single element
+                        bool mapped{false};
+                        bool zeroed{true};  // Not written since it was declared (or for the temporary, reserved)
+                        Statement declaration{};
+                        uint64_t image_bytes{0};
+                };
+                
+                struct Expression {
+                        enum class Kind {
+                                Literal,
+                                Variable,
+                                Not,
+                                Binary,
+                                ArrayLiteral,
+                        };
+                        
+                        Kind kind;
+                        Token token;                  // The literal, identifier or operator
+                        TokenType type;               // Of each element: Int, Float, Bool, Char, String, or ALL for an empty array literal
+                        std::vector<size_t> sizes{1}; // Outermost first
+                        bool array{false};
+                        const Variable* variable{nullptr};
+                        std::vector<Expression> operands{};
+                        
+                        [[nodiscard]] uint64_t count() const;
+                };
+        private: // Private Member Functions
+                [[nodiscard]] x86::Image generateProgram();
+                
+                // Statements
+                void generateStatement();
+                Statement locateStatement(const Token& first, const Token& last);
+                void generateDeclaration();
+                void generateAssignment();
+                void generateLoad(Variable& target, Token path);
+                void generatePrint();
+                void generateRead();
+                
+                // Expressions, built by the grammar of the Parser
+                Expression parseExpression();
+                Expression parseArrayLiteral();
+                Expression parseOr();
+                Expression parseAnd();
+                Expression parseComparison();
+                Expression parseAdditive();
+                Expression parseMultiplicative();
+                Expression parsePrimary();
+                Expression makeBinary(Token operation, Expression lhs, Expression rhs);
+                
+                // Code, every emitter leaving its result in rax
+                void emitCall(x86::Label routine, NativeProfiler::Cost cost);
+                void emitExpression(const Expression& expression, bool indexed);
+                void emitBinary(const Expression& expression, bool indexed);
+                // Sets the flags so that NotEqual holds if rax, holding a value of type, is nonzero
+                void emitTruth(x86::Register value, TokenType type);
+                void emitToDouble(x86::Xmm destination, x86::Register source, TokenType type);
+                // Stores rax, holding a value of type, into the element of target at ElementIndex (or its first if not indexed)
+                void emitStore(const Variable& target, TokenType type, bool indexed);
+                void emitElementAddress(x86::Register destination, const Variable& variable, bool indexed);
+                // The address of the first element of variable
+                void emitStorageAddress(x86::Register destination, const Variable& variable);
+                // The bool element of variable at ElementIndex (or its first if not indexed) into rax, and rax into one of target
+                void emitLoadBit(const Variable& variable, bool indexed);
+                void emitStoreBit(const Variable& target, bool indexed);
+                void emitAssignment(Variable& target, const Expression& expression);
+                void emitArrayLiteral(Variable& target, const Expression& literal);
+                // The ymm registers it takes to compute four elements of expression at once, with the operations of type (the
+                // target's, Int or Float) on arrays of count elements, or 0 if it can't be. scalars counts the operands of a
+                // single element.
+                static size_t vectorRegisters(const Expression& expression, TokenType type, uint64_t count, size_t& scalars);
+                void emitVectorAssignment(const Variable& target, const Expression& expression);
+                // Stores the operands of a single element of expression, as type, into the vector scalar slots from slot on
+                void emitVectorScalars(const Expression& expression, TokenType type, size_t& slot);
+                // The four elements of expression at rdi into destination, using the registers after it as well
+                void emitVector(const Expression& expression, TokenType type, x86::Ymm destination, size_t& slot);
+                // Four elements of variable at rdi, clobbering rax
+                x86::Memory emitVectorAddress(const Variable& variable);
+                // Collects the elements of literal, at depth in the extents of target, along with their index into it
+                void flattenArrayLiteral(const Variable& target, const Expression& literal, size_t depth, uint64_t first, std::vector<std::pair<uint64_t, const Expression*>>& elements);
+                // Copies size bytes at offset in .rodata over the storage of target, starting at the byte first
+                void emitCopyFromRodata(Variable& target, uint64_t offset, uint64_t size, uint64_t first = 0);
+                void emitPrintArray(const Variable& variable);
+                // Stops or resumes the program right here, as generateStopping() or generateResuming() was asked for
+                void emitSnapshotPoint();
+                void emitRestore(const Snapshot& snapshot);
+                // Runs body(indexed) for each of count elements, counting ElementIndex up if there is more than one
+                template<typename Body>
+                void forEachElement(uint64_t count, const Body& body);
+                
+                Variable& declare(Token name, TokenType type, std::vector<size_t> sizes, bool array, Statement declaration);
+                // Storage for the value of an array expression that has no variable of its own, only good until the next statement
+                Variable& temporary(const Expression& expression);
+                // Reserves storage for variable, its count of elements of its type, in .bss as long as it stays within reach of
+                // a 32-bit displacement, or mapped if it is large, emitting the mapping
+                void reserveStorage(Token token, Variable& variable);
+                void emitUnmap(const Variable& variable);
+                // Offsets into .rodata of a string constant and of a descriptor of it, each added once
+                uint64_t stringBytes(uint32_t constant);
+                uint64_t stringDescriptor(uint32_t constant);
+                // Adds image to .rodata, storing the address of the .rodata offset in the second of each pointer at the first
+                uint64_t addRodataImage(std::string_view image, const std::vector<std::pair<uint64_t, uint64_t>>& pointers);
+                // The block sizes printArray expects for sizes
+                uint64_t blockSizes(const std::vector<size_t>& sizes);
+                
+                [[nodiscard]] const Token& peek() const { return m_tokens[m_next]; }
+                const Token& eat() { return m_tokens[m_next++]; }
+                [[nodiscard]] Variable& findVariable(Token identifier) const;
+                [[noreturn]] void unsupported(std::string_view rule_name, Token token, std::string_view what) const;
+                
+                static uint64_t elementSize(TokenType type);
+                // The bytes taken by count elements of type
+                static uint64_t storageBytes(TokenType type, uint64_t count);
+                static NativeRuntime::ElementKind elementKind(TokenType type);
+        private: // Private Member Variables
+                std::string_view m_source;
+                std::span<const Token> m_tokens;
+                const ConstantPool& m_constants;
+                std::string m_name;
+                size_t m_next{0};
+                LineIndex m_lines;
+                
+                x86::Assembler m_assembler;
+                NativeRuntime m_runtime;
+                std::optional<NativeProfiler> m_profiler;
+                
+                std::deque<Variable> m_variables; // A deque, so expressions can point at them
+                FlatMap<std::string, Variable*> m_scope; // Name -> latest declaration
+                Variable m_temporary;
+                uint64_t m_temporary_capacity{0};
+                uint64_t m_vector_scalars{std::numeric_limits<uint64_t>::max()}; // In .bss, reserved once first needed
+                // By string constant, UINT64_MAX until added
+                std::vector<uint64_t> m_string_bytes;
+                std::vector<uint64_t> m_string_descriptors;
+                
+                bool m_stopping{false};
+                const Snapshot* m_resuming{nullptr};
+                x86::Label m_restore{};
+                bool m_snapshot_point_passed{false};
+                std::vector<Variable*> m_snapshot_variables; // In scope at the snapshot point, in order of declaration
+        };
+}
@@ -0,0 +1,233 @@
+#include "profiler.h"
+
+using enum pa::x86::Register;
+using enum pa::x86::Condition;
+using pa::x86::Arithmetic;
+using pa::x86::at;
+
+namespace {
+        // Linux x86-64 syscall numbers
+        constexpr int64_t SysOpen = 2;
+        constexpr int64_t SysClose = 3;
+        
+        constexpr int64_t OpenForWriting = 0x241; // O_WRONLY | O_CREAT | O_TRUNC
+        constexpr uint64_t PathCapacity = 4096;
+        
+        // Leaves the time stamp counter in rax, clobbering rdx
+        void emitTicks(pa::x86::Assembler& a) {
+                a.rdtsc();
+                a.shift(pa::x86::Shift::Left, Rdx, 32);
+                a.arithmetic(Arithmetic::Or, Rax, Rdx);
+        }
+}
+
+pa::NativeProfiler::NativeProfiler(pa::x86::Assembler& assembler, pa::NativeRuntime& runtime, const std::string_view name, const size_t statement_count)
+        : m_assembler(assembler), m_runtime(runtime), m_name(name) {
+        report = m_assembler.newLabel();
+        
+        m_counters = m_assembler.reserveBss(statement_count * 32);
+        m_statement_ticks = m_assembler.reserveBss(8);
+        m_call_ticks = m_assembler.reserveBss(8);
+        m_program_name = m_assembler.reserveBss(8);
+        m_path = m_assembler.reserveBss(PathCapacity);
+}
+
+// argv[0] sits just above argc at the top of the initial stack
+void pa::NativeProfiler::emitStart() {
+        m_assembler.load(Rax, at(Rsp, 8));
+        m_assembler.store(state(m_program_name), Rax);
+}
+
+void pa::NativeProfiler::beginStatement() {
+        x86::Assembler& a = m_assembler;
+        a.load(Rax, state(counter(m_statement, 0)));
+        a.arithmetic(Arithmetic::Add, Rax, 1);
+        a.store(state(counter(m_statement, 0)), Rax);
+        emitTicks(a);
+        a.store(state(m_statement_ticks), Rax);
+}
+
+void pa::NativeProfiler::endStatement(const size_t line, const size_t column, std::string text) {
+        emitAccumulate(m_statement_ticks, counter(m_statement, 1));
+        
+        if (text.size() > MaxStatementText)
+                text = text.substr(0, MaxStatementText - 3) + "...";
+        for (uint64_t value: {static_cast<uint64_t>(line), static_cast<uint64_t>(column), uint64_t{0}, static_cast<uint64_t>(text.size())})
+                m_statements.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        m_texts.emplace_back(m_statements.size() - 16, std::move(text));
+        m_statement++;
+}
+
+// rax and rdx are saved around reading the counter, since they may hold arguments going in and results coming out
+void pa::NativeProfiler::call(const pa::x86::Label routine, const pa::NativeProfiler::Cost cost) {
+        x86::Assembler& a = m_assembler;
+        a.push(Rax);
+        a.push(Rdx);
+        emitTicks(a);
+        a.store(state(m_call_ticks), Rax);
+        a.pop(Rdx);
+        a.pop(Rax);
+        a.call(routine);
+        emitAccumulate(m_call_ticks, counter(m_statement, cost == Cost::Strings ? 2 : 3));
+}
+
+void pa::NativeProfiler::emitAccumulate(const uint64_t since, const uint64_t total) {
+        x86::Assembler& a = m_assembler;
+        a.push(Rax);
+        a.push(Rdx);
+        emitTicks(a);
+        a.load(Rcx, state(since));
+        a.arithmetic(Arithmetic::Sub, Rax, Rcx);
+        a.load(Rcx, state(total));
+        a.arithmetic(Arithmetic::Add, Rcx, Rax);
+        a.store(state(total), Rcx);
+        a.pop(Rdx);
+        a.pop(Rax);
+}
+
+void pa::NativeProfiler::emitReport() {
+        x86::Assembler& a = m_assembler;
+        
+        uint64_t table = a.addData(x86::Section::Rodata, m_statements, 16);
+        for (const auto& [descriptor, text]: m_texts)
+                a.addPointer(x86::Section::Rodata, table + descriptor, x86::Section::Rodata, static_cast<int64_t>(a.addData(x86::Section::Rodata, text, 1)));
+        
+        // rbx is the file being written, rbp the statement in the table, r13 its counters, r12 how many are left and
+        // r14 a cost of the folded stacks
+        a.bind(report);
+        for (x86::Register saved: {Rbx, Rbp, R12, R13, R14})
+                a.push(saved);
+        
+        auto forEachStatement = [&](const auto& body) {
+                x86::Label loop = a.newLabel(), done = a.newLabel();
+                a.lea(Rbp, a.global(x86::Section::Rodata, table));
+                a.lea(R13, state(m_counters));
+                a.mov(R12, static_cast<int64_t>(m_statement));
+                a.test(R12, R12);
+                a.jump(Equal, done);
+                a.bind(loop);
+                body();
+                a.arithmetic(Arithmetic::Add, Rbp, 32);
+                a.arithmetic(Arithmetic::Add, R13, 32);
+                a.arithmetic(Arithmetic::Sub, R12, 1);
+                a.jump(NotEqual, loop);
+                a.bind(done);
+        };
+        auto printField = [&](const x86::Register base, const int32_t offset) {
+                a.load(Rdi, at(base, offset));
+                a.call(m_runtime.printInt);
+        };
+        auto loadCompute = [&](const x86::Register destination) {
+                a.load(destination, at(R13, 8));
+                a.load(Rax, at(R13, 16));
+                a.arithmetic(Arithmetic::Sub, destination, Rax);
+                a.load(Rax, at(R13, 24));
+                a.arithmetic(Arithmetic::Sub, destination, Rax);
+        };
+        auto writeReport = [&](const std::string_view suffix, const auto& body) {
+                x86::Label skipped = a.newLabel();
+                emitOpen(suffix);
+                a.test(Rax, Rax);
+                a.jump(Sign, skipped);
+                a.mov(Rbx, Rax);
+                a.mov(Rdi, Rax);
+                a.call(m_runtime.setOutput);
+                body();
+                a.mov(Rdi, 1);
+                a.call(m_runtime.setOutput);
+                a.mov(Rax, SysClose);
+                a.mov(Rdi, Rbx);
+                a.syscall();
+                a.bind(skipped);
+        };
+        
+        writeReport(".profile", [&] {
+                emitWrite("line:col\tcount\tticks\tcompute\tstrings\tio\tstatement\n");
+                forEachStatement([&] {
+                        printField(Rbp, 0);
+                        emitWrite(":");
+                        printField(Rbp, 8);
+                        for (int32_t field: {0, 8}) {
+                                emitWrite("\t");
+                                printField(R13, field);
+                        }
+                        emitWrite("\t");
+                        loadCompute(Rdi);
+                        a.call(m_runtime.printInt);
+                        for (int32_t field: {16, 24}) {
+                                emitWrite("\t");
+                                printField(R13, field);
+                        }
+                        emitWrite("\t");
+                        a.lea(Rdi, at(Rbp, 16));
+                        a.call(m_runtime.printString);
+                        a.call(m_runtime.printNewline);
+                });
+        });
+        
+        writeReport(".folded", [&] {
+                forEachStatement([&] {
+                        for (std::string_view cost: {"compute", "strings", "io"}) {
+                                x86::Label next = a.newLabel();
+                                if (cost == "compute")
+                                        loadCompute(R14);
+                                else
+                                        a.load(R14, at(R13, cost == "strings" ? 16 : 24));
+                                a.test(R14, R14);
+                                a.jump(LessOrEqual, next);
+                                emitWrite(m_name + ";");
+                                printField(Rbp, 0);
+                                emitWrite(":");
+                                printField(Rbp, 8);
+                                emitWrite(" ");
+                                a.lea(Rdi, at(Rbp, 16));
+                                a.call(m_runtime.printString);
+                                emitWrite(std::string(";") + std::string(cost) + " ");
+                                a.mov(Rdi, R14);
+                                a.call(m_runtime.printInt);
+                                a.call(m_runtime.printNewline);
+                                a.bind(next);
+                        }
+                });
+        });
+        
+        for (x86::Register saved: {R14, R13, R12, Rbp, Rbx})
+                a.pop(saved);
+        a.ret();
+}
+
+// Cuts argv[0] short rather than overflow the path, which at worst writes the reports under a shorter name
+void pa::NativeProfiler::emitOpen(const std::string_view suffix) {
+        x86::Assembler& a = m_assembler;
+        x86::Label loop = a.newLabel(), copied = a.newLabel();
+        a.load(Rsi, state(m_program_name));
+        a.lea(Rdi, state(m_path));
+        a.mov(Rcx, 0);
+        a.test(Rsi, Rsi);
+        a.jump(Equal, copied);
+        a.bind(loop);
+        a.arithmetic(Arithmetic::Cmp, Rcx, static_cast<int32_t>(PathCapacity - suffix.size() - 1));
+        a.jump(AboveOrEqual, copied);
+        a.load(Rax, at(Rsi, Rcx, 1), 1);
+        a.test(Rax, Rax);
+        a.jump(Equal, copied);
+        a.store(at(Rdi, Rcx, 1), Rax, 1);
+        a.arithmetic(Arithmetic::Add, Rcx, 1);
+        a.jump(loop);
+        a.bind(copied);
+        for (size_t i = 0; i <= suffix.size(); i++) {
+                a.mov(Rax, i < suffix.size() ? suffix[i] : 0);
+                a.store(at(Rdi, Rcx, 1, static_cast<int32_t>(i)), Rax, 1);
+        }
+        
+        a.mov(Rax, SysOpen);
+        a.mov(Rsi, OpenForWriting);
+        a.mov(Rdx, 0644);
+        a.syscall();
+}
+
+void pa::NativeProfiler::emitWrite(const std::string_view text) {
+        m_assembler.lea(Rsi, m_assembler.global(x86::Section::Rodata, m_assembler.addData(x86::Section::Rodata, text, 1)));
+        m_assembler.mov(Rdx, static_cast<int64_t>(text.size()));
+        m_assembler.call(m_runtime.write);
+}
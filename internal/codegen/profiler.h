@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "runtime.h"
+
+// Instruments a native program to count how often each statement runs and how many time stamp counter ticks it takes,
+// split into computation, building strings and print/read I/O. Each statement costs a couple of rdtsc and a few
+// increments of counters in .bss, and each call into the runtime it makes two more rdtsc, so the instrumentation can
+// stay on outside of benchmarks.
+// At exit the program writes two reports next to itself, named after argv[0]:
+//   <program>.profile  a tab separated listing of each statement's line:col, executions, ticks in total and for each
+//                      kind of cost, followed by the statement's source
+//   <program>.folded   folded stacks of name;line:col statement;cost ticks, as taken by flamegraph.pl and speedscope
+// Statements are the ones of the source, as located by the CodeGenerator, so generated sources are profiled statement
+// by statement.
+
+namespace pa {
+        class NativeProfiler {
+        public: // Static Data
+                enum class Cost {
+                        Strings,
+                        IO,
+                };
+                
+                // Longer statements are cut short in the reports
+                static constexpr size_t MaxStatementText = 100;
+        public: // Constructors/Destructors/Overloads
+                // name is the root frame of the folded stacks, statement_count how many statements the program has
+                NativeProfiler(x86::Assembler& assembler, NativeRuntime& runtime, std::string_view name, size_t statement_count);
+        public: // Public Member Functions
+                // Right after NativeRuntime::initialize, while the stack is as the kernel left it
+                void emitStart();
+                // Around the code of each statement, text being the statement on a single line
+                void beginStatement();
+                void endStatement(size_t line, size_t column, std::string text);
+                // Calls a runtime routine, counting its ticks as cost of the current statement
+                void call(x86::Label routine, Cost cost);
+                // The report routine, once every statement has been emitted
+                void emitReport();
+        public: // Public Member Variables
+                x86::Label report; // Writes both reports, to be called before exiting
+        private: // Private Member Functions
+                // Adds the current time stamp counter minus the one at since to the counter at total, keeping rax and rdx
+                void emitAccumulate(uint64_t since, uint64_t total);
+                // Opens argv[0] followed by suffix for writing, leaving the file descriptor (or a negative error) in rax
+                void emitOpen(std::string_view suffix);
+                void emitWrite(std::string_view text);
+                [[nodiscard]] x86::Memory state(uint64_t offset) const { return x86::at(NativeRuntime::StorageBase, static_cast<int32_t>(offset)); }
+                [[nodiscard]] uint64_t counter(size_t statement, size_t field) const { return m_counters + statement * 32 + field * 8; }
+        private: // Private Member Variables
+                x86::Assembler& m_assembler;
+                NativeRuntime& m_runtime;
+                std::string m_name;
+                
+                size_t m_statement{0}; // Being emitted
+                // The table of statements in .rodata, 32 bytes each: line, column and a string descriptor of the statement
+                std::string m_statements;
+                std::vector<std::pair<uint64_t, std::string>> m_texts; // Offset of each descriptor in m_statements, and its text
+                
+                // State in .bss
+                uint64_t m_counters; // Per statement: executions, ticks, string ticks, I/O ticks
+                uint64_t m_statement_ticks;
+                uint64_t m_call_ticks;
+                uint64_t m_program_name;
+                uint64_t m_path;
+        };
+}
@@ -0,0 +1,944 @@
+#include <algorithm>
+#include <bit>
+#include <string>
+#include "runtime.h"
+
+using enum pa::x86::Register;
+using enum pa::x86::Condition;
+using pa::x86::Arithmetic;
+using pa::x86::at;
+
+namespace {
+        // Linux x86-64 syscall numbers
+        constexpr int64_t SysRead = 0;
+        constexpr int64_t SysWrite = 1;
+        constexpr int64_t SysMmap = 9;
+        constexpr int64_t SysMunmap = 11;
+        constexpr int64_t SysMadvise = 28;
+        constexpr int64_t SysGetpid = 39;
+        constexpr int64_t SysClone = 56;
+        constexpr int64_t SysExit = 60;
+        constexpr int64_t SysKill = 62;
+        constexpr int64_t SysFutex = 202;
+        constexpr int64_t SysSchedGetaffinity = 204;
+        constexpr int64_t SysExitGroup = 231;
+        
+        // CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD | CLONE_SYSVSEM | CLONE_PARENT_SETTID | CLONE_CHILD_CLEARTID
+        constexpr int64_t CloneThread = 0x350F00;
+        constexpr int64_t FutexWait = 0;
+        
+        constexpr int64_t SignalStop = 19; // SIGSTOP
+}
+
+pa::NativeRuntime::NativeRuntime(pa::x86::Assembler& assembler) : m_assembler(assembler) {
+        for (x86::Label* label: {&exit, &write, &printInt, &printFloat, &printBool, &printChar, &printString, &printNewline, &printArray,
+                                 &readLine, &parseInt, &parseFloat, &parseBool, &parseChar, &copyString, &allocate, &concatenate, &mapStorage, &unmapStorage, &clearStorage, &flush, &setOutput, &snapshot,
+                                 &vectorLoop, &m_write_all, &m_out_of_memory})
+                *label = m_assembler.newLabel();
+        
+        m_output = m_assembler.reserveBss(OutputCapacity, 64);
+        m_input = m_assembler.reserveBss(InputCapacity, 64);
+        m_line = m_assembler.reserveBss(LineCapacity, 64);
+        m_output_size = m_assembler.reserveBss(8);
+        m_input_position = m_assembler.reserveBss(8);
+        m_input_size = m_assembler.reserveBss(8);
+        m_arena = m_assembler.reserveBss(8);
+        m_arena_end = m_assembler.reserveBss(8);
+        m_output_fd = m_assembler.reserveBss(8);
+        m_vector_threads = m_assembler.reserveBss(8);
+        m_thread_ids = m_assembler.reserveBss(MaxThreads * 8);
+        m_thread_stacks = m_assembler.reserveBss(MaxThreads * ThreadStackSize, 64);
+        
+        emitOutput();
+        emitPrinting();
+        emitPrintArray();
+        emitInput();
+        emitStrings();
+        emitStorage();
+        emitVectorLoop();
+        
+        // Each routine runs up to the next one, the labels inside them being left out
+        std::pair<std::string_view, x86::Label> routines[] = {
+                {"exit", exit}, {"snapshot", snapshot}, {"flush", flush}, {"setOutput", setOutput}, {"write", write}, {"writeAll", m_write_all},
+                {"printInt", printInt}, {"printFloat", printFloat}, {"printBool", printBool}, {"printChar", printChar},
+                {"printString", printString}, {"printNewline", printNewline}, {"printArray", printArray}, {"readLine", readLine},
+                {"parseInt", parseInt}, {"parseFloat", parseFloat}, {"parseBool", parseBool}, {"parseChar", parseChar},
+                {"copyString", copyString}, {"allocate", allocate}, {"concatenate", concatenate}, {"mapStorage", mapStorage},
+                {"unmapStorage", unmapStorage}, {"clearStorage", clearStorage}, {"vectorLoop", vectorLoop},
+        };
+        std::ranges::sort(routines, {}, [&](const auto& routine) { return m_assembler.offsetOf(routine.second); });
+        for (size_t i = 0; i < std::size(routines); i++) {
+                uint64_t start = m_assembler.offsetOf(routines[i].second);
+                uint64_t end = i + 1 < std::size(routines) ? m_assembler.offsetOf(routines[i + 1].second) : m_assembler.position();
+                m_assembler.addSymbol(std::string("pa_runtime::") + std::string(routines[i].first), start, end - start);
+        }
+}
+
+void pa::NativeRuntime::initialize() {
+        x86::Assembler& a = m_assembler;
+        a.lea(StorageBase, a.global(x86::Section::Bss, 0));
+        a.mov(Rax, 1);
+        a.store(state(m_output_fd), Rax);
+        
+        // AVX2 needs the CPU to have AVX (with OSXSAVE, for xgetbv to be there at all) and AVX2, and the kernel to save the
+        // xmm and ymm state
+        x86::Label done = a.newLabel();
+        a.mov(Rax, 1);
+        a.mov(Rcx, 0);
+        a.cpuid();
+        a.arithmetic(Arithmetic::And, Rcx, 0x18000000);
+        a.arithmetic(Arithmetic::Cmp, Rcx, 0x18000000);
+        a.jump(NotEqual, done);
+        a.mov(Rcx, 0);
+        a.xgetbv();
+        a.arithmetic(Arithmetic::And, Rax, 6);
+        a.arithmetic(Arithmetic::Cmp, Rax, 6);
+        a.jump(NotEqual, done);
+        a.mov(Rax, 7);
+        a.mov(Rcx, 0);
+        a.cpuid();
+        a.arithmetic(Arithmetic::And, Rbx, 1 << 5);
+        a.jump(Equal, done);
+        
+        // A thread for each CPU in the affinity mask, at least the one there is
+        x86::Label count = a.newLabel(), counted = a.newLabel();
+        a.arithmetic(Arithmetic::Sub, Rsp, 128);
+        a.mov(Rax, SysSchedGetaffinity);
+        a.mov(Rdi, 0);
+        a.mov(Rsi, 128);
+        a.mov(Rdx, Rsp);
+        a.syscall();
+        a.mov(R8, 0);
+        a.bind(count);
+        a.arithmetic(Arithmetic::Sub, Rax, 8);
+        a.jump(Less, counted);
+        a.load(Rcx, at(Rsp, Rax, 1));
+        a.popcnt(Rcx, Rcx);
+        a.arithmetic(Arithmetic::Add, R8, Rcx);
+        a.jump(count);
+        a.bind(counted);
+        a.arithmetic(Arithmetic::Add, Rsp, 128);
+        x86::Label some = a.newLabel(), capped = a.newLabel();
+        a.test(R8, R8);
+        a.jump(NotEqual, some);
+        a.mov(R8, 1);
+        a.bind(some);
+        a.arithmetic(Arithmetic::Cmp, R8, MaxThreads);
+        a.jump(BelowOrEqual, capped);
+        a.mov(R8, MaxThreads);
+        a.bind(capped);
+        a.store(state(m_vector_threads), R8);
+        a.bind(done);
+}
+
+
+void pa::NativeRuntime::emitOutput() {
+        x86::Assembler& a = m_assembler;
+        
+        // writeAll(rsi bytes, rdx size), straight to stdout. Stops early on an error, there being nobody to tell.
+        a.bind(m_write_all);
+        x86::Label loop = a.newLabel(), done = a.newLabel();
+        a.bind(loop);
+        a.test(Rdx, Rdx);
+        a.jump(Equal, done);
+        a.mov(Rax, SysWrite);
+        a.load(Rdi, state(m_output_fd));
+        a.syscall();
+        a.test(Rax, Rax);
+        a.jump(LessOrEqual, done);
+        a.arithmetic(Arithmetic::Add, Rsi, Rax);
+        a.arithmetic(Arithmetic::Sub, Rdx, Rax);
+        a.jump(loop);
+        a.bind(done);
+        a.ret();
+        
+        a.bind(flush);
+        a.lea(Rsi, state(m_output));
+        a.load(Rdx, state(m_output_size));
+        a.call(m_write_all);
+        a.mov(Rax, 0);
+        a.store(state(m_output_size), Rax);
+        a.ret();
+        
+        // write(rsi bytes, rdx size), through the buffer unless it is bigger than the buffer
+        a.bind(write);
+        x86::Label copy = a.newLabel();
+        a.load(Rax, state(m_output_size));
+        a.lea(Rcx, at(Rax, Rdx, 1));
+        a.arithmetic(Arithmetic::Cmp, Rcx, OutputCapacity);
+        a.jump(BelowOrEqual, copy);
+        a.push(Rsi);
+        a.push(Rdx);
+        a.call(flush);
+        a.pop(Rdx);
+        a.pop(Rsi);
+        a.arithmetic(Arithmetic::Cmp, Rdx, OutputCapacity);
+        a.jump(BelowOrEqual, copy);
+        a.jump(m_write_all);
+        a.bind(copy);
+        a.load(Rax, state(m_output_size));
+        a.lea(Rdi, at(StorageBase, Rax, 1, static_cast<int32_t>(m_output)));
+        a.mov(Rcx, Rdx);
+        a.repMovsb();
+        a.arithmetic(Arithmetic::Add, Rax, Rdx);
+        a.store(state(m_output_size), Rax);
+        a.ret();
+        
+        a.bind(setOutput);
+        a.push(Rdi);
+        a.call(flush);
+        a.pop(Rdi);
+        a.store(state(m_output_fd), Rdi);
+        a.ret();
+        
+        // The process that started the program reads what it needs while it is stopped, and goes on from here if continued
+        a.bind(snapshot);
+        a.call(flush);
+        a.mov(Rax, SysGetpid);
+        a.syscall();
+        a.mov(Rdi, Rax);
+        a.mov(Rsi, SignalStop);
+        a.mov(Rax, SysKill);
+        a.syscall();
+        a.ret();
+        
+        a.bind(exit);
+        a.call(flush);
+        a.mov(Rax, SysExitGroup);
+        a.mov(Rdi, 0);
+        a.syscall();
+}
+
+void pa::NativeRuntime::emitPrinting() {
+        x86::Assembler& a = m_assembler;
+        
+        a.bind(printChar);
+        a.push(Rdi);
+        a.mov(Rsi, Rsp);
+        a.mov(Rdx, 1);
+        a.call(write);
+        a.pop(Rdi);
+        a.ret();
+        
+        a.bind(printNewline);
+        a.mov(Rdi, '\n');
+        a.jump(printChar);
+        
+        // Digits are produced last first, into a buffer on the stack that is filled from its end
+        a.bind(printInt);
+        x86::Label positive = a.newLabel(), digit = a.newLabel(), unsigned_done = a.newLabel();
+        a.arithmetic(Arithmetic::Sub, Rsp, 32);
+        a.mov(R8, Rdi);
+        a.mov(Rax, Rdi);
+        a.test(Rax, Rax);
+        a.jump(NoSign, positive);
+        a.neg(Rax);
+        a.bind(positive);
+        a.lea(Rsi, at(Rsp, 32));
+        a.mov(Rcx, 10);
+        a.bind(digit);
+        a.mov(Rdx, 0);
+        a.div(Rcx);
+        a.arithmetic(Arithmetic::Add, Rdx, '0');
+        a.arithmetic(Arithmetic::Sub, Rsi, 1);
+        a.store(at(Rsi), Rdx, 1);
+        a.test(Rax, Rax);
+        a.jump(NotEqual, digit);
+        a.test(R8, R8);
+        a.jump(NoSign, unsigned_done);
+        a.arithmetic(Arithmetic::Sub, Rsi, 1);
+        a.mov(Rax, '-');
+        a.store(at(Rsi), Rax, 1);
+        a.bind(unsigned_done);
+        a.lea(Rdx, at(Rsp, 32));
+        a.arithmetic(Arithmetic::Sub, Rdx, Rsi);
+        a.call(write);
+        a.arithmetic(Arithmetic::Add, Rsp, 32);
+        a.ret();
+        
+        uint64_t words = m_assembler.addData(x86::Section::Rodata, "TrueFalseinfnan", 1);
+        
+        a.bind(printBool);
+        x86::Label is_false = a.newLabel();
+        a.test(Rdi, Rdi);
+        a.jump(Equal, is_false);
+        a.lea(Rsi, a.global(x86::Section::Rodata, words));
+        a.mov(Rdx, 4);
+        a.jump(write);
+        a.bind(is_false);
+        a.lea(Rsi, a.global(x86::Section::Rodata, words + 4));
+        a.mov(Rdx, 5);
+        a.jump(write);
+        
+        a.bind(printString);
+        a.load(Rsi, at(Rdi));
+        a.load(Rdx, at(Rdi, 8));
+        a.jump(write);
+        
+        // The integer part is printed as an int and the fraction rounded to six digits, leaving off the trailing zeros but
+        // one. From 1e15 up the value is divided down to a single digit before the point, followed by the exponent.
+        a.bind(printFloat);
+        x86::Label finite = a.newLabel(), not_a_number = a.newLabel(), infinite = a.newLabel(), absolute = a.newLabel(), scale = a.newLabel(),
+                   scaled = a.newLabel(), rounded = a.newLabel(), fraction_digit = a.newLabel(), trim = a.newLabel(), trimmed = a.newLabel(),
+                   done = a.newLabel();
+        a.push(Rbx);
+        a.push(Rbp);
+        a.mov(Rax, Rdi);
+        a.mov(Rcx, Rax);
+        a.shift(x86::Shift::LogicalRight, Rcx, 52);
+        a.arithmetic(Arithmetic::And, Rcx, 0x7FF);
+        a.arithmetic(Arithmetic::Cmp, Rcx, 0x7FF);
+        a.jump(NotEqual, finite);
+        a.mov(Rcx, Rax);
+        a.shift(x86::Shift::Left, Rcx, 12);
+        a.test(Rcx, Rcx);
+        a.jump(NotEqual, not_a_number);
+        a.test(Rax, Rax);
+        a.jump(NoSign, infinite);
+        a.mov(Rdi, '-');
+        a.call(printChar);
+        a.bind(infinite);
+        a.lea(Rsi, a.global(x86::Section::Rodata, words + 9));
+        a.mov(Rdx, 3);
+        a.call(write);
+        a.jump(done);
+        a.bind(not_a_number);
+        a.lea(Rsi, a.global(x86::Section::Rodata, words + 12));
+        a.mov(Rdx, 3);
+        a.call(write);
+        a.jump(done);
+        
+        a.bind(finite);
+        a.test(Rax, Rax);
+        a.jump(NoSign, absolute);
+        a.push(Rax);
+        a.mov(Rdi, '-');
+        a.call(printChar);
+        a.pop(Rax);
+        a.shift(x86::Shift::Left, Rax, 1);
+        a.shift(x86::Shift::LogicalRight, Rax, 1);
+        a.bind(absolute);
+        a.movq(x86::Xmm::Xmm0, Rax);
+        a.mov(Rbp, 0);
+        a.load(Rcx, constant(1e15));
+        a.movq(x86::Xmm::Xmm1, Rcx);
+        a.load(Rcx, constant(10.0));
+        a.movq(x86::Xmm::Xmm2, Rcx);
+        a.ucomisd(x86::Xmm::Xmm0, x86::Xmm::Xmm1);
+        a.jump(Below, scaled);
+        a.bind(scale);
+        a.scalarDouble(x86::ScalarDouble::Divide, x86::Xmm::Xmm0, x86::Xmm::Xmm2);
+        a.arithmetic(Arithmetic::Add, Rbp, 1);
+        a.ucomisd(x86::Xmm::Xmm0, x86::Xmm::Xmm2);
+        a.jump(AboveOrEqual, scale);
+        a.bind(scaled);
+        a.cvttsd2si(Rax, x86::Xmm::Xmm0);
+        a.cvtsi2sd(x86::Xmm::Xmm1, Rax);
+        a.scalarDouble(x86::ScalarDouble::Subtract, x86::Xmm::Xmm0, x86::Xmm::Xmm1);
+        a.load(Rcx, constant(1e6));
+        a.movq(x86::Xmm::Xmm1, Rcx);
+        a.scalarDouble(x86::ScalarDouble::Multiply, x86::Xmm::Xmm0, x86::Xmm::Xmm1);
+        a.load(Rcx, constant(0.5));
+        a.movq(x86::Xmm::Xmm1, Rcx);
+        a.scalarDouble(x86::ScalarDouble::Add, x86::Xmm::Xmm0, x86::Xmm::Xmm1);
+        a.cvttsd2si(Rbx, x86::Xmm::Xmm0);
+        a.arithmetic(Arithmetic::Cmp, Rbx, 1000000);
+        a.jump(Below, rounded);
+        a.arithmetic(Arithmetic::Sub, Rbx, 1000000);
+        a.arithmetic(Arithmetic::Add, Rax, 1);
+        a.bind(rounded);
+        a.mov(Rdi, Rax);
+        a.call(printInt);
+        
+        // '.' and six digits at [rsp, rsp + 7)
+        a.arithmetic(Arithmetic::Sub, Rsp, 16);
+        a.mov(Rax, '.');
+        a.store(at(Rsp), Rax, 1);
+        a.mov(Rax, Rbx);
+        a.mov(Rcx, 10);
+        a.lea(Rsi, at(Rsp, 6));
+        a.bind(fraction_digit);
+        a.mov(Rdx, 0);
+        a.div(Rcx);
+        a.arithmetic(Arithmetic::Add, Rdx, '0');
+        a.store(at(Rsi), Rdx, 1);
+        a.arithmetic(Arithmetic::Sub, Rsi, 1);
+        a.arithmetic(Arithmetic::Cmp, Rsi, Rsp);
+        a.jump(NotEqual, fraction_digit);
+        a.mov(Rdx, 7);
+        a.bind(trim);
+        a.arithmetic(Arithmetic::Cmp, Rdx, 2);
+        a.jump(BelowOrEqual, trimmed);
+        a.load(R8, at(Rsp, Rdx, 1, -1), 1);
+        a.arithmetic(Arithmetic::Cmp, R8, '0');
+        a.jump(NotEqual, trimmed);
+        a.arithmetic(Arithmetic::Sub, Rdx, 1);
+        a.jump(trim);
+        a.bind(trimmed);
+        a.mov(Rsi, Rsp);
+        a.call(write);
+        a.arithmetic(Arithmetic::Add, Rsp, 16);
+        
+        a.test(Rbp, Rbp);
+        a.jump(Equal, done);
+        a.mov(Rdi, 'e');
+        a.call(printChar);
+        a.mov(Rdi, Rbp);
+        a.call(printInt);
+        a.bind(done);
+        a.pop(Rbp);
+        a.pop(Rbx);
+        a.ret();
+}
+
+// Walks the elements in order, putting out the braces of every block an element starts or ends. Block sizes are the
+// number of elements under one index of each dimension, so every block boundary of a dimension is one of the next
+// dimension in as well.
+void pa::NativeRuntime::emitPrintArray() {
+        x86::Assembler& a = m_assembler;
+        std::string braces = std::string(MaxPrintedRank, '{') + std::string(MaxPrintedRank, '}') + ", ";
+        uint64_t opening = a.addData(x86::Section::Rodata, braces, 1), closing = opening + MaxPrintedRank, separator = closing + MaxPrintedRank;
+        
+        a.bind(printArray);
+        x86::Label element = a.newLabel(), not_empty = a.newLabel(), opened = a.newLabel(), printed = a.newLabel(),
+                   done = a.newLabel();
+        a.push(Rbx);
+        a.push(Rbp);
+        a.push(R12);
+        a.push(R13);
+        a.push(R14);
+        a.push(Rdx); // The ElementKind, at [rsp]
+        a.mov(Rbx, Rdi);
+        a.mov(Rbp, Rsi);
+        a.mov(R13, Rcx);
+        a.mov(R14, R8);
+        a.mov(R12, 0);
+        a.test(Rbp, Rbp);
+        a.jump(NotEqual, not_empty);
+        a.lea(Rsi, a.global(x86::Section::Rodata, closing - 1));
+        a.mov(Rdx, 2);
+        a.call(write);
+        a.jump(done);
+        a.bind(not_empty);
+        
+        a.bind(element);
+        a.test(R12, R12);
+        a.jump(Equal, opened);
+        a.lea(Rsi, a.global(x86::Section::Rodata, separator));
+        a.mov(Rdx, 2);
+        a.call(write);
+        a.bind(opened);
+        emitCountBoundaries(R12, 0);
+        a.lea(Rsi, a.global(x86::Section::Rodata, opening));
+        a.mov(Rdx, R8);
+        a.call(write);
+        
+        std::pair<ElementKind, x86::Label> kinds[] = {{ElementKind::Int, printInt}, {ElementKind::Float, printFloat}, {ElementKind::Bool, printBool},
+                                                      {ElementKind::Char, printChar}, {ElementKind::String, printString}};
+        for (auto [kind, print]: kinds) {
+                x86::Label next = a.newLabel();
+                a.load(Rax, at(Rsp));
+                a.arithmetic(Arithmetic::Cmp, Rax, static_cast<int32_t>(kind));
+                a.jump(NotEqual, next);
+                switch (kind) {
+                        case ElementKind::Int:
+                        case ElementKind::Float:
+                                a.load(Rdi, at(Rbx, R12, 8));
+                                break;
+                        case ElementKind::Bool:
+                                a.bitTest(x86::BitTest::Test, at(Rbx), R12);
+                                a.set(Below, Rdi);
+                                break;
+                        case ElementKind::Char:
+                                a.load(Rdi, at(Rbx, R12, 1), 1);
+                                break;
+                        case ElementKind::String:
+                                a.mov(Rdi, R12);
+                                a.shift(x86::Shift::Left, Rdi, 4);
+                                a.arithmetic(Arithmetic::Add, Rdi, Rbx);
+                                break;
+                }
+                a.call(print);
+                a.jump(printed);
+                a.bind(next);
+        }
+        a.bind(printed);
+        
+        emitCountBoundaries(R12, 1);
+        a.lea(Rsi, a.global(x86::Section::Rodata, closing));
+        a.mov(Rdx, R8);
+        a.call(write);
+        a.arithmetic(Arithmetic::Add, R12, 1);
+        a.arithmetic(Arithmetic::Cmp, R12, Rbp);
+        a.jump(Below, element);
+        
+        a.bind(done);
+        a.pop(Rdx);
+        a.pop(R14);
+        a.pop(R13);
+        a.pop(R12);
+        a.pop(Rbp);
+        a.pop(Rbx);
+        a.ret();
+}
+
+void pa::NativeRuntime::emitCountBoundaries(const pa::x86::Register value, const int32_t addend) {
+        x86::Assembler& a = m_assembler;
+        x86::Label loop = a.newLabel(), done = a.newLabel();
+        a.mov(R8, 0);
+        a.mov(R9, R14);
+        a.bind(loop);
+        a.test(R9, R9);
+        a.jump(Equal, done);
+        a.arithmetic(Arithmetic::Sub, R9, 1);
+        a.load(Rcx, at(R13, R9, 8));
+        a.mov(Rax, value);
+        a.arithmetic(Arithmetic::Add, Rax, addend);
+        a.mov(Rdx, 0);
+        a.div(Rcx);
+        a.test(Rdx, Rdx);
+        a.jump(NotEqual, done);
+        a.arithmetic(Arithmetic::Add, R8, 1);
+        a.jump(loop);
+        a.bind(done);
+        
+        x86::Label capped = a.newLabel();
+        a.arithmetic(Arithmetic::Cmp, R8, MaxPrintedRank);
+        a.jump(BelowOrEqual, capped);
+        a.mov(R8, MaxPrintedRank);
+        a.bind(capped);
+}
+
+
+void pa::NativeRuntime::emitInput() {
+        x86::Assembler& a = m_assembler;
+        
+        // Copies the next line (without its line break) into the line buffer, refilling the input buffer as it runs dry.
+        // r8 is the size of the line so far, r9 and r10 the position in and size of the input buffer.
+        a.bind(readLine);
+        x86::Label next = a.newLabel(), have = a.newLabel(), done = a.newLabel(), no_return = a.newLabel();
+        a.call(flush);
+        a.mov(R8, 0);
+        a.load(R9, state(m_input_position));
+        a.load(R10, state(m_input_size));
+        a.bind(next);
+        a.arithmetic(Arithmetic::Cmp, R9, R10);
+        a.jump(Below, have);
+        a.mov(Rax, SysRead);
+        a.mov(Rdi, 0);
+        a.lea(Rsi, state(m_input));
+        a.mov(Rdx, InputCapacity);
+        a.syscall();
+        a.mov(R9, 0);
+        a.mov(R10, Rax);
+        a.test(Rax, Rax);
+        a.jump(Greater, have);
+        a.mov(R10, 0);
+        a.jump(done);
+        a.bind(have);
+        a.load(Rax, at(StorageBase, R9, 1, static_cast<int32_t>(m_input)), 1);
+        a.arithmetic(Arithmetic::Add, R9, 1);
+        a.arithmetic(Arithmetic::Cmp, Rax, '\n');
+        a.jump(Equal, done);
+        a.arithmetic(Arithmetic::Cmp, R8, LineCapacity);
+        a.jump(AboveOrEqual, next);
+        a.store(at(StorageBase, R8, 1, static_cast<int32_t>(m_line)), Rax, 1);
+        a.arithmetic(Arithmetic::Add, R8, 1);
+        a.jump(next);
+        a.bind(done);
+        a.store(state(m_input_position), R9);
+        a.store(state(m_input_size), R10);
+        a.test(R8, R8);
+        a.jump(Equal, no_return);
+        a.load(Rax, at(StorageBase, R8, 1, static_cast<int32_t>(m_line) - 1), 1);
+        a.arithmetic(Arithmetic::Cmp, Rax, '\r');
+        a.jump(NotEqual, no_return);
+        a.arithmetic(Arithmetic::Sub, R8, 1);
+        a.bind(no_return);
+        a.lea(Rax, state(m_line));
+        a.mov(Rdx, R8);
+        a.ret();
+        
+        a.bind(parseInt);
+        x86::Label digit = a.newLabel(), parsed = a.newLabel(), positive = a.newLabel();
+        emitSkipBlanksAndSign();
+        a.mov(Rax, 0);
+        a.bind(digit);
+        a.arithmetic(Arithmetic::Cmp, Rcx, Rdx);
+        a.jump(AboveOrEqual, parsed);
+        a.load(R9, at(Rsi, Rcx, 1), 1);
+        a.arithmetic(Arithmetic::Sub, R9, '0');
+        a.arithmetic(Arithmetic::Cmp, R9, 9);
+        a.jump(Above, parsed);
+        a.imul(Rax, Rax, 10);
+        a.arithmetic(Arithmetic::Add, Rax, R9);
+        a.arithmetic(Arithmetic::Add, Rcx, 1);
+        a.jump(digit);
+        a.bind(parsed);
+        a.test(R8, R8);
+        a.jump(Equal, positive);
+        a.neg(Rax);
+        a.bind(positive);
+        a.ret();
+        
+        // The integer part accumulates as a double, so it can't overflow, and the first 18 digits of the fraction as an
+        // int over the matching power of ten
+        a.bind(parseFloat);
+        x86::Label integer_digit = a.newLabel(), fraction = a.newLabel(), fraction_digit = a.newLabel(), fraction_done = a.newLabel(),
+                   float_parsed = a.newLabel(), float_positive = a.newLabel();
+        emitSkipBlanksAndSign();
+        a.mov(Rax, 0);
+        a.movq(x86::Xmm::Xmm0, Rax);
+        a.load(Rax, constant(10.0));
+        a.movq(x86::Xmm::Xmm2, Rax);
+        a.bind(integer_digit);
+        a.arithmetic(Arithmetic::Cmp, Rcx, Rdx);
+        a.jump(AboveOrEqual, float_parsed);
+        a.load(R9, at(Rsi, Rcx, 1), 1);
+        a.arithmetic(Arithmetic::Sub, R9, '0');
+        a.arithmetic(Arithmetic::Cmp, R9, 9);
+        a.jump(Above, fraction);
+        a.scalarDouble(x86::ScalarDouble::Multiply, x86::Xmm::Xmm0, x86::Xmm::Xmm2);
+        a.cvtsi2sd(x86::Xmm::Xmm1, R9);
+        a.scalarDouble(x86::ScalarDouble::Add, x86::Xmm::Xmm0, x86::Xmm::Xmm1);
+        a.arithmetic(Arithmetic::Add, Rcx, 1);
+        a.jump(integer_digit);
+        a.bind(fraction);
+        a.arithmetic(Arithmetic::Cmp, R9, '.' - '0');
+        a.jump(NotEqual, float_parsed);
+        a.arithmetic(Arithmetic::Add, Rcx, 1);
+        a.mov(R10, 0);
+        a.mov(R11, 1);
+        a.mov(Rdi, 100000000000000000);
+        a.bind(fraction_digit);
+        a.arithmetic(Arithmetic::Cmp, Rcx, Rdx);
+        a.jump(AboveOrEqual, fraction_done);
+        a.load(R9, at(Rsi, Rcx, 1), 1);
+        a.arithmetic(Arithmetic::Sub, R9, '0');
+        a.arithmetic(Arithmetic::Cmp, R9, 9);
+        a.jump(Above, fraction_done);
+        a.arithmetic(Arithmetic::Add, Rcx, 1);
+        a.arithmetic(Arithmetic::Cmp, R11, Rdi);
+        a.jump(Above, fraction_digit);
+        a.imul(R10, R10, 10);
+        a.arithmetic(Arithmetic::Add, R10, R9);
+        a.imul(R11, R11, 10);
+        a.jump(fraction_digit);
+        a.bind(fraction_done);
+        a.cvtsi2sd(x86::Xmm::Xmm1, R10);
+        a.cvtsi2sd(x86::Xmm::Xmm3, R11);
+        a.scalarDouble(x86::ScalarDouble::Divide, x86::Xmm::Xmm1, x86::Xmm::Xmm3);
+        a.scalarDouble(x86::ScalarDouble::Add, x86::Xmm::Xmm0, x86::Xmm::Xmm1);
+        a.bind(float_parsed);
+        a.movq(Rax, x86::Xmm::Xmm0);
+        a.test(R8, R8);
+        a.jump(Equal, float_positive);
+        a.mov(Rcx, INT64_MIN);
+        a.arithmetic(Arithmetic::Xor, Rax, Rcx);
+        a.bind(float_positive);
+        a.ret();
+        
+        a.bind(parseBool);
+        x86::Label is_true = a.newLabel(), is_false = a.newLabel();
+        emitSkipBlanksAndSign();
+        a.arithmetic(Arithmetic::Cmp, Rcx, Rdx);
+        a.jump(AboveOrEqual, is_false);
+        a.load(Rax, at(Rsi, Rcx, 1), 1);
+        for (char c: {'T', 't', '1'}) {
+                a.arithmetic(Arithmetic::Cmp, Rax, c);
+                a.jump(Equal, is_true);
+        }
+        a.bind(is_false);
+        a.mov(Rax, 0);
+        a.ret();
+        a.bind(is_true);
+        a.mov(Rax, 1);
+        a.ret();
+        
+        a.bind(parseChar);
+        x86::Label empty = a.newLabel();
+        a.test(Rdx, Rdx);
+        a.jump(Equal, empty);
+        a.load(Rax, at(Rsi), 1);
+        a.ret();
+        a.bind(empty);
+        a.mov(Rax, 0);
+        a.ret();
+}
+
+void pa::NativeRuntime::emitSkipBlanksAndSign() {
+        x86::Assembler& a = m_assembler;
+        x86::Label blank = a.newLabel(), advance = a.newLabel(), sign = a.newLabel(), plus = a.newLabel(), done = a.newLabel();
+        a.mov(Rcx, 0);
+        a.mov(R8, 0);
+        a.bind(blank);
+        a.arithmetic(Arithmetic::Cmp, Rcx, Rdx);
+        a.jump(AboveOrEqual, done);
+        a.load(R9, at(Rsi, Rcx, 1), 1);
+        a.arithmetic(Arithmetic::Cmp, R9, ' ');
+        a.jump(Equal, advance);
+        a.arithmetic(Arithmetic::Cmp, R9, '\t');
+        a.jump(NotEqual, sign);
+        a.bind(advance);
+        a.arithmetic(Arithmetic::Add, Rcx, 1);
+        a.jump(blank);
+        a.bind(sign);
+        a.arithmetic(Arithmetic::Cmp, R9, '-');
+        a.jump(NotEqual, plus);
+        a.mov(R8, 1);
+        a.arithmetic(Arithmetic::Add, Rcx, 1);
+        a.jump(done);
+        a.bind(plus);
+        a.arithmetic(Arithmetic::Cmp, R9, '+');
+        a.jump(NotEqual, done);
+        a.arithmetic(Arithmetic::Add, Rcx, 1);
+        a.bind(done);
+}
+
+
+void pa::NativeRuntime::emitStrings() {
+        x86::Assembler& a = m_assembler;
+        
+        // Bump allocation from the current chunk, mapping a new one (at least ArenaChunk) when it runs out
+        a.bind(allocate);
+        x86::Label retry = a.newLabel(), grow = a.newLabel(), big = a.newLabel();
+        a.arithmetic(Arithmetic::Add, Rdi, 15);
+        a.arithmetic(Arithmetic::And, Rdi, -16);
+        a.bind(retry);
+        a.load(Rax, state(m_arena));
+        a.lea(Rcx, at(Rax, Rdi, 1));
+        a.load(Rdx, state(m_arena_end));
+        a.arithmetic(Arithmetic::Cmp, Rcx, Rdx);
+        a.jump(Above, grow);
+        a.store(state(m_arena), Rcx);
+        a.ret();
+        a.bind(grow);
+        a.mov(Rsi, Rdi);
+        a.arithmetic(Arithmetic::Cmp, Rsi, ArenaChunk);
+        a.jump(AboveOrEqual, big);
+        a.mov(Rsi, ArenaChunk);
+        a.bind(big);
+        a.push(Rdi);
+        a.push(Rsi);
+        a.mov(Rax, SysMmap);
+        a.mov(Rdi, 0);
+        a.mov(Rdx, 3);      // PROT_READ | PROT_WRITE
+        a.mov(R10, 0x22);   // MAP_PRIVATE | MAP_ANONYMOUS
+        a.mov(R8, -1);
+        a.mov(R9, 0);
+        a.syscall();
+        a.pop(Rsi);
+        a.pop(Rdi);
+        a.arithmetic(Arithmetic::Cmp, Rax, -4095);
+        a.jump(AboveOrEqual, m_out_of_memory);
+        a.store(state(m_arena), Rax);
+        a.arithmetic(Arithmetic::Add, Rax, Rsi);
+        a.store(state(m_arena_end), Rax);
+        a.jump(retry);
+        
+        std::string_view message = "Out of memory\n";
+        uint64_t message_offset = a.addData(x86::Section::Rodata, message, 1);
+        a.bind(m_out_of_memory);
+        a.mov(Rax, SysWrite);
+        a.mov(Rdi, 2);
+        a.lea(Rsi, a.global(x86::Section::Rodata, message_offset));
+        a.mov(Rdx, message.size());
+        a.syscall();
+        a.mov(Rax, SysExitGroup);
+        a.mov(Rdi, 1);
+        a.syscall();
+        
+        // A descriptor followed by the bytes it points to
+        a.bind(copyString);
+        a.push(Rsi);
+        a.push(Rdx);
+        a.lea(Rdi, at(Rdx, 16));
+        a.call(allocate);
+        a.pop(Rcx);
+        a.pop(Rsi);
+        a.lea(Rdi, at(Rax, 16));
+        a.store(at(Rax), Rdi);
+        a.store(at(Rax, 8), Rcx);
+        a.repMovsb();
+        a.ret();
+        
+        a.bind(concatenate);
+        a.push(Rbx);
+        a.push(Rbp);
+        a.mov(Rbx, Rdi);
+        a.mov(Rbp, Rsi);
+        a.load(Rdi, at(Rbx, 8));
+        a.load(Rcx, at(Rbp, 8));
+        a.arithmetic(Arithmetic::Add, Rdi, Rcx);
+        a.arithmetic(Arithmetic::Add, Rdi, 16);
+        a.call(allocate);
+        a.lea(Rdi, at(Rax, 16));
+        a.store(at(Rax), Rdi);
+        a.load(Rcx, at(Rbx, 8));
+        a.load(Rdx, at(Rbp, 8));
+        a.arithmetic(Arithmetic::Add, Rcx, Rdx);
+        a.store(at(Rax, 8), Rcx);
+        a.load(Rsi, at(Rbx));
+        a.load(Rcx, at(Rbx, 8));
+        a.repMovsb();
+        a.load(Rsi, at(Rbp));
+        a.load(Rcx, at(Rbp, 8));
+        a.repMovsb();
+        a.pop(Rbp);
+        a.pop(Rbx);
+        a.ret();
+}
+
+void pa::NativeRuntime::emitStorage() {
+        x86::Assembler& a = m_assembler;
+        
+        // Reserving no swap for the mapping, so that only the pages written count against memory
+        a.bind(mapStorage);
+        a.mov(Rsi, Rdi);
+        a.mov(Rax, SysMmap);
+        a.mov(Rdi, 0);
+        a.mov(Rdx, 3);      // PROT_READ | PROT_WRITE
+        a.mov(R10, 0x4022); // MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE
+        a.mov(R8, -1);
+        a.mov(R9, 0);
+        a.syscall();
+        a.arithmetic(Arithmetic::Cmp, Rax, -4095);
+        a.jump(AboveOrEqual, m_out_of_memory);
+        a.ret();
+        
+        a.bind(unmapStorage);
+        a.mov(Rax, SysMunmap);
+        a.syscall();
+        a.ret();
+        
+        a.bind(clearStorage);
+        a.mov(Rax, SysMadvise);
+        a.mov(Rdx, 4);      // MADV_DONTNEED
+        a.syscall();
+        a.ret();
+}
+
+void pa::NativeRuntime::emitVectorLoop() {
+        x86::Assembler& a = m_assembler;
+        x86::Label vectors = a.newLabel(), single = a.newLabel(), threaded = a.newLabel();
+        
+        a.bind(vectorLoop);
+        a.load(Rcx, state(m_vector_threads));
+        a.test(Rcx, Rcx);
+        a.jump(NotEqual, vectors);
+        a.mov(Rax, 0);
+        a.ret();
+        a.bind(vectors);
+        a.mov(Rax, Rsi);
+        a.arithmetic(Arithmetic::And, Rax, -4);
+        a.arithmetic(Arithmetic::Cmp, Rax, ParallelThreshold);
+        a.jump(Below, single);
+        a.arithmetic(Arithmetic::Cmp, Rcx, 1);
+        a.jump(NotEqual, threaded);
+        a.bind(single);
+        a.push(Rax);
+        a.mov(Rsi, Rax);
+        a.mov(Rax, Rdi);
+        a.mov(Rdi, 0);
+        a.call(Rax);
+        a.pop(Rax);
+        a.ret();
+        
+        // rbx the routine, r14 the end, r9 the size of every slice but the last (a multiple of 4), and rbp and r13 the slice
+        // a thread is started for. A thread starts out with the registers of the one that started it, so it finds its
+        // slice in rbp and r13.
+        x86::Label spawn = a.newLabel(), spawned = a.newLabel(), child = a.newLabel();
+        a.bind(threaded);
+        a.push(Rbx);
+        a.push(Rbp);
+        a.push(R13);
+        a.push(R14);
+        a.mov(Rbx, Rdi);
+        a.mov(R14, Rax);
+        a.shift(x86::Shift::LogicalRight, Rax, 2);
+        a.mov(Rdx, 0);
+        a.div(Rcx);
+        a.shift(x86::Shift::Left, Rax, 2);
+        a.mov(R9, Rax);
+        
+        // The slices are started last first, the one starting at 0 being left for this thread. Slice k > 0 gets the
+        // (k - 1)th stack and id.
+        a.arithmetic(Arithmetic::Sub, Rcx, 1);
+        a.mov(Rbp, Rcx);
+        a.imul(Rbp, R9);
+        a.mov(R13, R14);
+        a.mov(Rsi, Rcx);
+        a.shift(x86::Shift::Left, Rsi, std::countr_zero(ThreadStackSize));
+        a.lea(Rsi, at(StorageBase, Rsi, 1, static_cast<int32_t>(m_thread_stacks)));
+        a.lea(Rdx, at(StorageBase, Rcx, 8, static_cast<int32_t>(m_thread_ids - 8)));
+        a.bind(spawn);
+        a.mov(R10, Rdx);
+        a.mov(Rdi, CloneThread);
+        a.mov(Rax, SysClone);
+        a.syscall();
+        a.test(Rax, Rax);
+        a.jump(Equal, child);
+        a.jump(Greater, spawned);
+        // No thread to be had, so this one does the slice as well
+        a.push(Rsi);
+        a.mov(Rdi, Rbp);
+        a.mov(Rsi, R13);
+        a.call(Rbx);
+        a.pop(Rsi);
+        a.mov(Rax, 0);
+        a.store(at(Rdx), Rax);
+        a.bind(spawned);
+        a.mov(R13, Rbp);
+        a.arithmetic(Arithmetic::Sub, Rbp, R9);
+        a.arithmetic(Arithmetic::Sub, Rsi, ThreadStackSize);
+        a.arithmetic(Arithmetic::Sub, Rdx, 8);
+        a.test(Rbp, Rbp);
+        a.jump(NotEqual, spawn);
+        
+        a.mov(Rdi, 0);
+        a.mov(Rsi, R13);
+        a.call(Rbx);
+        
+        // Then waits for the kernel to clear the id of each thread, which it does as the thread exits
+        x86::Label next = a.newLabel(), check = a.newLabel(), joined = a.newLabel(), waited = a.newLabel();
+        a.mov(R8, 0);
+        a.bind(next);
+        a.load(R9, state(m_vector_threads));
+        a.arithmetic(Arithmetic::Sub, R9, 1);
+        a.arithmetic(Arithmetic::Cmp, R8, R9);
+        a.jump(AboveOrEqual, waited);
+        a.lea(Rdi, at(StorageBase, R8, 8, static_cast<int32_t>(m_thread_ids)));
+        a.bind(check);
+        a.load(Rdx, at(Rdi));
+        a.test(Rdx, Rdx);
+        a.jump(Equal, joined);
+        a.mov(Rsi, FutexWait);
+        a.mov(R10, 0);
+        a.mov(Rax, SysFutex);
+        a.syscall();
+        a.jump(check);
+        a.bind(joined);
+        a.arithmetic(Arithmetic::Add, R8, 1);
+        a.jump(next);
+        a.bind(waited);
+        a.mov(Rax, R14);
+        a.pop(R14);
+        a.pop(R13);
+        a.pop(Rbp);
+        a.pop(Rbx);
+        a.ret();
+        
+        a.bind(child);
+        a.mov(Rdi, Rbp);
+        a.mov(Rsi, R13);
+        a.call(Rbx);
+        a.mov(Rax, SysExit);
+        a.mov(Rdi, 0);
+        a.syscall();
+}
+
+
+pa::x86::Memory pa::NativeRuntime::constant(const double value) {
+        uint64_t bits = std::bit_cast<uint64_t>(value);
+        return m_assembler.global(x86::Section::Rodata, m_assembler.addData(x86::Section::Rodata, {reinterpret_cast<const char*>(&bits), sizeof(bits)}));
+}
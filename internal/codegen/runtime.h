@@ -0,0 +1,116 @@
+#pragma once
+#include "kernels.h"
+#include "x86.h"
+
+// The routines every native program carries with it in place of a C library, talking to the kernel through raw syscalls.
+// They follow the System V calling convention for arguments (rdi, rsi, rdx, rcx, r8) and results (rax, and rdx for a
+// second one), may clobber rax, rcx, rdx, rsi, rdi, r8-r11 and xmm0-xmm3, and keep everything else. StorageBase holds
+// the address of .bss for the whole run, the runtime's own state living at the start of it.
+//   Output is buffered and only written when the buffer fills, before reading input and at exit. It goes to stdout
+//   unless redirected with setOutput.
+//   Ints print in decimal, floats with up to six decimals (switching to an exponent from 1e15 up), bools as True or
+//   False, chars and strings as they are. Arrays print as nested braces, {{1, 2}, {3, 4}}.
+//   Input is read a line at a time. Ints and floats are parsed from the start of the line, skipping blanks and ignoring
+//   anything after the number, a bool is True if the line starts with T, t or 1, a char is the first character and a
+//   string the whole line.
+//   Strings are a descriptor of a pointer and a size, 16 bytes, and those made at runtime are allocated from an arena
+//   that grows with mmap and is never freed.
+//   Large arrays get a mapping of their own, left for the kernel to back with zeroed pages as they are first written.
+//   Whole-array arithmetic runs four elements at a time if the CPU has AVX2 (and the kernel saves the ymm registers),
+//   arrays of at least ParallelThreshold elements being split into a slice per CPU the program may run on, up to
+//   MaxThreads, each slice on a thread of its own.
+// Every routine is named in the Image's symbols as pa_runtime::<routine>.
+
+namespace pa {
+        class NativeRuntime {
+        public: // Static Data
+                static constexpr x86::Register StorageBase = x86::Register::R15;
+                // The element an element-wise loop is at, kept by every routine
+                static constexpr x86::Register ElementIndex = x86::Register::R12;
+                
+                // What printArray is printing
+                enum class ElementKind {
+                        Int,
+                        Float,
+                        Bool,
+                        Char,
+                        String,
+                };
+                
+                static constexpr uint64_t OutputCapacity = 1 << 16;
+                static constexpr uint64_t InputCapacity = 1 << 16;
+                static constexpr uint64_t LineCapacity = 1 << 12; // Longer lines are cut short
+                static constexpr uint64_t ArenaChunk = 1 << 20;
+                // Deeper arrays print their outermost braces all the same, just not all of them
+                static constexpr uint64_t MaxPrintedRank = 64;
+                static constexpr uint64_t ParallelThreshold = kernels::ParallelThreshold;
+                static constexpr uint64_t MaxThreads = 16;
+                static constexpr uint64_t ThreadStackSize = 1 << 14;
+        public: // Constructors/Destructors/Overloads
+                // Emits every routine and reserves their state, which has to come first in .bss
+                explicit NativeRuntime(x86::Assembler& assembler);
+        public: // Public Member Functions
+                // Sets up StorageBase and the state, first thing at the entry point
+                void initialize();
+        public: // Public Member Variables
+                x86::Label exit;              // Flushes the output and exits with status 0
+                x86::Label snapshot;          // Flushes the output and stops the process with SIGSTOP
+                x86::Label flush;
+                x86::Label setOutput;         // (rdi file descriptor), flushing what was written to the one before
+                x86::Label write;             // (rsi bytes, rdx size)
+                x86::Label printInt;          // (rdi value)
+                x86::Label printFloat;        // (rdi bits)
+                x86::Label printBool;         // (rdi value)
+                x86::Label printChar;         // (rdi value)
+                x86::Label printString;       // (rdi descriptor)
+                x86::Label printNewline;
+                x86::Label printArray;        // (rdi elements, rsi count, rdx ElementKind, rcx block sizes, r8 rank), bools packed a bit each
+                x86::Label readLine;          // -> (rax bytes, rdx size), good until the next readLine
+                x86::Label parseInt;          // (rsi bytes, rdx size) -> rax
+                x86::Label parseFloat;        // (rsi bytes, rdx size) -> rax bits
+                x86::Label parseBool;         // (rsi bytes, rdx size) -> rax
+                x86::Label parseChar;         // (rsi bytes, rdx size) -> rax
+                x86::Label copyString;        // (rsi bytes, rdx size) -> rax descriptor
+                x86::Label allocate;          // (rdi size) -> rax, 16 byte aligned
+                x86::Label concatenate;       // (rdi descriptor, rsi descriptor) -> rax descriptor
+                x86::Label mapStorage;        // (rdi size) -> rax, zeroed and page aligned
+                x86::Label unmapStorage;      // (rdi address, rsi size)
+                x86::Label clearStorage;      // (rdi address, rsi size) zeroes a mapping, dropping the pages written
+                // (rdi routine, rsi count) -> rax elements done, a multiple of 4 and 0 without AVX2. routine(rdi first, rsi end)
+                // does the elements in [first, end) four at a time, may clobber rax, rsi, rdi and the ymm registers, and has to
+                // be safe to run on several threads at once for disjoint ranges.
+                x86::Label vectorLoop;
+        private: // Private Member Functions
+                void emitOutput();
+                void emitPrinting();
+                void emitPrintArray();
+                void emitInput();
+                void emitStrings();
+                void emitStorage();
+                void emitVectorLoop();
+                // Leaves rcx at the first character after any blanks and sign in (rsi, rdx), and r8 at 1 if the sign was -
+                void emitSkipBlanksAndSign();
+                // Leaves in r8 how many dimensions value + addend is a multiple of the block size of, innermost first
+                void emitCountBoundaries(x86::Register value, int32_t addend);
+                [[nodiscard]] x86::Memory state(uint64_t offset) const { return x86::at(StorageBase, static_cast<int32_t>(offset)); }
+                [[nodiscard]] x86::Memory constant(double value);
+        private: // Private Member Variables
+                x86::Assembler& m_assembler;
+                x86::Label m_write_all;
+                x86::Label m_out_of_memory;
+                
+                // State in .bss
+                uint64_t m_output;
+                uint64_t m_output_size;
+                uint64_t m_input;
+                uint64_t m_input_position;
+                uint64_t m_input_size;
+                uint64_t m_line;
+                uint64_t m_arena;
+                uint64_t m_arena_end;
+                uint64_t m_output_fd;
+                uint64_t m_vector_threads; // 0 without AVX2
+                uint64_t m_thread_ids;     // Of each thread started, cleared by the kernel when it exits
+                uint64_t m_thread_stacks;
+        };
+}
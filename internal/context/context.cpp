@@ -0,0 +1,66 @@
+#include "context.h"
+
+const pa::CompilationContext::Result& pa::CompilationContext::compile(const std::string_view src, const size_t max_errors) {
+        m_tokens.clear();
+        m_constants.clear();
+        m_lex_error.reset();
+        m_lex_errors.clear();
+        m_result.succeeded = false;
+        m_result.diagnostic.clear();
+        m_result.position = NoPosition;
+        m_result.errors.clear();
+        
+        if (max_errors > 1) {
+                Lexer::tokenizeRecovering(src, m_constants, m_tokens, m_lex_errors, m_lex_error, max_errors);
+                
+                // The Lexer would raise the error of a leading INVALID token as it is made, so those are recorded here
+                size_t first_token = 0;
+                while (first_token < m_tokens.size() && m_tokens[first_token].type == TokenType::INVALID) {
+                        m_result.errors.push_back(m_lex_errors[first_token]);
+                        first_token++;
+                }
+                
+                try {
+                        std::span<const Token> tokens = std::span<const Token>(m_tokens).subspan(first_token);
+                        std::span<const CompileError> lex_errors = std::span<const CompileError>(m_lex_errors).subspan(first_token);
+                        if (m_parser)
+                                m_parser->reset(src, tokens, m_constants, m_lex_error ? &*m_lex_error : nullptr, lex_errors);
+                        else
+                                m_parser.emplace(src, tokens, m_constants, ErrorMode::Throw, m_lex_error ? &*m_lex_error : nullptr, lex_errors);
+                        
+                        m_parser->parseProgram(m_result.errors, max_errors);
+                } catch (const CompileError& truncation_error) {
+                        // Only the truncation error, raised by a Parser left with no tokens at all
+                        m_result.errors.push_back(truncation_error);
+                }
+                
+                m_result.succeeded = m_result.errors.empty();
+                if (!m_result.succeeded) {
+                        m_result.diagnostic = m_result.errors.front().message;
+                        m_result.position = m_result.errors.front().position;
+                }
+                return m_result;
+        }
+        
+        try {
+                Lexer(src, m_constants, ErrorMode::Throw).tokenize(m_tokens);
+        } catch (const CompileError& lex_error) {
+                m_lex_error = lex_error;
+        }
+        
+        try {
+                if (m_parser)
+                        m_parser->reset(src, m_tokens, m_constants, m_lex_error ? &*m_lex_error : nullptr);
+                else
+                        m_parser.emplace(src, m_tokens, m_constants, ErrorMode::Throw, m_lex_error ? &*m_lex_error : nullptr);
+                
+                m_parser->parseProgram();
+                m_result.succeeded = true;
+        } catch (const CompileError& compile_error) {
+                m_result.diagnostic = compile_error.message;
+                m_result.position = compile_error.position;
+                m_result.errors.push_back(compile_error);
+        }
+        
+        return m_result;
+}
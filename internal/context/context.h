@@ -0,0 +1,49 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+#include "parser.h"
+
+// Compiles one source after another in-process, for hosts that check many small programs and can neither afford to set
+// everything up again for each one nor have an error exit the process.
+// Between sources the context only clears its token buffer, constant pool and symbol tables, so once it has seen its
+// largest program it stops allocating for them. Errors come back in the Result rather than being thrown or printed.
+// The source is lexed into the token buffer before it is parsed, but a lexing error is only raised once the Parser asks
+// for the token it stopped at, so the first error reported is the same one pa::Parser::parseProgram would report.
+// Asked for more than one error, the context goes on past lexing and parsing errors alike, up to that many of them.
+
+namespace pa {
+        class CompilationContext {
+        public: // Static Data
+                struct Result {
+                        bool succeeded{false};
+                        std::string diagnostic; // The error message, empty if the source compiled
+                        size_t position{NoPosition}; // Of the error in the source
+                        std::vector<CompileError> errors; // Every error found, in the order found, the first being the one above
+                };
+        public: // Constructors/Destructors/Overloads
+                CompilationContext() = default;
+                CompilationContext(const CompilationContext&) = delete;
+                CompilationContext& operator=(const CompilationContext&) = delete;
+        public: // Public Member Functions
+                // Compiles src, which has to outlive any use of the accessors below, stopping after max_errors errors. The
+                // Result is good until the next compile.
+                const Result& compile(std::string_view src, size_t max_errors = 1);
+                
+                // What the last successful compile produced
+                [[nodiscard]] std::span<const Token> tokens() const { return m_tokens; }
+                [[nodiscard]] const ConstantPool& constants() const { return m_constants; }
+                [[nodiscard]] const Parser::SymbolTable& symbolTable() const { return m_parser->symbolTable(); }
+                // Also good after a failed compile, since the error may have come from one of them
+                [[nodiscard]] std::span<const std::string> loadedFiles() const { return m_parser ? m_parser->loadedFiles() : std::span<const std::string>(); }
+                
+        public: // Public Member Variables
+        private: // Private Member Variables
+                std::vector<Token> m_tokens;
+                ConstantPool m_constants;
+                std::optional<CompileError> m_lex_error; // Set if lexing stopped early, m_tokens then holds only what was lexed before it
+                std::vector<CompileError> m_lex_errors; // Lexed past, one for each INVALID token in m_tokens
+                std::optional<Parser> m_parser; // Made on the first compile, since a Parser can't exist without a source
+                Result m_result;
+        };
+}
@@ -0,0 +1,96 @@
+#include <cstring>
+#include <elf.h>
+#include "elf_writer.h"
+#include "io.h"
+
+namespace {
+        uint64_t alignUp(const uint64_t value, const uint64_t alignment) {
+                return (value + alignment - 1) / alignment * alignment;
+        }
+        
+        template<typename T>
+        void put(std::string& file, const uint64_t offset, const T& value) {
+                std::memcpy(file.data() + offset, &value, sizeof(value));
+        }
+}
+
+// Each section starts on a page of its own, after a page for the headers
+pa::x86::Layout pa::elf::layout(const pa::x86::Image& image, const uint64_t base) {
+        uint64_t text = base + PageSize;
+        uint64_t rodata = alignUp(text + image.text.size(), PageSize);
+        uint64_t data = alignUp(rodata + image.rodata.size(), PageSize);
+        return {text, rodata, data, data + alignUp(image.data.size(), 64)};
+}
+
+std::string pa::elf::link(pa::x86::Image image) {
+        // File offsets
+        x86::Layout placed = layout(image, BaseAddress);
+        uint64_t text_offset = placed.text - BaseAddress;
+        uint64_t rodata_offset = placed.rodata - BaseAddress;
+        uint64_t data_offset = placed.data - BaseAddress;
+        uint64_t bss_address = placed.bss;
+        
+        x86::relocate(image, placed);
+        
+        // Section names, then the section headers
+        static constexpr char SectionNames[] = "\0.text\0.rodata\0.data\0.bss\0.shstrtab";
+        uint64_t names_offset = data_offset + image.data.size();
+        uint64_t section_headers_offset = alignUp(names_offset + sizeof(SectionNames), 8);
+        
+        std::string file(section_headers_offset + 6 * sizeof(Elf64_Shdr), '\0');
+        std::memcpy(file.data() + text_offset, image.text.data(), image.text.size());
+        std::memcpy(file.data() + rodata_offset, image.rodata.data(), image.rodata.size());
+        std::memcpy(file.data() + data_offset, image.data.data(), image.data.size());
+        std::memcpy(file.data() + names_offset, SectionNames, sizeof(SectionNames));
+        
+        std::vector<Elf64_Phdr> segments;
+        auto addSegment = [&](uint64_t offset, uint64_t file_size, uint64_t memory_size, uint32_t flags) {
+                if (memory_size != 0)
+                        segments.push_back({PT_LOAD, flags, offset, BaseAddress + offset, BaseAddress + offset, file_size, memory_size, PageSize});
+        };
+        addSegment(text_offset, image.text.size(), image.text.size(), PF_R | PF_X);
+        addSegment(rodata_offset, image.rodata.size(), image.rodata.size(), PF_R);
+        addSegment(data_offset, image.data.size(), bss_address + image.bss_size - (BaseAddress + data_offset), PF_R | PF_W);
+        // A stack that isn't executable
+        segments.push_back({PT_GNU_STACK, PF_R | PF_W, 0, 0, 0, 0, 0, 16});
+        
+        Elf64_Ehdr header{};
+        std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+        header.e_ident[EI_CLASS] = ELFCLASS64;
+        header.e_ident[EI_DATA] = ELFDATA2LSB;
+        header.e_ident[EI_VERSION] = EV_CURRENT;
+        header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+        header.e_type = ET_EXEC;
+        header.e_machine = EM_X86_64;
+        header.e_version = EV_CURRENT;
+        header.e_entry = BaseAddress + text_offset + image.entry;
+        header.e_phoff = sizeof(Elf64_Ehdr);
+        header.e_shoff = section_headers_offset;
+        header.e_ehsize = sizeof(Elf64_Ehdr);
+        header.e_phentsize = sizeof(Elf64_Phdr);
+        header.e_phnum = segments.size();
+        header.e_shentsize = sizeof(Elf64_Shdr);
+        header.e_shnum = 6;
+        header.e_shstrndx = 5;
+        put(file, 0, header);
+        for (size_t i = 0; i < segments.size(); i++)
+                put(file, sizeof(Elf64_Ehdr) + i * sizeof(Elf64_Phdr), segments[i]);
+        
+        // Offsets of each name in SectionNames
+        Elf64_Shdr sections[6] = {
+                {},
+                {1, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, BaseAddress + text_offset, text_offset, image.text.size(), 0, 0, 16, 0},
+                {7, SHT_PROGBITS, SHF_ALLOC, BaseAddress + rodata_offset, rodata_offset, image.rodata.size(), 0, 0, 16, 0},
+                {15, SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, BaseAddress + data_offset, data_offset, image.data.size(), 0, 0, 16, 0},
+                {21, SHT_NOBITS, SHF_ALLOC | SHF_WRITE, bss_address, data_offset + image.data.size(), image.bss_size, 0, 0, 64, 0},
+                {26, SHT_STRTAB, 0, 0, names_offset, sizeof(SectionNames), 0, 0, 1, 0},
+        };
+        for (size_t i = 0; i < 6; i++)
+                put(file, section_headers_offset + i * sizeof(Elf64_Shdr), sections[i]);
+        
+        return file;
+}
+
+bool pa::elf::writeExecutable(const char* path, pa::x86::Image image) {
+        return io::writeFileAtomic(path, link(std::move(image)), 0755);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include "x86.h"
+
+// Static x86-64 Linux executables, written without an assembler or linker.
+// Each non-empty section of an Image gets a page aligned PT_LOAD segment of its own: .text read and execute, .rodata
+// read only, and .data followed by .bss read and write, .bss being the zero filled tail of the last segment. Nothing is
+// dynamically linked and there is no interpreter, the kernel jumps straight to the entry point. Section headers are only
+// there so objdump and readelf can find their way around.
+
+namespace pa::elf {
+        // Where the first byte of the file is mapped, with every section at the same offset from it as in the file
+        inline constexpr uint64_t BaseAddress = 0x400000;
+        inline constexpr uint64_t PageSize = 0x1000;
+        
+        // Where the sections of image go when its first byte is mapped at base, which link() places at BaseAddress and
+        // the jit wherever it mapped the image
+        [[nodiscard]] x86::Layout layout(const x86::Image& image, uint64_t base);
+        
+        // The bytes of the executable image lays out as
+        [[nodiscard]] std::string link(x86::Image image);
+        
+        // Links image and writes it to path with execute permission
+        bool writeExecutable(const char* path, x86::Image image);
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include "program.h"
+
+// Checks and compiles clike source embedded in a C++ program while that program is being built:
+//   constexpr auto& program = pa::embedded<R"(int a; a = 1;)">;
+// The Lexer and Parser run during constant evaluation, so a type error in the source is a build error (raised at the
+// check in the Lexer or Parser that failed, with the rule that was being parsed in the instantiation backtrace) and a
+// program that builds needs no checking at startup. What's left is the same precompiled form --emit-program writes,
+// baked into the binary as constant arrays with the accessors of pa::PrecompiledProgram.
+// Everything the compiler allocates has to be freed before constant evaluation ends, so each source is compiled once to
+// measure its sections and once more to copy them out.
+
+namespace pa {
+        // A string literal, passed by value as a template argument
+        template<size_t N>
+        struct EmbeddedSource {
+                char text[N]{};
+                
+                consteval EmbeddedSource(const char (&src)[N]) { std::copy_n(src, N, text); }
+                [[nodiscard]] constexpr std::string_view view() const { return {text, N - 1}; }
+        };
+        
+        // How many elements each section of an embedded program holds
+        struct EmbeddedLayout {
+                size_t source{0};
+                size_t tokens{0};
+                size_t symbols{0};
+                size_t sizes{0};
+                size_t ints{0};
+                size_t floats{0};
+                size_t chars{0};
+                size_t string_constants{0};
+                size_t strings{0};
+        };
+        
+        // Everything compiling an embedded source produces, only alive during the constant evaluation that made it
+        struct EmbeddedCompilation {
+                ConstantPool constants;
+                std::vector<Token> tokens;
+                PrecompiledProgram::Sections sections;
+                
+                static constexpr EmbeddedCompilation compile(std::string_view src);
+                [[nodiscard]] constexpr EmbeddedLayout layout(std::string_view src) const;
+        };
+        
+        template<EmbeddedLayout Layout>
+        class EmbeddedProgram {
+        public: // Constructors/Destructors/Overloads
+                consteval explicit EmbeddedProgram(std::string_view src);
+        public: // Public Member Functions
+                [[nodiscard]] constexpr std::string_view source() const { return {m_source.data(), m_source.size()}; }
+                [[nodiscard]] constexpr std::span<const Token> tokens() const { return m_tokens; }
+                [[nodiscard]] constexpr std::span<const PrecompiledProgram::Symbol> symbols() const { return m_symbols; }
+                
+                [[nodiscard]] constexpr const PrecompiledProgram::Symbol* findSymbol(std::string_view name) const;
+                [[nodiscard]] constexpr std::string_view name(const PrecompiledProgram::Symbol& symbol) const { return {m_strings.data() + symbol.name_offset, symbol.name_size}; }
+                [[nodiscard]] constexpr std::span<const uint64_t> sizes(const PrecompiledProgram::Symbol& symbol) const { return std::span(m_sizes).subspan(symbol.sizes_offset, symbol.sizes_count); }
+                
+                [[nodiscard]] constexpr std::span<const int64_t> ints() const { return m_ints; }
+                [[nodiscard]] constexpr std::span<const double> floats() const { return m_floats; }
+                [[nodiscard]] constexpr std::span<const char> chars() const { return m_chars; }
+                [[nodiscard]] constexpr std::string_view stringValue(uint32_t index) const { return {m_strings.data() + m_string_constants[index].offset, m_string_constants[index].size}; }
+                
+        public: // Public Member Variables
+        private: // Private Member Variables
+                std::array<char, Layout.source> m_source{};
+                std::array<Token, Layout.tokens> m_tokens{};
+                std::array<PrecompiledProgram::Symbol, Layout.symbols> m_symbols{};
+                std::array<uint64_t, Layout.sizes> m_sizes{};
+                std::array<int64_t, Layout.ints> m_ints{};
+                std::array<double, Layout.floats> m_floats{};
+                std::array<char, Layout.chars> m_chars{};
+                std::array<PrecompiledProgram::Slice, Layout.string_constants> m_string_constants{};
+                std::array<char, Layout.strings> m_strings{};
+        };
+        
+        template<EmbeddedSource Source>
+        inline constexpr EmbeddedProgram<EmbeddedCompilation::compile(Source.view()).layout(Source.view())> embedded{Source.view()};
+}
+
+constexpr pa::EmbeddedCompilation pa::EmbeddedCompilation::compile(const std::string_view src) {
+        EmbeddedCompilation compilation;
+        compilation.tokens = Lexer(src, compilation.constants).tokenize();
+        
+        Parser parser(src, compilation.tokens, compilation.constants);
+        parser.parseProgram();
+        
+        compilation.sections = PrecompiledProgram::collectSections(compilation.constants, parser.symbolTable());
+        return compilation;
+}
+
+constexpr pa::EmbeddedLayout pa::EmbeddedCompilation::layout(const std::string_view src) const {
+        return {src.size(), tokens.size(), sections.symbols.size(), sections.sizes.size(), constants.ints().size(), constants.floats().size(),
+                constants.chars().size(), sections.string_constants.size(), sections.strings.size()};
+}
+
+
+template<pa::EmbeddedLayout Layout>
+consteval pa::EmbeddedProgram<Layout>::EmbeddedProgram(const std::string_view src) {
+        EmbeddedCompilation compilation = EmbeddedCompilation::compile(src);
+        
+        std::ranges::copy(src, m_source.begin());
+        std::ranges::copy(compilation.tokens, m_tokens.begin());
+        std::ranges::copy(compilation.sections.symbols, m_symbols.begin());
+        std::ranges::copy(compilation.sections.sizes, m_sizes.begin());
+        std::ranges::copy(compilation.constants.ints(), m_ints.begin());
+        std::ranges::copy(compilation.constants.floats(), m_floats.begin());
+        std::ranges::copy(compilation.constants.chars(), m_chars.begin());
+        std::ranges::copy(compilation.sections.string_constants, m_string_constants.begin());
+        std::ranges::copy(compilation.sections.strings, m_strings.begin());
+}
+
+template<pa::EmbeddedLayout Layout>
+constexpr const pa::PrecompiledProgram::Symbol* pa::EmbeddedProgram<Layout>::findSymbol(const std::string_view name) const {
+        auto symbol = std::lower_bound(m_symbols.begin(), m_symbols.end(), name, [this](const PrecompiledProgram::Symbol& symbol, std::string_view name) {
+                return this->name(symbol) < name;
+        });
+        return symbol != m_symbols.end() && this->name(*symbol) == name ? &*symbol : nullptr;
+}
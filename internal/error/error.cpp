@@ -0,0 +1,10 @@
+#include <iostream>
+#include "error.h"
+
+void pa::reportError(const pa::ErrorMode mode, const std::string_view message, const size_t position) {
+        if (mode == ErrorMode::Throw)
+                throw CompileError{std::string(message), position};
+        
+        std::cout << message << "\n";
+        std::exit(EXIT_FAILURE);
+}
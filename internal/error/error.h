@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace pa {
+        // How the Lexer and Parser surface an error, either by printing it and exiting (the default for the command line)
+        // or by throwing it back to the caller as a CompileError
+        enum class ErrorMode {
+                Exit,
+                Throw,
+        };
+        
+        // The position of an error that isn't at any particular place in the source
+        inline constexpr size_t NoPosition = SIZE_MAX;
+        
+        struct CompileError {
+                std::string message;
+                size_t position{NoPosition}; // Byte offset into the source, which a LineIndex turns into a line and column
+        };
+        
+        [[noreturn]] void reportError(ErrorMode mode, std::string_view message, size_t position = NoPosition);
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "hash.h"
+
+namespace pa {
+        constexpr uint64_t hashKey(const std::string_view key) {
+                return pa::hashBytes(key);
+        }
+        
+        template<std::integral T>
+        constexpr uint64_t hashKey(const T key) {
+                uint64_t hash = static_cast<uint64_t>(key);
+                hash ^= hash >> 33;
+                hash *= 0xFF51AFD7ED558CCDull;
+                hash ^= hash >> 33;
+                hash *= 0xC4CEB9FE1A85EC53ull;
+                hash ^= hash >> 33;
+                return hash;
+        }
+        
+        // Hash map that keeps its entries packed in insertion order, beside an open addressed table of indices into them.
+        // Unlike std::unordered_map it can be used in a constant expression and iterates in a deterministic order, and a
+        // map keyed on std::string can be searched with a std::string_view without building a string.
+        // Inserting may move the entries, so pointers handed out by find are only good until the next insertion.
+        template<typename Key, typename Value>
+        class FlatMap {
+        public: // Static Data
+                using Entry = std::pair<Key, Value>;
+                
+                static constexpr size_t MinimumSlots = 16;
+        public: // Public Member Functions
+                template<typename K>
+                [[nodiscard]] constexpr const Value* find(const K& key) const {
+                        if (m_slots.empty())
+                                return nullptr;
+                        uint32_t slot = m_slots[slotOf(key)];
+                        return slot == 0 ? nullptr : &m_entries[slot - 1].second;
+                }
+                
+                template<typename K>
+                [[nodiscard]] constexpr Value* find(const K& key) {
+                        return const_cast<Value*>(std::as_const(*this).find(key));
+                }
+                
+                // Inserts value under key unless key is already present, returning the value now held under key and whether it was inserted
+                template<typename K>
+                constexpr std::pair<Value*, bool> tryEmplace(const K& key, Value value) {
+                        if ((m_entries.size() + 1) * 4 > m_slots.size() * 3)
+                                grow();
+                        
+                        uint32_t& slot = m_slots[slotOf(key)];
+                        if (slot != 0)
+                                return {&m_entries[slot - 1].second, false};
+                        
+                        m_entries.emplace_back(Key(key), std::move(value));
+                        slot = m_entries.size();
+                        return {&m_entries.back().second, true};
+                }
+                
+                template<typename K>
+                constexpr Value& operator[](const K& key) {
+                        return *tryEmplace(key, Value{}).first;
+                }
+                
+                // Empties the map but keeps its memory around for the next round of insertions
+                constexpr void clear() {
+                        m_entries.clear();
+                        std::fill(m_slots.begin(), m_slots.end(), 0);
+                }
+                
+                [[nodiscard]] constexpr size_t size() const { return m_entries.size(); }
+                [[nodiscard]] constexpr bool empty() const { return m_entries.empty(); }
+                
+                [[nodiscard]] constexpr auto begin() const { return m_entries.begin(); }
+                [[nodiscard]] constexpr auto end() const { return m_entries.end(); }
+                
+        private: // Private Member Functions
+                // The slot holding key, or the empty slot it would go in
+                template<typename K>
+                [[nodiscard]] constexpr size_t slotOf(const K& key) const {
+                        size_t mask = m_slots.size() - 1;
+                        for (size_t slot = hashKey(key) & mask;; slot = (slot + 1) & mask)
+                                if (m_slots[slot] == 0 || m_entries[m_slots[slot] - 1].first == key)
+                                        return slot;
+                }
+                
+                constexpr void grow() {
+                        m_slots.assign(std::max(m_slots.size() * 2, MinimumSlots), 0);
+                        for (size_t i = 0; i < m_entries.size(); i++)
+                                m_slots[slotOf(m_entries[i].first)] = i + 1;
+                }
+        private: // Private Member Variables
+                std::vector<Entry> m_entries;
+                std::vector<uint32_t> m_slots; // One past the index of the entry in each slot, 0 if the slot is empty
+        };
+}
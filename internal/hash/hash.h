@@ -0,0 +1,39 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace pa {
+        // Reads count (at most eight) bytes starting at offset as a native endian word, zero filling the rest.
+        // memcpy isn't usable in a constant expression, so there the word is assembled byte by byte in little endian order,
+        // which is what memcpy gives on every target we build for.
+        constexpr uint64_t loadWord(const std::string_view bytes, const size_t offset, const size_t count) {
+                uint64_t word = 0;
+                if consteval {
+                        for (size_t i = 0; i < count; i++)
+                                word |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[offset + i])) << (8 * i);
+                } else {
+                        std::memcpy(&word, bytes.data() + offset, count);
+                }
+                return word;
+        }
+        
+        // Fast non-cryptographic 64-bit hash over a byte buffer, eight bytes per step with a final avalanche.
+        // Good for spotting changed content, not for anything adversarial.
+        constexpr uint64_t hashBytes(const std::string_view bytes, uint64_t seed = 0) {
+                constexpr uint64_t Multiplier = 0x9E3779B97F4A7C15ull;
+                
+                uint64_t hash = seed ^ (bytes.size() * Multiplier);
+                size_t i = 0;
+                for (; i + 8 <= bytes.size(); i += 8)
+                        hash = (std::rotl(hash, 5) ^ loadWord(bytes, i, 8)) * Multiplier;
+                
+                hash = (std::rotl(hash, 5) ^ loadWord(bytes, i, bytes.size() - i)) * Multiplier;
+                
+                hash ^= hash >> 33;
+                hash *= 0xFF51AFD7ED558CCDull;
+                hash ^= hash >> 33;
+                return hash;
+        }
+}
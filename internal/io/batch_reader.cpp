@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <format>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "batch_reader.h"
+
+namespace {
+        // A single read returns at most this much, larger files taking a read per chunk
+        constexpr uint64_t MaxReadSize = 1 << 30;
+        
+        uint32_t loadAcquire(uint32_t* value) {
+                return std::atomic_ref<uint32_t>(*value).load(std::memory_order_acquire);
+        }
+        
+        void storeRelease(uint32_t* value, const uint32_t stored) {
+                std::atomic_ref<uint32_t>(*value).store(stored, std::memory_order_release);
+        }
+        
+        template<typename T>
+        T* at(void* mapping, const uint32_t offset) {
+                return reinterpret_cast<T*>(static_cast<char*>(mapping) + offset);
+        }
+}
+
+pa::io::BatchReader::BatchReader(const std::span<const char* const> paths)
+        : m_paths(paths), m_files(paths.size()), m_waiting(paths.size()), m_progress(paths.size()) {
+        if (setUpRing())
+                submitWindow();
+}
+
+pa::io::BatchReader::~BatchReader() {
+        if (m_ring_fd < 0)
+                return;
+        
+        // The kernel may still be writing into the files, so the reads in flight are waited out before anything goes
+        m_stopping = true;
+        while (m_in_flight != 0) {
+                submit(1);
+                reap();
+        }
+        for (size_t i = 0; i < m_files.size(); i++)
+                closeFile(i);
+        tearDownRing();
+}
+
+void pa::io::BatchReader::poll() {
+        if (m_ring_fd < 0 || (m_in_flight == 0 && m_to_submit == 0))
+                return;
+        
+        submit(1);
+        reap();
+        submitWindow();
+        
+        // Only resumed now, since a coroutine may go on to ask for more files
+        std::vector<std::coroutine_handle<>> ready = std::exchange(m_ready, {});
+        for (std::coroutine_handle<> waiting: ready)
+                waiting.resume();
+}
+
+bool pa::io::BatchReader::ready(const size_t index) {
+        m_consumed = std::max(m_consumed, index);
+        if (m_ring_fd < 0) {
+                if (!m_files[index].done)
+                        readBlocking(index);
+                return true;
+        }
+        
+        submitWindow();
+        return m_files[index].done;
+}
+
+void pa::io::BatchReader::readBlocking(const size_t index) {
+        File& file = m_files[index];
+        file.done = true;
+        m_progress[index].stage = Stage::Done;
+        
+        int fd = open(m_paths[index], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+                file.error = std::format("Failed to open the file: {}\n", m_paths[index]);
+                return;
+        }
+        
+        struct stat status{};
+        if (fstat(fd, &status) == 0 && status.st_size > 0) {
+                file.contents.resize(status.st_size);
+                uint64_t offset = 0;
+                while (offset < file.contents.size()) {
+                        ssize_t result = pread(fd, file.contents.data() + offset, file.contents.size() - offset, static_cast<off_t>(offset));
+                        if (result < 0 && errno == EINTR)
+                                continue;
+                        if (result < 0) {
+                                file.contents.clear();
+                                file.error = "Failed to read the file.\n";
+                                break;
+                        }
+                        if (result == 0)
+                                break;
+                        offset += result;
+                }
+                if (file.error.empty())
+                        file.contents.resize(offset);
+        }
+        close(fd);
+}
+
+bool pa::io::BatchReader::setUpRing() {
+        io_uring_params params{};
+        auto fd = static_cast<int>(syscall(__NR_io_uring_setup, QueueDepth, &params));
+        if (fd < 0)
+                return false;
+        m_ring_fd = fd;
+        
+        m_submission_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        m_completion_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap)
+                m_submission_ring_size = m_completion_ring_size = std::max(m_submission_ring_size, m_completion_ring_size);
+        
+        void* submission_ring = mmap(nullptr, m_submission_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (submission_ring == MAP_FAILED) {
+                tearDownRing();
+                return false;
+        }
+        m_submission_ring = submission_ring;
+        
+        if (single_mmap) {
+                m_completion_ring = m_submission_ring;
+        } else {
+                void* completion_ring = mmap(nullptr, m_completion_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                if (completion_ring == MAP_FAILED) {
+                        tearDownRing();
+                        return false;
+                }
+                m_completion_ring = completion_ring;
+        }
+        
+        m_entries_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* entries = mmap(nullptr, m_entries_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (entries == MAP_FAILED) {
+                tearDownRing();
+                return false;
+        }
+        m_entries = entries;
+        
+        m_sq_head = at<uint32_t>(m_submission_ring, params.sq_off.head);
+        m_sq_tail = at<uint32_t>(m_submission_ring, params.sq_off.tail);
+        m_sq_array = at<uint32_t>(m_submission_ring, params.sq_off.array);
+        m_sq_mask = *at<uint32_t>(m_submission_ring, params.sq_off.ring_mask);
+        m_cq_head = at<uint32_t>(m_completion_ring, params.cq_off.head);
+        m_cq_tail = at<uint32_t>(m_completion_ring, params.cq_off.tail);
+        m_cq_mask = *at<uint32_t>(m_completion_ring, params.cq_off.ring_mask);
+        m_cqes = at<void>(m_completion_ring, params.cq_off.cqes);
+        return true;
+}
+
+void pa::io::BatchReader::tearDownRing() {
+        if (m_entries != nullptr)
+                munmap(m_entries, m_entries_size);
+        if (m_completion_ring != nullptr && m_completion_ring != m_submission_ring)
+                munmap(m_completion_ring, m_completion_ring_size);
+        if (m_submission_ring != nullptr)
+                munmap(m_submission_ring, m_submission_ring_size);
+        m_entries = m_completion_ring = m_submission_ring = nullptr;
+        close(m_ring_fd);
+        m_ring_fd = -1;
+}
+
+void pa::io::BatchReader::submitWindow() {
+        // Each file in the window has at most one operation in flight, so the queue never overflows
+        while (m_next_open < m_paths.size() && m_next_open < m_consumed + QueueDepth)
+                prepareOpen(m_next_open++);
+        if (m_to_submit != 0)
+                submit(0);
+}
+
+void pa::io::BatchReader::prepareOpen(const size_t index) {
+        uint32_t tail = *m_sq_tail;
+        uint32_t slot = tail & m_sq_mask;
+        io_uring_sqe& entry = static_cast<io_uring_sqe*>(m_entries)[slot];
+        entry = {};
+        entry.opcode = IORING_OP_OPENAT;
+        entry.fd = AT_FDCWD;
+        entry.addr = reinterpret_cast<uint64_t>(m_paths[index]);
+        entry.open_flags = O_RDONLY | O_CLOEXEC;
+        entry.user_data = index;
+        m_sq_array[slot] = slot;
+        storeRelease(m_sq_tail, tail + 1);
+        
+        m_progress[index].stage = Stage::Opening;
+        m_to_submit++;
+        m_in_flight++;
+}
+
+void pa::io::BatchReader::prepareRead(const size_t index) {
+        Progress& progress = m_progress[index];
+        uint32_t tail = *m_sq_tail;
+        uint32_t slot = tail & m_sq_mask;
+        io_uring_sqe& entry = static_cast<io_uring_sqe*>(m_entries)[slot];
+        entry = {};
+        entry.opcode = IORING_OP_READ;
+        entry.fd = progress.fd;
+        entry.addr = reinterpret_cast<uint64_t>(m_files[index].contents.data() + progress.offset);
+        entry.len = static_cast<uint32_t>(std::min(progress.size - progress.offset, MaxReadSize));
+        entry.off = progress.offset;
+        entry.user_data = index;
+        m_sq_array[slot] = slot;
+        storeRelease(m_sq_tail, tail + 1);
+        
+        progress.stage = Stage::Reading;
+        m_to_submit++;
+        m_in_flight++;
+}
+
+void pa::io::BatchReader::submit(const uint32_t wait_for) {
+        unsigned flags = wait_for != 0 ? IORING_ENTER_GETEVENTS : 0;
+        for (;;) {
+                auto result = syscall(__NR_io_uring_enter, m_ring_fd, m_to_submit, wait_for, flags, nullptr, 0);
+                if (result >= 0) {
+                        m_to_submit -= std::min<uint32_t>(m_to_submit, static_cast<uint32_t>(result));
+                        return;
+                }
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                        return;
+        }
+}
+
+void pa::io::BatchReader::reap() {
+        uint32_t head = *m_cq_head;
+        uint32_t tail = loadAcquire(m_cq_tail);
+        for (; head != tail; head++) {
+                const io_uring_cqe& completion = static_cast<const io_uring_cqe*>(m_cqes)[head & m_cq_mask];
+                size_t index = completion.user_data;
+                int32_t result = completion.res;
+                m_in_flight--;
+                complete(index, result);
+        }
+        storeRelease(m_cq_head, head);
+}
+
+void pa::io::BatchReader::complete(const size_t index, const int32_t result) {
+        Progress& progress = m_progress[index];
+        File& file = m_files[index];
+        if (progress.stage == Stage::Opening) {
+                if (result == -EINVAL || result == -EOPNOTSUPP) {
+                        // A kernel with io_uring but without these operations
+                        if (!m_stopping)
+                                readBlocking(index);
+                        return finish(index, std::move(file.error));
+                }
+                if (result < 0)
+                        return finish(index, std::format("Failed to open the file: {}\n", m_paths[index]));
+                
+                progress.fd = result;
+                struct stat status{};
+                if (m_stopping || fstat(progress.fd, &status) != 0 || status.st_size <= 0)
+                        return finish(index, "");
+                progress.size = status.st_size;
+                file.contents.resize(progress.size);
+                return prepareRead(index);
+        }
+        
+        if (result < 0) {
+                file.contents.clear();
+                return finish(index, "Failed to read the file.\n");
+        }
+        progress.offset += result;
+        if (result == 0 || progress.offset == progress.size || m_stopping) {
+                // A file that shrank since it was opened is cut short, as readFile would
+                file.contents.resize(progress.offset);
+                return finish(index, "");
+        }
+        prepareRead(index);
+}
+
+void pa::io::BatchReader::finish(const size_t index, std::string error) {
+        closeFile(index);
+        m_progress[index].stage = Stage::Done;
+        m_files[index].error = std::move(error);
+        m_files[index].done = true;
+        if (m_waiting[index])
+                m_ready.push_back(std::exchange(m_waiting[index], {}));
+}
+
+void pa::io::BatchReader::closeFile(const size_t index) {
+        if (m_progress[index].fd >= 0)
+                close(std::exchange(m_progress[index].fd, -1));
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <coroutine>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Reads many files ahead of whoever consumes them, so a batch of sources isn't read one blocking open and read at a
+// time. Opens and reads go to the kernel in batches through io_uring, driven by raw syscalls, and a completed open
+// queues the read of the whole file straight away. Up to QueueDepth files are in flight or waiting to be consumed at
+// once, which bounds the memory held by files read ahead. Where io_uring is unavailable (old kernels, seccomp filters)
+// each file is read with blocking calls when it is asked for.
+// Consumers are coroutines: co_await reader.read(i) suspends until file i has been read, and poll() resumes them as
+// their reads complete.
+
+namespace pa::io {
+        // Coroutine that starts running as soon as it is called and is destroyed with its Task
+        class Task {
+        public: // Static Data
+                struct promise_type {
+                        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+                        std::suspend_never initial_suspend() noexcept { return {}; }
+                        std::suspend_always final_suspend() noexcept { return {}; }
+                        void return_void() {}
+                        void unhandled_exception() { throw; }
+                };
+        public: // Constructors/Destructors/Overloads
+                explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+                Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+                Task(const Task&) = delete;
+                Task& operator=(const Task&) = delete;
+                ~Task() {
+                        if (m_handle)
+                                m_handle.destroy();
+                }
+        public: // Public Member Functions
+                [[nodiscard]] bool done() const { return m_handle.done(); }
+        private: // Private Member Variables
+                std::coroutine_handle<promise_type> m_handle;
+        };
+        
+        class BatchReader {
+        public: // Static Data
+                static constexpr uint32_t QueueDepth = 64;
+                
+                struct File {
+                        std::string contents;
+                        std::string error; // The message readFile would have printed, empty if the file was read
+                        bool done{false};
+                };
+                
+                class ReadAwaiter {
+                public:
+                        ReadAwaiter(BatchReader& reader, size_t index) : m_reader(reader), m_index(index) {}
+                        bool await_ready() { return m_reader.ready(m_index); }
+                        void await_suspend(std::coroutine_handle<> waiting) { m_reader.m_waiting[m_index] = waiting; }
+                        File& await_resume() { return m_reader.m_files[m_index]; }
+                private:
+                        BatchReader& m_reader;
+                        size_t m_index;
+                };
+        public: // Constructors/Destructors/Overloads
+                // paths have to outlive the BatchReader, which starts reading them straight away
+                explicit BatchReader(std::span<const char* const> paths);
+                ~BatchReader();
+                BatchReader(const BatchReader&) = delete;
+                BatchReader& operator=(const BatchReader&) = delete;
+        public: // Public Member Functions
+                [[nodiscard]] bool usesIoUring() const { return m_ring_fd >= 0; }
+                
+                // Hands out file index once it has been read. Files are expected to be asked for in order, each one asked
+                // for letting the reader move on to another file past the window read ahead.
+                ReadAwaiter read(size_t index) { return {*this, index}; }
+                
+                // Waits for at least one read to complete, resuming the coroutine waiting on each file that is now done
+                void poll();
+        private: // Private Member Types
+                enum class Stage : uint8_t {
+                        Queued,
+                        Opening,
+                        Reading,
+                        Done,
+                };
+                
+                struct Progress {
+                        Stage stage{Stage::Queued};
+                        int fd{-1};
+                        uint64_t size{0};
+                        uint64_t offset{0}; // Read so far
+                };
+        private: // Private Member Functions
+                bool ready(size_t index);
+                void readBlocking(size_t index);
+                
+                bool setUpRing();
+                void tearDownRing();
+                // Queues opens for files in the window that haven't been started, and submits everything queued
+                void submitWindow();
+                void prepareOpen(size_t index);
+                void prepareRead(size_t index);
+                void submit(uint32_t wait_for);
+                void complete(size_t index, int32_t result);
+                // Handles every completion there is, moving the coroutines now able to continue to m_ready
+                void reap();
+                void finish(size_t index, std::string error);
+                void closeFile(size_t index);
+        private: // Private Member Variables
+                std::span<const char* const> m_paths;
+                std::vector<File> m_files;
+                std::vector<std::coroutine_handle<>> m_waiting;
+                size_t m_consumed{0}; // Files before this one have been asked for
+                size_t m_next_open{0};
+                uint32_t m_in_flight{0};
+                
+                std::vector<Progress> m_progress; // Per file, while being read through the ring
+                std::vector<std::coroutine_handle<>> m_ready; // Resumed by poll once the completions are all handled
+                bool m_stopping{false}; // Set while destroying, to wind down the reads in flight
+                
+                // The ring, mapped from the kernel, with m_ring_fd -1 if io_uring is unavailable
+                int m_ring_fd{-1};
+                void* m_submission_ring{nullptr};
+                size_t m_submission_ring_size{0};
+                void* m_completion_ring{nullptr};
+                size_t m_completion_ring_size{0};
+                void* m_entries{nullptr};
+                size_t m_entries_size{0};
+                uint32_t* m_sq_head{nullptr};
+                uint32_t* m_sq_tail{nullptr};
+                uint32_t* m_sq_array{nullptr};
+                uint32_t m_sq_mask{0};
+                uint32_t* m_cq_head{nullptr};
+                uint32_t* m_cq_tail{nullptr};
+                uint32_t m_cq_mask{0};
+                void* m_cqes{nullptr};
+                uint32_t m_to_submit{0};
+        };
+}
@@ -1,3 +1,8 @@
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "io.h"
 
 std::string pa::io::readFile(const char* filepath) noexcept {
@@ -25,3 +30,62 @@ std::string pa::io::readFile(const char* filepath) noexcept {
         fclose(file);
         return ret;
 }
+
+bool pa::io::writeFileAtomic(const char* filepath, const std::string_view bytes, const unsigned mode) noexcept {
+        std::string temporary_path = std::string(filepath) + ".tmp." + std::to_string(getpid());
+        
+        int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+        if (fd < 0)
+                return false;
+        
+        size_t written = 0;
+        while (written < bytes.size()) {
+                ssize_t result = write(fd, bytes.data() + written, bytes.size() - written);
+                if (result < 0) {
+                        close(fd);
+                        unlink(temporary_path.c_str());
+                        return false;
+                }
+                written += result;
+        }
+        
+        if (close(fd) != 0 || rename(temporary_path.c_str(), filepath) != 0) {
+                unlink(temporary_path.c_str());
+                return false;
+        }
+        return true;
+}
+
+
+pa::io::MappedFile::MappedFile(const char* filepath) noexcept {
+        int fd = open(filepath, O_RDONLY);
+        if (fd < 0)
+                return;
+        
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+                void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping != MAP_FAILED) {
+                        m_data = static_cast<const char*>(mapping);
+                        m_size = file_stat.st_size;
+                }
+        }
+        close(fd);
+}
+
+pa::io::MappedFile::MappedFile(pa::io::MappedFile&& other) noexcept : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+
+pa::io::MappedFile& pa::io::MappedFile::operator=(pa::io::MappedFile&& other) noexcept {
+        if (this != &other) {
+                if (m_data != nullptr)
+                        munmap(const_cast<char*>(m_data), m_size);
+                m_data = std::exchange(other.m_data, nullptr);
+                m_size = std::exchange(other.m_size, 0);
+        }
+        return *this;
+}
+
+pa::io::MappedFile::~MappedFile() {
+        if (m_data != nullptr)
+                munmap(const_cast<char*>(m_data), m_size);
+}
@@ -1,6 +1,29 @@
 #pragma once
 #include <string>
+#include <string_view>
 
 namespace pa::io {
         std::string readFile(const char* filepath) noexcept;
+        
+        // Writes bytes to a temporary file next to filepath and renames it into place, so readers never see a partial file.
+        // mode is the permissions the file is created with.
+        bool writeFileAtomic(const char* filepath, std::string_view bytes, unsigned mode = 0644) noexcept;
+        
+        // Read-only mapping of a whole file, unmapped on destruction
+        class MappedFile {
+        public: // Constructors/Destructors/Overloads
+                MappedFile() = default;
+                explicit MappedFile(const char* filepath) noexcept;
+                MappedFile(MappedFile&& other) noexcept;
+                MappedFile& operator=(MappedFile&& other) noexcept;
+                MappedFile(const MappedFile&) = delete;
+                MappedFile& operator=(const MappedFile&) = delete;
+                ~MappedFile();
+        public: // Public Member Functions
+                [[nodiscard]] bool isOpen() const { return m_data != nullptr; }
+                [[nodiscard]] std::string_view bytes() const { return {m_data, m_size}; }
+        private: // Private Member Variables
+                const char* m_data{nullptr};
+                size_t m_size{0};
+        };
 }
@@ -0,0 +1,273 @@
+#include <cstring>
+#include <ctime>
+#include <format>
+#include <iostream>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "elf_writer.h"
+#include "io.h"
+#include "jit.h"
+
+namespace {
+        // From the jitdump specification of the Linux perf tools
+        constexpr uint32_t JitdumpMagic = 0x4A695444;
+        constexpr uint32_t JitdumpVersion = 1;
+        constexpr uint32_t JitCodeLoad = 0;
+        constexpr uint32_t JitCodeDebugInfo = 2;
+        constexpr uint32_t ElfMachineX86_64 = 62;
+        
+        uint64_t alignUp(const uint64_t value, const uint64_t alignment) {
+                return (value + alignment - 1) / alignment * alignment;
+        }
+        
+        template<typename T>
+        void append(std::string& bytes, const T& value) {
+                bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        
+        uint64_t monotonicTime() {
+                timespec now{};
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                return static_cast<uint64_t>(now.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(now.tv_nsec);
+        }
+        
+        // The whole jitdump, but for the pids that are only known in the child, which are left at the offsets in pids
+        std::string buildJitdump(const pa::x86::Image& image, const uint64_t text, const std::string& source_path, std::vector<size_t>& pids) {
+                uint64_t timestamp = monotonicTime();
+                std::string dump;
+                for (uint32_t field: {JitdumpMagic, JitdumpVersion, uint32_t{40}, ElfMachineX86_64, uint32_t{0}, uint32_t{0}})
+                        append(dump, field);
+                pids.push_back(dump.size() - 4);
+                append(dump, timestamp);
+                append(dump, uint64_t{0});
+                
+                // Each record is padded to 8 bytes, its size including its 16 byte header
+                auto record = [&](const uint32_t id, const std::string& body) {
+                        append(dump, id);
+                        append(dump, static_cast<uint32_t>(alignUp(16 + body.size(), 8)));
+                        append(dump, timestamp);
+                        dump += body;
+                        dump.resize(alignUp(dump.size(), 8), '\0');
+                };
+                
+                uint64_t index = 0;
+                for (const pa::x86::Symbol& symbol: image.symbols) {
+                        uint64_t address = text + symbol.offset;
+                        
+                        // The line table has to come before the code it describes
+                        if (symbol.line != 0) {
+                                std::string body;
+                                append(body, address);
+                                append(body, uint64_t{1});
+                                append(body, address);
+                                append(body, symbol.line);
+                                append(body, uint32_t{0});
+                                body.append(source_path.c_str(), source_path.size() + 1);
+                                record(JitCodeDebugInfo, body);
+                        }
+                        
+                        std::string body;
+                        size_t pid = dump.size() + 16;
+                        append(body, uint32_t{0});
+                        append(body, uint32_t{0});
+                        append(body, address);
+                        append(body, address);
+                        append(body, symbol.size);
+                        append(body, index++);
+                        body.append(symbol.name.c_str(), symbol.name.size() + 1);
+                        body.append(image.text, symbol.offset, symbol.size);
+                        record(JitCodeLoad, body);
+                        pids.push_back(pid);
+                        pids.push_back(pid + 4);
+                }
+                return dump;
+        }
+        
+        // Only async-signal-safe calls, since the child of a process that may have had threads running can't allocate
+        void writeJitdump(std::string& dump, const std::vector<size_t>& pids) {
+                uint32_t pid = static_cast<uint32_t>(getpid());
+                for (size_t offset: pids)
+                        std::memcpy(dump.data() + offset, &pid, sizeof(pid));
+                
+                char path[64] = "/tmp/jit-";
+                char digits[16];
+                size_t length = 0;
+                for (uint32_t rest = pid; length == 0 || rest != 0; rest /= 10)
+                        digits[length++] = static_cast<char>('0' + rest % 10);
+                size_t end = std::strlen(path);
+                while (length != 0)
+                        path[end++] = digits[--length];
+                std::memcpy(path + end, ".dump", 6);
+                
+                int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+                if (fd < 0)
+                        return;
+                for (size_t written = 0; written < dump.size();) {
+                        ssize_t result = write(fd, dump.data() + written, dump.size() - written);
+                        if (result <= 0)
+                                break;
+                        written += result;
+                }
+                // perf record notices the dump by this executable mapping of it, which has to stay mapped
+                mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+                close(fd);
+        }
+        
+        // Where place() put an Image, and the stack it set up after it
+        struct PlacedImage {
+                void* mapping{MAP_FAILED};
+                uint64_t size{0};
+                pa::x86::Layout layout{};
+                uint64_t* stack{nullptr};
+                uint64_t entry{0};
+        };
+        
+        PlacedImage place(const pa::x86::Image& image, const std::string& name) {
+                // One mapping for the image, laid out as in an executable, followed by the stack
+                PlacedImage placed_image;
+                pa::x86::Layout offsets = pa::elf::layout(image, 0);
+                uint64_t image_size = alignUp(offsets.bss + image.bss_size, pa::elf::PageSize);
+                placed_image.size = image_size + pa::jit::StackSize;
+                placed_image.mapping = mmap(nullptr, placed_image.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (placed_image.mapping == MAP_FAILED)
+                        return placed_image;
+                auto base = reinterpret_cast<uint64_t>(placed_image.mapping);
+                
+                pa::x86::Image placed = image;
+                pa::x86::Layout layout = pa::elf::layout(placed, base);
+                pa::x86::relocate(placed, layout);
+                std::memcpy(reinterpret_cast<char*>(layout.text), placed.text.data(), placed.text.size());
+                std::memcpy(reinterpret_cast<char*>(layout.rodata), placed.rodata.data(), placed.rodata.size());
+                std::memcpy(reinterpret_cast<char*>(layout.data), placed.data.data(), placed.data.size());
+                mprotect(reinterpret_cast<char*>(layout.text), layout.rodata - layout.text, PROT_READ | PROT_EXEC);
+                mprotect(reinterpret_cast<char*>(layout.rodata), layout.data - layout.rodata, PROT_READ);
+                
+                // The stack as the kernel leaves it: argc, argv, an empty environment and an empty auxiliary vector, with the
+                // string argv[0] points to above them
+                uint64_t stack_top = base + placed_image.size;
+                uint64_t program_name = stack_top - alignUp(name.size() + 1, 16);
+                std::memcpy(reinterpret_cast<char*>(program_name), name.c_str(), name.size() + 1);
+                placed_image.stack = reinterpret_cast<uint64_t*>(program_name - 6 * sizeof(uint64_t));
+                uint64_t initial[] = {1, program_name, 0, 0, 0, 0};
+                std::memcpy(placed_image.stack, initial, sizeof(initial));
+                
+                placed_image.layout = layout;
+                placed_image.entry = layout.text + image.entry;
+                return placed_image;
+        }
+        
+        int exitStatus(const int status) {
+                return WIFEXITED(status) ? WEXITSTATUS(status) : WIFSIGNALED(status) ? 128 + WTERMSIG(status) : -1;
+        }
+        
+        void writePerfMap(const pa::x86::Image& image, const uint64_t text, const pid_t pid) {
+                std::string map;
+                for (const pa::x86::Symbol& symbol: image.symbols)
+                        map += std::format("{:x} {:x} {}\n", text + symbol.offset, symbol.size, symbol.name);
+                if (!pa::io::writeFileAtomic(std::format("/tmp/perf-{}.map", pid).c_str(), map))
+                        std::cout << std::format("Failed to write /tmp/perf-{}.map\n", pid);
+        }
+}
+
+int pa::jit::run(const pa::x86::Image& image, const pa::jit::Options& options) {
+        PlacedImage placed = place(image, options.name);
+        if (placed.mapping == MAP_FAILED)
+                return -1;
+        
+        std::vector<size_t> pids;
+        std::string dump = options.jitdump ? buildJitdump(image, placed.layout.text, options.source_path, pids) : std::string();
+        
+        std::cout.flush();
+        pid_t child = fork();
+        if (child == 0) {
+                if (options.jitdump)
+                        writeJitdump(dump, pids);
+                asm volatile("mov %0, %%rsp\n\tjmp *%1" :: "r"(placed.stack), "r"(placed.entry) : "memory");
+                __builtin_unreachable();
+        }
+        
+        int status = -1;
+        if (child > 0) {
+                if (options.perf_map)
+                        writePerfMap(image, placed.layout.text, child);
+                if (waitpid(child, &status, 0) == child)
+                        status = exitStatus(status);
+                else
+                        status = -1;
+        }
+        munmap(placed.mapping, placed.size);
+        return status;
+}
+
+
+pa::jit::StoppedProgram::StoppedProgram(const pa::x86::Image& image, const pa::jit::Options& options) {
+        PlacedImage placed = place(image, options.name);
+        if (placed.mapping == MAP_FAILED)
+                return;
+        m_mapping = placed.mapping;
+        m_mapping_size = placed.size;
+        m_bss = placed.layout.bss;
+        m_output = memfd_create("pa-stopped-output", MFD_CLOEXEC);
+        if (m_output < 0)
+                return;
+        
+        std::cout.flush();
+        m_pid = fork();
+        if (m_pid == 0) {
+                dup2(m_output, STDOUT_FILENO);
+                asm volatile("mov %0, %%rsp\n\tjmp *%1" :: "r"(placed.stack), "r"(placed.entry) : "memory");
+                __builtin_unreachable();
+        }
+        
+        int status = 0;
+        if (m_pid < 0 || waitpid(m_pid, &status, WUNTRACED) != m_pid) {
+                m_pid = -1;
+                return;
+        }
+        m_stopped = WIFSTOPPED(status);
+        if (!m_stopped) {
+                m_status = exitStatus(status);
+                m_pid = -1;
+        }
+}
+
+pa::jit::StoppedProgram::~StoppedProgram() {
+        if (m_pid > 0) {
+                kill(m_pid, SIGKILL);
+                waitpid(m_pid, nullptr, 0);
+        }
+        if (m_output >= 0)
+                close(m_output);
+        if (m_mapping != nullptr)
+                munmap(m_mapping, m_mapping_size);
+}
+
+bool pa::jit::StoppedProgram::read(const uint64_t address, char* const bytes, const uint64_t size) const {
+        if (!m_stopped)
+                return false;
+        for (uint64_t done = 0; done < size;) {
+                iovec local{bytes + done, size - done};
+                iovec remote{reinterpret_cast<void*>(address + done), size - done};
+                ssize_t result = process_vm_readv(m_pid, &local, 1, &remote, 1, 0);
+                if (result <= 0)
+                        return false;
+                done += result;
+        }
+        return true;
+}
+
+std::string pa::jit::StoppedProgram::output() const {
+        std::string output;
+        char buffer[1 << 16];
+        for (off_t offset = 0;;) {
+                ssize_t result = pread(m_output, buffer, sizeof(buffer), offset);
+                if (result <= 0)
+                        return output;
+                output.append(buffer, result);
+                offset += result;
+        }
+}
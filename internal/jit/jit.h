@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include "x86.h"
+
+// Runs a native program straight from memory, without writing an executable first.
+// The Image is laid out as elf::link() would lay it out, only at wherever the mapping lands, and a forked child jumps to
+// its entry point on a stack set up like the kernel's. Since the code then lives in anonymous memory, perf would only
+// see addresses in it, so the symbols of the Image can be published the two ways perf understands:
+//   /tmp/perf-<pid>.map  a line of start, size and name per symbol, read by perf report as it is
+//   /tmp/jit-<pid>.dump  the jitdump format, with the code and a line table per symbol, for perf inject --jit to turn
+//                        into an ELF object of its own (record with perf record -k mono, since its timestamps are
+//                        CLOCK_MONOTONIC)
+// The files are left behind for perf to read once the program has exited.
+// A program can also be run only as far as where it stops itself, for the memory it has by then to be read from it.
+
+namespace pa::jit {
+        inline constexpr uint64_t StackSize = 8 << 20;
+        
+        struct Options {
+                std::string name;          // argv[0] of the program
+                std::string source_path{}; // Names the source file in the line tables
+                bool perf_map{false};
+                bool jitdump{false};
+        };
+        
+        // The exit status of the program, 128 plus the signal if one killed it, or -1 if it couldn't be started
+        int run(const x86::Image& image, const Options& options);
+        
+        // A program run until it stops itself with SIGSTOP, what it writes to stdout being kept rather than passed on. Its
+        // memory can be read for as long as this lives, the program being killed once it is destroyed. Only the name of
+        // the Options is used.
+        class StoppedProgram {
+        public: // Constructors/Destructors/Overloads
+                StoppedProgram(const x86::Image& image, const Options& options);
+                ~StoppedProgram();
+                StoppedProgram(const StoppedProgram&) = delete;
+                StoppedProgram& operator=(const StoppedProgram&) = delete;
+        public: // Public Member Functions
+                // Whether it stopped, rather than exiting or failing to start, in which case status() is as run() returns it
+                [[nodiscard]] bool stopped() const { return m_stopped; }
+                [[nodiscard]] int status() const { return m_status; }
+                // Where the .bss of the Image was placed
+                [[nodiscard]] uint64_t bss() const { return m_bss; }
+                // Copies size bytes at address in the program into bytes, returning whether they could all be read
+                bool read(uint64_t address, char* bytes, uint64_t size) const;
+                // Everything it wrote to stdout
+                [[nodiscard]] std::string output() const;
+        private: // Private Member Variables
+                void* m_mapping{nullptr};
+                uint64_t m_mapping_size{0};
+                uint64_t m_bss{0};
+                int m_pid{-1};
+                int m_output{-1}; // A memfd standing in for its stdout
+                bool m_stopped{false};
+                int m_status{-1};
+        };
+}
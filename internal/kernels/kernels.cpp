@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "kernels.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+        using pa::kernels::Comparison;
+        using pa::kernels::Operation;
+        
+        // An operand of a single element is read at the same index every time
+        template<typename T>
+        struct Operand {
+                const T* data;
+                size_t step;
+                
+                explicit Operand(std::span<const T> values) : data(values.data()), step(values.size() == 1 ? 0 : 1) {}
+                [[nodiscard]] T operator[](size_t i) const { return data[i * step]; }
+        };
+        
+        int64_t applyScalar(const Operation operation, const int64_t lhs, const int64_t rhs) {
+                // Computed unsigned, which wraps around rather than overflowing
+                auto l = static_cast<uint64_t>(lhs), r = static_cast<uint64_t>(rhs);
+                switch (operation) {
+                        case Operation::Add:
+                                return static_cast<int64_t>(l + r);
+                        case Operation::Subtract:
+                                return static_cast<int64_t>(l - r);
+                        case Operation::Multiply:
+                                return static_cast<int64_t>(l * r);
+                        case Operation::Divide:
+                                if (rhs == 0)
+                                        return 0;
+                                if (rhs == -1)
+                                        return static_cast<int64_t>(0 - l);
+                                return lhs / rhs;
+                        case Operation::And:
+                                return static_cast<int64_t>(l & r);
+                        case Operation::Or:
+                                return static_cast<int64_t>(l | r);
+                }
+                return 0;
+        }
+        
+        double applyScalar(const Operation operation, const double lhs, const double rhs) {
+                switch (operation) {
+                        case Operation::Add:
+                                return lhs + rhs;
+                        case Operation::Subtract:
+                                return lhs - rhs;
+                        case Operation::Multiply:
+                                return lhs * rhs;
+                        case Operation::Divide:
+                                return lhs / rhs;
+                        default: // Only ints are combined bitwise
+                                return 0;
+                }
+        }
+        
+        template<typename T>
+        int64_t compareScalar(const Comparison comparison, const T lhs, const T rhs) {
+                switch (comparison) {
+                        case Comparison::Less:
+                                return lhs < rhs;
+                        case Comparison::LessOrEqual:
+                                return lhs <= rhs;
+                        case Comparison::Greater:
+                                return lhs > rhs;
+                        case Comparison::GreaterOrEqual:
+                                return lhs >= rhs;
+                        case Comparison::Equal:
+                                return lhs == rhs;
+                        case Comparison::NotEqual:
+                                return lhs != rhs;
+                }
+                return 0;
+        }
+        
+        template<typename T>
+        void applyRange(const Operation operation, const Operand<T> lhs, const Operand<T> rhs, T* out, size_t begin, const size_t end) {
+                for (; begin < end; begin++)
+                        out[begin] = applyScalar(operation, lhs[begin], rhs[begin]);
+        }
+        
+        template<typename T>
+        void compareRange(const Comparison comparison, const Operand<T> lhs, const Operand<T> rhs, int64_t* out, size_t begin, const size_t end) {
+                for (; begin < end; begin++)
+                        out[begin] = compareScalar(comparison, lhs[begin], rhs[begin]);
+        }
+
+#if defined(__x86_64__)
+        bool hasAvx2() {
+                static const bool has_avx2 = __builtin_cpu_supports("avx2");
+                return has_avx2;
+        }
+        
+        __attribute__((target("avx2"))) __m256d load(const Operand<double> operand, const size_t i) {
+                return operand.step ? _mm256_loadu_pd(operand.data + i) : _mm256_set1_pd(*operand.data);
+        }
+        
+        __attribute__((target("avx2"))) __m256i load(const Operand<int64_t> operand, const size_t i) {
+                return operand.step ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(operand.data + i)) : _mm256_set1_epi64x(*operand.data);
+        }
+        
+        __attribute__((target("avx2"))) void applyAvx2(const Operation operation, const Operand<double> lhs, const Operand<double> rhs, double* out, size_t begin, const size_t end) {
+                for (; begin + 4 <= end; begin += 4) {
+                        __m256d l = load(lhs, begin), r = load(rhs, begin), result;
+                        switch (operation) {
+                                case Operation::Add:
+                                        result = _mm256_add_pd(l, r);
+                                        break;
+                                case Operation::Subtract:
+                                        result = _mm256_sub_pd(l, r);
+                                        break;
+                                case Operation::Multiply:
+                                        result = _mm256_mul_pd(l, r);
+                                        break;
+                                default:
+                                        result = _mm256_div_pd(l, r);
+                                        break;
+                        }
+                        _mm256_storeu_pd(out + begin, result);
+                }
+                applyRange(operation, lhs, rhs, out, begin, end);
+        }
+        
+        // AVX2 has no 64-bit multiply or divide, so only sums, differences and bitwise operations are done four at a time
+        __attribute__((target("avx2"))) void applyAvx2(const Operation operation, const Operand<int64_t> lhs, const Operand<int64_t> rhs, int64_t* out, size_t begin, const size_t end) {
+                if (operation != Operation::Multiply && operation != Operation::Divide) {
+                        for (; begin + 4 <= end; begin += 4) {
+                                __m256i l = load(lhs, begin), r = load(rhs, begin), result;
+                                switch (operation) {
+                                        case Operation::Add:
+                                                result = _mm256_add_epi64(l, r);
+                                                break;
+                                        case Operation::Subtract:
+                                                result = _mm256_sub_epi64(l, r);
+                                                break;
+                                        case Operation::And:
+                                                result = _mm256_and_si256(l, r);
+                                                break;
+                                        default:
+                                                result = _mm256_or_si256(l, r);
+                                                break;
+                                }
+                                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + begin), result);
+                        }
+                }
+                applyRange(operation, lhs, rhs, out, begin, end);
+        }
+        
+        // The predicate of a float comparison has to be an immediate, so each gets a loop of its own. Ordered predicates are
+        // false for NaN, and NotEqual's unordered one true.
+        template<int Predicate>
+        __attribute__((target("avx2"))) void compareAvx2(const Operand<double> lhs, const Operand<double> rhs, int64_t* out, size_t begin, const size_t end) {
+                __m256i one = _mm256_set1_epi64x(1);
+                for (; begin + 4 <= end; begin += 4) {
+                        __m256i mask = _mm256_castpd_si256(_mm256_cmp_pd(load(lhs, begin), load(rhs, begin), Predicate));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + begin), _mm256_and_si256(mask, one));
+                }
+        }
+        
+        __attribute__((target("avx2"))) void compareAvx2(const Comparison comparison, const Operand<double> lhs, const Operand<double> rhs, int64_t* out, const size_t begin, const size_t end) {
+                switch (comparison) {
+                        case Comparison::Less:
+                                compareAvx2<_CMP_LT_OQ>(lhs, rhs, out, begin, end);
+                                break;
+                        case Comparison::LessOrEqual:
+                                compareAvx2<_CMP_LE_OQ>(lhs, rhs, out, begin, end);
+                                break;
+                        case Comparison::Greater:
+                                compareAvx2<_CMP_GT_OQ>(lhs, rhs, out, begin, end);
+                                break;
+                        case Comparison::GreaterOrEqual:
+                                compareAvx2<_CMP_GE_OQ>(lhs, rhs, out, begin, end);
+                                break;
+                        case Comparison::Equal:
+                                compareAvx2<_CMP_EQ_OQ>(lhs, rhs, out, begin, end);
+                                break;
+                        case Comparison::NotEqual:
+                                compareAvx2<_CMP_NEQ_UQ>(lhs, rhs, out, begin, end);
+                                break;
+                }
+                size_t vectorised = begin + (end - begin) / 4 * 4;
+                compareRange(comparison, lhs, rhs, out, vectorised, end);
+        }
+        
+        // Every comparison of ints comes from a greater than or an equality, swapped or inverted
+        __attribute__((target("avx2"))) void compareAvx2(const Comparison comparison, const Operand<int64_t> lhs, const Operand<int64_t> rhs, int64_t* out, size_t begin, const size_t end) {
+                __m256i one = _mm256_set1_epi64x(1);
+                for (; begin + 4 <= end; begin += 4) {
+                        __m256i l = load(lhs, begin), r = load(rhs, begin), mask;
+                        bool inverted = false;
+                        switch (comparison) {
+                                case Comparison::Less:
+                                        mask = _mm256_cmpgt_epi64(r, l);
+                                        break;
+                                case Comparison::LessOrEqual:
+                                        mask = _mm256_cmpgt_epi64(l, r);
+                                        inverted = true;
+                                        break;
+                                case Comparison::Greater:
+                                        mask = _mm256_cmpgt_epi64(l, r);
+                                        break;
+                                case Comparison::GreaterOrEqual:
+                                        mask = _mm256_cmpgt_epi64(r, l);
+                                        inverted = true;
+                                        break;
+                                case Comparison::Equal:
+                                        mask = _mm256_cmpeq_epi64(l, r);
+                                        break;
+                                default:
+                                        mask = _mm256_cmpeq_epi64(l, r);
+                                        inverted = true;
+                                        break;
+                        }
+                        __m256i result = inverted ? _mm256_andnot_si256(mask, one) : _mm256_and_si256(mask, one);
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + begin), result);
+                }
+                compareRange(comparison, lhs, rhs, out, begin, end);
+        }
+#endif
+        
+        // Calls kernel(begin, end) over [0, count), on a slice per core once count reaches the threshold
+        template<typename Kernel>
+        void forEachSlice(const size_t count, const Kernel& kernel) {
+                size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+                if (count < pa::kernels::ParallelThreshold || thread_count == 1) {
+                        kernel(0, count);
+                        return;
+                }
+                
+                thread_count = std::min(thread_count, count / (pa::kernels::ParallelThreshold / 4));
+                // Slices are kept a multiple of the vector width, so only the last one has a scalar tail
+                size_t slice_size = (count / thread_count + 3) & ~size_t(3);
+                
+                std::vector<std::jthread> threads;
+                threads.reserve(thread_count - 1);
+                for (size_t begin = slice_size; begin < count; begin += slice_size)
+                        threads.emplace_back(kernel, begin, std::min(begin + slice_size, count));
+                kernel(0, std::min(slice_size, count));
+        }
+        
+        template<typename T>
+        void compareAll(const Comparison comparison, const std::span<const T> lhs, const std::span<const T> rhs, const std::span<int64_t> out) {
+                Operand<T> l(lhs), r(rhs);
+                forEachSlice(out.size(), [&](size_t begin, size_t end) {
+#if defined(__x86_64__)
+                        if (hasAvx2()) {
+                                compareAvx2(comparison, l, r, out.data(), begin, end);
+                                return;
+                        }
+#endif
+                        compareRange(comparison, l, r, out.data(), begin, end);
+                });
+        }
+        
+        template<typename T>
+        void applyAll(const Operation operation, const std::span<const T> lhs, const std::span<const T> rhs, const std::span<T> out) {
+                Operand<T> l(lhs), r(rhs);
+                forEachSlice(out.size(), [&](size_t begin, size_t end) {
+#if defined(__x86_64__)
+                        if (hasAvx2()) {
+                                applyAvx2(operation, l, r, out.data(), begin, end);
+                                return;
+                        }
+#endif
+                        applyRange(operation, l, r, out.data(), begin, end);
+                });
+        }
+}
+
+
+void pa::kernels::apply(const Operation operation, const std::span<const int64_t> lhs, const std::span<const int64_t> rhs, const std::span<int64_t> out) {
+        applyAll(operation, lhs, rhs, out);
+}
+
+void pa::kernels::apply(const Operation operation, const std::span<const double> lhs, const std::span<const double> rhs, const std::span<double> out) {
+        applyAll(operation, lhs, rhs, out);
+}
+
+
+void pa::kernels::compare(const Comparison comparison, const std::span<const int64_t> lhs, const std::span<const int64_t> rhs, const std::span<int64_t> out) {
+        compareAll(comparison, lhs, rhs, out);
+}
+
+void pa::kernels::compare(const Comparison comparison, const std::span<const double> lhs, const std::span<const double> rhs, const std::span<int64_t> out) {
+        compareAll(comparison, lhs, rhs, out);
+}
+
+
+// Left to the compiler to vectorise, like the conversions below
+void pa::kernels::truth(const std::span<const int64_t> values, const std::span<int64_t> out, const bool negated) {
+        Operand<int64_t> operand(values);
+        forEachSlice(out.size(), [&](size_t begin, size_t end) {
+                for (; begin < end; begin++)
+                        out[begin] = (operand[begin] != 0) != negated;
+        });
+}
+
+void pa::kernels::truth(const std::span<const double> values, const std::span<int64_t> out, const bool negated) {
+        Operand<double> operand(values);
+        forEachSlice(out.size(), [&](size_t begin, size_t end) {
+                for (; begin < end; begin++)
+                        out[begin] = (operand[begin] != 0.0) != negated;
+        });
+}
+
+
+void pa::kernels::convert(const std::span<const char> bools, const std::span<int64_t> out) {
+        forEachSlice(out.size(), [&](size_t begin, size_t end) {
+                for (; begin < end; begin++)
+                        out[begin] = bools[begin] != 0;
+        });
+}
+
+void pa::kernels::convert(const std::span<const int64_t> ints, const std::span<double> out) {
+        // Simple enough for the compiler to vectorise on its own
+        forEachSlice(out.size(), [&](size_t begin, size_t end) {
+                for (; begin < end; begin++)
+                        out[begin] = static_cast<double>(ints[begin]);
+        });
+}
+
+void pa::kernels::convert(const std::span<const double> floats, const std::span<int64_t> out) {
+        forEachSlice(out.size(), [&](size_t begin, size_t end) {
+                for (; begin < end; begin++) {
+#if defined(__x86_64__)
+                        out[begin] = _mm_cvttsd_si64(_mm_set_sd(floats[begin]));
+#else
+                        double value = floats[begin];
+                        out[begin] = value >= -0x1p63 && value < 0x1p63 ? static_cast<int64_t>(value) : INT64_MIN;
+#endif
+                }
+        });
+}
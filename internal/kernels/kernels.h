@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+// Element-wise kernels for whole-array arithmetic such as c = a + b * 2, where the Parser has already checked that the
+// operands share a shape (or that one of them is a scalar) and settled the result type: Int for Int and Bool operands,
+// Float as soon as one operand is a Float. Bool and Int operands are widened with convert before an operation on them.
+// On x86-64 hosts with AVX2 the loops run four lanes at a time, picked once at runtime, with a scalar loop for the tail
+// and for everything else. Arrays of at least ParallelThreshold elements are split into one contiguous slice per core.
+// Comparisons, truth tests and conversions follow what the native backend computes for a single value, bools coming out
+// as 0 or 1 in an int64_t each.
+
+namespace pa::kernels {
+        enum class Operation {
+                Add,
+                Subtract,
+                Multiply,
+                Divide,
+                And, // Bitwise, for ints that are all 0 or 1
+                Or,
+        };
+        
+        enum class Comparison {
+                Less,
+                LessOrEqual,
+                Greater,
+                GreaterOrEqual,
+                Equal,
+                NotEqual,
+        };
+        
+        // Below this many elements starting threads costs more than it saves
+        inline constexpr size_t ParallelThreshold = 1 << 18;
+        
+        // out[i] = lhs[i] op rhs[i], where an operand of a single element is used for every i.
+        // Ints wrap around on overflow and dividing by zero gives zero, so no input stops the program.
+        void apply(Operation operation, std::span<const int64_t> lhs, std::span<const int64_t> rhs, std::span<int64_t> out);
+        void apply(Operation operation, std::span<const double> lhs, std::span<const double> rhs, std::span<double> out);
+        
+        // out[i] = lhs[i] compared to rhs[i], broadcasting as apply does. Every comparison with a NaN is false but NotEqual.
+        void compare(Comparison comparison, std::span<const int64_t> lhs, std::span<const int64_t> rhs, std::span<int64_t> out);
+        void compare(Comparison comparison, std::span<const double> lhs, std::span<const double> rhs, std::span<int64_t> out);
+        
+        // out[i] = whether values[i] is nonzero, or with negated whether it is zero. Zero of either sign is zero.
+        void truth(std::span<const int64_t> values, std::span<int64_t> out, bool negated = false);
+        void truth(std::span<const double> values, std::span<int64_t> out, bool negated = false);
+        
+        // Widens an operand to the result type, bools being stored a byte each
+        void convert(std::span<const char> bools, std::span<int64_t> out);
+        void convert(std::span<const int64_t> ints, std::span<double> out);
+        // Truncates toward zero, NaNs and floats out of range giving INT64_MIN
+        void convert(std::span<const double> floats, std::span<int64_t> out);
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace pa {
+        // Correctly rounded conversion of a FloatLiteral (-?Digit*.Digit*) to a double, for constant evaluation where
+        // std::from_chars isn't usable. Gives exactly what std::from_chars does, including nothing for values that overflow
+        // or underflow to zero, so a constant comes out the same whether it is decoded at run time or at compile time.
+        // The value is digits / 10^fraction_digits as big integers, divided out one bit at a time, which is slow but exact.
+        class Decimal {
+        public: // Static Data
+                static constexpr int32_t MantissaBits = 53;
+                static constexpr int32_t MinimumExponent = -1022;
+                static constexpr int32_t MaximumExponent = 1023;
+        public: // Public Member Functions
+                static constexpr std::optional<double> toDouble(std::string_view text);
+        private: // Private Member Types
+                using BigUnsigned = std::vector<uint32_t>; // Little endian limbs, without leading zero limbs
+        private: // Private Member Functions
+                static constexpr void multiplyAdd(BigUnsigned& value, uint32_t multiplier, uint32_t addend);
+                static constexpr void shiftLeft(BigUnsigned& value, size_t bits);
+                static constexpr void subtract(BigUnsigned& value, const BigUnsigned& subtrahend);
+                static constexpr int32_t compare(const BigUnsigned& l, const BigUnsigned& r);
+                static constexpr size_t bitLength(const BigUnsigned& value);
+        };
+}
+
+constexpr std::optional<double> pa::Decimal::toDouble(std::string_view text) {
+        bool negative = text.starts_with('-');
+        if (negative)
+                text.remove_prefix(1);
+        
+        BigUnsigned numerator;
+        BigUnsigned denominator = {1};
+        bool fraction = false;
+        size_t fraction_digits = 0;
+        for (char c: text) {
+                if (c == '.') {
+                        fraction = true;
+                        continue;
+                }
+                multiplyAdd(numerator, 10, c - '0');
+                if (fraction) {
+                        multiplyAdd(denominator, 10, 0);
+                        fraction_digits++;
+                }
+        }
+        
+        uint64_t sign = negative ? uint64_t(1) << 63 : 0;
+        if (numerator.empty())
+                return std::bit_cast<double>(sign);
+        
+        // Both sides are exact doubles, so a single correctly rounded division gives the answer
+        constexpr double Powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        if (bitLength(numerator) <= MantissaBits && fraction_digits < std::size(Powers)) {
+                uint64_t mantissa = numerator[0] | (numerator.size() > 1 ? uint64_t(numerator[1]) << 32 : 0);
+                double value = static_cast<double>(mantissa) / Powers[fraction_digits];
+                return negative ? -value : value;
+        }
+        
+        // Scale so that 1 <= numerator / denominator < 2, making exponent the binary exponent of the value
+        int32_t exponent = static_cast<int32_t>(bitLength(numerator)) - static_cast<int32_t>(bitLength(denominator));
+        if (exponent >= 0)
+                shiftLeft(denominator, exponent);
+        else
+                shiftLeft(numerator, -exponent);
+        if (compare(numerator, denominator) < 0) {
+                shiftLeft(numerator, 1);
+                exponent--;
+        }
+        
+        // One more bit than the mantissa holds to round with, and whether anything at all is left beyond it
+        uint64_t quotient = 0;
+        for (int32_t bit = 0; bit <= MantissaBits; bit++) {
+                quotient <<= 1;
+                if (compare(numerator, denominator) >= 0) {
+                        subtract(numerator, denominator);
+                        quotient |= 1;
+                }
+                shiftLeft(numerator, 1);
+        }
+        bool sticky = !numerator.empty();
+        
+        // Subnormals keep fewer bits the further below the normal range they are
+        int32_t precision = exponent >= MinimumExponent ? MantissaBits : exponent - MinimumExponent + MantissaBits;
+        int32_t dropped = MantissaBits + 1 - precision;
+        if (exponent > MaximumExponent || dropped > MantissaBits + 1)
+                return std::nullopt;
+        
+        uint64_t mantissa = quotient >> dropped;
+        uint64_t remainder = quotient & ((uint64_t(1) << dropped) - 1);
+        uint64_t half = uint64_t(1) << (dropped - 1);
+        if (remainder > half || (remainder == half && (sticky || (mantissa & 1))))
+                mantissa++;
+        
+        uint64_t bits;
+        if (precision == MantissaBits) {
+                if (mantissa == uint64_t(1) << MantissaBits) {
+                        mantissa >>= 1;
+                        exponent++;
+                }
+                if (exponent > MaximumExponent)
+                        return std::nullopt;
+                bits = (uint64_t(exponent - MinimumExponent + 1) << (MantissaBits - 1)) | (mantissa & ((uint64_t(1) << (MantissaBits - 1)) - 1));
+        } else {
+                // A subnormal mantissa is its own bit pattern, and rounding up out of the subnormals lands on the smallest normal
+                bits = mantissa;
+                if (bits == 0)
+                        return std::nullopt;
+        }
+        
+        return std::bit_cast<double>(sign | bits);
+}
+
+
+constexpr void pa::Decimal::multiplyAdd(pa::Decimal::BigUnsigned& value, const uint32_t multiplier, const uint32_t addend) {
+        uint64_t carry = addend;
+        for (auto& limb: value) {
+                uint64_t product = uint64_t(limb) * multiplier + carry;
+                limb = static_cast<uint32_t>(product);
+                carry = product >> 32;
+        }
+        if (carry != 0)
+                value.push_back(static_cast<uint32_t>(carry));
+}
+
+constexpr void pa::Decimal::shiftLeft(pa::Decimal::BigUnsigned& value, const size_t bits) {
+        if (value.empty())
+                return;
+        
+        value.insert(value.begin(), bits / 32, 0);
+        if (bits % 32 == 0)
+                return;
+        
+        uint32_t carry = 0;
+        for (size_t i = bits / 32; i < value.size(); i++) {
+                uint32_t limb = value[i];
+                value[i] = (limb << (bits % 32)) | carry;
+                carry = limb >> (32 - bits % 32);
+        }
+        if (carry != 0)
+                value.push_back(carry);
+}
+
+// Requires value >= subtrahend
+constexpr void pa::Decimal::subtract(pa::Decimal::BigUnsigned& value, const pa::Decimal::BigUnsigned& subtrahend) {
+        int64_t borrow = 0;
+        for (size_t i = 0; i < value.size(); i++) {
+                int64_t difference = int64_t(value[i]) - (i < subtrahend.size() ? subtrahend[i] : 0) - borrow;
+                borrow = difference < 0;
+                value[i] = static_cast<uint32_t>(difference + (borrow << 32));
+        }
+        while (!value.empty() && value.back() == 0)
+                value.pop_back();
+}
+
+constexpr int32_t pa::Decimal::compare(const pa::Decimal::BigUnsigned& l, const pa::Decimal::BigUnsigned& r) {
+        if (l.size() != r.size())
+                return l.size() < r.size() ? -1 : 1;
+        for (size_t i = l.size(); i-- > 0;)
+                if (l[i] != r[i])
+                        return l[i] < r[i] ? -1 : 1;
+        return 0;
+}
+
+constexpr size_t pa::Decimal::bitLength(const pa::Decimal::BigUnsigned& value) {
+        return value.empty() ? 0 : (value.size() - 1) * 32 + std::bit_width(value.back());
+}
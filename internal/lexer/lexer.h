@@ -1,9 +1,21 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <limits>
+#include <optional>
 #include <string_view>
 #include <ostream>
 #include <format>
 #include <sstream>
+#include <span>
+#include <vector>
 #include "token.h"
+#include "constant_pool.h"
+#include "decimal.h"
+#include "hash.h"
+#include "error.h"
 
 // Tokens
 // LineComment    -> // .*\n
@@ -34,82 +46,583 @@
 
 // Print          -> print
 // Read           -> read
+// Load           -> load
+
+// Tokens are told apart by their first character through CharacterClasses, a 256 entry table built at compile time
+// from the definitions below, so the start of each token is a single indexed load and jump rather than a chain of
+// comparisons. Operators and punctuation are all lexed by one transition through OperatorTransitions, which says for a
+// first character the token it makes alone, the second character that extends it and the token the two make together.
+// fuzz/fuzz_lexer.cpp checks the tables against a reference lexer that dispatches on each character through a switch,
+// as this one did before them.
+
+// Everything but error() is constexpr, so a source can be lexed during constant evaluation. Reaching an error there
+// calls the non-constexpr error(), which turns the error into a compile time failure at the call that raised it.
 
 namespace pa {
+        class TokenStream;
+        
+        namespace detail {
+                constexpr unsigned int hash(std::string_view str) {
+                        unsigned int hash = 5381;
+                        for (char c: str)
+                                hash = ((hash << 5) + hash) + static_cast<unsigned int>(c);
+                        return hash;
+                }
+                
+                constexpr unsigned int operator "" _(char const* chr, size_t) noexcept { return hash(chr); }
+                
+                // What a token starting with a character is
+                enum class CharacterClass : uint8_t {
+                        Invalid,
+                        Space,
+                        Number,     // A digit, - or ., since - always starts a negative literal
+                        Word,       // A letter or _
+                        Quote,
+                        Apostrophe,
+                        OpenBracket,
+                        Slash,      // A ForwardSlash or the start of a line comment
+                        Operator,   // Anything in Operators
+                };
+                
+                // An operator or punctuation token of one character, or two when second follows first
+                struct Operator {
+                        char first;
+                        char second;      // '\0' if it never takes two characters
+                        TokenType single; // INVALID if it has to
+                        TokenType doubled;
+                };
+                
+                inline constexpr Operator Operators[] = {
+                        {'(', '\0', TokenType::OpenParen, TokenType::INVALID},
+                        {')', '\0', TokenType::CloseParen, TokenType::INVALID},
+                        {'{', '\0', TokenType::OpenCurly, TokenType::INVALID},
+                        {'}', '\0', TokenType::CloseCurly, TokenType::INVALID},
+                        {',', '\0', TokenType::Comma, TokenType::INVALID},
+                        {';', '\0', TokenType::SemiColon, TokenType::INVALID},
+                        {'+', '\0', TokenType::Plus, TokenType::INVALID},
+                        {'*', '\0', TokenType::Asterisk, TokenType::INVALID},
+                        {'<', '=', TokenType::LessThan, TokenType::LessThanOrEquals},
+                        {'>', '=', TokenType::GreaterThan, TokenType::GreaterThanOrEquals},
+                        {'=', '=', TokenType::Equals, TokenType::EqualsEquals},
+                        {'!', '=', TokenType::Not, TokenType::NotEquals},
+                        {'&', '&', TokenType::INVALID, TokenType::And},
+                        {'|', '|', TokenType::INVALID, TokenType::Or},
+                };
+                
+                inline constexpr std::array<CharacterClass, 256> CharacterClasses = [] {
+                        std::array<CharacterClass, 256> classes{};
+                        for (unsigned c: {' ', '\t', '\n', '\v', '\f', '\r'})
+                                classes[c] = CharacterClass::Space;
+                        for (unsigned c = '0'; c <= '9'; c++)
+                                classes[c] = CharacterClass::Number;
+                        classes['-'] = classes['.'] = CharacterClass::Number;
+                        for (unsigned c = 'a'; c <= 'z'; c++)
+                                classes[c] = classes[c - 'a' + 'A'] = CharacterClass::Word;
+                        classes['_'] = CharacterClass::Word;
+                        classes['"'] = CharacterClass::Quote;
+                        classes['\''] = CharacterClass::Apostrophe;
+                        classes['['] = CharacterClass::OpenBracket;
+                        classes['/'] = CharacterClass::Slash;
+                        for (const Operator& op: Operators)
+                                classes[static_cast<unsigned char>(op.first)] = CharacterClass::Operator;
+                        return classes;
+                }();
+                
+                // Characters that go on an identifier or keyword once it has started
+                inline constexpr std::array<bool, 256> WordCharacters = [] {
+                        std::array<bool, 256> word{};
+                        for (size_t c = 0; c < word.size(); c++)
+                                word[c] = CharacterClasses[c] == CharacterClass::Word || (c >= '0' && c <= '9');
+                        return word;
+                }();
+                
+                inline constexpr std::array<Operator, 256> OperatorTransitions = [] {
+                        std::array<Operator, 256> transitions{};
+                        for (const Operator& op: Operators)
+                                transitions[static_cast<unsigned char>(op.first)] = op;
+                        return transitions;
+                }();
+        }
+        
         class Lexer {
         public: // Static Data
         public: // Constructors/Destructors/Overloads
-                Lexer(std::string_view src);
+                // Literals are decoded into constants, which has to outlive the Lexer
+                constexpr Lexer(std::string_view src, ConstantPool& constants, ErrorMode error_mode = ErrorMode::Exit);
+                constexpr Lexer(std::string_view src, size_t start_index, ConstantPool& constants, ErrorMode error_mode = ErrorMode::Exit);
+                // Replays an already lexed token buffer and the pool its literals were decoded into, raising truncation_error
+                // (if any, which has to outlive the Lexer) when asked for a token past its end. Each INVALID token in the
+                // buffer raises the next of lex_errors when it is reached, as left there by tokenizeRecovering.
+                constexpr Lexer(std::string_view src, std::span<const Token> tokens, ConstantPool& constants, ErrorMode error_mode = ErrorMode::Exit, const CompileError* truncation_error = nullptr,
+                                std::span<const CompileError> lex_errors = {});
+                // Consumes the tokens a TokenStream lexes on another thread, raising the error it stopped at (if any) when
+                // asked for a token past the last one it lexed
+                Lexer(std::string_view src, TokenStream& stream, ErrorMode error_mode = ErrorMode::Exit);
         public: // Public Member Functions
-                Token peek();
-                Token peek_prev();
-                Token eat();
-                
-                // Prints all values passed into the fold expression with a delimeter | in between
-                template<pa::TokenType... ExpectedTypes>
-                static constexpr std::string toString() {
-                        std::ostringstream oss;
-                        bool first = true;
-                        ((oss << (first ? "" : " | ") << pa::Token::typeToString(ExpectedTypes), first = false), ...);
-                        return oss.str();
-                }
+                constexpr Token peek();
+                constexpr Token peek_prev();
+                constexpr Token eat();
+                // Whether the token after the current one is a Comma or CloseCurly, judged from the source so nothing is lexed ahead
+                [[nodiscard]] constexpr bool nextIsListSeparator() const;
+                // Eats an Array token, returning its extent
+                constexpr int64_t eatArrayExtent(std::string_view rule_name);
                 
-                // Check if the passed type matches any of the ExpectedTypes using fold expression
-                template<pa::TokenType... ExpectedTypes>
-                constexpr inline void expect(std::string_view rule_name) {
-                        if (!((m_current_lexed.type == ExpectedTypes) || ...)) {
-                                error(std::format("Parsing Error({}, {}): Expected token types ( {} ), got {}({}) instead.",
-                                                  m_current_lexed.start,
-                                                  rule_name,
-                                                  toString<ExpectedTypes...>(),
-                                                  pa::Token::typeToString(m_current_lexed.type),
-                                                  m_current_lexed.toString(m_source)
-                                      )
-                                );
-                        }
+                [[nodiscard]] constexpr ConstantPool& constants() const { return *m_constants; }
+                
+                // Lexes everything that is left, up to and including the Eof token
+                constexpr std::vector<Token> tokenize();
+                // Same as above, but appends to out so the tokens lexed before an error are kept
+                constexpr void tokenize(std::vector<Token>& out);
+                
+                // Lexes all of src into out, going on past lexing errors rather than stopping at the first. Each error is
+                // appended to errors and leaves an INVALID token in its place standing for the rest of its statement, lexing
+                // going on after the next semicolon. The max_errors'th error stops lexing instead and ends up in
+                // truncation_error, so out then holds no Eof token.
+                static constexpr void tokenizeRecovering(std::string_view src, ConstantPool& constants, std::vector<Token>& out, std::vector<CompileError>& errors,
+                                                         std::optional<CompileError>& truncation_error, size_t max_errors);
+                // Whether the error just raised while replaying came from lexing (an INVALID token or the truncation error)
+                // rather than from what was expected of a token
+                [[nodiscard]] constexpr bool atLexError() const { return m_at_lex_error; }
+                [[nodiscard]] constexpr bool truncated() const { return m_truncated; }
+                // Goes on past the INVALID token whose error was just raised, to the statement after it
+                constexpr void skipLexError();
+                
+                // Lexes every token that starts before end into out, returns the index just past the last one lexed (only meaningful if any were)
+                constexpr size_t lexRange(size_t end, std::vector<Token>& out);
+                
+                // Raises an error unless the current token is one of expected
+                constexpr void expect(const TokenSet expected, const std::string_view rule_name) {
+                        if (!expected.contains(m_current_lexed.type))
+                                unexpected(expected, rule_name);
                 }
                 
-                template<pa::TokenType... ExpectedTypes>
-                pa::Token peek(std::string_view rule_name) {
-                        expect<ExpectedTypes...>(rule_name);
+                constexpr pa::Token peek(const TokenSet expected, const std::string_view rule_name) {
+                        expect(expected, rule_name);
                         return peek();
                 }
                 
-                template<pa::TokenType... ExpectedTypes>
-                pa::Token eat(std::string_view rule_name) {
-                        expect<ExpectedTypes...>(rule_name);
+                constexpr pa::Token eat(const TokenSet expected, const std::string_view rule_name) {
+                        expect(expected, rule_name);
                         return eat();
                 }
                 
-                template<pa::TokenType... ExpectedTypes>
-                bool is() {
-                        return ((m_current_lexed.type == ExpectedTypes) || ...);
-                }
-                
-                template<pa::TokenType... ExpectedTypes>
-                void eatIfTokenIs(std::string_view rule_name) {
-                        is<ExpectedTypes...>();
-                        eat<ExpectedTypes...>(rule_name);
+                [[nodiscard]] constexpr bool is(const TokenSet types) const {
+                        return types.contains(m_current_lexed.type);
                 }
                 
         public: // Public Member Variables
         private: // Private Member Functions
-                void getNextToken();
-                void validateAndIncrementIndex(std::string_view message);
-                void incrementIndex();
-                
-                char currentCharacter();
-                Token lexNum();
-                Token lexChar();
-                Token lexString();
-                Token lexWord();
-                Token lexArrayExt();
-                
-                static void error(std::string_view message);
+                static constexpr detail::CharacterClass classOf(const char c) { return detail::CharacterClasses[static_cast<unsigned char>(c)]; }
+                // Classified by hand since <cctype> isn't constexpr (and is undefined for negative chars, which every byte past ASCII is)
+                static constexpr bool isSpace(const char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+                static constexpr bool isDigit(const char c) { return c >= '0' && c <= '9'; }
+                
+                constexpr void getNextToken();
+                constexpr void lexOperator();
+                constexpr void replayNextToken();
+                void streamNextToken();
+                constexpr void validateAndIncrementIndex(std::string_view delimiter, size_t open_index);
+                constexpr void incrementIndex();
+                
+                constexpr char currentCharacter();
+                [[nodiscard]] constexpr size_t skipDigits(size_t index) const;
+                constexpr Token lexNum();
+                constexpr Token lexChar();
+                constexpr Token lexString();
+                constexpr Token lexWord();
+                constexpr Token lexArrayExt();
+                
+                constexpr uint32_t decodeInt(std::string_view text);
+                constexpr uint32_t decodeFloat(std::string_view text);
+                
+                // position is the offset into the source the error is at, if it has one
+                [[noreturn]] void error(std::string_view message, size_t position = NoPosition) const;
+                // The error for a current token that isn't one of expected, only formatted once there is one
+                [[noreturn]] void unexpected(TokenSet expected, std::string_view rule_name) const;
         private: // Private Member Variables
                 std::string_view m_source;
                 Token m_current_lexed;
                 Token m_prev_lexed;
                 size_t m_current_index{0};
+                ErrorMode m_error_mode{ErrorMode::Exit};
+                ConstantPool* m_constants;
+                
+                bool m_replaying{false};
+                std::span<const Token> m_tokens;
+                size_t m_token_index{0};
+                const CompileError* m_truncation_error{nullptr};
+                std::span<const CompileError> m_lex_errors;
+                size_t m_lex_error_index{0};
+                bool m_at_lex_error{false};
+                bool m_truncated{false};
+                
+                TokenStream* m_stream{nullptr};
+                int64_t m_current_extent{0}; // Only kept up to date while streaming
         };
-}
\ No newline at end of file
+}
+
+constexpr pa::Lexer::Lexer(const std::string_view src, pa::ConstantPool& constants, const pa::ErrorMode error_mode)
+        : m_source(src), m_error_mode(error_mode), m_constants(&constants) {
+        getNextToken();
+}
+constexpr pa::Lexer::Lexer(const std::string_view src, const size_t start_index, pa::ConstantPool& constants, const pa::ErrorMode error_mode)
+        : m_source(src), m_current_index(start_index), m_error_mode(error_mode), m_constants(&constants) {
+        getNextToken();
+}
+constexpr pa::Lexer::Lexer(const std::string_view src, const std::span<const pa::Token> tokens, pa::ConstantPool& constants, const pa::ErrorMode error_mode, const pa::CompileError* truncation_error,
+                           const std::span<const pa::CompileError> lex_errors)
+        : m_source(src), m_error_mode(error_mode), m_constants(&constants), m_replaying(true), m_tokens(tokens), m_truncation_error(truncation_error), m_lex_errors(lex_errors) {
+        getNextToken();
+}
+
+
+
+constexpr pa::Token pa::Lexer::peek() {
+        return m_current_lexed;
+}
+constexpr pa::Token pa::Lexer::eat() {
+        m_prev_lexed = m_current_lexed;
+        getNextToken();
+        return m_prev_lexed;
+}
+constexpr bool pa::Lexer::nextIsListSeparator() const {
+        // Every token ends on its last character, inclusive
+        size_t index = m_current_lexed.end + 1;
+        while (index < m_source.size() && isSpace(m_source[index]))
+                index++;
+        return index < m_source.size() && (m_source[index] == ',' || m_source[index] == '}');
+}
+constexpr int64_t pa::Lexer::eatArrayExtent(const std::string_view rule_name) {
+        expect(TokenType::Array, rule_name);
+        // A streamed token's constant indexes a pool the lexer thread may still be adding to
+        int64_t extent = m_stream ? m_current_extent : m_constants->intValue(m_current_lexed.constant);
+        eat();
+        return extent;
+}
+constexpr pa::Token pa::Lexer::peek_prev() {
+        return m_prev_lexed;
+}
+
+constexpr std::vector<pa::Token> pa::Lexer::tokenize() {
+        std::vector<Token> tokens;
+        tokenize(tokens);
+        return tokens;
+}
+constexpr void pa::Lexer::tokenize(std::vector<pa::Token>& out) {
+        while (!is(TokenType::Eof)) {
+                out.push_back(m_current_lexed);
+                getNextToken();
+        }
+        out.push_back(m_current_lexed);
+}
+
+constexpr void pa::Lexer::tokenizeRecovering(const std::string_view src, pa::ConstantPool& constants, std::vector<pa::Token>& out, std::vector<pa::CompileError>& errors,
+                                             std::optional<pa::CompileError>& truncation_error, const size_t max_errors) {
+        size_t start_index = 0;
+        for (;;) {
+                size_t lexed = out.size();
+                try {
+                        Lexer(src, start_index, constants, ErrorMode::Throw).tokenize(out);
+                        return;
+                } catch (CompileError& lex_error) {
+                        if (errors.size() + 1 >= max_errors) {
+                                truncation_error = std::move(lex_error);
+                                return;
+                        }
+                        
+                        // An error without a position is placed just past the last token lexed before it
+                        size_t position = lex_error.position;
+                        if (position == NoPosition)
+                                position = out.size() > lexed ? out.back().end + 1 : start_index;
+                        position = std::max(position, start_index);
+                        out.emplace_back(TokenType::INVALID, position, position);
+                        errors.push_back(std::move(lex_error));
+                        
+                        size_t semicolon = src.find(';', position);
+                        start_index = semicolon == std::string_view::npos ? src.size() : semicolon + 1;
+                }
+        }
+}
+
+constexpr void pa::Lexer::skipLexError() {
+        m_at_lex_error = false;
+        getNextToken();
+}
+
+constexpr size_t pa::Lexer::lexRange(const size_t end, std::vector<pa::Token>& out) {
+        size_t resume_index = m_current_lexed.start;
+        while (!is(TokenType::Eof) && m_current_lexed.start < end) {
+                out.push_back(m_current_lexed);
+                resume_index = m_current_index;
+                getNextToken();
+        }
+        return resume_index;
+}
+
+constexpr void pa::Lexer::replayNextToken() {
+        if (m_token_index >= m_tokens.size() && m_truncation_error) {
+                m_at_lex_error = m_truncated = true;
+                error(m_truncation_error->message, m_truncation_error->position);
+        }
+        if (m_token_index < m_tokens.size() && m_tokens[m_token_index].type == TokenType::INVALID) {
+                // Stepped over first, so skipLexError goes on with the token after it
+                m_token_index++;
+                m_at_lex_error = true;
+                const CompileError& lex_error = m_lex_errors[m_lex_error_index++];
+                error(lex_error.message, lex_error.position);
+        }
+        
+        // Keep handing out the trailing Eof once the buffer runs out
+        m_current_lexed = m_token_index < m_tokens.size() ? m_tokens[m_token_index] : m_tokens.back();
+        m_token_index++;
+}
+
+constexpr void pa::Lexer::getNextToken() {
+        if (m_stream) {
+                streamNextToken();
+                return;
+        }
+        if (m_replaying) {
+                replayNextToken();
+                return;
+        }
+        
+        for (;;) {
+                while (m_current_index < m_source.size() && classOf(m_source[m_current_index]) == detail::CharacterClass::Space)
+                        m_current_index++;
+                
+                if (m_current_index >= m_source.size()) {
+                        m_current_lexed = {TokenType::Eof, m_current_index, m_current_index};
+                        return;
+                }
+                
+                switch (classOf(currentCharacter())) {
+                        case detail::CharacterClass::Number:
+                                m_current_lexed = lexNum();
+                                return;
+                        case detail::CharacterClass::Word:
+                                m_current_lexed = lexWord();
+                                return;
+                        case detail::CharacterClass::Quote:
+                                m_current_lexed = lexString();
+                                return;
+                        case detail::CharacterClass::Apostrophe:
+                                m_current_lexed = lexChar();
+                                return;
+                        case detail::CharacterClass::OpenBracket:
+                                m_current_lexed = lexArrayExt();
+                                return;
+                        case detail::CharacterClass::Operator:
+                                lexOperator();
+                                return;
+                        case detail::CharacterClass::Slash:
+                                if (m_current_index + 1 < m_source.size() && m_source[m_current_index + 1] == '/') {
+                                        // A line comment, running up to the end of the line
+                                        m_current_index = std::min(m_source.find_first_of("\n\r", m_current_index), m_source.size());
+                                        continue;
+                                }
+                                m_current_lexed = {TokenType::ForwardSlash, m_current_index, m_current_index};
+                                m_current_index++;
+                                return;
+                        default:
+                                error(std::format("Lexing Error({}): Unexpected Character {}.", m_current_index, currentCharacter()), m_current_index);
+                }
+        }
+}
+
+// Whether the operator takes its second character is a comparison and a select rather than a branch per operator. A
+// token of two characters ends one past its second, as it always has.
+constexpr void pa::Lexer::lexOperator() {
+        const detail::Operator& transition = detail::OperatorTransitions[static_cast<unsigned char>(currentCharacter())];
+        size_t start = m_current_index;
+        char next = start + 1 < m_source.size() ? m_source[start + 1] : '\0';
+        bool doubled = (transition.second != '\0') & (next == transition.second);
+        TokenType type = doubled ? transition.doubled : transition.single;
+        if (type == TokenType::INVALID)
+                error(std::format("Lexing Error({}): Bitwise operations are not supported, expected sequention {}, got {} instead.", start + 1, transition.second, next), start + 1);
+        
+        m_current_lexed = {type, start, start + 2 * doubled};
+        m_current_index = start + 1 + doubled;
+}
+
+constexpr pa::Token pa::Lexer::lexNum() {
+        TokenType float_or_int = TokenType::IntLiteral;
+        bool numbers_at_start = false;
+        
+        auto start = m_current_index;
+        
+        if (currentCharacter() == '-')
+                m_current_index++;
+        
+        if (isDigit(currentCharacter()))
+                numbers_at_start = true;
+        
+        m_current_index = skipDigits(m_current_index);
+        
+        if (currentCharacter() == '.') {
+                float_or_int = TokenType::FloatLiteral;
+                incrementIndex();
+        }
+        
+        if (!isDigit(currentCharacter()) && !numbers_at_start)
+                error(std::format("Lexing Error({}): Floating point numbers require atleast one digit on atleast one side of the decimal point.", m_current_index, currentCharacter()), m_current_index);
+        
+        m_current_index = skipDigits(m_current_index);
+        
+        std::string_view text(m_source.begin() + start, m_current_index - start);
+        return {float_or_int, start, m_current_index - 1, float_or_int == TokenType::IntLiteral ? decodeInt(text) : decodeFloat(text)};
+}
+
+// Accumulates the magnitude unsigned so the most negative value still fits until the sign is applied
+constexpr uint32_t pa::Lexer::decodeInt(const std::string_view text) {
+        bool negative = text.starts_with('-');
+        uint64_t limit = negative ? uint64_t(std::numeric_limits<int64_t>::max()) + 1 : std::numeric_limits<int64_t>::max();
+        
+        uint64_t magnitude = 0;
+        for (char c: text.substr(negative)) {
+                uint64_t digit = c - '0';
+                if (magnitude > (limit - digit) / 10)
+                        error(std::format("Lexing Error({}): Integer literal {} does not fit in 64 bits.", m_current_index, text), m_current_index);
+                magnitude = magnitude * 10 + digit;
+        }
+        return m_constants->addInt(static_cast<int64_t>(negative ? 0 - magnitude : magnitude));
+}
+
+constexpr uint32_t pa::Lexer::decodeFloat(const std::string_view text) {
+        std::optional<double> value;
+        if consteval {
+                value = Decimal::toDouble(text);
+        } else {
+                double parsed = 0;
+                if (std::from_chars(text.begin(), text.end(), parsed).ec != std::errc::result_out_of_range)
+                        value = parsed;
+        }
+        
+        if (!value)
+                error(std::format("Lexing Error({}): Float literal {} is out of range.", m_current_index, text), m_current_index);
+        return m_constants->addFloat(*value);
+}
+
+constexpr pa::Token pa::Lexer::lexChar() {
+        auto start = m_current_index;
+        validateAndIncrementIndex("quote", start); // Get past the starting quote
+        
+        bool escaped = currentCharacter() == '\\';
+        if (escaped)
+                validateAndIncrementIndex("quote", start); // Eat escape sequence
+        else if (currentCharacter() == '\'')
+                error(std::format("Lexing Error({}): Empty char.", start), start);
+        
+        char value = escaped ? ConstantPool::unescape(currentCharacter()) : currentCharacter();
+        validateAndIncrementIndex("quote", start); // Get past char
+        
+        if (currentCharacter() != '\'')// Validate closing quote
+                error(std::format("Lexing Error({}): Expected closing quote, found {} instead.", m_current_index, currentCharacter()), m_current_index);
+        incrementIndex(); // Get past the closing quote
+        
+        return {TokenType::CharLiteral, start, m_current_index - 1, m_constants->addChar(value)};
+}
+
+constexpr pa::Token pa::Lexer::lexString() {
+        auto start = m_current_index;
+        validateAndIncrementIndex("quote", start);
+        
+        while (currentCharacter() != '"') {
+                if (currentCharacter() == '\\')
+                        validateAndIncrementIndex("quote", start);
+                validateAndIncrementIndex("quote", start);
+        }
+        incrementIndex();
+        
+        // Decode everything between the quotes
+        uint32_t constant = m_constants->addEscapedString(std::string_view(m_source.begin() + start + 1, m_current_index - start - 2));
+        return {TokenType::StringLiteral, start, m_current_index - 1, constant};
+}
+
+constexpr pa::Token pa::Lexer::lexArrayExt() {
+        validateAndIncrementIndex("brace", m_current_index); // Get past the opening brace
+        
+        Token ret = lexNum(); // Get Size, storing this makes type validation a bit easier
+        
+        if (currentCharacter() != ']')
+                error(std::format("Lexing Error({}): Expected closing brace, found {} instead.", m_current_index, currentCharacter()), m_current_index);
+        incrementIndex(); // Get past the closing brace
+        
+        if (ret.type == TokenType::FloatLiteral)
+                error(std::format("Lexing Error({}): Expected Integer Literal, found Float Literal({}).", m_current_index, ret.toString(m_source)), m_current_index);
+        
+        ret.type = TokenType::Array;
+        return ret;
+}
+
+constexpr pa::Token pa::Lexer::lexWord() {
+        auto start = m_current_index;
+        while (m_current_index < m_source.size() && detail::WordCharacters[static_cast<unsigned char>(m_source[m_current_index])])
+                m_current_index++;
+        
+        using detail::operator""_;
+        switch (detail::hash(std::string_view(m_source.begin() + start, m_current_index - start))) {
+                case "True"_:
+                        return {TokenType::True, start, m_current_index - 1};
+                case "False"_:
+                        return {TokenType::False, start, m_current_index - 1};
+                
+                case "int"_:
+                        return {TokenType::Int, start, m_current_index - 1};
+                case "bool"_:
+                        return {TokenType::Bool, start, m_current_index - 1};
+                case "float"_:
+                        return {TokenType::Float, start, m_current_index - 1};
+                case "char"_:
+                        return {TokenType::Char, start, m_current_index - 1};
+                case "string"_:
+                        return {TokenType::String, start, m_current_index - 1};
+                
+                case "print"_:
+                        return {TokenType::Print, start, m_current_index - 1};
+                case "read"_:
+                        return {TokenType::Read, start, m_current_index - 1};
+                case "load"_:
+                        return {TokenType::Load, start, m_current_index - 1};
+                
+                default:
+                        return {TokenType::Identifier, start, m_current_index - 1};
+        }
+}
+
+// Past the end of the source reads as NUL rather than running off the end of the buffer
+constexpr char pa::Lexer::currentCharacter() {
+        return m_current_index < m_source.size() ? m_source[m_current_index] : '\0';
+}
+
+// Returns the index of the first non-digit at or after index, testing eight characters at a time: XORing with '0' maps
+// exactly the digits to 0-9, and adding 0x76 to the low seven bits of a byte carries into its top bit exactly when they
+// are 10 or more, without spilling into the next byte
+constexpr size_t pa::Lexer::skipDigits(size_t index) const {
+        for (; index + 8 <= m_source.size(); index += 8) {
+                uint64_t word = loadWord(m_source, index, 8);
+                if constexpr (std::endian::native == std::endian::big)
+                        word = std::byteswap(word);
+                
+                uint64_t offsets = word ^ 0x3030303030303030ull;
+                uint64_t non_digits = (((offsets & 0x7F7F7F7F7F7F7F7Full) + 0x7676767676767676ull) | offsets) & 0x8080808080808080ull;
+                if (non_digits != 0)
+                        return index + std::countr_zero(non_digits) / 8;
+        }
+        
+        while (index < m_source.size() && isDigit(m_source[index]))
+                index++;
+        return index;
+}
+
+constexpr void pa::Lexer::incrementIndex() {
+        m_current_index++;
+}
+
+// Errors out if the source ends before the delimiter opened at open_index is closed. The message is only formatted
+// then, since this runs for every character of a literal.
+constexpr void pa::Lexer::validateAndIncrementIndex(const std::string_view delimiter, const size_t open_index) {
+        incrementIndex();
+        if (m_current_index >= m_source.size())
+                error(std::format("Lexing Error({}): Could not locate closing {} for open {}.", open_index, delimiter, delimiter), open_index);
+}
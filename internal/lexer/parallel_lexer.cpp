@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstring>
+#include "parallel_lexer.h"
+
+pa::ParallelLexer::ParallelLexer(const std::string_view src, const size_t thread_count, const pa::ErrorMode error_mode)
+        : m_source(src), m_thread_count(std::max<size_t>(thread_count, 1)), m_error_mode(error_mode) {}
+
+
+std::vector<pa::Token> pa::ParallelLexer::tokenize() {
+        std::vector<Chunk> chunks = splitChunks();
+        m_constants = std::make_shared<ConstantPool>();
+        m_lex_error.reset();
+        
+        // The first chunk always starts between tokens, so it is lexed on this thread while the rest speculate
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < chunks.size(); i++)
+                workers.emplace_back([this, &chunk = chunks[i]] { speculate(chunk); });
+        if (!chunks.empty()) {
+                chunks[0].between_tokens.start = chunks[0].begin;
+                lexSpeculation(chunks[0].between_tokens, chunks[0].end);
+        }
+        for (auto& worker: workers)
+                worker.join();
+        
+        size_t total_tokens = 1;
+        for (const auto& chunk: chunks)
+                total_tokens += std::max(chunk.between_tokens.tokens.size(), chunk.inside_string.tokens.size());
+        
+        std::vector<Token> tokens;
+        tokens.reserve(total_tokens);
+        
+        // Where the serial lexer would be after the last token stitched so far
+        size_t resume = 0;
+        for (auto& chunk: chunks) {
+                // A literal from an earlier chunk swallowed this one whole
+                if (resume >= chunk.end)
+                        continue;
+                
+                Speculation* chosen = nullptr;
+                if (resume <= chunk.begin && chunk.between_tokens.valid)
+                        chosen = &chunk.between_tokens;
+                else if (chunk.inside_string.valid && resume == chunk.inside_string.start)
+                        chosen = &chunk.inside_string;
+                
+                if (chosen != nullptr) {
+                        for (Token token: chosen->tokens) {
+                                if (ConstantPool::hasConstant(token.type))
+                                        token.constant = m_constants->addFrom(chosen->constants, token);
+                                tokens.push_back(token);
+                        }
+                        if (!chosen->tokens.empty())
+                                resume = chosen->resume;
+                        continue;
+                }
+                
+                // Neither guess matches (or the right one hit an error), so lex this chunk for real from where the last one stopped.
+                // The tokens before an error are pushed as they are lexed, so they are left exactly as the serial Lexer has them.
+                size_t lexed_before = tokens.size();
+                try {
+                        Lexer lexer(m_source, resume, *m_constants, ErrorMode::Throw);
+                        size_t chunk_resume = lexer.lexRange(chunk.end, tokens);
+                        if (tokens.size() != lexed_before)
+                                resume = chunk_resume;
+                } catch (const CompileError& lex_error) {
+                        m_lex_error = lex_error;
+                        return tokens;
+                }
+        }
+        
+        tokens.push_back({TokenType::Eof, m_source.size(), m_source.size()});
+        return tokens;
+}
+
+std::vector<pa::Token> pa::ParallelLexer::tokenizeAndVerify() {
+        std::vector<Token> parallel_tokens = tokenize();
+        ConstantPool serial_constants;
+        std::vector<Token> serial_tokens;
+        std::optional<CompileError> serial_error;
+        try {
+                Lexer(m_source, serial_constants, ErrorMode::Throw).tokenize(serial_tokens);
+        } catch (const CompileError& lex_error) {
+                serial_error = lex_error;
+        }
+        verify("Parallel", parallel_tokens, *m_constants, "serial", serial_tokens, serial_constants);
+        verifyError("Parallel", m_lex_error, "serial", serial_error);
+        return parallel_tokens;
+}
+
+void pa::ParallelLexer::verify(const std::string_view name, const std::span<const pa::Token> tokens, const pa::ConstantPool& constants,
+                               const std::string_view expected_name, const std::span<const pa::Token> expected_tokens, const pa::ConstantPool& expected_constants) const {
+        size_t count = std::min(tokens.size(), expected_tokens.size());
+        for (size_t i = 0; i < count; i++) {
+                const Token& token = tokens[i];
+                const Token& expected = expected_tokens[i];
+                if (token.type != expected.type || token.start != expected.start || token.end != expected.end || token.constant != expected.constant)
+                        error(std::format("Lexing Error(verify {}): {} lexer produced {}({}, {}, constant {}), {} lexer produced {}({}, {}, constant {}).",
+                                          i,
+                                          name, Token::typeToString(token.type), token.start, token.end, token.constant,
+                                          expected_name, Token::typeToString(expected.type), expected.start, expected.end, expected.constant),
+                              expected.start);
+        }
+        
+        if (tokens.size() != expected_tokens.size())
+                error(std::format("Lexing Error(verify {}): {} lexer produced {} tokens, {} lexer produced {}.", count, name, tokens.size(), expected_name, expected_tokens.size()));
+        
+        if (!std::ranges::equal(constants.ints(), expected_constants.ints()) || !std::ranges::equal(constants.floats(), expected_constants.floats())
+            || !std::ranges::equal(constants.chars(), expected_constants.chars()) || !std::ranges::equal(constants.strings(), expected_constants.strings()))
+                error(std::format("Lexing Error(verify): {} and {} lexers decoded different constant pools.", name, expected_name));
+}
+
+void pa::ParallelLexer::verifyError(const std::string_view name, const std::optional<pa::CompileError>& lex_error,
+                                    const std::string_view expected_name, const std::optional<pa::CompileError>& expected_error) const {
+        auto describe = [](const std::optional<CompileError>& compile_error) {
+                return compile_error ? std::format("\"{}\" at {}", compile_error->message, compile_error->position) : std::string("no error");
+        };
+        if (lex_error.has_value() != expected_error.has_value()
+            || (lex_error && (lex_error->message != expected_error->message || lex_error->position != expected_error->position)))
+                error(std::format("Lexing Error(verify): {} lexer stopped with {}, {} lexer with {}.", name, describe(lex_error), expected_name, describe(expected_error)));
+}
+
+
+std::vector<pa::ParallelLexer::Chunk> pa::ParallelLexer::splitChunks() const {
+        std::vector<Chunk> chunks;
+        size_t chunk_size = std::max(m_source.size() / m_thread_count, MinimumChunkSize);
+        
+        size_t begin = 0;
+        while (begin < m_source.size()) {
+                // Push each boundary forward to just past a newline
+                size_t end = std::min(begin + chunk_size, m_source.size());
+                if (end < m_source.size()) {
+                        auto newline = static_cast<const char*>(std::memchr(m_source.data() + end, '\n', m_source.size() - end));
+                        end = newline == nullptr ? m_source.size() : newline - m_source.data() + 1;
+                }
+                
+                Chunk& chunk = chunks.emplace_back();
+                chunk.begin = begin;
+                chunk.end = end;
+                begin = end;
+        }
+        
+        return chunks;
+}
+
+void pa::ParallelLexer::speculate(pa::ParallelLexer::Chunk& chunk) const {
+        chunk.between_tokens.start = chunk.begin;
+        lexSpeculation(chunk.between_tokens, chunk.end);
+        
+        size_t string_close = findStringClose(chunk.begin, chunk.end);
+        if (string_close < chunk.end) {
+                chunk.inside_string.start = string_close + 1;
+                lexSpeculation(chunk.inside_string, chunk.end);
+        }
+}
+
+void pa::ParallelLexer::lexSpeculation(pa::ParallelLexer::Speculation& speculation, const size_t end) const {
+        try {
+                Lexer lexer(m_source, speculation.start, speculation.constants, ErrorMode::Throw);
+                speculation.resume = lexer.lexRange(end, speculation.tokens);
+                speculation.valid = true;
+        } catch (const CompileError&) {
+                speculation.tokens.clear();
+                speculation.valid = false;
+        }
+}
+
+// Finds the quote that would close a string literal already open at begin, skipping escaped characters
+size_t pa::ParallelLexer::findStringClose(const size_t begin, const size_t end) const {
+        for (size_t i = begin; i < end; i++) {
+                if (m_source[i] == '\\')
+                        i++;
+                else if (m_source[i] == '"')
+                        return i;
+        }
+        return end;
+}
+
+void pa::ParallelLexer::error(const std::string_view message, const size_t position) const {
+        pa::reportError(m_error_mode, message, position);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <optional>
+#include <thread>
+#include <vector>
+#include "lexer.h"
+
+// Splits the source into one chunk per thread, each ending just past a newline, and lexes every chunk twice at once:
+// once assuming it starts between tokens, and once assuming it starts inside a string literal carried over from the
+// previous chunk. Line comments end at the newline, so a chunk can never start inside one.
+// The chunks are then stitched together in order by picking whichever guess agrees with where the previous chunk
+// actually stopped, re-lexing the chunk serially if neither does. Each guess decodes literals into a pool of its own, which
+// are re-added to the shared pool while stitching so constant indices come out in the same order as lexing serially.
+// The result is the token buffer and constant pool pa::Lexer::tokenize produces. Lexing stops at the first error, which
+// is kept rather than raised: the tokens before it are all a Parser gets, with the error as the truncation error it raises
+// once it asks for the token after them, so errors in earlier statements are still reported first as they are serially.
+
+namespace pa {
+        class ParallelLexer {
+        public: // Static Data
+                static constexpr size_t MinimumChunkSize = 1 << 16;
+        public: // Constructors/Destructors/Overloads
+                ParallelLexer(std::string_view src, size_t thread_count = std::thread::hardware_concurrency(), ErrorMode error_mode = ErrorMode::Exit);
+        public: // Public Member Functions
+                // Every token up to the first lexing error, followed by the Eof token if there was none
+                std::vector<Token> tokenize();
+                
+                // Lexes the source both in parallel and serially, and errors out if the two token buffers (or errors) differ
+                std::vector<Token> tokenizeAndVerify();
+                
+                // The pool the last tokenize decoded literals into
+                [[nodiscard]] const std::shared_ptr<ConstantPool>& constants() const { return m_constants; }
+                // The error the last tokenize stopped at, if any
+                [[nodiscard]] const std::optional<CompileError>& lexError() const { return m_lex_error; }
+                
+        public: // Public Member Variables
+        private: // Private Member Types
+                struct Speculation {
+                        bool valid{false}; // False if lexing under the guessed starting state ran into an error
+                        size_t start{0};
+                        size_t resume{0};
+                        std::vector<Token> tokens;
+                        ConstantPool constants;
+                };
+                
+                struct Chunk {
+                        size_t begin{0};
+                        size_t end{0};
+                        Speculation between_tokens;
+                        Speculation inside_string;
+                };
+        private: // Private Member Functions
+                std::vector<Chunk> splitChunks() const;
+                void speculate(Chunk& chunk) const;
+                void lexSpeculation(Speculation& speculation, size_t end) const;
+                size_t findStringClose(size_t begin, size_t end) const;
+                // Errors out unless tokens and constants, named name, are exactly expected_tokens and expected_constants
+                void verify(std::string_view name, std::span<const Token> tokens, const ConstantPool& constants,
+                            std::string_view expected_name, std::span<const Token> expected_tokens, const ConstantPool& expected_constants) const;
+                // Errors out unless lex_error, of the lexer named name, is the same as expected_error
+                void verifyError(std::string_view name, const std::optional<CompileError>& lex_error,
+                                 std::string_view expected_name, const std::optional<CompileError>& expected_error) const;
+                
+                [[noreturn]] void error(std::string_view message, size_t position = NoPosition) const;
+        private: // Private Member Variables
+                std::string_view m_source;
+                size_t m_thread_count;
+                ErrorMode m_error_mode;
+                std::shared_ptr<ConstantPool> m_constants;
+                std::optional<CompileError> m_lex_error;
+        };
+}
@@ -0,0 +1,56 @@
+#include "token_stream.h"
+
+pa::TokenStream::TokenStream(const std::string_view src, const bool keep_tokens)
+        : m_source(src), m_keep_tokens(keep_tokens), m_thread(&TokenStream::produce, this) {}
+
+pa::TokenStream::~TokenStream() {
+        m_ring.cancel();
+        m_thread.join();
+}
+
+const pa::TokenStream::Entry* pa::TokenStream::next() {
+        if (m_batch_index == m_batch_size) {
+                if (m_current.token.type == TokenType::Eof)
+                        return &m_current;
+                
+                m_batch_size = m_ring.pop(m_batch);
+                m_batch_index = 0;
+                if (m_batch_size == 0)
+                        return nullptr;
+        }
+        
+        m_current = m_batch[m_batch_index++];
+        return &m_current;
+}
+
+void pa::TokenStream::produce() {
+        std::array<Entry, BatchSize> batch;
+        size_t count = 0;
+        
+        try {
+                Lexer lexer(m_source, m_constants, ErrorMode::Throw);
+                while (true) {
+                        // Hand the current token over before lexing the next one, which is what may fail
+                        Token token = lexer.peek();
+                        batch[count++] = {token, token.type == TokenType::Array ? m_constants.intValue(token.constant) : 0};
+                        if (m_keep_tokens)
+                                m_tokens.push_back(token);
+                        
+                        if (token.type == TokenType::Eof)
+                                break;
+                        
+                        if (count == batch.size()) {
+                                if (!m_ring.push(std::span(batch).first(count)))
+                                        return;
+                                count = 0;
+                        }
+                        lexer.eat();
+                }
+        } catch (const CompileError& lex_error) {
+                m_error = lex_error;
+        }
+        
+        // Closing publishes m_error, m_constants and m_tokens along with the last batch
+        if (m_ring.push(std::span(batch).first(count)))
+                m_ring.close();
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <vector>
+#include "lexer.h"
+#include "spsc_ring.h"
+
+// Lexes the source on a thread of its own while the Parser consumes the tokens, so the two phases of compiling one large
+// file overlap instead of running back to back.
+// The lexer thread hands tokens over in batches through an SpscRing, and blocks once it is Capacity tokens ahead. It stops
+// at the first lexing error, which the consuming Lexer raises only when the Parser asks for the token the lexer thread
+// stopped at, so the first error reported is the same one pa::Parser::parseProgram would report.
+// The Parser only ever needs the value of a literal for array extents, which travel beside their token, so the constant
+// pool is left to the lexer thread until it is done.
+
+namespace pa {
+        class TokenStream {
+        public: // Static Data
+                static constexpr size_t Capacity = 1 << 14;
+                static constexpr size_t BatchSize = 256;
+                
+                struct Entry {
+                        Token token;
+                        int64_t extent{0}; // The value of an Array token's extent
+                };
+        public: // Constructors/Destructors/Overloads
+                // Starts lexing src, which has to outlive the TokenStream. If keep_tokens is set the lexer thread also
+                // collects every token into a buffer, for callers that need it once parsing is done.
+                explicit TokenStream(std::string_view src, bool keep_tokens = false);
+                ~TokenStream();
+                
+                TokenStream(const TokenStream&) = delete;
+                TokenStream& operator=(const TokenStream&) = delete;
+        public: // Public Member Functions
+                // The next token, blocking until it is lexed, or nullptr if lexing stopped at an error before it. Keeps
+                // handing out the Eof token once it has been reached.
+                const Entry* next();
+                // Why lexing stopped, once next has returned nullptr
+                [[nodiscard]] const CompileError& error() const { return m_error; }
+                
+                // The pool literals are decoded into and, if kept, every token lexed. Only safe to use once next has handed out Eof.
+                [[nodiscard]] ConstantPool& constants() { return m_constants; }
+                [[nodiscard]] std::span<const Token> tokens() const { return m_tokens; }
+                
+        public: // Public Member Variables
+        private: // Private Member Functions
+                void produce();
+        private: // Private Member Variables
+                std::string_view m_source;
+                bool m_keep_tokens;
+                
+                // Only touched by the lexer thread until it closes the ring
+                ConstantPool m_constants;
+                std::vector<Token> m_tokens;
+                CompileError m_error;
+                
+                SpscRing<Entry, Capacity> m_ring;
+                
+                // Only touched by the consuming thread
+                std::array<Entry, BatchSize> m_batch;
+                size_t m_batch_size{0};
+                size_t m_batch_index{0};
+                Entry m_current;
+                
+                std::thread m_thread;
+        };
+}
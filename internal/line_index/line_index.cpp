@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <bit>
+#include <format>
+#include "line_index.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+        size_t countNewlinesScalar(const std::string_view src, const size_t begin) {
+                return static_cast<size_t>(std::count(src.begin() + static_cast<std::ptrdiff_t>(begin), src.end(), '\n'));
+        }
+        
+        void findLineStartsScalar(const std::string_view src, size_t begin, std::vector<size_t>& line_starts) {
+                for (; begin < src.size(); begin++)
+                        if (src[begin] == '\n')
+                                line_starts.push_back(begin + 1);
+        }
+
+#if defined(__x86_64__)
+        bool hasAvx2() {
+                static const bool has_avx2 = __builtin_cpu_supports("avx2");
+                return has_avx2;
+        }
+        
+        // A bit set for every newline among the 32 bytes at i
+        __attribute__((target("avx2"))) uint32_t newlineMask(const std::string_view src, const size_t i) {
+                __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src.data() + i));
+                return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))));
+        }
+        
+        __attribute__((target("avx2"))) size_t countNewlinesAvx2(const std::string_view src) {
+                size_t count = 0, i = 0;
+                for (; i + 32 <= src.size(); i += 32)
+                        count += std::popcount(newlineMask(src, i));
+                return count + countNewlinesScalar(src, i);
+        }
+        
+        __attribute__((target("avx2"))) void findLineStartsAvx2(const std::string_view src, std::vector<size_t>& line_starts) {
+                size_t i = 0;
+                for (; i + 32 <= src.size(); i += 32)
+                        for (uint32_t mask = newlineMask(src, i); mask != 0; mask &= mask - 1)
+                                line_starts.push_back(i + std::countr_zero(mask) + 1);
+                findLineStartsScalar(src, i, line_starts);
+        }
+#endif
+}
+
+pa::LineIndex::Location pa::LineIndex::locate(const size_t offset) {
+        if (m_line_starts.empty())
+                build();
+        
+        size_t clamped = std::min(offset, m_source.size());
+        // The last line starting at or before the offset
+        size_t line = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), clamped) - m_line_starts.begin();
+        return {line, clamped - m_line_starts[line - 1] + 1};
+}
+
+size_t pa::LineIndex::lineCount() {
+        if (m_line_starts.empty())
+                build();
+        return m_line_starts.size();
+}
+
+std::string pa::LineIndex::annotate(const std::string_view message, const size_t position) {
+        if (position == NoPosition)
+                return std::string(message);
+        Location location = locate(position);
+        return std::format("{}:{}: {}", location.line, location.column, message);
+}
+
+std::string pa::LineIndex::annotate(const std::span<const pa::CompileError> errors) {
+        std::string annotated;
+        for (const CompileError& compile_error: errors) {
+                if (!annotated.empty())
+                        annotated += '\n';
+                annotated += annotate(compile_error);
+        }
+        return annotated;
+}
+
+// Counted first, so the index is allocated once at its final size however large the source is
+void pa::LineIndex::build() {
+#if defined(__x86_64__)
+        if (hasAvx2()) {
+                m_line_starts.reserve(countNewlinesAvx2(m_source) + 1);
+                m_line_starts.push_back(0);
+                findLineStartsAvx2(m_source, m_line_starts);
+                return;
+        }
+#endif
+        m_line_starts.reserve(countNewlinesScalar(m_source, 0) + 1);
+        m_line_starts.push_back(0);
+        findLineStartsScalar(m_source, 0, m_line_starts);
+}
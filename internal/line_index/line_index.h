@@ -0,0 +1,40 @@
+#pragma once
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "error.h"
+
+// Maps byte offsets into a source, which is all tokens and errors keep, to lines and columns for diagnostics and source
+// maps. Nothing counts lines while lexing: the index of where every line starts is only built the first time a position
+// is asked for, finding the newlines 32 bytes at a time on x86-64 hosts with AVX2 (picked once at runtime) and a byte at
+// a time everywhere else. Each lookup is then a binary search over the line starts.
+
+namespace pa {
+        class LineIndex {
+        public: // Static Data
+                // Both counted from 1, columns in bytes
+                struct Location {
+                        size_t line;
+                        size_t column;
+                };
+        public: // Constructors/Destructors/Overloads
+                // src has to outlive the LineIndex
+                explicit LineIndex(std::string_view src) : m_source(src) {}
+        public: // Public Member Functions
+                // Offsets past the end of the source are at its end, where the Eof token is
+                [[nodiscard]] Location locate(size_t offset);
+                [[nodiscard]] size_t lineCount();
+                
+                // message prefixed with the line and column of position, as in "3:14: message", or as it is if it has no position
+                [[nodiscard]] std::string annotate(std::string_view message, size_t position);
+                [[nodiscard]] std::string annotate(const CompileError& compile_error) { return annotate(compile_error.message, compile_error.position); }
+                // Each of errors annotated on a line of its own
+                [[nodiscard]] std::string annotate(std::span<const CompileError> errors);
+        private: // Private Member Functions
+                void build();
+        private: // Private Member Variables
+                std::string_view m_source;
+                std::vector<size_t> m_line_starts; // Empty until built, then always starting with 0
+        };
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include "parallel_checker.h"
+#include "parallel_lexer.h"
+
+pa::ParallelChecker::ParallelChecker(const std::string_view src, const size_t thread_count, const pa::ErrorMode error_mode)
+        : m_source(src), m_thread_count(std::max<size_t>(thread_count, 1)), m_error_mode(error_mode) {}
+
+
+void pa::ParallelChecker::checkProgram() {
+        lexProgram();
+        if (m_tokens.empty())
+                error(*m_lex_error);
+        
+        std::optional<Diagnostic> declaration_error = collectDeclarations();
+        
+        // Give every thread a contiguous run of roughly the same number of tokens
+        size_t statement_tokens = 0;
+        for (const auto& statement: m_statements)
+                statement_tokens += statement.end_token - statement.first_token;
+        size_t tokens_per_chunk = statement_tokens / m_thread_count + 1;
+        
+        std::vector<std::span<const Statement>> chunks;
+        size_t chunk_begin = 0;
+        size_t chunk_tokens = 0;
+        for (size_t i = 0; i < m_statements.size(); i++) {
+                chunk_tokens += m_statements[i].end_token - m_statements[i].first_token;
+                if (chunk_tokens >= tokens_per_chunk || i + 1 == m_statements.size()) {
+                        chunks.emplace_back(m_statements.begin() + chunk_begin, m_statements.begin() + i + 1);
+                        chunk_begin = i + 1;
+                        chunk_tokens = 0;
+                }
+        }
+        
+        std::vector<std::optional<Diagnostic>> chunk_errors(chunks.size());
+        std::vector<std::vector<std::string>> chunk_loaded_files(chunks.size());
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < chunks.size(); i++)
+                workers.emplace_back([this, &chunk = chunks[i], &chunk_error = chunk_errors[i], &loaded_files = chunk_loaded_files[i]] { chunk_error = checkStatements(chunk, loaded_files); });
+        if (!chunks.empty())
+                chunk_errors[0] = checkStatements(chunks[0], chunk_loaded_files[0]);
+        for (auto& worker: workers)
+                worker.join();
+        
+        for (auto& loaded_files: chunk_loaded_files)
+                m_loaded_files.insert(m_loaded_files.end(), std::make_move_iterator(loaded_files.begin()), std::make_move_iterator(loaded_files.end()));
+        
+        // Chunks are in program order, so the first one to fail holds the earliest error of the second phase.
+        // The first phase stopped at its own error, so every statement checked in the second phase comes before it.
+        for (const auto& chunk_error: chunk_errors)
+                if (chunk_error)
+                        error(chunk_error->error);
+        if (declaration_error)
+                error(declaration_error->error);
+}
+
+
+void pa::ParallelChecker::lexProgram() {
+        // The ParallelLexer stops at a lexing error with exactly the tokens the serial Parser would have seen before it
+        ParallelLexer lexer(m_source, m_thread_count, ErrorMode::Throw);
+        m_tokens = lexer.tokenize();
+        m_constants = lexer.constants();
+        m_lex_error = lexer.lexError();
+}
+
+std::optional<pa::ParallelChecker::Diagnostic> pa::ParallelChecker::collectDeclarations() {
+        Parser parser(m_source, m_tokens, *m_constants, ErrorMode::Throw);
+        
+        size_t statement_index = 0;
+        for (size_t first_token = 0; first_token < m_tokens.size() && m_tokens[first_token].type != TokenType::Eof; statement_index++) {
+                // A statement runs up to and including its semicolon, or to the end of the buffer if it has none
+                size_t end_token = first_token;
+                while (end_token < m_tokens.size() && m_tokens[end_token].type != TokenType::SemiColon && m_tokens[end_token].type != TokenType::Eof)
+                        end_token++;
+                end_token = std::min(end_token + 1, m_tokens.size());
+                
+                Statement statement = {statement_index, first_token, end_token};
+                first_token = end_token;
+                
+                auto type = m_tokens[statement.first_token].type;
+                if (type == TokenType::Identifier || type == TokenType::Print || type == TokenType::Read) {
+                        m_statements.push_back(statement);
+                        continue;
+                }
+                
+                // Declarations, and anything that can't start a statement at all
+                try {
+                        parser.parseStatementAt(std::span(m_tokens).subspan(statement.first_token, statement.end_token - statement.first_token), statement.index, m_declarations, truncationErrorFor(statement));
+                } catch (const CompileError& declaration_error) {
+                        return Diagnostic{statement.index, declaration_error};
+                }
+        }
+        
+        return std::nullopt;
+}
+
+std::optional<pa::ParallelChecker::Diagnostic> pa::ParallelChecker::checkStatements(const std::span<const Statement> statements, std::vector<std::string>& loaded_files) {
+        Parser parser(m_source, m_tokens, *m_constants, ErrorMode::Throw);
+        
+        std::optional<Diagnostic> diagnostic;
+        for (const auto& statement: statements) {
+                try {
+                        parser.parseStatementAt(std::span(m_tokens).subspan(statement.first_token, statement.end_token - statement.first_token), statement.index, m_declarations, truncationErrorFor(statement));
+                } catch (const CompileError& statement_error) {
+                        diagnostic = Diagnostic{statement.index, statement_error};
+                        break;
+                }
+        }
+        
+        loaded_files.assign(parser.loadedFiles().begin(), parser.loadedFiles().end());
+        return diagnostic;
+}
+
+// The serial Lexer runs one token ahead of the Parser, so a lexing error surfaces as soon as the last token lexed before it is eaten
+const pa::CompileError* pa::ParallelChecker::truncationErrorFor(const pa::ParallelChecker::Statement& statement) const {
+        return statement.end_token == m_tokens.size() && m_lex_error ? &*m_lex_error : nullptr;
+}
+
+void pa::ParallelChecker::error(const pa::CompileError& compile_error) const {
+        pa::reportError(m_error_mode, compile_error.message, compile_error.position);
+}
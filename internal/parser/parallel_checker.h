@@ -0,0 +1,57 @@
+#pragma once
+#include <optional>
+#include <thread>
+#include <vector>
+#include "parser.h"
+
+// Checks a program in two phases instead of walking it once in order.
+// The first phase runs serially: it splits the token buffer into statements at their semicolons, fully parses each
+// declaration, and records it in a Parser::DeclarationIndex along with its statement index. Assignments, print and read
+// statements are only located. The second phase parses and type checks those in parallel chunks. Each statement resolves
+// identifiers against the declarations made by earlier statements, which is exactly what the serial symbol table holds
+// at that point. The earliest error across both phases is the one the serial Parser would have reported.
+
+namespace pa {
+        class ParallelChecker {
+        public: // Static Data
+        public: // Constructors/Destructors/Overloads
+                ParallelChecker(std::string_view src, size_t thread_count = std::thread::hardware_concurrency(), ErrorMode error_mode = ErrorMode::Exit);
+        public: // Public Member Functions
+                void checkProgram();
+                
+                // The files the program's load expressions pulled in, in program order
+                [[nodiscard]] std::span<const std::string> loadedFiles() const { return m_loaded_files; }
+                
+        public: // Public Member Variables
+        private: // Private Member Types
+                struct Statement {
+                        size_t index{0};
+                        size_t first_token{0};
+                        size_t end_token{0};
+                };
+                
+                struct Diagnostic {
+                        size_t statement_index{0};
+                        CompileError error;
+                };
+        private: // Private Member Functions
+                void lexProgram();
+                std::optional<Diagnostic> collectDeclarations();
+                std::optional<Diagnostic> checkStatements(std::span<const Statement> statements, std::vector<std::string>& loaded_files);
+                const CompileError* truncationErrorFor(const Statement& statement) const;
+                
+                [[noreturn]] void error(const CompileError& compile_error) const;
+        private: // Private Member Variables
+                std::string_view m_source;
+                size_t m_thread_count;
+                ErrorMode m_error_mode;
+                
+                std::vector<Token> m_tokens;
+                std::shared_ptr<ConstantPool> m_constants;
+                std::optional<CompileError> m_lex_error; // Set if lexing stopped early, m_tokens then holds only what was lexed before it
+                
+                Parser::DeclarationIndex m_declarations;
+                std::vector<Statement> m_statements; // Only the statements left for the second phase
+                std::vector<std::string> m_loaded_files;
+        };
+}
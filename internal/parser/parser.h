@@ -1,7 +1,12 @@
 #pragma once
-#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <utility>
 #include <vector>
 #include "lexer.h"
+#include "flat_map.h"
+#include "small_vector.h"
 
 // Tokens
 // LineComment    -> // .*\\n
@@ -33,6 +38,7 @@
 
 // Print          -> print
 // Read           -> read
+// Load           -> load
 
 
 // Grammar
@@ -50,7 +56,8 @@
 // Expression      -> BaseExpression | ArrayExpr
 
 // Declaration    -> BasicType Identifier ; | BasicType Identifier ArrayExt ;
-// Assignment     -> Identifier = Expression;
+// LoadExpr       -> Load \( StringLiteral \)
+// Assignment     -> Identifier = Expression; | Identifier = LoadExpr;
 
 // PrintCall      -> Print \( Expression \) ;
 // ReadCall       -> Read \( Expression \) ;
@@ -59,55 +66,862 @@
 
 // Program        -> Statement* EOF
 
+// The Parser is also the type checker, and like the Lexer is constexpr throughout except for error(), so checking a
+// program during constant evaluation fails to compile at the check it breaks.
+// Given somewhere to put its errors, parseProgram goes on past them rather than stopping at the first. A statement with
+// an error is skipped to its semicolon, and an element of an array literal with one to its comma or closing brace. A
+// failed declaration or an undeclared variable leaves a poisoned symbol behind, and errors in statements or elements that
+// use one aren't reported, since they most likely follow from the error that poisoned it.
+
 namespace pa {
         class Parser {
                 enum class Operator {
                         And,
                         Not,
                         Or,
-                        
+                
                 };
                 
         public: // Static Data
+                // Deeper nesting of parentheses, ! and array literals is rejected before the recursive descent can exhaust the stack
+                static constexpr int32_t MaxNestingDepth = 1000;
+                
+                // The tokens each rule can start with, per the grammar above
+                static constexpr TokenSet BasicTypes{TokenType::Int, TokenType::Bool, TokenType::Float, TokenType::Char, TokenType::String};
+                static constexpr TokenSet BasicRValues{TokenType::Identifier, TokenType::CharLiteral, TokenType::StringLiteral, TokenType::True, TokenType::False, TokenType::FloatLiteral, TokenType::IntLiteral};
+                static constexpr TokenSet BaseExpressionStart = BasicRValues | TokenSet{TokenType::Not, TokenType::OpenParen};
+                static constexpr TokenSet ExpressionStart = BaseExpressionStart | TokenType::OpenCurly;
+                static constexpr TokenSet ComparisonOperators{TokenType::GreaterThan, TokenType::LessThan, TokenType::GreaterThanOrEquals, TokenType::LessThanOrEquals, TokenType::EqualsEquals, TokenType::NotEquals};
+                static constexpr TokenSet ArithmeticOperators{TokenType::Plus, TokenType::Minus, TokenType::ForwardSlash, TokenType::Asterisk};
+                
+                // Extents, outermost first, with arrays of up to 4 dimensions keeping theirs off the heap
+                using Sizes = SmallVector<size_t, 4>;
+                
                 struct SymbolData {
                         TokenType type{TokenType::INVALID};
-                        std::vector<size_t> sizes{};
+                        Sizes sizes{};
+                        bool poisoned{false}; // Stands in for a failed declaration or an undeclared variable
+                };
+                
+                // Keyed on names in the source, which outlives the Parser, so declaring a variable copies no string
+                using SymbolTable = FlatMap<std::string_view, SymbolData>;
+                
+                // Every declaration of each identifier in statement order, so a statement can be checked against exactly the
+                // declarations that come before it without walking the program in order
+                class DeclarationIndex {
+                public:
+                        constexpr void add(std::string_view name, size_t statement_index, const SymbolData& symbol_data);
+                        [[nodiscard]] constexpr const SymbolData* find(std::string_view name, size_t statement_index) const;
+                private:
+                        struct Declaration {
+                                size_t statement_index;
+                                SymbolData symbol_data;
+                        };
+                        FlatMap<std::string_view, std::vector<Declaration>> m_declarations; // Keyed on names in the source
                 };
         public: // Constructors/Destructors/Overloads
-                Parser(const std::string_view src) : m_source(src), m_lexer(src) {};
+                constexpr Parser(const std::string_view src, const ErrorMode error_mode = ErrorMode::Exit)
+                        : m_source(src), m_owned_constants(std::make_unique<ConstantPool>()), m_lexer(src, *m_owned_constants, error_mode), m_error_mode(error_mode) {};
+                // Replays tokens, raising truncation_error (if any) when asked for a token past their end
+                // and raising the next of lex_errors at each INVALID token
+                constexpr Parser(const std::string_view src, const std::span<const Token> tokens, ConstantPool& constants, const ErrorMode error_mode = ErrorMode::Exit, const CompileError* truncation_error = nullptr,
+                                 const std::span<const CompileError> lex_errors = {})
+                        : m_source(src), m_lexer(src, tokens, constants, error_mode, truncation_error, lex_errors), m_error_mode(error_mode) {};
+                // Parses the tokens a TokenStream lexes on another thread
+                Parser(const std::string_view src, TokenStream& stream, const ErrorMode error_mode = ErrorMode::Exit)
+                        : m_source(src), m_lexer(src, stream, error_mode), m_error_mode(error_mode) {};
         public: // Public Member Functions
-                void parseProgram();
-                void parseStatement();
+                constexpr void parseProgram();
+                // Parses the whole program in ErrorMode::Throw, appending every error to errors instead of stopping at the
+                // first, up to max_errors of them
+                constexpr void parseProgram(std::vector<CompileError>& errors, size_t max_errors);
+                constexpr void parseStatement();
+                // The token the next statement starts at, Eof once the program has been parsed
+                [[nodiscard]] constexpr Token nextToken() { return m_lexer.peek(); }
                 
-                void parseDeclaration();
-                void parseAssignment();
-                void parsePrintCall();
-                void parseReadCall();
+                // Parses tokens as the single statement_index'th statement of the program, recording declarations into and
+                // resolving identifiers through declarations instead of the symbol table
+                constexpr void parseStatementAt(std::span<const Token> tokens, size_t statement_index, DeclarationIndex& declarations, const CompileError* truncation_error = nullptr);
                 
-                SymbolData parseBoolExpr();
-                SymbolData parseLogicalExpr();
-                SymbolData parseComparisonExpr();
-                SymbolData parseArithmeticExpr();
-                SymbolData parsePrimaryExpr();
+                // Starts over on another source by replaying its tokens, raising truncation_error (if any) past their end.
+                // The symbol tables keep their memory, so a Parser reused this way stops allocating for them once it has
+                // seen its largest program.
+                constexpr void reset(std::string_view src, std::span<const Token> tokens, ConstantPool& constants, const CompileError* truncation_error = nullptr,
+                                     std::span<const CompileError> lex_errors = {});
+                
+                constexpr void parseDeclaration();
+                constexpr void parseAssignment();
+                constexpr void parsePrintCall();
+                constexpr void parseReadCall();
+                // Checks the file a load expression names against the declaration of target. Needs the file system, so like
+                // error() it isn't constexpr, and a load in a source checked during constant evaluation fails to compile.
+                void parseLoadExpression(Token target);
+                
+                // The files load expressions have pulled in so far, which a compile result depends on as much as the source
+                [[nodiscard]] std::span<const std::string> loadedFiles() const { return m_loaded_files; }
+                
+                constexpr SymbolData parseBoolExpr();
+                constexpr SymbolData parseLogicalExpr();
+                constexpr SymbolData parseComparisonExpr();
+                constexpr SymbolData parseArithmeticExpr();
+                constexpr SymbolData parsePrimaryExpr();
+                
+                constexpr SymbolData parseBaseExpression();
+                constexpr SymbolData parseNestedBaseExpression();
+                constexpr SymbolData parseArrayExpression();
+                // The type of the current token if it is a literal that makes up a whole array element, INVALID otherwise
+                constexpr TokenType literalElementType();
+                
+                constexpr SymbolData parseExpression();
+                
+                [[nodiscard]] constexpr const SymbolTable& symbolTable() const { return m_symbol_table; }
                 
-                SymbolData parseBaseExpression();
-                SymbolData parseArrayExpression();
-        
-                SymbolData parseExpression();
-        
         public: // Public Member Variables
+        private: // Private Member Types
+                // Thrown once an error in an array element has been recorded, when the rest of its statement is to be skipped
+                struct Recovered {};
         private: // Private Member Functions
-                static TokenType deLiteralType(pa::TokenType type);
-                void validateAssignment(pa::Token token, SymbolData symbol_data);
-                bool identifierIsType(pa::Token token, const SymbolData& symbol_data);
-                void consumeOpenParen(std::string_view message);
-                void consumeCloseParen(std::string_view message);
-                static void error(std::string_view message);
+                // Records compile_error (if any) unless it follows from a poisoned symbol, then skips what is left of its
+                // statement, recording any lexing errors on the way
+                void recover(std::optional<CompileError> compile_error);
+                void record(const CompileError& error);
+                constexpr void skipStatement();
+                // Skips what is left of an array element, up to the comma or closing brace ending it
+                constexpr void skipElement();
+                // Raises the error for an identifier that hasn't been declared, poisoning it if recovering
+                [[noreturn]] void undeclared(std::string_view rule_name, Token token);
+                
+                static constexpr TokenType deLiteralType(pa::TokenType type);
+                static constexpr bool sizesAreEqual(const Sizes& l_sizes, const Sizes& r_sizes);
+                // The sizes of an element-wise operation on lhs and rhs
+                constexpr Sizes elementwiseSizes(const SymbolData& lhs, const SymbolData& rhs, std::string_view rule_name, size_t position);
+                constexpr void validateAssignment(pa::Token token, SymbolData symbol_data);
+                constexpr bool identifierIsType(pa::Token token, const SymbolData& symbol_data);
+                constexpr const SymbolData* findSymbol(std::string_view name);
+                constexpr void enterNesting(std::string_view rule_name);
+                constexpr void consumeOpenParen();
+                constexpr void consumeCloseParen();
+                
+                // Only ever called to build error messages
+                template<typename T>
+                static std::string str(T begin, T end) {
+                        std::stringstream ss;
+                        for (; begin != end; begin++)
+                                ss << '[' << *begin << ']';
+                        return ss.str();
+                }
+                template<typename T>
+                static std::string reverse_str(T begin, T end) {
+                        std::stringstream ss;
+                        for (; end != begin; end--)
+                                ss << '[' << *(end - 1) << ']';
+                        return ss.str();
+                }
+                
+                [[noreturn]] void error(std::string_view message, size_t position = NoPosition) const;
         private: // Private Member Variables
                 std::string_view m_source;
+                std::unique_ptr<ConstantPool> m_owned_constants; // Only set if the Parser lexes the source itself
                 pa::Lexer m_lexer;
-                std::unordered_map<std::string, SymbolData> m_symbol_table; // Identifier name -> Type
-                std::unordered_map<std::string, std::vector<SymbolData>> m_array_symbol_table;
+                ErrorMode m_error_mode{ErrorMode::Exit};
+                SymbolTable m_symbol_table; // Identifier name -> Type
+                FlatMap<std::string, std::vector<SymbolData>> m_array_symbol_table;
                 int32_t m_parenthesis_depth{0};
+                int32_t m_nesting_depth{0};
+                
+                // Set while parsing a program that goes on past its errors
+                std::vector<CompileError>* m_errors{nullptr};
+                size_t m_max_errors{0};
+                bool m_poisoned{false}; // A poisoned symbol has been used by the current statement or element
+                std::string_view m_declaring; // The variable being declared, poisoned if its declaration fails
+                TokenType m_declaring_type{TokenType::INVALID};
+                
+                DeclarationIndex* m_declarations{nullptr}; // Set while parsing through parseStatementAt
+                size_t m_statement_index{0};
+                
+                std::vector<std::string> m_loaded_files;
         };
-}
\ No newline at end of file
+}
+
+constexpr bool pa::Parser::sizesAreEqual(const pa::Parser::Sizes& l_sizes, const pa::Parser::Sizes& r_sizes) {
+        for (size_t i = 0; i < l_sizes.size(); i++) {
+                if (l_sizes[i] == 0)
+                        continue;
+                else if (i >= r_sizes.size() || l_sizes[i] != r_sizes[i])
+                        return false;
+        }
+        return true;
+}
+
+// Operators apply element by element to arrays of one shape, with a scalar standing for every element of the other side.
+// Strings only concatenate as scalars.
+constexpr pa::Parser::Sizes pa::Parser::elementwiseSizes(const pa::Parser::SymbolData& lhs, const pa::Parser::SymbolData& rhs, const std::string_view rule_name, const size_t position) {
+        bool lhs_is_scalar = lhs.sizes.size() == 1 && lhs.sizes.front() == 1;
+        bool rhs_is_scalar = rhs.sizes.size() == 1 && rhs.sizes.front() == 1;
+        if (lhs_is_scalar && rhs_is_scalar)
+                return lhs.sizes;
+        
+        if (lhs.type == TokenType::String || rhs.type == TokenType::String)
+                error(std::format("Parsing Error({} {}): Trying to perform element-wise operation on string array.", rule_name, position), position);
+        
+        if (lhs_is_scalar)
+                return rhs.sizes;
+        if (!rhs_is_scalar && (lhs.sizes.size() != rhs.sizes.size() || !sizesAreEqual(lhs.sizes, rhs.sizes)))
+                error(std::format("Parsing Error({} {}): Element-wise operation on arrays of sizes {} and {}.", rule_name, position, str(lhs.sizes.begin(), lhs.sizes.end()), str(rhs.sizes.begin(), rhs.sizes.end())), position);
+        return lhs.sizes;
+}
+
+constexpr void pa::Parser::parseProgram() {
+        while (!m_lexer.is(TokenType::Eof))
+                parseStatement();
+        m_lexer.eat(TokenType::Eof, "parseProgram");
+}
+
+constexpr void pa::Parser::parseProgram(std::vector<pa::CompileError>& errors, const size_t max_errors) {
+        m_errors = &errors;
+        m_max_errors = max_errors;
+        while (errors.size() < max_errors && !m_lexer.truncated()) {
+                try {
+                        if (m_lexer.is(TokenType::Eof)) {
+                                m_lexer.eat(TokenType::Eof, "parseProgram");
+                                break;
+                        }
+                        m_poisoned = false;
+                        parseStatement();
+                } catch (const Recovered&) {
+                        recover(std::nullopt);
+                } catch (const CompileError& compile_error) {
+                        recover(compile_error);
+                }
+        }
+        m_errors = nullptr;
+}
+
+constexpr void pa::Parser::skipStatement() {
+        while (!m_lexer.is({TokenType::SemiColon, TokenType::Eof}))
+                m_lexer.eat();
+        if (m_lexer.is(TokenType::SemiColon))
+                m_lexer.eat();
+}
+
+constexpr void pa::Parser::skipElement() {
+        int32_t depth = 0;
+        while (!m_lexer.is({TokenType::SemiColon, TokenType::Eof})) {
+                if (depth == 0 && m_lexer.is({TokenType::Comma, TokenType::CloseCurly}))
+                        return;
+                if (m_lexer.is({TokenType::OpenCurly, TokenType::OpenParen}))
+                        depth++;
+                else if (m_lexer.is({TokenType::CloseCurly, TokenType::CloseParen}) && depth > 0)
+                        depth--;
+                m_lexer.eat();
+        }
+        
+        // The literal never closed, so neither can the statement it is in
+        throw Recovered{};
+}
+
+constexpr void pa::Parser::parseStatementAt(const std::span<const pa::Token> tokens, const size_t statement_index, pa::Parser::DeclarationIndex& declarations, const pa::CompileError* truncation_error) {
+        m_lexer = Lexer(m_source, tokens, m_lexer.constants(), m_error_mode, truncation_error);
+        m_declarations = &declarations;
+        m_statement_index = statement_index;
+        
+        parseStatement();
+}
+
+constexpr void pa::Parser::reset(const std::string_view src, const std::span<const pa::Token> tokens, pa::ConstantPool& constants, const pa::CompileError* truncation_error,
+                                 const std::span<const pa::CompileError> lex_errors) {
+        m_source = src;
+        if (m_owned_constants.get() != &constants)
+                m_owned_constants.reset();
+        m_symbol_table.clear();
+        m_array_symbol_table.clear();
+        m_parenthesis_depth = 0;
+        m_nesting_depth = 0;
+        m_declarations = nullptr;
+        m_statement_index = 0;
+        m_loaded_files.clear();
+        m_poisoned = false;
+        m_declaring = {};
+        
+        // Last, since the Lexer raises truncation_error (or the error of a leading INVALID token) straight away
+        m_lexer = Lexer(src, tokens, constants, m_error_mode, truncation_error, lex_errors);
+}
+
+constexpr void pa::Parser::parseStatement() {
+        auto tok = m_lexer.peek(BasicTypes | TokenSet{TokenType::Identifier, TokenType::Print, TokenType::Read}, "parseStatement");
+        
+        switch (tok.type) {
+                case TokenType::Bool:
+                case TokenType::Float:
+                case TokenType::Char:
+                case TokenType::String:
+                case TokenType::Int:
+                        parseDeclaration();
+                        break;
+                
+                case TokenType::Identifier:
+                        parseAssignment();
+                        break;
+                
+                case TokenType::Print:
+                        parsePrintCall();
+                        break;
+                
+                case TokenType::Read:
+                        parseReadCall();
+                        break;
+        }
+}
+
+constexpr void pa::Parser::parseDeclaration() {
+        SymbolData symbol_data;
+        
+        // Eat and store the type
+        symbol_data.type = m_lexer.eat(BasicTypes, "parseDeclaration").type;
+        
+        // Eat the identifier and store its name
+        // Named before it is eaten, since lexing the token after it can fail too
+        std::string_view symbol_name = m_lexer.peek(TokenType::Identifier, "parseDeclaration").toString(m_source);
+        m_declaring = symbol_name;
+        m_declaring_type = symbol_data.type;
+        m_lexer.eat();
+        
+        // Eat all the array extension and set the sizes to the sizes of the arrays
+        Sizes sizes;
+        while (m_lexer.is(TokenType::Array))
+                sizes.push_back(m_lexer.eatArrayExtent("parseDeclaration"));
+        if (sizes.empty())
+                symbol_data.sizes = {1};
+        else
+                symbol_data.sizes = sizes;
+        
+        // Insert the variable into the symbol table
+        if (m_declarations != nullptr)
+                m_declarations->add(symbol_name, m_statement_index, symbol_data);
+        else
+                m_symbol_table[symbol_name] = symbol_data;
+        m_declaring = {};
+        
+        m_lexer.eat(TokenType::SemiColon, "parseDeclaration");
+}
+
+constexpr void pa::Parser::parseAssignment() {
+        // Eat the identifier and store its name
+        auto tok = m_lexer.eat(TokenType::Identifier, "parseAssignment");
+        
+        // Eat the equals
+        m_lexer.eat(TokenType::Equals, "parseAssignment");
+        
+        // Parse the assigned expression and validate the assignnment
+        if (m_lexer.is(TokenType::Load)) {
+                parseLoadExpression(tok);
+        } else {
+                validateAssignment(tok, parseExpression());
+        }
+        
+        // Eat the semicolon
+        m_lexer.eat(TokenType::SemiColon, "parseDeclaration");
+}
+
+constexpr void pa::Parser::parsePrintCall() {
+        // Eat the print statement
+        m_lexer.eat(TokenType::Print, "parsePrintCall");
+        
+        // Eat the open paren
+        m_lexer.eat(TokenType::OpenParen, "parsePrintCall");
+        
+        // Validate the parameter
+        parseExpression();
+        
+        // Eat the close paren
+        m_lexer.eat(TokenType::CloseParen, "parsePrintCall");
+        
+        
+        // Eat the semicolon
+        m_lexer.eat(TokenType::SemiColon, "parsePrintCall");
+}
+
+constexpr void pa::Parser::parseReadCall() {
+        // Eat the print statement
+        m_lexer.eat(TokenType::Read, "parseReadCall");
+        
+        // Eat the open paren
+        m_lexer.eat(TokenType::OpenParen, "parseReadCall");
+        
+        // Validate the parameter
+        parseExpression();
+        
+        // Eat the close paren
+        m_lexer.eat(TokenType::CloseParen, "parseReadCall");
+        
+        
+        // Eat the semicolon
+        m_lexer.eat(TokenType::SemiColon, "parseReadCall");
+}
+
+
+constexpr pa::Parser::SymbolData pa::Parser::parseExpression() {
+        auto tok = m_lexer.peek(ExpressionStart, "parseExpression");
+        
+        if (tok.type == TokenType::OpenCurly) {
+                // ArrayExpr, whose sizes are collected innermost first
+                SymbolData symbol_data = parseArrayExpression();
+                std::reverse(symbol_data.sizes.begin(), symbol_data.sizes.end());
+                return symbol_data;
+        } else
+                // BaseExpr
+                return parseBaseExpression();
+}
+
+
+constexpr pa::Parser::SymbolData pa::Parser::parseArrayExpression() {
+        enterNesting("parseArrayExpression");
+        Token start = m_lexer.eat(TokenType::OpenCurly, "parseArrayExpression");
+        
+        size_t size = 0;
+        SymbolData symbol_data = {TokenType::INVALID};
+        
+        auto tok = m_lexer.peek(ExpressionStart | TokenType::CloseCurly, "parseArrayExpression");
+        
+        // Each element is checked on its own when recovering, so an error in one doesn't hide those in the next
+        bool poisoned = false;
+        while (!m_lexer.is(TokenType::CloseCurly)) {
+                bool outer_poisoned = std::exchange(m_poisoned, false);
+                int32_t nesting_depth = m_nesting_depth;
+                int32_t parenthesis_depth = m_parenthesis_depth;
+                try {
+                        if (tok.type == TokenType::OpenCurly) {
+                                // ArrayExpr
+                                auto expr_symbol_data = parseArrayExpression();
+                                
+                                if (symbol_data.type == TokenType::INVALID || symbol_data.type == TokenType::ALL)
+                                        symbol_data.type = expr_symbol_data.type;
+                                
+                                // The first element's shape is taken over rather than copied, and only later elements are compared against
+                                // it, so each level of nesting costs the same however deep the literal goes
+                                if (symbol_data.sizes.empty())
+                                        symbol_data.sizes = std::move(expr_symbol_data.sizes);
+                                else if ((symbol_data.type != expr_symbol_data.type || !sizesAreEqual(symbol_data.sizes, expr_symbol_data.sizes)) && (expr_symbol_data.type != TokenType::ALL && symbol_data.type != TokenType::ALL))
+                                        error(std::format("Parsing Error(parseArrayExpression {}): Found expression of type {}{} in array literal of type {}{}", start.start + 1, Token::typeToString(expr_symbol_data.type), reverse_str(expr_symbol_data.sizes.begin(), expr_symbol_data.sizes.end()), Token::typeToString(symbol_data.type), str(symbol_data.sizes.begin(), symbol_data.sizes.end())), start.start + 1);
+                        } else {
+                                // BaseExpr, or a literal that is the whole element
+                                TokenType expr_type = literalElementType();
+                                if (expr_type == TokenType::INVALID)
+                                        expr_type = parseBaseExpression().type;
+                                else
+                                        m_lexer.eat();
+                                
+                                if (symbol_data.type == TokenType::INVALID || symbol_data.type == TokenType::ALL)
+                                        symbol_data.type = expr_type;
+                                else if (symbol_data.type != expr_type && expr_type != TokenType::ALL && symbol_data.type != TokenType::ALL)
+                                        error(std::format("Parsing Error(parseArrayExpression {}): Found expression of type {} in array literal of type {}", start.start + 1, Token::typeToString(expr_type), Token::typeToString(symbol_data.type)), start.start + 1);
+                        }
+                } catch (const CompileError& element_error) {
+                        if (m_errors == nullptr || m_lexer.atLexError())
+                                throw;
+                        if (!m_poisoned)
+                                record(element_error);
+                        if (m_errors->size() >= m_max_errors)
+                                throw Recovered{};
+                        m_nesting_depth = nesting_depth;
+                        m_parenthesis_depth = parenthesis_depth;
+                        skipElement();
+                        m_poisoned = true;
+                }
+                poisoned = poisoned || m_poisoned;
+                m_poisoned = outer_poisoned;
+                
+                size++;
+                
+                if (!m_lexer.is(TokenType::CloseCurly))
+                        start = m_lexer.eat(TokenType::Comma, "parseArrayExpression");
+        }
+        
+        m_lexer.eat(TokenType::CloseCurly, "parseArrayExpression");
+        
+        symbol_data.sizes.push_back(size);
+        m_nesting_depth--;
+        m_poisoned = m_poisoned || poisoned;
+        
+        if (size == 0) {
+                
+                return {TokenType::ALL, std::move(symbol_data.sizes)};
+        }
+        
+        
+        return symbol_data;
+}
+
+// Generated tables are array literals of millions of plain literals, each making up a whole element. The type of those is
+// known from the token alone, so they skip the expression chain. The chain would enter one more level of nesting, so at
+// the limit they still go through it to report the same error.
+constexpr pa::TokenType pa::Parser::literalElementType() {
+        TokenType type;
+        switch (m_lexer.peek().type) {
+                case TokenType::IntLiteral:
+                        type = TokenType::Int;
+                        break;
+                case TokenType::FloatLiteral:
+                        type = TokenType::Float;
+                        break;
+                case TokenType::StringLiteral:
+                        type = TokenType::String;
+                        break;
+                case TokenType::CharLiteral:
+                        type = TokenType::Char;
+                        break;
+                case TokenType::True:
+                case TokenType::False:
+                        type = TokenType::Bool;
+                        break;
+                default:
+                        return TokenType::INVALID;
+        }
+        
+        if (m_nesting_depth >= MaxNestingDepth || !m_lexer.nextIsListSeparator())
+                return TokenType::INVALID;
+        return type;
+}
+
+constexpr pa::Parser::SymbolData pa::Parser::parseBaseExpression() {
+        enterNesting("parseBaseExpression");
+        SymbolData symbol_data = parseNestedBaseExpression();
+        m_nesting_depth--;
+        return symbol_data;
+}
+
+constexpr pa::Parser::SymbolData pa::Parser::parseNestedBaseExpression() {
+        auto tok = m_lexer.peek(BaseExpressionStart, "parseBaseExpression");
+        switch (tok.type) {
+                // BaseExpression -> Identifier<Char> | CharLiteral
+                case TokenType::CharLiteral:
+                        m_lexer.eat(TokenType::CharLiteral, "parseBaseExpression");
+                        return {TokenType::Char, {1}};
+                case TokenType::Identifier:
+                        if (findSymbol(tok.toString(m_source)) == nullptr)
+                                undeclared("parseBaseExpression", tok);
+                        if (findSymbol(tok.toString(m_source))->type == TokenType::Char) {
+                                m_lexer.eat(TokenType::Identifier, "parseBaseExpression");
+                                return *findSymbol(tok.toString(m_source));
+                        }
+                                // BaseExpression -> BoolExpr
+                        else
+                                return parseBoolExpr();
+                case TokenType::True:
+                case TokenType::False:
+                case TokenType::IntLiteral:
+                case TokenType::FloatLiteral:
+                case TokenType::StringLiteral:
+                case TokenType::OpenParen:
+                case TokenType::Not:
+                        return parseBoolExpr();
+                default:
+                        error(std::format("How did we get here? parseBaseExpression {}\n", Token::typeToString(tok.type)));
+                        return {TokenType::INVALID};
+        }
+}
+
+constexpr pa::Parser::SymbolData pa::Parser::parseBoolExpr() {
+        return parseLogicalExpr();
+}
+
+// (( 1 + (4 + 1) ) >= (2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary
+// ( 1 + (4 + 1) ) >= (2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary
+// 1 + (4 + 1) ) >= (2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic
+// (4 + 1) ) >= (2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary
+// 4 + 1) ) >= (2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic
+// ) ) >= (2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic
+// ) >= (2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic
+// >= (2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison
+// (2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary
+// 2 + 4)) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic
+// )) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic -> parsePrimary -> parseExpression -> parseLogical -> parseComparison -> parseArithmetic
+// ) && False
+// parseExpression -> parseLogical -> parseComparison -> parseArithmetic
+// && False
+// parseExpression
+//
+
+constexpr pa::Parser::SymbolData pa::Parser::parseLogicalExpr() {
+        auto current_pos = m_lexer.peek().start;
+        SymbolData symbol_data = parseComparisonExpr();
+        
+        while (m_lexer.is({TokenType::And, TokenType::Or})) {
+                if (symbol_data.type == TokenType::String)
+                        error(std::format("Parsing Error(parseLogicalExpr {}): Trying to perform logical operation on string.", current_pos), current_pos);
+                
+                symbol_data.type = TokenType::Bool;
+                m_lexer.eat({TokenType::And, TokenType::Or}, "parseLogical");
+                
+                symbol_data.sizes = elementwiseSizes(symbol_data, parseComparisonExpr(), "parseLogicalExpr", current_pos);
+        }
+        
+        return symbol_data;
+}
+
+constexpr pa::Parser::SymbolData pa::Parser::parseComparisonExpr() {
+        auto current_pos = m_lexer.peek().start;
+        SymbolData symbol_data = parseArithmeticExpr();
+        
+        while (m_lexer.is(ComparisonOperators)) {
+                if (symbol_data.type == TokenType::String)
+                        error(std::format("Parsing Error(parseComparisonExpr {}): Trying to perform comparison operation on string.", current_pos), current_pos);
+                
+                symbol_data.type = TokenType::Bool;
+                m_lexer.eat(ComparisonOperators, "parseComparison");
+                
+                symbol_data.sizes = elementwiseSizes(symbol_data, parseArithmeticExpr(), "parseComparisonExpr", current_pos);
+        }
+        
+        return symbol_data;
+}
+
+constexpr pa::Parser::SymbolData pa::Parser::parseArithmeticExpr() {
+        auto current_pos = m_lexer.peek().start;
+        SymbolData symbol_data = parsePrimaryExpr();
+        SymbolData curr_symbol_data = symbol_data;
+        
+        // Bool            -> Bool
+        // Int             -> Int
+        // Float           -> Float
+        // String          -> String
+        // String + String -> String
+        
+        // Bool op Bool    -> Int
+        // Bool op Int     -> Int
+        // Int op Int      -> Int
+        
+        // Bool op Float   -> Float
+        // Int op Float    -> Float
+        // Float op Float  -> Float
+        
+        // Turns Bool | Int -> Int on arithmetic operation
+        if (m_lexer.is(ArithmeticOperators) && curr_symbol_data.type != TokenType::Float && curr_symbol_data.type != TokenType::String)
+                curr_symbol_data.type = TokenType::Int;
+        
+        while (m_lexer.is(ArithmeticOperators)) {
+                // Only allows + for String
+                if (curr_symbol_data.type == TokenType::String && !m_lexer.is(TokenType::Plus))
+                        error(std::format("Parsing Error(parseArithmeticExpr {}): Trying to perform non-plus arithmetic operation on string.", current_pos), current_pos);
+                
+                m_lexer.eat(ArithmeticOperators, "parseArithmetic");
+                SymbolData rhs_symbol_data = parsePrimaryExpr();
+                
+                // Only allows for String + String
+                if (curr_symbol_data.type == TokenType::String && rhs_symbol_data.type != TokenType::String)
+                        error(std::format("Parsing Error(parseArithmeticExpr {}): Trying to append non-string to string.", current_pos), current_pos);
+                
+                symbol_data.sizes = elementwiseSizes(symbol_data, rhs_symbol_data, "parseArithmeticExpr", current_pos);
+                
+                // Turns expression into float if a single float is encountered
+                if (rhs_symbol_data.type == TokenType::Float)
+                        symbol_data.type = TokenType::Float;
+                
+                curr_symbol_data = rhs_symbol_data;
+        }
+        
+        return symbol_data;
+}
+
+constexpr pa::Parser::SymbolData pa::Parser::parsePrimaryExpr() {
+        if (m_lexer.is(TokenType::Not)) {
+                auto not_token = m_lexer.eat(TokenType::Not, "parsePrimary");
+                if (!m_lexer.is({TokenType::Identifier, TokenType::True, TokenType::False, TokenType::OpenParen}))
+                        error(std::format("Parsing Error(parsePrimaryExpr {}): Performing Not operation on type {} is not valid", not_token.start, Token::typeToString((m_lexer.eat().type))), not_token.start);
+                
+                if (m_lexer.is(TokenType::Identifier)) {
+                        auto possible_boolean_identifier_token = m_lexer.peek(TokenType::Identifier, "parsePrimary");
+                        if (possible_boolean_identifier_token.type != TokenType::Bool) {
+                                error(std::format("Parsing Error(parsePrimaryExpr {}): Performing Not operation on type {} is not valid", not_token.start, Token::typeToString((m_lexer.eat().type))), not_token.start);
+                        } else {
+                                m_lexer.eat(TokenType::Identifier, "parsePrimary");
+                                return {TokenType::Bool, {1}};
+                        }
+                } else if (m_lexer.is({TokenType::True, TokenType::False})){
+                        m_lexer.eat({TokenType::True, TokenType::False}, "parsePrimary");
+                        return {TokenType::Bool, {1}};
+                } else {
+                        consumeOpenParen();
+                        auto expr_tok = parseBaseExpression();
+                        consumeCloseParen();
+                        if (expr_tok.type != TokenType::Bool)
+                                error(std::format("Parsing Error(parsePrimaryExpr {}): Performing Not operation on type {} is not valid", not_token.start, Token::typeToString((expr_tok.type))), not_token.start);
+                        else
+                                return {TokenType::Bool, {1}};
+                
+                }
+        
+        }
+        
+        
+        auto tok = m_lexer.peek({TokenType::OpenParen, TokenType::Identifier, TokenType::IntLiteral, TokenType::FloatLiteral, TokenType::True, TokenType::False, TokenType::StringLiteral}, "parsePrimary");
+        
+        SymbolData symbol_data = {TokenType::INVALID, {1}};
+        
+        switch (tok.type) {
+                // Identifier<Int> | Identifier<Float> | Identifier<Bool>
+                case TokenType::Identifier:
+                        m_lexer.eat(TokenType::Identifier, "parsePrimary");
+                        
+                        if (findSymbol(tok.toString(m_source)) == nullptr)
+                                undeclared("parsePrimaryExpr", tok);
+                        
+                        symbol_data = *findSymbol(tok.toString(m_source));
+                        
+                        if (symbol_data.type != TokenType::Int && symbol_data.type != TokenType::Float && symbol_data.type != TokenType::Bool && symbol_data.type != TokenType::String)
+                                error(std::format("Parsing Error(parsePrimaryExpr {}): Expected variable of type Int | Float | Bool | String, got type {} instead.", tok.start, Token::typeToString(symbol_data.type)), tok.start);
+                        
+                        break;
+                        
+                        // ( Expression )
+                case TokenType::OpenParen:
+                        consumeOpenParen();
+                        symbol_data = parseBaseExpression();
+                        consumeCloseParen();
+                        break;
+                        
+                        
+                        // NumLiteral
+                case TokenType::IntLiteral:
+                        m_lexer.eat(TokenType::IntLiteral, "parsePrimary");
+                        symbol_data = {TokenType::Int, {1}};
+                        break;
+                case TokenType::FloatLiteral:
+                        m_lexer.eat(TokenType::FloatLiteral, "parsePrimary");
+                        symbol_data = {TokenType::Float, {1}};
+                        break;
+                case TokenType::StringLiteral:
+                        m_lexer.eat(TokenType::StringLiteral, "parsePrimary");
+                        symbol_data = {TokenType::String, {1}};
+                        break;
+                        
+                        // BooleanLiteral
+                case TokenType::True:
+                case TokenType::False:
+                        m_lexer.eat({TokenType::True, TokenType::False}, "parsePrimary");
+                        symbol_data = {TokenType::Bool, {1}};
+                        break;
+        }
+        
+        return symbol_data;
+}
+
+
+// Errors leave the depth unbalanced, which is fine since a Parser is only used again after a reset
+constexpr void pa::Parser::enterNesting(const std::string_view rule_name) {
+        if (++m_nesting_depth > MaxNestingDepth)
+                error(std::format("Parsing Error({} {}): Expression nested more than {} levels deep.", rule_name, m_lexer.peek().start, MaxNestingDepth), m_lexer.peek().start);
+}
+
+// The rule names are spelled out whole, rather than built for every parenthesis
+constexpr void pa::Parser::consumeOpenParen() {
+        m_lexer.eat(TokenType::OpenParen, "parsePrimary -> consumeOpenParen");
+        m_parenthesis_depth++;
+}
+constexpr void pa::Parser::consumeCloseParen() {
+        m_lexer.eat(TokenType::CloseParen, "parsePrimary -> consumeCloseParen");
+        m_parenthesis_depth--;
+}
+
+
+// Turns a literal type into a regular type (regular types passed in return themselves)
+constexpr pa::TokenType pa::Parser::deLiteralType(pa::TokenType type) {
+        switch (type) {
+                case TokenType::IntLiteral:
+                case TokenType::Int:
+                        return TokenType::Int;
+                case TokenType::Bool:
+                case TokenType::True:
+                case TokenType::False:
+                        return TokenType::Bool;
+                case TokenType::Float:
+                case TokenType::FloatLiteral:
+                        return TokenType::Float;
+                case TokenType::Char:
+                case TokenType::CharLiteral:
+                        return TokenType::Char;
+                case TokenType::String:
+                case TokenType::StringLiteral:
+                        return TokenType::String;
+                
+                case TokenType::IntArray:
+                        return TokenType::IntArray;
+                case TokenType::BoolArray:
+                        return TokenType::BoolArray;
+                case TokenType::FloatArray:
+                        return TokenType::FloatArray;
+                case TokenType::CharArray:
+                        return TokenType::CharArray;
+                case TokenType::StringArray:
+                        return TokenType::StringArray;
+                
+                default:
+                        return TokenType::INVALID;
+        }
+}
+
+constexpr void pa::Parser::validateAssignment(pa::Token token, pa::Parser::SymbolData symbol_data) {
+        if (findSymbol(token.toString(m_source)) == nullptr)
+                undeclared("validateAssignment", token);
+        
+        auto target_symbol_data = *findSymbol(token.toString(m_source));
+        
+        if ((target_symbol_data.type != deLiteralType(symbol_data.type) || !sizesAreEqual(target_symbol_data.sizes, symbol_data.sizes)) && symbol_data.type != TokenType::ALL) {
+                error(std::format("Parsing Error(validateAssignment {}): R-value of type ({}, {}) assigned to variable '{}' of type ({}, {}).",
+                                  token.start,
+                                  Token::typeToString(deLiteralType(symbol_data.type)),
+                                  str(symbol_data.sizes.begin(), symbol_data.sizes.end()),
+                                  token.toString(m_source),
+                                  Token::typeToString(target_symbol_data.type),
+                                  str(target_symbol_data.sizes.begin(), target_symbol_data.sizes.end())), token.start);
+        }
+}
+constexpr bool pa::Parser::identifierIsType(pa::Token token, const pa::Parser::SymbolData& symbol_data) {
+        if (findSymbol(token.toString(m_source)) == nullptr)
+                return false;
+        
+        auto target_symbol_data = *findSymbol(token.toString(m_source));
+        
+        if (target_symbol_data.type != deLiteralType(symbol_data.type) || target_symbol_data.sizes != symbol_data.sizes)
+                return false;
+        
+        return true;
+}
+
+constexpr const pa::Parser::SymbolData* pa::Parser::findSymbol(const std::string_view name) {
+        if (m_declarations != nullptr)
+                return m_declarations->find(name, m_statement_index);
+        
+        const SymbolData* symbol_data = m_symbol_table.find(name);
+        if (symbol_data != nullptr && symbol_data->poisoned)
+                m_poisoned = true;
+        return symbol_data;
+}
+
+
+constexpr void pa::Parser::DeclarationIndex::add(const std::string_view name, const size_t statement_index, const pa::Parser::SymbolData& symbol_data) {
+        m_declarations[name].push_back({statement_index, symbol_data});
+}
+
+constexpr const pa::Parser::SymbolData* pa::Parser::DeclarationIndex::find(const std::string_view name, const size_t statement_index) const {
+        auto declarations = m_declarations.find(name);
+        if (declarations == nullptr)
+                return nullptr;
+        
+        // The latest declaration made by an earlier statement, which is what the symbol table would hold at this point
+        auto after = std::lower_bound(declarations->begin(), declarations->end(), statement_index, [](const Declaration& declaration, size_t index) {
+                return declaration.statement_index < index;
+        });
+        return after == declarations->begin() ? nullptr : &(after - 1)->symbol_data;
+}
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include "program.h"
+#include "hash.h"
+#include "version.h"
+
+static_assert(std::is_trivially_copyable_v<pa::Token>, "Tokens are mapped straight out of precompiled programs");
+// Records are written byte for byte, so any padding in them would make the output differ between identical inputs
+static_assert(std::has_unique_object_representations_v<pa::Token>, "Tokens are written without padding");
+static_assert(std::has_unique_object_representations_v<pa::PrecompiledProgram::Symbol>, "Symbols are written without padding");
+static_assert(std::has_unique_object_representations_v<pa::PrecompiledProgram::Slice>, "Slices are written without padding");
+static_assert(pa::CompilerVersion.size() < sizeof(pa::PrecompiledProgram::Header::compiler_version));
+
+// Appends count values to the buffer at the next 8 byte boundary and returns where they went
+template<typename T>
+static pa::PrecompiledProgram::Section appendSection(std::string& buffer, const T* values, size_t count) {
+        buffer.resize((buffer.size() + 7) & ~size_t(7));
+        pa::PrecompiledProgram::Section section = {buffer.size(), count};
+        buffer.append(reinterpret_cast<const char*>(values), count * sizeof(T));
+        return section;
+}
+
+// How many constants of the kind a token of type indexes the file holds
+static uint64_t constantCount(const pa::PrecompiledProgram::Header& header, const pa::TokenType type) {
+        switch (type) {
+                case pa::TokenType::IntLiteral:
+                case pa::TokenType::Array:
+                        return header.ints.count;
+                case pa::TokenType::FloatLiteral:
+                        return header.floats.count;
+                case pa::TokenType::CharLiteral:
+                        return header.chars.count;
+                case pa::TokenType::StringLiteral:
+                        return header.string_constants.count;
+                default:
+                        return 0;
+        }
+}
+
+
+bool pa::PrecompiledProgram::write(const char* filepath, const std::string_view src, const std::span<const pa::Token> tokens, const pa::ConstantPool& constants, const pa::Parser::SymbolTable& symbol_table) {
+        Sections sections = collectSections(constants, symbol_table);
+        
+        Header header{};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.format_version = FormatVersion;
+        header.token_size = sizeof(Token);
+        std::memcpy(header.compiler_version, CompilerVersion.data(), CompilerVersion.size());
+        header.source_hash = pa::hashBytes(src);
+        header.source_size = src.size();
+        
+        std::string buffer(sizeof(Header), '\0');
+        header.tokens = appendSection(buffer, tokens.data(), tokens.size());
+        header.symbols = appendSection(buffer, sections.symbols.data(), sections.symbols.size());
+        header.sizes = appendSection(buffer, sections.sizes.data(), sections.sizes.size());
+        header.ints = appendSection(buffer, constants.ints().data(), constants.ints().size());
+        header.floats = appendSection(buffer, constants.floats().data(), constants.floats().size());
+        header.chars = appendSection(buffer, constants.chars().data(), constants.chars().size());
+        header.string_constants = appendSection(buffer, sections.string_constants.data(), sections.string_constants.size());
+        header.strings = appendSection(buffer, sections.strings.data(), sections.strings.size());
+        std::memcpy(buffer.data(), &header, sizeof(Header));
+        
+        return io::writeFileAtomic(filepath, buffer);
+}
+
+std::optional<pa::PrecompiledProgram> pa::PrecompiledProgram::map(const char* filepath, const std::string_view src) {
+        io::MappedFile file(filepath);
+        if (!file.isOpen() || file.bytes().size() < sizeof(Header))
+                return std::nullopt;
+        
+        Header header;
+        std::memcpy(&header, file.bytes().data(), sizeof(Header));
+        
+        char compiler_version[sizeof(header.compiler_version)] = {};
+        std::memcpy(compiler_version, CompilerVersion.data(), CompilerVersion.size());
+        
+        if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+            || header.format_version != FormatVersion
+            || header.token_size != sizeof(Token)
+            || std::memcmp(header.compiler_version, compiler_version, sizeof(compiler_version)) != 0)
+                return std::nullopt;
+        
+        if (header.source_size != src.size() || header.source_hash != pa::hashBytes(src))
+                return std::nullopt;
+        
+        // Every section has to lie within the file, aligned for its element type
+        auto fits = [size = file.bytes().size()](const Section& section, size_t element_size) {
+                return section.offset % 8 == 0 && section.offset <= size && section.count <= (size - section.offset) / element_size;
+        };
+        if (!fits(header.tokens, sizeof(Token)) || !fits(header.symbols, sizeof(Symbol)) || !fits(header.sizes, sizeof(uint64_t))
+            || !fits(header.ints, sizeof(int64_t)) || !fits(header.floats, sizeof(double)) || !fits(header.chars, 1)
+            || !fits(header.string_constants, sizeof(Slice)) || !fits(header.strings, 1))
+                return std::nullopt;
+        
+        // Written as subtractions so that offsets near the top of the range can't wrap around
+        auto within = [](const uint64_t offset, const uint64_t count, const uint64_t limit) { return offset <= limit && count <= limit - offset; };
+        PrecompiledProgram program(std::move(file));
+        for (const auto& symbol: program.symbols())
+                if (!within(symbol.name_offset, symbol.name_size, header.strings.count) || !within(symbol.sizes_offset, symbol.sizes_count, header.sizes.count))
+                        return std::nullopt;
+        for (const auto& string_constant: program.section<Slice>(header.string_constants))
+                if (!within(string_constant.offset, string_constant.size, header.strings.count))
+                        return std::nullopt;
+        
+        // The tokens go to the backends as they are, so each has to be one a checked program can hold, lie within the
+        // source and index a constant the pool has, and the last has to be the Eof token
+        auto tokens = program.tokens();
+        if (tokens.empty() || tokens.back().type != TokenType::Eof)
+                return std::nullopt;
+        for (const Token& token: tokens) {
+                if (std::to_underlying(token.type) < 0 || std::to_underlying(token.type) > std::to_underlying(TokenType::Eof)
+                    || token.start > token.end || token.end > src.size())
+                        return std::nullopt;
+                if (ConstantPool::hasConstant(token.type) && token.constant >= constantCount(header, token.type))
+                        return std::nullopt;
+        }
+        
+        return program;
+}
+
+
+std::span<const pa::Token> pa::PrecompiledProgram::tokens() const {
+        return section<Token>(header().tokens);
+}
+std::span<const pa::PrecompiledProgram::Symbol> pa::PrecompiledProgram::symbols() const {
+        return section<Symbol>(header().symbols);
+}
+
+const pa::PrecompiledProgram::Symbol* pa::PrecompiledProgram::findSymbol(const std::string_view name) const {
+        auto symbols = this->symbols();
+        auto symbol = std::lower_bound(symbols.begin(), symbols.end(), name, [this](const Symbol& symbol, std::string_view name) {
+                return this->name(symbol) < name;
+        });
+        return symbol != symbols.end() && this->name(*symbol) == name ? &*symbol : nullptr;
+}
+
+std::string_view pa::PrecompiledProgram::name(const pa::PrecompiledProgram::Symbol& symbol) const {
+        return {m_file.bytes().data() + header().strings.offset + symbol.name_offset, symbol.name_size};
+}
+
+std::span<const uint64_t> pa::PrecompiledProgram::sizes(const pa::PrecompiledProgram::Symbol& symbol) const {
+        return section<uint64_t>(header().sizes).subspan(symbol.sizes_offset, symbol.sizes_count);
+}
+
+std::span<const int64_t> pa::PrecompiledProgram::ints() const {
+        return section<int64_t>(header().ints);
+}
+std::span<const double> pa::PrecompiledProgram::floats() const {
+        return section<double>(header().floats);
+}
+std::span<const char> pa::PrecompiledProgram::chars() const {
+        return section<char>(header().chars);
+}
+std::string_view pa::PrecompiledProgram::stringValue(const uint32_t index) const {
+        const Slice& slice = section<Slice>(header().string_constants)[index];
+        return {m_file.bytes().data() + header().strings.offset + slice.offset, slice.size};
+}
+
+pa::ConstantPool pa::PrecompiledProgram::constants() const {
+        // Each section holds distinct values in the order they were first added, so adding them again gives the same indices
+        ConstantPool constants;
+        for (int64_t value: ints())
+                constants.addInt(value);
+        for (double value: floats())
+                constants.addFloat(value);
+        for (char value: chars())
+                constants.addChar(value);
+        for (uint32_t i = 0; i < header().string_constants.count; i++)
+                constants.addString(stringValue(i));
+        return constants;
+}
+
+const pa::PrecompiledProgram::Header& pa::PrecompiledProgram::header() const {
+        return *reinterpret_cast<const Header*>(m_file.bytes().data());
+}
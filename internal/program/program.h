@@ -0,0 +1,139 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "io.h"
+#include "parser.h"
+
+// A checked program serialised so it can be mapped and used in place, without re-running the Lexer and Parser.
+// Every section is 8 byte aligned and read straight out of the mapping:
+//   Header
+//   Token[]    the token buffer, laid out exactly as pa::Token so a Parser can replay it directly
+//   Symbol[]   the final symbol table, sorted by name
+//   uint64_t[] array extents, each symbol owning a contiguous run
+//   int64_t[]  the constant pool, one section per kind in the order the Lexer decoded them, indexed by Token::constant
+//   double[]
+//   char[]
+//   Slice[]    decoded string constants
+//   char[]     interned symbol names and string constants
+// Files written by a different compiler version, or for different source bytes, are rejected when mapped, as are those
+// with a section, symbol or token pointing outside the file, the source or the constant pool.
+
+namespace pa {
+        class PrecompiledProgram {
+        public: // Static Data
+                static constexpr char Magic[8] = {'P', 'A', 'P', 'R', 'O', 'G', '\0', '\0'};
+                static constexpr uint32_t FormatVersion = 2;
+                
+                struct Section {
+                        uint64_t offset;
+                        uint64_t count;
+                };
+                
+                struct Header {
+                        char magic[8];
+                        uint32_t format_version;
+                        uint32_t token_size;
+                        char compiler_version[16];
+                        uint64_t source_hash;
+                        uint64_t source_size;
+                        Section tokens;
+                        Section symbols;
+                        Section sizes;
+                        Section ints;
+                        Section floats;
+                        Section chars;
+                        Section string_constants;
+                        Section strings;
+                };
+                
+                struct Symbol {
+                        uint64_t name_offset;
+                        uint32_t name_size;
+                        TokenType type;
+                        uint64_t sizes_offset;
+                        uint64_t sizes_count;
+                };
+                
+                struct Slice {
+                        uint64_t offset;
+                        uint64_t size;
+                };
+                
+                // The sections derived from the symbol table and string constants, the rest are copied as they are
+                struct Sections {
+                        std::vector<Symbol> symbols;
+                        std::vector<uint64_t> sizes;
+                        std::vector<Slice> string_constants;
+                        std::string strings;
+                };
+        public: // Constructors/Destructors/Overloads
+                // Maps filepath, returning nothing if it is missing, malformed or stale for src
+                static std::optional<PrecompiledProgram> map(const char* filepath, std::string_view src);
+                
+                static bool write(const char* filepath, std::string_view src, std::span<const Token> tokens, const ConstantPool& constants, const Parser::SymbolTable& symbol_table);
+                
+                // Also used to lay out pa::EmbeddedProgram, which is why it is constexpr
+                static constexpr Sections collectSections(const ConstantPool& constants, const Parser::SymbolTable& symbol_table);
+        public: // Public Member Functions
+                [[nodiscard]] std::span<const Token> tokens() const;
+                [[nodiscard]] std::span<const Symbol> symbols() const;
+                
+                [[nodiscard]] const Symbol* findSymbol(std::string_view name) const;
+                [[nodiscard]] std::string_view name(const Symbol& symbol) const;
+                [[nodiscard]] std::span<const uint64_t> sizes(const Symbol& symbol) const;
+                
+                [[nodiscard]] std::span<const int64_t> ints() const;
+                [[nodiscard]] std::span<const double> floats() const;
+                [[nodiscard]] std::span<const char> chars() const;
+                [[nodiscard]] std::string_view stringValue(uint32_t index) const;
+                // The constant pool decoded back out of the mapping, each constant at the index its tokens refer to, for the
+                // backends that walk the tokens again
+                [[nodiscard]] ConstantPool constants() const;
+        
+        public: // Public Member Variables
+        private: // Private Member Functions
+                explicit PrecompiledProgram(io::MappedFile file) : m_file(std::move(file)) {};
+                
+                [[nodiscard]] const Header& header() const;
+                template<typename T>
+                [[nodiscard]] std::span<const T> section(const Section& section) const {
+                        return {reinterpret_cast<const T*>(m_file.bytes().data() + section.offset), section.count};
+                }
+        private: // Private Member Variables
+                io::MappedFile m_file;
+        };
+}
+
+constexpr pa::PrecompiledProgram::Sections pa::PrecompiledProgram::collectSections(const pa::ConstantPool& constants, const pa::Parser::SymbolTable& symbol_table) {
+        Sections sections;
+        
+        // Sorted so lookups can binary search the mapping
+        std::vector<const Parser::SymbolTable::Entry*> sorted_symbols;
+        for (const auto& entry: symbol_table)
+                sorted_symbols.push_back(&entry);
+        std::sort(sorted_symbols.begin(), sorted_symbols.end(), [](auto l, auto r) { return l->first < r->first; });
+        
+        for (const auto* entry: sorted_symbols) {
+                // Value-initialised first, so that any padding a later layout gains is written out as zeroes
+                Symbol symbol{};
+                symbol.name_offset = sections.strings.size();
+                symbol.name_size = static_cast<uint32_t>(entry->first.size());
+                symbol.type = entry->second.type;
+                symbol.sizes_offset = sections.sizes.size();
+                symbol.sizes_count = entry->second.sizes.size();
+                sections.symbols.push_back(symbol);
+                sections.strings += entry->first;
+                sections.sizes.insert(sections.sizes.end(), entry->second.sizes.begin(), entry->second.sizes.end());
+        }
+        
+        for (const auto& value: constants.strings()) {
+                sections.string_constants.push_back({sections.strings.size(), value.size()});
+                sections.strings += value;
+        }
+        
+        return sections;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+namespace pa {
+        // Vector that keeps up to InlineCapacity elements inside itself and only moves them to the heap past that, so the
+        // small sequences built and copied on every expression (such as array extents) cost no allocation.
+        // Usable in a constant expression like std::vector. Once on the heap it stays there until cleared.
+        template<typename T, size_t InlineCapacity>
+        class SmallVector {
+        public: // Constructors/Destructors/Overloads
+                constexpr SmallVector() = default;
+                constexpr SmallVector(std::initializer_list<T> values) {
+                        for (const T& value: values)
+                                push_back(value);
+                }
+                
+                [[nodiscard]] constexpr bool operator==(const SmallVector& other) const { return std::equal(begin(), end(), other.begin(), other.end()); }
+        public: // Public Member Functions
+                constexpr void push_back(const T& value) {
+                        if (!m_heap.empty())
+                                m_heap.push_back(value);
+                        else if (m_size < InlineCapacity)
+                                m_inline[m_size++] = value;
+                        else {
+                                m_heap.reserve(InlineCapacity * 2);
+                                m_heap.assign(m_inline, m_inline + m_size);
+                                m_heap.push_back(value);
+                        }
+                }
+                
+                // Keeps the heap memory, if any, but goes back to storing elements inline
+                constexpr void clear() {
+                        m_heap.clear();
+                        m_size = 0;
+                }
+                
+                [[nodiscard]] constexpr size_t size() const { return m_heap.empty() ? m_size : m_heap.size(); }
+                [[nodiscard]] constexpr bool empty() const { return size() == 0; }
+                
+                [[nodiscard]] constexpr T* data() { return m_heap.empty() ? m_inline : m_heap.data(); }
+                [[nodiscard]] constexpr const T* data() const { return m_heap.empty() ? m_inline : m_heap.data(); }
+                [[nodiscard]] constexpr T* begin() { return data(); }
+                [[nodiscard]] constexpr T* end() { return data() + size(); }
+                [[nodiscard]] constexpr const T* begin() const { return data(); }
+                [[nodiscard]] constexpr const T* end() const { return data() + size(); }
+                
+                [[nodiscard]] constexpr T& operator[](size_t index) { return data()[index]; }
+                [[nodiscard]] constexpr const T& operator[](size_t index) const { return data()[index]; }
+                [[nodiscard]] constexpr const T& front() const { return data()[0]; }
+                [[nodiscard]] constexpr const T& back() const { return data()[size() - 1]; }
+        private: // Private Member Variables
+                T m_inline[InlineCapacity]{};
+                size_t m_size{0}; // Of m_inline, only meaningful while m_heap is empty
+                std::vector<T> m_heap;
+        };
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <span>
+
+namespace pa {
+        // Bounded lock-free queue between exactly one producer thread and one consumer thread.
+        // Items move in batches: each side copies as many as it can and then publishes them with a single store of its
+        // index, so the two threads only meet on one cache line per batch instead of once per item. The indices sit on
+        // separate cache lines so that one side advancing doesn't invalidate the line the other side is writing.
+        // A side that has to wait (the producer on a full ring, the consumer on an empty one) sleeps on the other side's
+        // index. The producer closes the ring when it has nothing more to send, and the consumer cancels it when it
+        // wants nothing more, both by setting the top bit of their index so that a sleeping peer wakes up.
+        template<typename T, size_t Capacity>
+        class SpscRing {
+                static_assert(std::has_single_bit(Capacity), "Capacity has to be a power of two");
+        public: // Static Data
+                static constexpr size_t StopBit = size_t(1) << (sizeof(size_t) * 8 - 1);
+        public: // Public Member Functions
+                // Producer side: blocks until every item is in the ring, returns false instead if the consumer cancelled
+                bool push(std::span<const T> items);
+                // Producer side: no more items will be pushed
+                void close();
+                
+                // Consumer side: blocks until any items are available and moves up to out.size() of them into out, returns
+                // how many it moved, which is 0 only once the ring is closed and empty
+                size_t pop(std::span<T> out);
+                // Consumer side: no more items will be popped, so a producer waiting on a full ring gives up
+                void cancel();
+                
+        public: // Public Member Variables
+        private: // Private Member Variables
+                alignas(64) std::atomic<size_t> m_head{0}; // Next item to pop, only written by the consumer
+                alignas(64) std::atomic<size_t> m_tail{0}; // Next free slot, only written by the producer
+                alignas(64) std::array<T, Capacity> m_slots{};
+        };
+}
+
+template<typename T, size_t Capacity>
+bool pa::SpscRing<T, Capacity>::push(std::span<const T> items) {
+        while (!items.empty()) {
+                size_t tail = m_tail.load(std::memory_order_relaxed);
+                size_t head = m_head.load(std::memory_order_acquire);
+                if (head & StopBit)
+                        return false;
+                
+                size_t free = Capacity - (tail - head);
+                if (free == 0) {
+                        m_head.wait(head, std::memory_order_acquire);
+                        continue;
+                }
+                
+                size_t count = std::min(free, items.size());
+                for (size_t i = 0; i < count; i++)
+                        m_slots[(tail + i) & (Capacity - 1)] = items[i];
+                m_tail.store(tail + count, std::memory_order_release);
+                m_tail.notify_one();
+                items = items.subspan(count);
+        }
+        return true;
+}
+
+template<typename T, size_t Capacity>
+void pa::SpscRing<T, Capacity>::close() {
+        m_tail.fetch_or(StopBit, std::memory_order_release);
+        m_tail.notify_one();
+}
+
+template<typename T, size_t Capacity>
+size_t pa::SpscRing<T, Capacity>::pop(std::span<T> out) {
+        while (true) {
+                size_t head = m_head.load(std::memory_order_relaxed);
+                size_t tail = m_tail.load(std::memory_order_acquire);
+                
+                size_t available = (tail & ~StopBit) - head;
+                if (available == 0) {
+                        if (tail & StopBit)
+                                return 0;
+                        m_tail.wait(tail, std::memory_order_acquire);
+                        continue;
+                }
+                
+                size_t count = std::min(available, out.size());
+                for (size_t i = 0; i < count; i++)
+                        out[i] = m_slots[(head + i) & (Capacity - 1)];
+                m_head.store(head + count, std::memory_order_release);
+                m_head.notify_one();
+                return count;
+        }
+}
+
+template<typename T, size_t Capacity>
+void pa::SpscRing<T, Capacity>::cancel() {
+        m_head.fetch_or(StopBit, std::memory_order_release);
+        m_head.notify_one();
+}
@@ -0,0 +1,158 @@
+#include <charconv>
+#include <format>
+#include "table.h"
+
+pa::Table::Table(const char* path, const pa::TokenType element_type, const std::span<const size_t> extents)
+        : m_element_type(element_type), m_file(path) {
+        if (!m_file.isOpen()) {
+                m_error = std::format("'{}' could not be opened, or is empty.", path);
+                return;
+        }
+        
+        size_t element_count = 1;
+        for (size_t extent: extents)
+                element_count *= extent;
+        
+        if (std::string_view(path).ends_with(".bin"))
+                loadBinary(path, element_count);
+        else
+                loadCsv(path, extents);
+}
+
+
+std::span<const int64_t> pa::Table::ints() const {
+        if (m_binary)
+                return {reinterpret_cast<const int64_t*>(m_file.bytes().data()), m_file.bytes().size() / sizeof(int64_t)};
+        return m_ints;
+}
+
+std::span<const double> pa::Table::floats() const {
+        if (m_binary)
+                return {reinterpret_cast<const double*>(m_file.bytes().data()), m_file.bytes().size() / sizeof(double)};
+        return m_floats;
+}
+
+std::span<const char> pa::Table::chars() const {
+        if (m_binary)
+                return m_file.bytes();
+        return m_chars;
+}
+
+
+void pa::Table::loadBinary(const std::string_view path, const size_t element_count) {
+        size_t element_size;
+        switch (m_element_type) {
+                case TokenType::Int:
+                        element_size = sizeof(int64_t);
+                        break;
+                case TokenType::Float:
+                        element_size = sizeof(double);
+                        break;
+                case TokenType::Char:
+                case TokenType::Bool:
+                        element_size = 1;
+                        break;
+                default:
+                        m_error = std::format("{} arrays can only be loaded from CSV, not from '{}'.", Token::typeToString(m_element_type), path);
+                        return;
+        }
+        
+        // The mapping is page aligned, so the elements can be read in place
+        if (m_file.bytes().size() != element_count * element_size) {
+                m_error = std::format("'{}' holds {} bytes, but {} elements of type {} take {}.", path, m_file.bytes().size(), element_count, Token::typeToString(m_element_type), element_count * element_size);
+                return;
+        }
+        m_binary = true;
+}
+
+void pa::Table::loadCsv(const std::string_view path, const std::span<const size_t> extents) {
+        size_t rows = extents.empty() ? 1 : extents.front();
+        size_t fields_per_row = 1;
+        for (size_t extent: extents.subspan(std::min<size_t>(extents.size(), 1)))
+                fields_per_row *= extent;
+        
+        std::string_view bytes = m_file.bytes();
+        size_t row = 0;
+        while (!bytes.empty()) {
+                size_t line_end = bytes.find('\n');
+                std::string_view line = bytes.substr(0, line_end);
+                bytes = line_end == std::string_view::npos ? std::string_view() : bytes.substr(line_end + 1);
+                if (line.ends_with('\r'))
+                        line.remove_suffix(1);
+                
+                // Blank lines are only allowed at the end
+                if (line.find_first_not_of(" \t") == std::string_view::npos && bytes.find_first_not_of(" \t\r\n") == std::string_view::npos)
+                        break;
+                
+                if (++row > rows) {
+                        m_error = std::format("'{}' has more than the {} lines its first extent allows.", path, rows);
+                        return;
+                }
+                
+                size_t fields = 0;
+                while (true) {
+                        size_t comma = line.find(',');
+                        std::string_view field = line.substr(0, comma);
+                        
+                        if (++fields > fields_per_row) {
+                                m_error = std::format("'{}' line {}: Expected {} fields, found more.", path, row, fields_per_row);
+                                return;
+                        }
+                        if (!parseField(field)) {
+                                m_error = std::format("'{}' line {} field {}: '{}' is not a valid {}.", path, row, fields, field, Token::typeToString(m_element_type));
+                                return;
+                        }
+                        
+                        if (comma == std::string_view::npos)
+                                break;
+                        line.remove_prefix(comma + 1);
+                }
+                
+                if (fields != fields_per_row) {
+                        m_error = std::format("'{}' line {}: Expected {} fields, found {}.", path, row, fields_per_row, fields);
+                        return;
+                }
+        }
+        
+        if (row != rows)
+                m_error = std::format("'{}' has {} lines, but its first extent is {}.", path, row, rows);
+}
+
+bool pa::Table::parseField(std::string_view field) {
+        size_t begin = field.find_first_not_of(" \t");
+        field = begin == std::string_view::npos ? std::string_view() : field.substr(begin, field.find_last_not_of(" \t") - begin + 1);
+        
+        switch (m_element_type) {
+                case TokenType::Int: {
+                        int64_t value;
+                        auto [end, error] = std::from_chars(field.begin(), field.end(), value);
+                        if (error != std::errc() || end != field.end())
+                                return false;
+                        m_ints.push_back(value);
+                        return true;
+                }
+                case TokenType::Float: {
+                        double value;
+                        auto [end, error] = std::from_chars(field.begin(), field.end(), value);
+                        if (error != std::errc() || end != field.end())
+                                return false;
+                        m_floats.push_back(value);
+                        return true;
+                }
+                case TokenType::Bool:
+                        if (field != "True" && field != "False")
+                                return false;
+                        m_chars.push_back(field == "True");
+                        return true;
+                case TokenType::Char:
+                        if (field.size() != 1)
+                                return false;
+                        m_chars.push_back(field.front());
+                        return true;
+                case TokenType::String:
+                        m_strings.push_back(field);
+                        return true;
+                default:
+                        return false;
+        }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "io.h"
+#include "token.h"
+
+// Array data kept in a file of its own rather than written out as an array literal, which a program pulls in with
+//   int table[1000][4];
+//   table = load("table.bin");
+// Files ending in .bin hold the elements back to back in row-major order and in the host's byte order: an int64_t per
+// int, a double per float, and a byte per char or bool (any nonzero byte is True). They are mapped and used in place,
+// so checking one only compares its size against the declaration.
+// Any other file is read as CSV, with a line per element of the first extent and the product of the remaining extents
+// comma separated fields on each. Fields are written as in the source (True/False for bools), except that chars and
+// strings are taken as they are, without quotes or escapes. The fields are parsed in bulk into a packed buffer of the
+// element type.
+
+namespace pa {
+        class Table {
+        public: // Constructors/Destructors/Overloads
+                // Loads path as an array of element_type (Int, Float, Char, Bool or String) with extents outermost first
+                Table(const char* path, TokenType element_type, std::span<const size_t> extents);
+        public: // Public Member Functions
+                // Why the file doesn't match the declaration, empty if it does
+                [[nodiscard]] std::string_view error() const { return m_error; }
+                
+                // The elements, in row-major order, of whichever type the Table was loaded as
+                [[nodiscard]] std::span<const int64_t> ints() const;
+                [[nodiscard]] std::span<const double> floats() const;
+                [[nodiscard]] std::span<const char> chars() const;
+                [[nodiscard]] std::span<const char> bools() const { return chars(); }
+                [[nodiscard]] std::span<const std::string_view> strings() const { return m_strings; }
+                
+        public: // Public Member Variables
+        private: // Private Member Functions
+                void loadBinary(std::string_view path, size_t element_count);
+                void loadCsv(std::string_view path, std::span<const size_t> extents);
+                bool parseField(std::string_view field);
+        private: // Private Member Variables
+                TokenType m_element_type;
+                io::MappedFile m_file;
+                bool m_binary{false};
+                std::string m_error;
+                
+                // Only filled for CSV, binary files are read straight from the mapping
+                std::vector<int64_t> m_ints;
+                std::vector<double> m_floats;
+                std::vector<char> m_chars;
+                std::vector<std::string_view> m_strings; // Into the mapping
+        };
+}
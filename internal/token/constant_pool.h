@@ -0,0 +1,200 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "token.h"
+#include "flat_map.h"
+
+namespace pa {
+        // Every distinct literal value in a source, decoded once by the Lexer and referenced by Token::constant.
+        // Each kind of literal has its own index space: IntLiteral and Array extents index ints, FloatLiteral floats,
+        // CharLiteral chars and StringLiteral strings. Decoded strings live in large blocks that never move, so the
+        // views handed out stay valid for the lifetime of the pool, even if the pool itself is moved.
+        // Everything is constexpr so a pool can be filled during constant evaluation too.
+        class ConstantPool {
+        public: // Static Data
+                static constexpr size_t StringBlockSize = 1 << 16;
+        public: // Constructors/Destructors/Overloads
+                constexpr ConstantPool() { m_char_indices.fill(std::numeric_limits<uint32_t>::max()); }
+                ConstantPool(const ConstantPool&) = delete;
+                ConstantPool& operator=(const ConstantPool&) = delete;
+                constexpr ConstantPool(ConstantPool&&) = default;
+                constexpr ConstantPool& operator=(ConstantPool&&) = default;
+        public: // Public Member Functions
+                constexpr uint32_t addInt(int64_t value);
+                constexpr uint32_t addFloat(double value);
+                constexpr uint32_t addChar(char value);
+                constexpr uint32_t addString(std::string_view value);
+                
+                // Decodes the escape sequences in the body of a string literal (quotes excluded) straight into the pool
+                constexpr uint32_t addEscapedString(std::string_view escaped);
+                
+                // Adds the constant token refers to in other, returning its index in this pool
+                constexpr uint32_t addFrom(const ConstantPool& other, const Token& token);
+                
+                // Empties the pool, keeping its memory (and the current string block) for the next source
+                constexpr void clear();
+                
+                [[nodiscard]] constexpr int64_t intValue(uint32_t index) const { return m_ints[index]; }
+                [[nodiscard]] constexpr double floatValue(uint32_t index) const { return m_floats[index]; }
+                [[nodiscard]] constexpr char charValue(uint32_t index) const { return m_chars[index]; }
+                [[nodiscard]] constexpr std::string_view stringValue(uint32_t index) const { return m_strings[index]; }
+                
+                [[nodiscard]] constexpr std::span<const int64_t> ints() const { return m_ints; }
+                [[nodiscard]] constexpr std::span<const double> floats() const { return m_floats; }
+                [[nodiscard]] constexpr std::span<const char> chars() const { return m_chars; }
+                [[nodiscard]] constexpr std::span<const std::string_view> strings() const { return m_strings; }
+                
+                static constexpr bool hasConstant(TokenType type);
+                
+                // The character an escape sequence stands for, given the character after the backslash
+                static constexpr char unescape(const char escaped) {
+                        switch (escaped) {
+                                case 'n':
+                                        return '\n';
+                                case 't':
+                                        return '\t';
+                                case 'r':
+                                        return '\r';
+                                case '0':
+                                        return '\0';
+                                case 'a':
+                                        return '\a';
+                                case 'b':
+                                        return '\b';
+                                case 'f':
+                                        return '\f';
+                                case 'v':
+                                        return '\v';
+                                default: // \\, \', \" and anything else stand for themselves
+                                        return escaped;
+                        }
+                }
+        private: // Private Member Functions
+                constexpr char* reserveString(size_t size);
+                constexpr uint32_t internString(std::string_view value);
+        private: // Private Member Variables
+                std::vector<int64_t> m_ints;
+                FlatMap<int64_t, uint32_t> m_int_indices;
+                
+                std::vector<double> m_floats;
+                FlatMap<uint64_t, uint32_t> m_float_indices; // Keyed on the bit pattern so 0.0 and -0.0 stay apart
+                
+                std::vector<char> m_chars;
+                std::array<uint32_t, 256> m_char_indices{};
+                
+                std::vector<std::string_view> m_strings;
+                FlatMap<std::string_view, uint32_t> m_string_indices;
+                std::vector<std::unique_ptr<char[]>> m_string_blocks;
+                size_t m_block_used{0};
+                size_t m_block_size{0};
+        };
+}
+
+constexpr uint32_t pa::ConstantPool::addInt(const int64_t value) {
+        auto [index, inserted] = m_int_indices.tryEmplace(value, m_ints.size());
+        if (inserted)
+                m_ints.push_back(value);
+        return *index;
+}
+
+constexpr uint32_t pa::ConstantPool::addFloat(const double value) {
+        auto [index, inserted] = m_float_indices.tryEmplace(std::bit_cast<uint64_t>(value), m_floats.size());
+        if (inserted)
+                m_floats.push_back(value);
+        return *index;
+}
+
+constexpr uint32_t pa::ConstantPool::addChar(const char value) {
+        uint32_t& index = m_char_indices[static_cast<unsigned char>(value)];
+        if (index == std::numeric_limits<uint32_t>::max()) {
+                index = m_chars.size();
+                m_chars.push_back(value);
+        }
+        return index;
+}
+
+constexpr uint32_t pa::ConstantPool::addString(const std::string_view value) {
+        char* destination = reserveString(value.size());
+        std::copy_n(value.data(), value.size(), destination);
+        return internString({destination, value.size()});
+}
+
+constexpr uint32_t pa::ConstantPool::addEscapedString(const std::string_view escaped) {
+        // Decoding only ever shrinks a string, so decode in place at the end of the current block
+        char* destination = reserveString(escaped.size());
+        size_t size = 0;
+        for (size_t i = 0; i < escaped.size(); i++) {
+                if (escaped[i] == '\\' && i + 1 < escaped.size())
+                        destination[size++] = unescape(escaped[++i]);
+                else
+                        destination[size++] = escaped[i];
+        }
+        return internString({destination, size});
+}
+
+constexpr uint32_t pa::ConstantPool::addFrom(const pa::ConstantPool& other, const pa::Token& token) {
+        switch (token.type) {
+                case TokenType::IntLiteral:
+                case TokenType::Array:
+                        return addInt(other.intValue(token.constant));
+                case TokenType::FloatLiteral:
+                        return addFloat(other.floatValue(token.constant));
+                case TokenType::CharLiteral:
+                        return addChar(other.charValue(token.constant));
+                case TokenType::StringLiteral:
+                        return addString(other.stringValue(token.constant));
+                default:
+                        return 0;
+        }
+}
+
+constexpr void pa::ConstantPool::clear() {
+        m_ints.clear();
+        m_int_indices.clear();
+        m_floats.clear();
+        m_float_indices.clear();
+        m_chars.clear();
+        m_char_indices.fill(std::numeric_limits<uint32_t>::max());
+        m_strings.clear();
+        m_string_indices.clear();
+        
+        // m_block_size is the size of the newest block, so that is the one to keep
+        if (!m_string_blocks.empty()) {
+                std::swap(m_string_blocks.front(), m_string_blocks.back());
+                m_string_blocks.resize(1);
+        }
+        m_block_used = 0;
+}
+
+constexpr bool pa::ConstantPool::hasConstant(const pa::TokenType type) {
+        return type == TokenType::IntLiteral || type == TokenType::Array || type == TokenType::FloatLiteral || type == TokenType::CharLiteral || type == TokenType::StringLiteral;
+}
+
+
+// Room for size bytes at the end of the current block, only committed once internString keeps them.
+// Blocks are only as big as they need to be during constant evaluation, where every byte allocated costs compile time.
+constexpr char* pa::ConstantPool::reserveString(const size_t size) {
+        if (m_block_size - m_block_used < size) {
+                m_block_size = std::is_constant_evaluated() ? size : std::max(size, StringBlockSize);
+                m_block_used = 0;
+                m_string_blocks.push_back(std::make_unique<char[]>(m_block_size));
+        }
+        return m_string_blocks.empty() ? nullptr : m_string_blocks.back().get() + m_block_used;
+}
+
+constexpr uint32_t pa::ConstantPool::internString(const std::string_view value) {
+        auto [index, inserted] = m_string_indices.tryEmplace(value, m_strings.size());
+        if (inserted) {
+                m_strings.push_back(value);
+                m_block_used += value.size();
+        }
+        return *index;
+}
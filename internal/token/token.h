@@ -1,5 +1,9 @@
 #pragma once
+#include <bit>
 #include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
 #include <string_view>
 #include <iostream>
 
@@ -17,6 +21,7 @@ namespace pa {
                 Identifier,
                 Print,
                 Read,
+                Load,
                 Equals,
                 
                 // Literals
@@ -73,9 +78,13 @@ namespace pa {
         
         struct Token {
                 TokenType type{pa::TokenType::INVALID};
+                uint32_t constant{0}; // Index into the ConstantPool for literals and array extents
                 size_t start{0};
                 size_t end{0};
                 
+                constexpr Token() = default;
+                constexpr Token(const TokenType type, const size_t start, const size_t end, const uint32_t constant = 0) : type(type), constant(constant), start(start), end(end) {}
+                
                 static constexpr std::string_view typeToString(TokenType token_type) {
                         switch (token_type) {
                                 // Keywords
@@ -103,6 +112,8 @@ namespace pa {
                                         return "Print";
                                 case TokenType::Read:
                                         return "Read";
+                                case TokenType::Load:
+                                        return "Load";
                                 case TokenType::Equals:
                                         return "Equals";
                                 
@@ -187,7 +198,7 @@ namespace pa {
                         }
                 }
                 
-                [[nodiscard]] std::string_view toString(std::string_view src) const {
+                [[nodiscard]] constexpr std::string_view toString(std::string_view src) const {
                         return {src.begin() + start, end - start + 1};
                 }
                 
@@ -195,4 +206,43 @@ namespace pa {
                         std::cout << typeToString(type) << ": " << std::string_view(src.begin() + start, end - start + 1) << "\n";
                 }
         };
+        
+        // A set of token types as a bit per type, so testing a token against any number of them is a single AND
+        class TokenSet {
+        public: // Constructors/Destructors/Overloads
+                constexpr TokenSet() = default;
+                constexpr TokenSet(const TokenType type) : m_mask(bit(type)) {}
+                constexpr TokenSet(const std::initializer_list<TokenType> types) {
+                        for (TokenType type: types)
+                                m_mask |= bit(type);
+                }
+                
+                [[nodiscard]] constexpr TokenSet operator|(const TokenSet other) const { return fromMask(m_mask | other.m_mask); }
+                [[nodiscard]] constexpr bool operator==(const TokenSet&) const = default;
+        public: // Public Member Functions
+                [[nodiscard]] constexpr bool contains(const TokenType type) const { return (m_mask & bit(type)) != 0; }
+                [[nodiscard]] constexpr uint64_t mask() const { return m_mask; }
+                
+                // The types in the order they are declared in, separated by " | ", for diagnostics
+                [[nodiscard]] constexpr std::string toString() const {
+                        std::string types;
+                        for (uint64_t mask = m_mask; mask != 0; mask &= mask - 1) {
+                                if (!types.empty())
+                                        types += " | ";
+                                types += Token::typeToString(static_cast<TokenType>(std::countr_zero(mask)));
+                        }
+                        return types;
+                }
+        private: // Private Member Functions
+                static constexpr uint64_t bit(const TokenType type) { return uint64_t{1} << static_cast<unsigned>(type); }
+                static constexpr TokenSet fromMask(const uint64_t mask) {
+                        TokenSet set;
+                        set.m_mask = mask;
+                        return set;
+                }
+        private: // Private Member Variables
+                uint64_t m_mask{0};
+        };
+        
+        static_assert(static_cast<unsigned>(TokenType::ALL) < 64, "Every TokenType needs a bit of a TokenSet");
 }
\ No newline at end of file
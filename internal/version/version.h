@@ -0,0 +1,7 @@
+#pragma once
+#include <string_view>
+
+namespace pa {
+        // Bump whenever a change alters what the compiler accepts or produces, anything built by an older compiler is then rejected
+        inline constexpr std::string_view CompilerVersion = "0.10.0";
+}
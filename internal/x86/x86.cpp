@@ -0,0 +1,483 @@
+#include <cstring>
+#include <limits>
+#include "x86.h"
+
+namespace {
+        constexpr uint64_t Unbound = std::numeric_limits<uint64_t>::max();
+        
+        uint8_t code(const pa::x86::Register reg) { return static_cast<uint8_t>(reg); }
+        uint8_t code(const pa::x86::Xmm reg) { return static_cast<uint8_t>(reg); }
+        uint8_t code(const pa::x86::Ymm reg) { return static_cast<uint8_t>(reg); }
+        
+        bool fitsInt8(const int64_t value) { return value >= INT8_MIN && value <= INT8_MAX; }
+        bool fitsInt32(const int64_t value) { return value >= INT32_MIN && value <= INT32_MAX; }
+        
+        // spl, bpl, sil and dil can only be addressed with a REX prefix, without one they are ah, ch, dh and bh
+        bool needsRexForByte(const pa::x86::Register reg) { return code(reg) >= 4 && code(reg) < 8; }
+        
+        uint64_t addressOf(const pa::x86::Layout& layout, const pa::x86::Section section) {
+                switch (section) {
+                        case pa::x86::Section::Text:
+                                return layout.text;
+                        case pa::x86::Section::Rodata:
+                                return layout.rodata;
+                        case pa::x86::Section::Data:
+                                return layout.data;
+                        default:
+                                return layout.bss;
+                }
+        }
+        
+        std::string& bytesOf(pa::x86::Image& image, const pa::x86::Section section) {
+                switch (section) {
+                        case pa::x86::Section::Text:
+                                return image.text;
+                        case pa::x86::Section::Rodata:
+                                return image.rodata;
+                        default:
+                                return image.data;
+                }
+        }
+}
+
+void pa::x86::relocate(pa::x86::Image& image, const pa::x86::Layout& layout) {
+        for (const Relocation& relocation: image.relocations) {
+                char* field = bytesOf(image, relocation.section).data() + relocation.offset;
+                uint64_t target = addressOf(layout, relocation.target) + relocation.addend;
+                
+                if (relocation.kind == Relocation::Kind::Absolute64) {
+                        std::memcpy(field, &target, sizeof(target));
+                } else {
+                        auto value = static_cast<int32_t>(target - (addressOf(layout, relocation.section) + relocation.offset + 4));
+                        std::memcpy(field, &value, sizeof(value));
+                }
+        }
+}
+
+
+pa::x86::Label pa::x86::Assembler::newLabel() {
+        m_labels.push_back(Unbound);
+        return {static_cast<uint32_t>(m_labels.size() - 1)};
+}
+
+void pa::x86::Assembler::bind(const pa::x86::Label label) {
+        m_labels[label.id] = position();
+}
+
+uint64_t pa::x86::Assembler::addData(const pa::x86::Section section, const std::string_view bytes, const uint64_t alignment) {
+        std::string& data = bytesOf(m_image, section);
+        data.resize((data.size() + alignment - 1) / alignment * alignment);
+        uint64_t offset = data.size();
+        data += bytes;
+        return offset;
+}
+
+uint64_t pa::x86::Assembler::reserveBss(const uint64_t size, const uint64_t alignment) {
+        uint64_t offset = (m_image.bss_size + alignment - 1) / alignment * alignment;
+        m_image.bss_size = offset + size;
+        return offset;
+}
+
+void pa::x86::Assembler::addPointer(const pa::x86::Section section, const uint64_t offset, const pa::x86::Section target, const int64_t addend) {
+        m_image.relocations.push_back({Relocation::Kind::Absolute64, section, offset, target, addend});
+}
+
+pa::x86::Memory pa::x86::Assembler::global(const pa::x86::Section section, const uint64_t offset) const {
+        return {Register::None, Register::None, 1, static_cast<int32_t>(offset), section};
+}
+
+void pa::x86::Assembler::addSymbol(std::string name, const uint64_t offset, const uint64_t size, const uint32_t line) {
+        m_image.symbols.push_back({std::move(name), offset, size, line});
+}
+
+
+void pa::x86::Assembler::mov(const pa::x86::Register destination, const pa::x86::Register source) {
+        wideRegisters(0x89, source, destination);
+}
+
+void pa::x86::Assembler::mov(const pa::x86::Register destination, const int64_t immediate) {
+        if (immediate >= 0 && immediate <= UINT32_MAX) {
+                // Writing the low half zero extends, so this is the shortest form for small values
+                rex(false, 0, nullptr, code(destination));
+                emit(0xB8 + (code(destination) & 7));
+                emit32(static_cast<uint32_t>(immediate));
+        } else if (fitsInt32(immediate)) {
+                rex(true, 0, nullptr, code(destination));
+                emit(0xC7);
+                modrm(0, code(destination));
+                emit32(static_cast<uint32_t>(immediate));
+        } else {
+                rex(true, 0, nullptr, code(destination));
+                emit(0xB8 + (code(destination) & 7));
+                emit64(static_cast<uint64_t>(immediate));
+        }
+}
+
+void pa::x86::Assembler::load(const pa::x86::Register destination, const pa::x86::Memory& source, const int width) {
+        if (width == 1) {
+                rex(false, code(destination), &source, 0);
+                emit(0x0F);
+                emit(0xB6);
+        } else {
+                rex(true, code(destination), &source, 0);
+                emit(0x8B);
+        }
+        modrm(code(destination), source);
+}
+
+void pa::x86::Assembler::store(const pa::x86::Memory& destination, const pa::x86::Register source, const int width) {
+        if (width == 1) {
+                rex(false, code(source), &destination, 0, needsRexForByte(source));
+                emit(0x88);
+        } else {
+                rex(true, code(source), &destination, 0);
+                emit(0x89);
+        }
+        modrm(code(source), destination);
+}
+
+void pa::x86::Assembler::lea(const pa::x86::Register destination, const pa::x86::Memory& source) {
+        rex(true, code(destination), &source, 0);
+        emit(0x8D);
+        modrm(code(destination), source);
+}
+
+void pa::x86::Assembler::push(const pa::x86::Register source) {
+        rex(false, 0, nullptr, code(source));
+        emit(0x50 + (code(source) & 7));
+}
+
+void pa::x86::Assembler::pop(const pa::x86::Register destination) {
+        rex(false, 0, nullptr, code(destination));
+        emit(0x58 + (code(destination) & 7));
+}
+
+
+void pa::x86::Assembler::arithmetic(const pa::x86::Arithmetic operation, const pa::x86::Register destination, const pa::x86::Register source) {
+        wideRegisters(static_cast<uint8_t>(operation) << 3 | 1, source, destination);
+}
+
+void pa::x86::Assembler::arithmetic(const pa::x86::Arithmetic operation, const pa::x86::Register destination, const int32_t immediate) {
+        rex(true, 0, nullptr, code(destination));
+        emit(fitsInt8(immediate) ? 0x83 : 0x81);
+        modrm(static_cast<uint8_t>(operation), code(destination));
+        if (fitsInt8(immediate))
+                emit(static_cast<uint8_t>(immediate));
+        else
+                emit32(static_cast<uint32_t>(immediate));
+}
+
+void pa::x86::Assembler::test(const pa::x86::Register lhs, const pa::x86::Register rhs) {
+        wideRegisters(0x85, rhs, lhs);
+}
+
+void pa::x86::Assembler::imul(const pa::x86::Register destination, const pa::x86::Register source) {
+        rex(true, code(destination), nullptr, code(source));
+        emit(0x0F);
+        emit(0xAF);
+        modrm(code(destination), code(source));
+}
+
+void pa::x86::Assembler::imul(const pa::x86::Register destination, const pa::x86::Register source, const int32_t immediate) {
+        rex(true, code(destination), nullptr, code(source));
+        emit(fitsInt8(immediate) ? 0x6B : 0x69);
+        modrm(code(destination), code(source));
+        if (fitsInt8(immediate))
+                emit(static_cast<uint8_t>(immediate));
+        else
+                emit32(static_cast<uint32_t>(immediate));
+}
+
+void pa::x86::Assembler::cqo() {
+        emit(0x48);
+        emit(0x99);
+}
+
+void pa::x86::Assembler::idiv(const pa::x86::Register divisor) {
+        rex(true, 0, nullptr, code(divisor));
+        emit(0xF7);
+        modrm(7, code(divisor));
+}
+
+void pa::x86::Assembler::div(const pa::x86::Register divisor) {
+        rex(true, 0, nullptr, code(divisor));
+        emit(0xF7);
+        modrm(6, code(divisor));
+}
+
+void pa::x86::Assembler::neg(const pa::x86::Register destination) {
+        rex(true, 0, nullptr, code(destination));
+        emit(0xF7);
+        modrm(3, code(destination));
+}
+
+void pa::x86::Assembler::shift(const pa::x86::Shift shift, const pa::x86::Register destination, const uint8_t count) {
+        rex(true, 0, nullptr, code(destination));
+        emit(0xC1);
+        modrm(static_cast<uint8_t>(shift), code(destination));
+        emit(count);
+}
+
+void pa::x86::Assembler::set(const pa::x86::Condition condition, const pa::x86::Register destination) {
+        // setcc into the low byte, then movzx over the rest
+        rex(false, 0, nullptr, code(destination), needsRexForByte(destination));
+        emit(0x0F);
+        emit(0x90 + static_cast<uint8_t>(condition));
+        modrm(0, code(destination));
+        rex(false, code(destination), nullptr, code(destination), needsRexForByte(destination));
+        emit(0x0F);
+        emit(0xB6);
+        modrm(code(destination), code(destination));
+}
+
+void pa::x86::Assembler::bitTest(const pa::x86::BitTest operation, const pa::x86::Memory& bits, const pa::x86::Register index) {
+        rex(true, code(index), &bits, 0);
+        emit(0x0F);
+        emit(static_cast<uint8_t>(operation));
+        modrm(code(index), bits);
+}
+
+
+void pa::x86::Assembler::jump(const pa::x86::Label target) {
+        emit(0xE9);
+        rel32(target);
+}
+
+void pa::x86::Assembler::jump(const pa::x86::Condition condition, const pa::x86::Label target) {
+        emit(0x0F);
+        emit(0x80 + static_cast<uint8_t>(condition));
+        rel32(target);
+}
+
+void pa::x86::Assembler::call(const pa::x86::Label target) {
+        emit(0xE8);
+        rel32(target);
+}
+
+void pa::x86::Assembler::call(const pa::x86::Register target) {
+        rex(false, 0, nullptr, code(target));
+        emit(0xFF);
+        modrm(2, code(target));
+}
+
+void pa::x86::Assembler::ret() {
+        emit(0xC3);
+}
+
+void pa::x86::Assembler::syscall() {
+        emit(0x0F);
+        emit(0x05);
+}
+
+void pa::x86::Assembler::rdtsc() {
+        emit(0x0F);
+        emit(0x31);
+}
+
+void pa::x86::Assembler::repMovsb() {
+        emit(0xF3);
+        emit(0xA4);
+}
+
+void pa::x86::Assembler::repStosb() {
+        emit(0xF3);
+        emit(0xAA);
+}
+
+void pa::x86::Assembler::cpuid() {
+        emit(0x0F);
+        emit(0xA2);
+}
+
+void pa::x86::Assembler::xgetbv() {
+        emit(0x0F);
+        emit(0x01);
+        emit(0xD0);
+}
+
+void pa::x86::Assembler::popcnt(const pa::x86::Register destination, const pa::x86::Register source) {
+        emit(0xF3);
+        rex(true, code(destination), nullptr, code(source));
+        emit(0x0F);
+        emit(0xB8);
+        modrm(code(destination), code(source));
+}
+
+
+void pa::x86::Assembler::movq(const pa::x86::Xmm destination, const pa::x86::Register source) {
+        emit(0x66);
+        rex(true, code(destination), nullptr, code(source));
+        emit(0x0F);
+        emit(0x6E);
+        modrm(code(destination), code(source));
+}
+
+void pa::x86::Assembler::movq(const pa::x86::Register destination, const pa::x86::Xmm source) {
+        emit(0x66);
+        rex(true, code(source), nullptr, code(destination));
+        emit(0x0F);
+        emit(0x7E);
+        modrm(code(source), code(destination));
+}
+
+void pa::x86::Assembler::scalarDouble(const pa::x86::ScalarDouble operation, const pa::x86::Xmm destination, const pa::x86::Xmm source) {
+        emit(0xF2);
+        emit(0x0F);
+        emit(static_cast<uint8_t>(operation));
+        modrm(code(destination), code(source));
+}
+
+void pa::x86::Assembler::cvtsi2sd(const pa::x86::Xmm destination, const pa::x86::Register source) {
+        emit(0xF2);
+        rex(true, code(destination), nullptr, code(source));
+        emit(0x0F);
+        emit(0x2A);
+        modrm(code(destination), code(source));
+}
+
+void pa::x86::Assembler::cvttsd2si(const pa::x86::Register destination, const pa::x86::Xmm source) {
+        emit(0xF2);
+        rex(true, code(destination), nullptr, code(source));
+        emit(0x0F);
+        emit(0x2C);
+        modrm(code(destination), code(source));
+}
+
+void pa::x86::Assembler::ucomisd(const pa::x86::Xmm lhs, const pa::x86::Xmm rhs) {
+        emit(0x66);
+        emit(0x0F);
+        emit(0x2E);
+        modrm(code(lhs), code(rhs));
+}
+
+
+void pa::x86::Assembler::vmovupd(const pa::x86::Ymm destination, const pa::x86::Memory& source) {
+        vex(1, code(destination), &source, 0, 0);
+        emit(0x10);
+        modrm(code(destination), source);
+}
+
+void pa::x86::Assembler::vmovupd(const pa::x86::Memory& destination, const pa::x86::Ymm source) {
+        vex(1, code(source), &destination, 0, 0);
+        emit(0x11);
+        modrm(code(source), destination);
+}
+
+void pa::x86::Assembler::vbroadcastsd(const pa::x86::Ymm destination, const pa::x86::Memory& source) {
+        vex(2, code(destination), &source, 0, 0);
+        emit(0x19);
+        modrm(code(destination), source);
+}
+
+void pa::x86::Assembler::packed(const pa::x86::Packed operation, const pa::x86::Ymm destination, const pa::x86::Ymm lhs, const pa::x86::Ymm rhs) {
+        vex(1, code(destination), nullptr, code(rhs), code(lhs));
+        emit(static_cast<uint8_t>(operation));
+        modrm(code(destination), code(rhs));
+}
+
+void pa::x86::Assembler::packedShift(const pa::x86::PackedShift shift, const pa::x86::Ymm destination, const pa::x86::Ymm source, const uint8_t count) {
+        // The destination goes in vvvv, the /digit taking the place of a register
+        vex(1, 0, nullptr, code(source), code(destination));
+        emit(0x73);
+        modrm(static_cast<uint8_t>(shift), code(source));
+        emit(count);
+}
+
+void pa::x86::Assembler::vzeroupper() {
+        emit(0xC5);
+        emit(0xF8);
+        emit(0x77);
+}
+
+
+pa::x86::Image pa::x86::Assembler::finish(const pa::x86::Label entry) {
+        for (auto [field, label]: m_label_uses) {
+                auto value = static_cast<int32_t>(m_labels[label.id] - (field + 4));
+                std::memcpy(m_image.text.data() + field, &value, sizeof(value));
+        }
+        m_label_uses.clear();
+        
+        m_image.entry = offsetOf(entry);
+        return std::move(m_image);
+}
+
+
+void pa::x86::Assembler::emit32(const uint32_t value) {
+        for (int i = 0; i < 4; i++)
+                emit(value >> (8 * i));
+}
+
+void pa::x86::Assembler::emit64(const uint64_t value) {
+        for (int i = 0; i < 8; i++)
+                emit(value >> (8 * i));
+}
+
+void pa::x86::Assembler::rex(const bool wide, const uint8_t reg, const pa::x86::Memory* memory, const uint8_t rm, const bool force) {
+        uint8_t prefix = 0x40 | wide << 3 | (reg >> 3 & 1) << 2;
+        if (memory != nullptr) {
+                if (memory->index != Register::None)
+                        prefix |= (code(memory->index) >> 3 & 1) << 1;
+                if (memory->base != Register::None)
+                        prefix |= code(memory->base) >> 3 & 1;
+        } else {
+                prefix |= rm >> 3 & 1;
+        }
+        
+        if (prefix != 0x40 || force)
+                emit(prefix);
+}
+
+void pa::x86::Assembler::modrm(const uint8_t reg, const pa::x86::Memory& memory) {
+        if (memory.base == Register::None) {
+                // [rip + disp32], the displacement being filled in once the sections are placed
+                emit(0x05 | (reg & 7) << 3);
+                m_image.relocations.push_back({Relocation::Kind::Relative32, Section::Text, position(), memory.section, memory.displacement});
+                emit32(0);
+                return;
+        }
+        
+        uint8_t base = code(memory.base) & 7;
+        // rbp and r13 have no form without a displacement, that encoding being taken by [rip + disp32]
+        uint8_t mod = memory.displacement == 0 && base != 5 ? 0 : fitsInt8(memory.displacement) ? 1 : 2;
+        
+        if (memory.index != Register::None) {
+                uint8_t scale = memory.scale == 8 ? 3 : memory.scale == 4 ? 2 : memory.scale == 2 ? 1 : 0;
+                emit(mod << 6 | (reg & 7) << 3 | 4);
+                emit(scale << 6 | (code(memory.index) & 7) << 3 | base);
+        } else if (base == 4) {
+                // rsp and r12 as a base always need a SIB byte
+                emit(mod << 6 | (reg & 7) << 3 | 4);
+                emit(0x24);
+        } else {
+                emit(mod << 6 | (reg & 7) << 3 | base);
+        }
+        
+        if (mod == 1)
+                emit(static_cast<uint8_t>(memory.displacement));
+        else if (mod == 2)
+                emit32(static_cast<uint32_t>(memory.displacement));
+}
+
+void pa::x86::Assembler::vex(const uint8_t map, const uint8_t reg, const pa::x86::Memory* memory, const uint8_t rm, const uint8_t vvvv) {
+        // R, X, B and vvvv are all stored inverted
+        uint8_t index = 0, base = rm >> 3 & 1;
+        if (memory != nullptr) {
+                index = memory->index != Register::None ? code(memory->index) >> 3 & 1 : 0;
+                base = memory->base != Register::None ? code(memory->base) >> 3 & 1 : 0;
+        }
+        emit(0xC4);
+        emit((~reg >> 3 & 1) << 7 | (~index & 1) << 6 | (~base & 1) << 5 | map);
+        // W0, 256 bits, 66
+        emit((~vvvv & 0xF) << 3 | 1 << 2 | 1);
+}
+
+void pa::x86::Assembler::wideRegisters(const uint8_t opcode, const pa::x86::Register reg, const pa::x86::Register rm) {
+        rex(true, code(reg), nullptr, code(rm));
+        emit(opcode);
+        modrm(code(reg), code(rm));
+}
+
+void pa::x86::Assembler::rel32(const pa::x86::Label target) {
+        m_label_uses.emplace_back(position(), target);
+        emit32(0);
+}
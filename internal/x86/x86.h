@@ -0,0 +1,221 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Just enough of an x86-64 assembler for the native backend to emit machine code without an external toolchain.
+// An Assembler builds a whole Image at once: code goes into .text, constants into .rodata and .data, and zero filled
+// storage is reserved in .bss. Nothing has an address until the Image is laid out in memory, so references between
+// sections are recorded as relocations and patched by relocate() once the writer (or loader) has placed the sections.
+// Only the encodings the backend uses are supported, all operating on 64-bit registers unless a byte width is asked for.
+
+namespace pa::x86 {
+        enum class Register : uint8_t {
+                Rax, Rcx, Rdx, Rbx, Rsp, Rbp, Rsi, Rdi,
+                R8, R9, R10, R11, R12, R13, R14, R15,
+                None = 0xFF,
+        };
+        
+        enum class Xmm : uint8_t {
+                Xmm0, Xmm1, Xmm2, Xmm3,
+        };
+        
+        enum class Ymm : uint8_t {
+                Ymm0, Ymm1, Ymm2, Ymm3, Ymm4, Ymm5, Ymm6, Ymm7,
+                Ymm8, Ymm9, Ymm10, Ymm11, Ymm12, Ymm13, Ymm14, Ymm15,
+        };
+        
+        // In the order of their encoding in Jcc and SETcc
+        enum class Condition : uint8_t {
+                Overflow, NoOverflow, Below, AboveOrEqual, Equal, NotEqual, BelowOrEqual, Above,
+                Sign, NoSign, Parity, NoParity, Less, GreaterOrEqual, LessOrEqual, Greater,
+        };
+        
+        // The /digit of the group 1 immediate forms
+        enum class Arithmetic : uint8_t {
+                Add = 0, Or = 1, And = 4, Sub = 5, Xor = 6, Cmp = 7,
+        };
+        
+        enum class Shift : uint8_t {
+                Left = 4, LogicalRight = 5, ArithmeticRight = 7,
+        };
+        
+        // The second opcode byte of the bit string forms that take the bit offset in a register
+        enum class BitTest : uint8_t {
+                Test = 0xA3, Set = 0xAB, Reset = 0xB3,
+        };
+        
+        enum class ScalarDouble : uint8_t {
+                Add = 0x58, Multiply = 0x59, Subtract = 0x5C, Divide = 0x5E,
+        };
+        
+        // The opcode of the VEX.256.66.0F forms on four doubles or four quadwords. MultiplyUnsigned multiplies the low 32
+        // bits of each quadword into all 64 of it.
+        enum class Packed : uint8_t {
+                AddDouble = 0x58, MultiplyDouble = 0x59, SubtractDouble = 0x5C, DivideDouble = 0x5E,
+                AddInt = 0xD4, SubtractInt = 0xFB, MultiplyUnsigned = 0xF4,
+        };
+        
+        // The /digit of the quadword shifts by an immediate
+        enum class PackedShift : uint8_t {
+                Left = 6, LogicalRight = 2,
+        };
+        
+        enum class Section : uint8_t {
+                Text, Rodata, Data, Bss,
+        };
+        
+        struct Relocation {
+                enum class Kind : uint8_t {
+                        Relative32, // target - (address of the field + 4), for RIP relative operands and branches
+                        Absolute64, // target, for pointers stored in .rodata or .data
+                };
+                
+                Kind kind;
+                Section section; // Where the field is
+                uint64_t offset;
+                Section target;
+                int64_t addend;
+        };
+        
+        // Where each section of an Image is placed
+        struct Layout {
+                uint64_t text;
+                uint64_t rodata;
+                uint64_t data;
+                uint64_t bss;
+        };
+        
+        // A named range of .text, so profilers and debuggers can attribute addresses to the source they were compiled from
+        struct Symbol {
+                std::string name;
+                uint64_t offset;
+                uint64_t size;
+                uint32_t line{0}; // Of the source, 0 if it has none
+        };
+        
+        struct Image {
+                std::string text;
+                std::string rodata;
+                std::string data;
+                uint64_t bss_size{0};
+                uint64_t entry{0}; // Offset into .text
+                std::vector<Relocation> relocations;
+                std::vector<Symbol> symbols;
+        };
+        
+        // Patches every relocation in image for the sections being placed at layout
+        void relocate(Image& image, const Layout& layout);
+        
+        // [base + index * scale + displacement], or [rip + displacement] into section if base is None
+        struct Memory {
+                Register base{Register::None};
+                Register index{Register::None};
+                uint8_t scale{1};
+                int32_t displacement{0};
+                Section section{Section::Text};
+        };
+        
+        [[nodiscard]] constexpr Memory at(const Register base, const int32_t displacement = 0) { return {base, Register::None, 1, displacement}; }
+        [[nodiscard]] constexpr Memory at(const Register base, const Register index, const uint8_t scale, const int32_t displacement = 0) { return {base, index, scale, displacement}; }
+        
+        struct Label {
+                uint32_t id;
+        };
+        
+        class Assembler {
+        public: // Public Member Functions
+                [[nodiscard]] Label newLabel();
+                void bind(Label label);
+                [[nodiscard]] uint64_t offsetOf(Label label) const { return m_labels[label.id]; }
+                [[nodiscard]] uint64_t position() const { return m_image.text.size(); }
+                
+                // Appends bytes to .rodata or .data, returning their offset in it
+                uint64_t addData(Section section, std::string_view bytes, uint64_t alignment = 8);
+                uint64_t reserveBss(uint64_t size, uint64_t alignment = 8);
+                // Stores the address of target + addend at offset in section once the Image is placed
+                void addPointer(Section section, uint64_t offset, Section target, int64_t addend);
+                [[nodiscard]] Memory global(Section section, uint64_t offset) const;
+                void addSymbol(std::string name, uint64_t offset, uint64_t size, uint32_t line = 0);
+                
+                void mov(Register destination, Register source);
+                void mov(Register destination, int64_t immediate);
+                // Width is 1 (zero extended into destination) or 8
+                void load(Register destination, const Memory& source, int width = 8);
+                void store(const Memory& destination, Register source, int width = 8);
+                void lea(Register destination, const Memory& source);
+                void push(Register source);
+                void pop(Register destination);
+                
+                void arithmetic(Arithmetic operation, Register destination, Register source);
+                void arithmetic(Arithmetic operation, Register destination, int32_t immediate);
+                void test(Register lhs, Register rhs);
+                void imul(Register destination, Register source);
+                void imul(Register destination, Register source, int32_t immediate);
+                void cqo();
+                void idiv(Register divisor);
+                void div(Register divisor);
+                void neg(Register destination);
+                void shift(Shift shift, Register destination, uint8_t count);
+                // Sets destination to 1 if condition holds and 0 otherwise
+                void set(Condition condition, Register destination);
+                // Copies bit index of the bit string at bits into the carry flag, then (for Set and Reset) sets or clears it.
+                // The index is signed and can reach past the 8 bytes addressed, whole aligned quadwords being read and written.
+                void bitTest(BitTest operation, const Memory& bits, Register index);
+                
+                void jump(Label target);
+                void jump(Condition condition, Label target);
+                void call(Label target);
+                void call(Register target);
+                void ret();
+                void syscall();
+                // The time stamp counter, into edx:eax
+                void rdtsc();
+                void repMovsb();
+                void repStosb();
+                void cpuid();
+                // The extended control register ecx, into edx:eax
+                void xgetbv();
+                void popcnt(Register destination, Register source);
+                
+                void movq(Xmm destination, Register source);
+                void movq(Register destination, Xmm source);
+                void scalarDouble(ScalarDouble operation, Xmm destination, Xmm source);
+                void cvtsi2sd(Xmm destination, Register source);
+                void cvttsd2si(Register destination, Xmm source);
+                void ucomisd(Xmm lhs, Xmm rhs);
+                
+                // AVX2, on all 256 bits. Nothing has to be aligned.
+                void vmovupd(Ymm destination, const Memory& source);
+                void vmovupd(const Memory& destination, Ymm source);
+                void vbroadcastsd(Ymm destination, const Memory& source);
+                // destination = lhs operation rhs, lane by lane
+                void packed(Packed operation, Ymm destination, Ymm lhs, Ymm rhs);
+                void packedShift(PackedShift shift, Ymm destination, Ymm source, uint8_t count);
+                // Clears the upper halves, which would otherwise slow down the SSE code that follows
+                void vzeroupper();
+                
+                // Resolves the labels and hands over the Image, entry being where execution starts
+                [[nodiscard]] Image finish(Label entry);
+                
+        private: // Private Member Functions
+                void emit(uint8_t byte) { m_image.text.push_back(static_cast<char>(byte)); }
+                void emit32(uint32_t value);
+                void emit64(uint64_t value);
+                void rex(bool wide, uint8_t reg, const Memory* memory, uint8_t rm, bool force = false);
+                // ModRM (and SIB and displacement) for a memory operand, reg being the /r or /digit field
+                void modrm(uint8_t reg, const Memory& memory);
+                void modrm(uint8_t reg, uint8_t rm) { emit(0xC0 | (reg & 7) << 3 | (rm & 7)); }
+                // The three byte VEX prefix of a 256-bit 66-prefixed instruction in opcode map (1 for 0F, 2 for 0F38), with
+                // vvvv the extra source register
+                void vex(uint8_t map, uint8_t reg, const Memory* memory, uint8_t rm, uint8_t vvvv);
+                // opcode r/m64, r64 (or r64, r/m64 for the loads), always with REX.W
+                void wideRegisters(uint8_t opcode, Register reg, Register rm);
+                void rel32(Label target);
+        private: // Private Member Variables
+                Image m_image;
+                std::vector<uint64_t> m_labels;
+                std::vector<std::pair<uint64_t, Label>> m_label_uses; // Offsets of rel32 fields to patch with each label
+        };
+}
@@ -1,19 +1,475 @@
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+#include "alloc_counter.h"
+#include "batch.h"
+#include "batch_reader.h"
 #include "io.h"
 #include "parser.h"
+#include "parallel_lexer.h"
+#include "parallel_checker.h"
+#include "token_stream.h"
+#include "program.h"
+#include "cache.h"
+#include "context.h"
+#include "codegen.h"
+#include "elf_writer.h"
+#include "jit.h"
+#include "line_index.h"
 
-int main(int argc, char *argv[]) {
-        if (argc < 2) {
-                std::cout << "Usage: pa2 assets/src1.txt assets/src2.txt assets/src3.txt\n";
+struct Options {
+        bool parallel_lex = false;
+        bool verify_lex = false;
+        bool pipeline = false;
+        bool parallel_check = false;
+        bool emit_program = false;
+        bool use_program = false;
+        bool emit_elf = false;
+        bool profile = false;
+        bool run = false;
+        bool perf_map = false;
+        bool jitdump = false;
+        bool alloc_stats = false;
+        bool memory_report = false;
+        bool warm_start = false;
+        bool batch = false;
+        size_t max_errors = 1; // Only the default path goes on past errors, the others all stop at the first
+        
+        std::string cache_directory;
+        uint64_t cache_size = pa::CompilationCache::DefaultMaxSize;
+        bool cache_stats = false;
+        
+        // The flags that change what a compile produces, and so go into its cache key
+        [[nodiscard]] std::string cacheFlags() const {
+                std::string flags;
+                if (emit_program)
+                        flags += "--emit-program";
+                if (emit_elf)
+                        flags += "--emit-elf";
+                if (profile)
+                        flags += "--profile";
+                if (warm_start)
+                        flags += "--warm-start";
+                if (max_errors != 1)
+                        flags += std::format("--max-errors={}", max_errors);
+                return flags;
+        }
+        
+        // Whether the program is compiled natively, for --emit-elf, --run or --memory-report
+        [[nodiscard]] bool native() const {
+                return emit_elf || run || memory_report;
+        }
+};
+
+// What the backends have to say about a source, printed on lines of their own once its status line is out
+struct Notes {
+        std::string text;
+        bool failed_write = false; // An output couldn't be written, so the result isn't one to cache
+};
+
+// Where --emit-program writes, and --use-program looks for, the precompiled form of a source file
+static std::string programPathFor(const char* filepath) {
+        return (std::filesystem::path("output") / std::filesystem::path(filepath).stem()).string() + ".pap";
+}
+
+// Where --emit-elf writes the executable compiled from a source file
+static std::string executablePathFor(const char* filepath) {
+        return (std::filesystem::path("output") / std::filesystem::path(filepath).stem()).string();
+}
+
+// Runs (checker.*check)(), copying the files its load expressions pulled in into loaded_files whether or not it succeeds,
+// since an error can come from one of them as well
+template<typename Checker>
+static void checkRecordingLoads(Checker& checker, void (Checker::*check)(), std::vector<std::string>& loaded_files) {
+        try {
+                (checker.*check)();
+        } catch (const pa::CompileError&) {
+                loaded_files.assign(checker.loadedFiles().begin(), checker.loadedFiles().end());
+                throw;
+        }
+        loaded_files.assign(checker.loadedFiles().begin(), checker.loadedFiles().end());
+}
+
+// --use-program only compares a precompiled program against its source, so one that loads other files is never written
+static void emitProgram(const std::string& program_path, const std::string& source, std::span<const pa::Token> tokens, const pa::ConstantPool& constants,
+                        const pa::Parser::SymbolTable& symbol_table, const std::vector<std::string>& loaded_files, Notes& notes) {
+        if (!loaded_files.empty())
+                notes.text += std::format("Not writing the precompiled program, since it loads {}: {}\n", loaded_files.front(), program_path);
+        else if (!pa::PrecompiledProgram::write(program_path.c_str(), source, tokens, constants, symbol_table)) {
+                notes.text += std::format("Failed to write the precompiled program: {}\n", program_path);
+                notes.failed_write = true;
+        }
+}
+
+// --memory-report lists the storage of every variable of a native program, and how much of it is mapped only when declared
+static void reportMemory(const std::vector<pa::CodeGenerator::VariableMemory>& usage, Notes& notes) {
+        uint64_t bytes = 0, mapped = 0, image_bytes = 0;
+        for (const pa::CodeGenerator::VariableMemory& variable: usage) {
+                bytes += variable.bytes;
+                mapped += variable.mapped ? variable.bytes : 0;
+                image_bytes += variable.image_bytes;
+        }
+        notes.text += std::format("Memory: {} bytes of variables, {} of them mapped and only backed once written, {} bytes of .rodata images\n",
+                                  bytes, mapped, image_bytes);
+        for (const pa::CodeGenerator::VariableMemory& variable: usage) {
+                std::string location = variable.line != 0 ? std::format("{}:{} ", variable.line, variable.column) : "";
+                notes.text += std::format("  {}{}: {} bytes {}, {} bytes of images\n", location, variable.declaration, variable.bytes,
+                                          variable.mapped ? "mapped" : "in .bss", variable.image_bytes);
+        }
+}
+
+// --warm-start runs a native program as far as its first read once, for the program written or run to start out there.
+// A program that doesn't get there, or has too much to put back, goes without. Throws a pa::CompileError if the program
+// can't be compiled natively at all.
+static std::optional<pa::CodeGenerator::Snapshot> takeSnapshot(const std::string& executable_path, const std::string& source, std::span<const pa::Token> tokens,
+                                                               const pa::ConstantPool& constants, const Options& options, Notes& notes) {
+        std::string name = std::filesystem::path(executable_path).filename().string();
+        pa::CodeGenerator generator(source, tokens, constants, name, options.profile);
+        pa::jit::StoppedProgram program(generator.generateStopping(), {name});
+        if (!program.stopped()) {
+                notes.text += std::format("Not warm starting: the program exited with status {} before its first read\n", program.status());
+                return std::nullopt;
+        }
+        try {
+                return generator.capture(program);
+        } catch (const pa::CompileError& compile_error) {
+                notes.text += std::format("Not warm starting: {}\n", pa::LineIndex(source).annotate(compile_error));
+                return std::nullopt;
+        }
+}
+
+// Compiles a checked program natively for --emit-elf to write, --run to run and --memory-report to report on. A program the native backend can't
+// compile is still a valid program, so it only goes without an executable, and one left over from an earlier version of
+// the source is removed rather than left looking current.
+static std::optional<pa::x86::Image> generateNative(const std::string& executable_path, const std::string& source, std::span<const pa::Token> tokens, const pa::ConstantPool& constants,
+                                                    const Options& options, Notes& notes) {
+        try {
+                std::optional<pa::CodeGenerator::Snapshot> snapshot;
+                if (options.warm_start)
+                        snapshot = takeSnapshot(executable_path, source, tokens, constants, options, notes);
+                pa::CodeGenerator generator(source, tokens, constants, std::filesystem::path(executable_path).filename().string(), options.profile);
+                pa::x86::Image image = snapshot ? generator.generateResuming(*snapshot) : generator.generate();
+                if (options.memory_report)
+                        reportMemory(generator.memoryUsage(), notes);
+                if (options.emit_elf && !pa::elf::writeExecutable(executable_path.c_str(), image)) {
+                        notes.text += std::format("Failed to write the executable: {}\n", executable_path);
+                        notes.failed_write = true;
+                }
+                return image;
+        } catch (const pa::CompileError& compile_error) {
+                if (options.emit_elf) {
+                        std::error_code ignored;
+                        std::filesystem::remove(executable_path, ignored);
+                        notes.text += std::format("Not writing the executable {}: {}\n", executable_path, pa::LineIndex(source).annotate(compile_error));
+                } else
+                        notes.text += std::format("Not compiling natively: {}\n", pa::LineIndex(source).annotate(compile_error));
+                return std::nullopt;
+        }
+}
+
+// Compiles a checked program into steps for --batch to run over the records of stdin. Like one the native backend can't
+// compile, a program that doesn't fit in batches is still valid and only goes without them.
+static void generateBatch(const std::string& source, std::span<const pa::Token> tokens, const pa::ConstantPool& constants, std::optional<pa::BatchRunner>& batch,
+                          Notes& notes) {
+        try {
+                batch.emplace(source, tokens, constants);
+        } catch (const pa::CompileError& compile_error) {
+                notes.text += std::format("Not running in batches: {}\n", pa::LineIndex(source).annotate(compile_error));
+        }
+}
+
+// Checks a single source, throwing a pa::CompileError if it doesn't. context is reused from one source to the next.
+// loaded_files receives the files the result depends on besides the source, image the native program and batch the
+// batched one if they were asked for, and notes what the backends have to say, to be printed once the source is done.
+static void compile(const std::string& source, const Options& options, const std::string& program_path, const std::string& executable_path, pa::CompilationContext& context,
+                    std::vector<std::string>& loaded_files, std::optional<pa::x86::Image>& image, std::optional<pa::BatchRunner>& batch, Notes& notes) {
+        bool native = options.native();
+        if (options.parallel_lex) {
+                pa::ParallelLexer lexer(source, std::thread::hardware_concurrency(), pa::ErrorMode::Throw);
+                std::vector<pa::Token> tokens = options.verify_lex ? lexer.tokenizeAndVerify() : lexer.tokenize();
+                std::shared_ptr<pa::ConstantPool> constants = lexer.constants();
+                
+                // A lexing error is raised once the Parser gets to it, so that errors before it come first
+                pa::Parser parser(source, tokens, *constants, pa::ErrorMode::Throw, lexer.lexError() ? &*lexer.lexError() : nullptr);
+                checkRecordingLoads(parser, &pa::Parser::parseProgram, loaded_files);
+                
+                if (options.emit_program)
+                        emitProgram(program_path, source, tokens, *constants, parser.symbolTable(), loaded_files, notes);
+                if (native)
+                        image = generateNative(executable_path, source, tokens, *constants, options, notes);
+                if (options.batch)
+                        generateBatch(source, tokens, *constants, batch, notes);
+        } else if (options.pipeline) {
+                pa::TokenStream stream(source, options.emit_program || native || options.batch);
+                pa::Parser parser(source, stream, pa::ErrorMode::Throw);
+                checkRecordingLoads(parser, &pa::Parser::parseProgram, loaded_files);
+                
+                if (options.emit_program)
+                        emitProgram(program_path, source, stream.tokens(), stream.constants(), parser.symbolTable(), loaded_files, notes);
+                if (native)
+                        image = generateNative(executable_path, source, stream.tokens(), stream.constants(), options, notes);
+                if (options.batch)
+                        generateBatch(source, stream.tokens(), stream.constants(), batch, notes);
+        } else if (options.parallel_check && !options.emit_program && !native && !options.batch) {
+                pa::ParallelChecker checker(source, std::thread::hardware_concurrency(), pa::ErrorMode::Throw);
+                checkRecordingLoads(checker, &pa::ParallelChecker::checkProgram, loaded_files);
+        } else {
+                const pa::CompilationContext::Result& result = context.compile(source, options.max_errors);
+                loaded_files.assign(context.loadedFiles().begin(), context.loadedFiles().end());
+                if (!result.succeeded && result.errors.size() == 1)
+                        throw pa::CompileError{result.diagnostic, result.position};
+                if (!result.succeeded) {
+                        std::string diagnostics = pa::LineIndex(source).annotate(result.errors);
+                        if (result.errors.size() == options.max_errors)
+                                diagnostics += std::format("\nStopped after {} errors.", options.max_errors);
+                        throw pa::CompileError{std::move(diagnostics)};
+                }
+                
+                if (options.emit_program)
+                        emitProgram(program_path, source, context.tokens(), context.constants(), context.symbolTable(), loaded_files, notes);
+                if (native)
+                        image = generateNative(executable_path, source, context.tokens(), context.constants(), options, notes);
+                if (options.batch)
+                        generateBatch(source, context.tokens(), context.constants(), batch, notes);
+        }
+}
+
+// Runs the backends asked for off an up to date precompiled program, which was checked when it was written. They walk the
+// tokens and constants mapped from it, where compile would have them from the Parser.
+static void compilePrecompiled(const pa::PrecompiledProgram& precompiled, const std::string& source, const Options& options, const std::string& executable_path,
+                               std::optional<pa::x86::Image>& image, std::optional<pa::BatchRunner>& batch, pa::ConstantPool& constants, Notes& notes) {
+        constants = precompiled.constants();
+        if (options.native())
+                image = generateNative(executable_path, source, precompiled.tokens(), constants, options, notes);
+        if (options.batch)
+                generateBatch(source, precompiled.tokens(), constants, batch, notes);
+}
+
+// Leaves the outputs and notes of a cached result as compiling the source again would have
+static void replayCached(const pa::CompilationCache::Entry& entry, const Options& options, const std::string& program_path, const std::string& executable_path,
+                         Notes& notes) {
+        notes.text += entry.notes;
+        bool has_executable = false;
+        for (const auto& artifact: entry.artifacts) {
+                if (artifact.name == "program" && !pa::io::writeFileAtomic(program_path.c_str(), artifact.data)) {
+                        notes.text += std::format("Failed to write the precompiled program: {}\n", program_path);
+                        notes.failed_write = true;
+                } else if (artifact.name == "executable") {
+                        has_executable = true;
+                        if (!pa::io::writeFileAtomic(executable_path.c_str(), artifact.data, 0755)) {
+                                notes.text += std::format("Failed to write the executable: {}\n", executable_path);
+                                notes.failed_write = true;
+                        }
+                }
+        }
+        
+        // A checked program the native backend couldn't compile, whose stale executable generateNative removed
+        if (entry.succeeded && options.emit_elf && !has_executable) {
+                std::error_code ignored;
+                std::filesystem::remove(executable_path, ignored);
+        }
+}
+
+// --alloc-stats lexes and parses a checked source twice, the second time reusing the buffers of the first, and reports
+// what each phase allocated both times along with every statement that still allocated once warm. Returns whether none did.
+static bool reportAllocations(const std::string& source) {
+        if (!pa::alloc::Counting) {
+                std::cout << "Allocation counting isn't compiled in, build with -DPA_COUNT_ALLOCATIONS\n";
+                return true;
+        }
+        
+        pa::alloc::Measurement measurement = pa::alloc::measureLexAndParse(source);
+        for (auto [name, pass]: {std::pair{"cold", &measurement.cold}, std::pair{"warm", &measurement.warm}}) {
+                pa::alloc::Counts parsing = pass->resetting;
+                parsing += pass->parsing;
+                std::cout << std::format("Allocations ({}): lexing {} ({} bytes), parsing {} ({} bytes), {} of the statements allocating\n",
+                                         name, pass->lexing.allocations, pass->lexing.bytes, parsing.allocations, parsing.bytes, pass->allocating_statements.size());
+        }
+        
+        pa::LineIndex lines(source);
+        for (const auto& [start, statement]: measurement.warm.allocating_statements) {
+                pa::LineIndex::Location location = lines.locate(start);
+                std::cout << std::format("  {}:{}: {} allocations ({} bytes) once warm\n", location.line, location.column, statement.allocations, statement.bytes);
+        }
+        return measurement.warm.allocating_statements.empty();
+}
+
+static void reportCacheStatistics(pa::CompilationCache& cache) {
+        auto run = cache.statistics();
+        auto total = cache.flushStatistics();
+        std::cout << std::format("Cache: {} hits, {} misses, {} stores, {} evictions (all time: {} hits, {} misses, {} stores, {} evictions)\n",
+                                 run.hits, run.misses, run.stores, run.evictions,
+                                 total.hits, total.misses, total.stores, total.evictions);
+}
+
+// Compiles the filepaths[index] read by reader, as a coroutine so that it can wait for the read while the reader goes on
+// with reading the files after it
+static pa::io::Task compileFile(pa::io::BatchReader& reader, size_t index, const char* filepath, const Options& options, pa::CompilationCache* cache,
+                                pa::CompilationContext& context) {
+        std::cout << filepath << ": ";
+        pa::io::BatchReader::File& file = co_await reader.read(index);
+        std::cout << file.error;
+        std::string source = std::move(file.contents);
+        std::string program_path = programPathFor(filepath);
+        std::string executable_path = executablePathFor(filepath);
+        
+        // Only successfully checked programs are ever written, so an up to date one needs no further work unless a backend
+        // or report was asked for
+        std::optional<pa::PrecompiledProgram> precompiled;
+        if (options.use_program)
+                precompiled = pa::PrecompiledProgram::map(program_path.c_str(), source);
+        if (precompiled && !options.native() && !options.batch && !options.alloc_stats) {
+                std::cout << "Parsed Successfully!\n";
+                co_return;
+        }
+        
+        // Running, reporting memory and batching need the program itself, which the cache doesn't keep
+        bool cacheable = cache && !options.run && !options.memory_report && !options.batch;
+        pa::CompilationCache::Key cache_key;
+        std::optional<pa::CompilationCache::Entry> result;
+        std::optional<pa::x86::Image> image;
+        std::optional<pa::BatchRunner> batch;
+        pa::ConstantPool precompiled_constants;
+        Notes notes;
+        if (precompiled) {
+                result.emplace();
+                result->succeeded = true;
+                compilePrecompiled(*precompiled, source, options, executable_path, image, batch, precompiled_constants, notes);
+        } else {
+                if (cacheable) {
+                        cache_key = pa::CompilationCache::key(source, options.cacheFlags());
+                        result = cache->lookup(cache_key);
+                }
+                
+                if (result)
+                        replayCached(*result, options, program_path, executable_path, notes);
+                else {
+                        result.emplace();
+                        std::vector<std::string> loaded_files;
+                        try {
+                                compile(source, options, program_path, executable_path, context, loaded_files, image, batch, notes);
+                                result->succeeded = true;
+                        } catch (const pa::CompileError& compile_error) {
+                                result->diagnostics = pa::LineIndex(source).annotate(compile_error);
+                        }
+                        
+                        // The cache is keyed on the source alone, so it can't hold a result that depends on other files, nor
+                        // one whose outputs couldn't all be written
+                        if (cacheable && loaded_files.empty() && !notes.failed_write) {
+                                if (result->succeeded && options.emit_program)
+                                        result->artifacts.push_back({"program", std::string(pa::io::MappedFile(program_path.c_str()).bytes())});
+                                if (result->succeeded && options.emit_elf && std::filesystem::exists(executable_path))
+                                        result->artifacts.push_back({"executable", std::string(pa::io::MappedFile(executable_path.c_str()).bytes())});
+                                result->notes = notes.text;
+                                cache->store(cache_key, *result);
+                        }
+                }
+        }
+        
+        if (!result->succeeded) {
+                std::cout << result->diagnostics << "\n" << notes.text;
+                if (cache && options.cache_stats)
+                        reportCacheStatistics(*cache);
                 std::exit(EXIT_FAILURE);
         }
+        std::cout << "Parsed Successfully!\n" << notes.text;
+        
+        if (options.alloc_stats && !reportAllocations(source))
+                std::exit(EXIT_FAILURE);
+        if (options.run && image) {
+                int status = pa::jit::run(*image, {executable_path, std::filesystem::absolute(filepath).string(), options.perf_map, options.jitdump});
+                if (status < 0)
+                        std::cout << "Failed to run " << filepath << "\n";
+                else if (status != 0)
+                        std::cout << filepath << " exited with status " << status << "\n";
+        }
+        if (batch) {
+                // The records are written straight to the descriptor, after whatever is still buffered
+                std::cout.flush();
+                batch->run(STDIN_FILENO, STDOUT_FILENO);
+        }
+}
+
+int main(int argc, char *argv[]) {
+        Options options;
+        std::vector<const char*> filepaths;
+        
+        if (const char* cache_directory = std::getenv("PA_CACHE_DIR"))
+                options.cache_directory = cache_directory;
         
         for (size_t i = 1; i < argc; i++) {
-                std::cout << argv[i] << ": ";
-                std::string source = pa::io::readFile(argv[i]);
-                pa::Parser parser(source);
-                parser.parseProgram();
-                std::cout << "Parsed Successfully!\n";
+                std::string_view arg = argv[i];
+                if (arg == "--parallel-lex")
+                        options.parallel_lex = true;
+                else if (arg == "--verify-lex")
+                        options.parallel_lex = options.verify_lex = true;
+                else if (arg == "--pipeline")
+                        options.pipeline = true;
+                else if (arg == "--parallel-check")
+                        options.parallel_check = true;
+                else if (arg == "--emit-program")
+                        options.emit_program = true;
+                else if (arg == "--use-program")
+                        options.use_program = true;
+                else if (arg == "--emit-elf")
+                        options.emit_elf = true;
+                else if (arg == "--profile")
+                        options.profile = options.emit_elf = true;
+                else if (arg == "--run")
+                        options.run = true;
+                else if (arg == "--perf-map")
+                        options.perf_map = options.run = true;
+                else if (arg == "--jitdump")
+                        options.jitdump = options.run = true;
+                else if (arg.starts_with("--cache-dir="))
+                        options.cache_directory = arg.substr(std::string_view("--cache-dir=").size());
+                else if (arg.starts_with("--cache-size="))
+                        options.cache_size = std::strtoull(argv[i] + std::string_view("--cache-size=").size(), nullptr, 10);
+                else if (arg == "--alloc-stats")
+                        options.alloc_stats = true;
+                else if (arg == "--memory-report")
+                        options.memory_report = true;
+                else if (arg == "--warm-start")
+                        options.warm_start = true;
+                else if (arg.starts_with("--max-errors="))
+                        options.max_errors = std::max<size_t>(1, std::strtoull(argv[i] + std::string_view("--max-errors=").size(), nullptr, 10));
+                else if (arg == "--batch")
+                        options.batch = true;
+                else if (arg == "--cache-stats")
+                        options.cache_stats = true;
+                else
+                        filepaths.push_back(argv[i]);
+        }
+        
+        if (filepaths.empty()) {
+                std::cout << "Usage: pa2 [--parallel-lex] [--verify-lex] [--pipeline] [--parallel-check] [--emit-program] [--use-program] [--emit-elf] [--profile] [--run] [--perf-map] [--jitdump] [--alloc-stats] [--memory-report] [--warm-start] [--batch] [--max-errors=N] [--cache-dir=DIR] [--cache-size=BYTES] [--cache-stats] assets/src1.txt assets/src2.txt assets/src3.txt\n";
+                std::exit(EXIT_FAILURE);
         }
+        
+        // A warm start only changes the program written or run, so without either it would run the program up to its first
+        // read for nothing
+        if (options.warm_start && !options.emit_elf && !options.run) {
+                std::cout << "--warm-start needs --emit-elf or --run\n";
+                std::exit(EXIT_FAILURE);
+        }
+        
+        std::unique_ptr<pa::CompilationCache> cache;
+        if (!options.cache_directory.empty())
+                cache = std::make_unique<pa::CompilationCache>(options.cache_directory, options.cache_size);
+        
+        pa::CompilationContext context;
+        pa::io::BatchReader reader(filepaths);
+        for (size_t i = 0; i < filepaths.size(); i++) {
+                // One file at a time, so the output stays in order and the first failing file ends the batch
+                pa::io::Task task = compileFile(reader, i, filepaths[i], options, cache.get(), context);
+                while (!task.done())
+                        reader.poll();
+        }
+        
+        if (cache && options.cache_stats)
+                reportCacheStatistics(*cache);
 
 	return 0;
-}
\ No newline at end of file
+}